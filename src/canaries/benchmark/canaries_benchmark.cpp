@@ -20,7 +20,9 @@
 
 #include <boost/log/trivial.hpp>
 
+#include <canaries/ClockRead.hpp>
 #include <canaries/Loops.hpp>
+#include <canaries/SleepError.hpp>
 
 namespace genny::testing {
 namespace {
@@ -125,5 +127,47 @@ TEST_CASE("Measure Phaseloop Overhead", "[benchmark]") {
         validateTimingRange(l3Res, "l3");
     }
 }
+
+TEST_CASE("Measure sleep error", "[benchmark]") {
+    using namespace std::chrono_literals;
+    using Mode = v1::SleepOptions::Mode;
+
+    auto measure = [](Mode mode) {
+        v1::SleepOptions options;
+        options.mode = mode;
+        const auto error = measureSleepError(20us, 1000, options);
+        BOOST_LOG_TRIVIAL(info) << (mode == Mode::kPrecise ? "precise" : "coarse")
+                                << " 20us sleep error: p50=" << error.p50
+                                << "ns p99=" << error.p99 << "ns max=" << error.max << "ns";
+        return error;
+    };
+
+    const auto coarse = measure(Mode::kCoarse);
+    const auto precise = measure(Mode::kPrecise);
+
+    // Neither wakes up early.
+    REQUIRE(coarse.p50 >= 0);
+    REQUIRE(precise.p50 >= 0);
+
+    // Timer slack alone is 50us so coarse sleeps typically overshoot by more than the whole
+    // sleep. Precise sleeps should be within a few microseconds.
+    REQUIRE(precise.p50 < coarse.p50);
+    REQUIRE(precise.p50 < 10 * 1000);
+}
+
+TEST_CASE("Measure clock reads", "[benchmark]") {
+    const auto cost = measureClockReads(10 * 1000 * 1000);
+    BOOST_LOG_TRIVIAL(info) << "steady_clock read: " << cost.steady << "ps";
+    if (!cost.tsc) {
+        BOOST_LOG_TRIVIAL(info) << "No invariant TSC";
+        return;
+    }
+    BOOST_LOG_TRIVIAL(info) << "TSC clock read: " << *cost.tsc << "ps";
+
+    // steady_clock reads the TSC too when the kernel trusts it, so the TSC clock's calibration
+    // can make it a little slower. Elsewhere it should be several times faster.
+    REQUIRE(*cost.tsc < 2 * cost.steady);
+}
+
 }  // namespace
 }  // namespace genny::testing
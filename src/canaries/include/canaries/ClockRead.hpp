@@ -0,0 +1,43 @@
+// Copyright 2022-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef HEADER_2B7E9D40_5C1A_4E86_A3F1_0D8B6C4E72A9_INCLUDED
+#define HEADER_2B7E9D40_5C1A_4E86_A3F1_0D8B6C4E72A9_INCLUDED
+
+#include <cstdint>
+#include <optional>
+
+namespace genny::canaries {
+
+/**
+ * How long one read of each clock the metrics can use took, in picoseconds.
+ */
+struct ClockReadCost {
+    int64_t steady;
+
+    // Unset if the CPU's TSC isn't invariant.
+    std::optional<int64_t> tsc;
+};
+
+/**
+ * Read steady_clock and then the calibrated TSC clock `iterations` times each.
+ *
+ * Use this to see how much the `Metrics: Clock` setting saves on a given machine. It's the
+ * most on VMs whose kernel reads time from a slower clocksource than the TSC.
+ */
+ClockReadCost measureClockReads(int64_t iterations);
+
+}  // namespace genny::canaries
+
+#endif  // HEADER_2B7E9D40_5C1A_4E86_A3F1_0D8B6C4E72A9_INCLUDED
@@ -0,0 +1,49 @@
+// Copyright 2022-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef HEADER_5D1B8E27_9C4F_4A63_B0E2_7F3A6C19D854_INCLUDED
+#define HEADER_5D1B8E27_9C4F_4A63_B0E2_7F3A6C19D854_INCLUDED
+
+#include <chrono>
+#include <cstdint>
+
+#include <gennylib/v1/FiberPool.hpp>
+
+namespace genny::canaries {
+
+/**
+ * How much longer than requested a sleep took, in nanoseconds.
+ */
+struct SleepError {
+    int64_t p50;
+    int64_t p90;
+    int64_t p99;
+    int64_t p999;
+    int64_t max;
+};
+
+/**
+ * Sleep for `requested` `iterations` times using genny::v1::sleepFor() with the given
+ * options and report the distribution of the overshoot.
+ *
+ * Use this to choose between Coarse and Precise `Execution: Sleep` settings for a
+ * workload with short `SleepBefore`/`SleepAfter` durations or high `GlobalRate`s.
+ */
+SleepError measureSleepError(std::chrono::nanoseconds requested,
+                             int64_t iterations,
+                             const v1::SleepOptions& options);
+
+}  // namespace genny::canaries
+
+#endif  // HEADER_5D1B8E27_9C4F_4A63_B0E2_7F3A6C19D854_INCLUDED
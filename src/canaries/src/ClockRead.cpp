@@ -0,0 +1,55 @@
+// Copyright 2022-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <canaries/ClockRead.hpp>
+
+#include <chrono>
+
+#include <metrics/v1/TscClock.hpp>
+
+namespace genny::canaries {
+
+namespace {
+
+// Picoseconds per call of `read`.
+template <typename Read>
+int64_t costOf(Read&& read, int64_t iterations) {
+    using SteadyClock = std::chrono::steady_clock;
+
+    // Summing the reads keeps the compiler from dropping them.
+    SteadyClock::duration sum{};
+    const auto before = SteadyClock::now();
+    for (int64_t i = 0; i < iterations; ++i) {
+        sum += read().time_since_epoch();
+    }
+    const auto took = SteadyClock::now() - before;
+    volatile auto keep = sum.count();
+    (void)keep;
+    return iterations <= 0
+        ? 0
+        : std::chrono::duration_cast<std::chrono::nanoseconds>(took).count() * 1000 / iterations;
+}
+
+}  // namespace
+
+ClockReadCost measureClockReads(int64_t iterations) {
+    ClockReadCost cost;
+    cost.steady = costOf([]() { return std::chrono::steady_clock::now(); }, iterations);
+    if (const auto* tsc = metrics::internals::v1::TscClock::invariant(); tsc) {
+        cost.tsc = costOf([&]() { return tsc->now(); }, iterations);
+    }
+    return cost;
+}
+
+}  // namespace genny::canaries
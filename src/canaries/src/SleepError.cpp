@@ -0,0 +1,51 @@
+// Copyright 2022-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <canaries/SleepError.hpp>
+
+#include <algorithm>
+#include <vector>
+
+namespace genny::canaries {
+
+SleepError measureSleepError(std::chrono::nanoseconds requested,
+                             int64_t iterations,
+                             const v1::SleepOptions& options) {
+    using SteadyClock = std::chrono::steady_clock;
+
+    v1::setSleepOptions(options);
+
+    std::vector<int64_t> errors;
+    errors.reserve(iterations);
+    for (int64_t i = 0; i < iterations; ++i) {
+        const auto before = SteadyClock::now();
+        v1::sleepFor(requested);
+        const auto slept = SteadyClock::now() - before;
+        errors.push_back((slept - requested).count());
+    }
+
+    // Don't leave the process in a mode the caller didn't ask for.
+    v1::setSleepOptions(v1::SleepOptions{});
+
+    if (errors.empty()) {
+        return SleepError{};
+    }
+    std::sort(errors.begin(), errors.end());
+    auto at = [&](double percentile) {
+        return errors[size_t(percentile / 100 * (errors.size() - 1))];
+    };
+    return SleepError{at(50), at(90), at(99), at(99.9), errors.back()};
+}
+
+}  // namespace genny::canaries
@@ -21,7 +21,9 @@
 #include <boost/filesystem.hpp>
 #include <boost/program_options.hpp>
 
+#include <canaries/ClockRead.hpp>
 #include <canaries/Loops.hpp>
+#include <canaries/SleepError.hpp>
 #include <gennylib/InvalidConfigurationException.hpp>
 
 using namespace genny;
@@ -43,6 +45,7 @@ struct ProgramOptions {
     bool _isHelp = false;
 
     int64_t _iterations = 0;
+    std::chrono::microseconds _sleepFor{0};
     std::chrono::seconds _logEverySeconds{0};
 
     std::string _description;
@@ -70,6 +73,14 @@ struct ProgramOptions {
     l3       Traverse through a 8MB array in 64KB strides; stress the CPU's L3 cache
              and/or RAM depending the CPU and its load
     ping     call db.ping() on a MongoDB server (running externally)
+    sleep-error
+             Sleep for --sleep-for microseconds with Coarse and then Precise
+             sleeps and report how much longer than requested the sleeps took.
+             Doesn't use loop types
+    clock-read
+             Read steady_clock and then the TSC clock metrics use when the CPU
+             has an invariant TSC, and report how long each read took.
+             Doesn't use loop types
     )"
                  << "\n\n";
 
@@ -108,6 +119,9 @@ struct ProgramOptions {
                 "Log every number of seconds, defaults to 15 minutes")
         ("mongo-uri,u",
                 po::value<std::string>()->default_value("mongodb://localhost:27017"))
+        ("sleep-for",
+                po::value<int64_t>()->default_value(20),
+                "Microseconds to sleep for in the sleep-error task")
         ("metrics-output-file,o",
                 po::value<std::string>(),
                 "Write output to file in addition to stdout. The format ouf the output"
@@ -155,6 +169,8 @@ struct ProgramOptions {
         _logEverySeconds = std::chrono::seconds{logEverySeconds < 0 ? 1 : logEverySeconds};
 
         _mongoUri = vm["mongo-uri"].as<std::string>();
+
+        _sleepFor = std::chrono::microseconds{vm["sleep-for"].as<int64_t>()};
     }
 };
 
@@ -176,6 +192,65 @@ void logging_thread(bool& complete, std::chrono::seconds logEverySeconds) {
     }
 };
 
+// Measure sleep overshoot in each sleep mode. Output lines are
+// sleep-error_[mode]_[percentile],[overshoot_in_nanoseconds].
+int reportSleepError(const ProgramOptions& opts) {
+    using Mode = v1::SleepOptions::Mode;
+    const std::vector<std::pair<std::string, Mode>> modes{{"coarse", Mode::kCoarse},
+                                                          {"precise", Mode::kPrecise}};
+
+    std::ostringstream out;
+    std::cout << "Sleep error for " << opts._sleepFor.count() << "us sleeps:\n";
+    for (const auto& [name, mode] : modes) {
+        v1::SleepOptions options;
+        options.mode = mode;
+        const auto error = canaries::measureSleepError(opts._sleepFor, opts._iterations, options);
+
+        std::cout << std::setw(8) << name << ": p50=" << error.p50 << "ns p90=" << error.p90
+                  << "ns p99=" << error.p99 << "ns p99.9=" << error.p999 << "ns max=" << error.max
+                  << "ns\n";
+        const std::pair<const char*, int64_t> values[] = {
+            {"p50", error.p50}, {"p90", error.p90}, {"p99", error.p99},
+            {"p99.9", error.p999}, {"max", error.max}};
+        for (const auto& [percentile, value] : values) {
+            out << "sleep-error_" << name << "_" << percentile << "," << value << "\n";
+        }
+    }
+
+    if (!opts._metricsFileName.empty()) {
+        createDirectory(opts._metricsFileName);
+        std::ofstream metrics{opts._metricsFileName, std::ofstream::out | std::ofstream::trunc};
+        metrics << out.str();
+        BOOST_LOG_TRIVIAL(info) << "Wrote metrics to " << opts._metricsFileName;
+    }
+    return 0;
+}
+
+// Measure the cost of each clock the metrics can read. Output lines are
+// clock-read_[clock],[read_duration_in_picoseconds].
+int reportClockReads(const ProgramOptions& opts) {
+    const auto cost = canaries::measureClockReads(opts._iterations);
+
+    std::ostringstream out;
+    std::cout << "Clock read cost over " << opts._iterations << " reads:\n";
+    std::cout << std::setw(8) << "steady" << ": " << cost.steady << "ps\n";
+    out << "clock-read_steady," << cost.steady << "\n";
+    if (cost.tsc) {
+        std::cout << std::setw(8) << "tsc" << ": " << *cost.tsc << "ps\n";
+        out << "clock-read_tsc," << *cost.tsc << "\n";
+    } else {
+        std::cout << std::setw(8) << "tsc" << ": not invariant on this CPU\n";
+    }
+
+    if (!opts._metricsFileName.empty()) {
+        createDirectory(opts._metricsFileName);
+        std::ofstream metrics{opts._metricsFileName, std::ofstream::out | std::ofstream::trunc};
+        metrics << out.str();
+        BOOST_LOG_TRIVIAL(info) << "Wrote metrics to " << opts._metricsFileName;
+    }
+    return 0;
+}
+
 int main(int argc, char** argv) {
     using namespace genny::canaries;
     auto opts = ProgramOptions(argc, argv);
@@ -184,6 +259,14 @@ int main(int argc, char** argv) {
         return 0;
     }
 
+    if (opts._task == "sleep-error") {
+        return reportSleepError(opts);
+    }
+
+    if (opts._task == "clock-read") {
+        return reportClockReads(opts);
+    }
+
     std::vector<Nanosecond> results;
     bool complete = false;
 
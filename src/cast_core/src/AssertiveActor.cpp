@@ -207,7 +207,10 @@ AssertiveActor::AssertiveActor(genny::ActorContext& context)
     : Actor{context},
       _assert{context.operation("Assert", AssertiveActor::id())},
       _client{context.client()},
-      _loop{context, (*_client)[context["Database"].to<std::string>()], AssertiveActor::id()} {}
+      _loop{*this,
+            context,
+            (*_client)[context["Database"].to<std::string>()],
+            AssertiveActor::id()} {}
 
 namespace {
 auto registerAssertiveActor = Cast::registerDefault<AssertiveActor>();
@@ -518,7 +518,7 @@ CollectionScanner::CollectionScanner(genny::ActorContext& context)
       _runningActorCounter{
           WorkloadContext::getActorSharedState<CollectionScanner, RunningActorCounter>()},
       _databaseNames{context["Database"].to<std::string>()},
-      _loop{context,
+      _loop{*this, context,
             this,
             _databaseNames,
             context["CollectionCount"].maybe<IntegerSpec>().value_or(0),
@@ -528,7 +528,8 @@ CollectionScanner::CollectionScanner(genny::ActorContext& context)
 
     const auto scanRateMegabytes = context["ScanRateMegabytes"].maybe<RateSpec>();
     _rateLimiter = scanRateMegabytes
-        ? context.workload().getRateLimiter("CollectionScanner", *scanRateMegabytes)
+        ? context.workload().getRateLimiter(
+              "CollectionScanner", *scanRateMegabytes, context)
         : nullptr;
 }
 
@@ -1424,6 +1424,8 @@ public:
     std::vector<std::unique_ptr<BaseOperation>> operations;
     std::string stateName;
     std::vector<double> transitionWeights;
+    // An alias table over transitionWeights, built once so picking a transition is O(1).
+    boost::random::discrete_distribution<> transitionDistribution;
     std::vector<Transition> transitions;
 
     template <typename A>
@@ -1449,6 +1451,7 @@ public:
                 states.at(transitionYaml["To"].template to<std::string>()),
                 Delay(transitionYaml["SleepBefore"], GeneratorArgs{phaseContext.rng(id), id})});
         }
+        transitionDistribution = boost::random::discrete_distribution<>(transitionWeights);
     }
 };
 
@@ -1458,6 +1461,7 @@ struct StateMachine {
 
     std::vector<State> states;
     std::vector<double> initialStateWeights;
+    boost::random::discrete_distribution<> initialStateDistribution;
 
     bool continueCurrentState;
     bool skipFirstOperations;
@@ -1530,6 +1534,9 @@ struct StateMachine {
             initialStateWeights[stateNames[state["State"].template to<std::string>()]] +=
                 state["Weight"].template to<double>();
         }
+        if (!continueCurrentState) {
+            initialStateDistribution = boost::random::discrete_distribution<>(initialStateWeights);
+        }
     }
 
     auto& operations() {
@@ -1576,9 +1583,7 @@ struct StateMachine {
     }
 
     [[nodiscard]] int pickNext(DefaultRandom& rng) {
-        auto distribution =
-            boost::random::discrete_distribution(states[currentState].transitionWeights);
-        int transition = distribution(rng);
+        int transition = states[currentState].transitionDistribution(rng);
         nextState = states[currentState].transitions[transition].nextState;
         return transition;
     }
@@ -1589,9 +1594,7 @@ struct StateMachine {
         if (!nop && !states.empty()) {
             if (!continueCurrentState) {
                 // pick the initial state for the phase
-                auto initial_distribution =
-                    boost::random::discrete_distribution(initialStateWeights);
-                nextState = initial_distribution(rng);
+                nextState = initialStateDistribution(rng);
                 BOOST_LOG_TRIVIAL(debug)
                     << "Actor " << actorId << " picking initial state " << nextState;
             } else {
@@ -1782,7 +1785,7 @@ void CrudActor::run() {
 CrudActor::CrudActor(genny::ActorContext& context)
     : Actor(context),
       _client{std::move(context.client())},
-      _loop{context, _client, CrudActor::id()},
+      _loop{*this, context, _client, CrudActor::id()},
       _rng{context.workload().getRNGForThread(CrudActor::id())} {}
 
 namespace {
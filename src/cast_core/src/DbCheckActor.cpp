@@ -181,7 +181,10 @@ DbCheckActor::DbCheckActor(genny::ActorContext& context)
     : Actor{context},
       _dbcheckMetric{context.operation("DbCheck", DbCheckActor::id())},
       _client{context.client()},
-      _loop{context, (*_client)[context["Database"].to<std::string>()], DbCheckActor::id()} {}
+      _loop{*this,
+            context,
+            (*_client)[context["Database"].to<std::string>()],
+            DbCheckActor::id()} {}
 
 namespace {
 auto registerDbCheckActor = Cast::registerDefault<DbCheckActor>();
@@ -69,7 +69,7 @@ void Deleter::run() {
 Deleter::Deleter(genny::ActorContext& context)
     : Actor{context},
       _client{context.client()},
-      _loop{context, (*_client)[context["Database"].to<std::string>()], Deleter::id()} {}
+      _loop{*this, context, (*_client)[context["Database"].to<std::string>()], Deleter::id()} {}
 
 namespace {
 auto registerDeleter = Cast::registerDefault<Deleter>();
@@ -215,7 +215,7 @@ Loader::Loader(genny::ActorContext& context, uint thread, size_t totalThreads)
       _individualBulkLoad{context.operation("IndividualBulkInsert", Loader::id())},
       _indexBuild{context.operation("IndexBuild", Loader::id())},
       _client{std::move(context.client())},
-      _loop{context, _client, thread, totalThreads, Loader::id()} {}
+      _loop{*this, context, _client, thread, totalThreads, Loader::id()} {}
 
 class LoaderProducer : public genny::ActorProducer {
 public:
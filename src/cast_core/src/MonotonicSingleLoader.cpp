@@ -116,7 +116,7 @@ MonotonicSingleLoader::MonotonicSingleLoader(genny::ActorContext& context)
       _docIdCounter{
           WorkloadContext::getActorSharedState<MonotonicSingleLoader,
                                                MonotonicSingleLoader::DocumentIdCounter>()},
-      _loop{context, _client, MonotonicSingleLoader::id()} {}
+      _loop{*this, context, _client, MonotonicSingleLoader::id()} {}
 
 namespace {
 auto registerMonotonicSingleLoader = Cast::registerDefault<MonotonicSingleLoader>();
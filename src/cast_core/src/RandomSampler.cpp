@@ -97,7 +97,7 @@ RandomSampler::RandomSampler(genny::ActorContext& context)
           WorkloadContext::getActorSharedState<CollectionScanner,
                                                CollectionScanner::RunningActorCounter>()},
       _random{context.workload().getRNGForThread(RandomSampler::id())},
-      _loop{context,
+      _loop{*this, context,
             this,
             (*_client)[context["Database"].to<std::string>()],
             context["CollectionCount"].to<IntegerSpec>(),
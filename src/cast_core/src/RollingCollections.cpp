@@ -469,7 +469,7 @@ RollingCollections::RollingCollections(genny::ActorContext& context)
       _client{context.client()},
       _collectionNames{
           WorkloadContext::getActorSharedState<RollingCollections, RollingCollectionNames>()},
-      _loop{context,
+      _loop{*this, context,
             (*_client)[context["Database"].to<std::string>()],
             RollingCollections::id(),
             WorkloadContext::getActorSharedState<RollingCollections, RollingCollectionNames>(),
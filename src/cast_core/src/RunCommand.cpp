@@ -395,7 +395,7 @@ void actor::RunCommand::run() {
 actor::RunCommand::RunCommand(ActorContext& context)
     : Actor(context),
       _client{std::move(context.client())},
-      _loop{context, context, _client, RunCommand::id()} {}
+      _loop{*this, context, context, _client, RunCommand::id()} {}
 
 namespace {
 auto registerRunCommand = Cast::registerDefault<actor::RunCommand>();
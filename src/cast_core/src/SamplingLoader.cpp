@@ -166,7 +166,7 @@ SamplingLoader::SamplingLoader(genny::ActorContext& context,
       _client{std::move(context.client())},
       _collection{(*_client)[dbName][collectionName]},
       _deferredSample{std::move(deferredSample)},
-      _loop{context, _client, SamplingLoader::id()} {}
+      _loop{*this, context, _client, SamplingLoader::id()} {}
 
 class SamplingLoaderProducer : public genny::ActorProducer {
 public:
@@ -109,7 +109,10 @@ StreamStatsReporter::StreamStatsReporter(genny::ActorContext& context)
     : Actor{context},
       _throughput{context.operation("Throughput", StreamStatsReporter::id())},
       _client{std::move(context.client())},
-      _loop{context, (*_client)[context["Database"].to<std::string>()], StreamStatsReporter::id()},
+      _loop{*this,
+            context,
+            (*_client)[context["Database"].to<std::string>()],
+            StreamStatsReporter::id()},
       _orchestrator{context.orchestrator()} {}
 
 namespace {
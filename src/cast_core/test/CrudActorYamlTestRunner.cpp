@@ -12,6 +12,8 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <map>
+#include <string>
 #include <vector>
 
 #include <boost/algorithm/string/trim.hpp>
@@ -29,6 +31,7 @@
 
 #include <testlib/ActorHelper.hpp>
 #include <testlib/MongoTestFixture.hpp>
+#include <testlib/distributions.hpp>
 #include <testlib/helpers.hpp>
 #include <testlib/yamlTest.hpp>
 #include <testlib/yamlToBson.hpp>
@@ -43,8 +46,8 @@ const char* DEFAULT_COLLECTION = "test";
 enum class RunMode { kNormal, kExpectedSetupException, kExpectedRuntimeException };
 
 RunMode convertRunMode(YAML::Node tcase) {
-    if (tcase["OutcomeData"] || tcase["OutcomeCounts"] || tcase["ExpectAllEvents"] ||
-        tcase["ExpectedCollectionsExist"]) {
+    if (tcase["OutcomeData"] || tcase["OutcomeCounts"] || tcase["OutcomeDistribution"] ||
+        tcase["ExpectAllEvents"] || tcase["ExpectedCollectionsExist"]) {
         return RunMode::kNormal;
     }
     if (tcase["Error"]) {
@@ -237,6 +240,20 @@ void requireOutcomeCounts(mongocxx::pool::entry& client, YAML::Node outcomeCount
     }
 }
 
+// Chi-squared test of how many documents match each Filter against its Probability.
+void requireOutcomeDistribution(mongocxx::pool::entry& client, YAML::Node outcomeDistribution) {
+    auto coll = (*client)[DEFAULT_DB][DEFAULT_COLLECTION];
+    std::map<std::string, double> observed;
+    std::map<std::string, double> pmf;
+    for (auto&& bin : outcomeDistribution) {
+        auto filter = genny::testing::toDocumentBson(bin["Filter"]);
+        auto name = bsoncxx::to_json(filter.view());
+        observed.emplace(name, coll.count_documents(filter.view()));
+        pmf.emplace(name, bin["Probability"].as<double>());
+    }
+    requireDistribution(observed, pmf);
+}
+
 NodeSource createConfigurationYaml(YAML::Node operations) {
     YAML::Node config = YAML::Load(R"(
           SchemaVersion: 2018-07-01
@@ -259,8 +276,8 @@ NodeSource createConfigurationYaml(YAML::Node operations) {
 }
 
 // Unlike the previous function, this takes everything in phase, and puts it into the Phase, not
-// just operations.
-NodeSource createConfigurationYamlPhase(YAML::Node phase) {
+// just operations. The Actor runs phaseCount copies of the Phase.
+NodeSource createConfigurationYamlPhase(YAML::Node phase, int phaseCount) {
     YAML::Node config = YAML::Load(R"(
           SchemaVersion: 2018-07-01
           Clients:
@@ -280,6 +297,9 @@ NodeSource createConfigurationYamlPhase(YAML::Node phase) {
     for (auto iter : phase) {
         config["Actors"][0]["Phases"][0][iter.first] = iter.second;
     }
+    for (int i = 1; i < phaseCount; ++i) {
+        config["Actors"][0]["Phases"].push_back(YAML::Clone(config["Actors"][0]["Phases"][0]));
+    }
     return NodeSource{YAML::Dump(config), "operationsConfig"};
 }
 void requireAfterState(mongocxx::pool::entry& client,
@@ -292,6 +312,9 @@ void requireAfterState(mongocxx::pool::entry& client,
     if (auto ocounts = tcase["OutcomeCounts"]; ocounts) {
         requireOutcomeCounts(client, ocounts);
     }
+    if (auto odistribution = tcase["OutcomeDistribution"]; odistribution) {
+        requireOutcomeDistribution(client, odistribution);
+    }
     if (auto requirements = tcase["ExpectAllEvents"]; requirements) {
         requireAllEvents(client, events, requirements);
     }
@@ -315,6 +338,7 @@ struct CrudActorTestCase {
         : description{node["Description"].as<std::string>()},
           operations{node["Operations"]},
           phase{node["Phase"]},
+          phaseCount{node["PhaseCount"] ? node["PhaseCount"].as<int>() : 1},
           runMode{convertRunMode(node)},
           error{node["Error"]},
           tcase{node} {}
@@ -326,7 +350,8 @@ struct CrudActorTestCase {
             auto apmCallback = makeApmCallback(events);
 
             auto config =
-                (phase ? createConfigurationYamlPhase(phase) : createConfigurationYaml(operations));
+                (phase ? createConfigurationYamlPhase(phase, phaseCount)
+                       : createConfigurationYaml(operations));
             {
                 std::stringstream str;
                 str << config.root();
@@ -389,6 +414,7 @@ struct CrudActorTestCase {
     std::string description;
     YAML::Node operations;
     YAML::Node phase;
+    int phaseCount = 1;
     YAML::Node tcase;
 };
 
@@ -66,6 +66,9 @@ public:
         DefaultDriver::RunMode runMode = RunMode::kNormal;
         boost::log::trivial::severity_level logVerbosity;
         OutcomeCode parseOutcome = OutcomeCode::kSuccess;
+
+        // Number of processes to run the workload in. See `genny::driver::fanOut`.
+        size_t workers = 1;
     };
 
     /**
@@ -0,0 +1,136 @@
+// Copyright 2022-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef HEADER_2BE0E721_4BF7_4CFB_A1E5_16530000486F_INCLUDED
+#define HEADER_2BE0E721_4BF7_4CFB_A1E5_16530000486F_INCLUDED
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <boost/core/noncopyable.hpp>
+
+#include <metrics/metrics.hpp>
+
+namespace genny::driver {
+
+/**
+ * Shows how each operation is doing while the workload runs, rather than only once its metrics
+ * have been post-processed.
+ *
+ * Every `Interval` it drains the registry's live stats, which doesn't stop the Actors, and logs
+ * one line per operation that ran in the interval. Throughput and percentiles are over the last
+ * `Window` intervals. Counts are since the reporter started.
+ *
+ * If a `Port` is given the latest numbers are also served on it over HTTP: `/metrics` in the
+ * Prometheus text format and `/metrics.json` as JSON.
+ */
+class LiveReporter : private boost::noncopyable {
+public:
+    using LiveOptions = metrics::internals::v1::LiveOptions;
+
+    /**
+     * Start reporting. The registry must have had enableLiveStats() called with `options`.
+     *
+     * @throws std::runtime_error if the port can't be listened on.
+     */
+    LiveReporter(metrics::Registry& registry, LiveOptions options);
+
+    ~LiveReporter();
+
+    /**
+     * Stop reporting and serving. Idempotent.
+     */
+    void stop();
+
+    /**
+     * Drain the registry and publish what it recorded since the last call. The reporter calls
+     * this every interval.
+     */
+    void collect();
+
+    /**
+     * @return the latest numbers in the Prometheus text exposition format.
+     */
+    std::string prometheus() const;
+
+    /**
+     * @return the latest numbers as a JSON document.
+     */
+    std::string json() const;
+
+    /**
+     * @return the port being served on, or 0 if not serving.
+     */
+    uint16_t port() const {
+        return _port;
+    }
+
+private:
+    using Key = std::pair<std::string, std::string>;
+    using Interval = std::map<Key, metrics::internals::v1::LiveOperation>;
+
+    struct Row {
+        std::string actorName;
+        std::string opName;
+        size_t threads = 0;
+
+        // Since the reporter started.
+        metrics::internals::v1::IntervalCounters total;
+
+        // Over the window.
+        metrics::internals::v1::IntervalCounters window;
+        double throughput = 0;
+        int64_t p50 = 0;
+        int64_t p90 = 0;
+        int64_t p99 = 0;
+        int64_t p999 = 0;
+        int64_t max = 0;
+    };
+
+    void run();
+    void serve();
+    std::string respond(const std::string& request) const;
+
+    metrics::Registry& _registry;
+    const LiveOptions _options;
+
+    // Guards everything below it.
+    mutable std::mutex _mutex;
+    std::condition_variable _stopped;
+    bool _stopping = false;
+    std::chrono::steady_clock::time_point _lastCollect;
+    std::deque<std::pair<std::chrono::nanoseconds, Interval>> _intervals;
+    std::map<Key, metrics::internals::v1::IntervalCounters> _totals;
+    std::vector<Row> _rows;
+    double _windowSeconds = 0;
+
+    int _listener = -1;
+    uint16_t _port = 0;
+    std::atomic<bool> _serving{false};
+    std::thread _collecting;
+    std::thread _serveThread;
+};
+
+}  // namespace genny::driver
+
+#endif  // HEADER_2BE0E721_4BF7_4CFB_A1E5_16530000486F_INCLUDED
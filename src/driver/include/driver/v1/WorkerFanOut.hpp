@@ -0,0 +1,94 @@
+// Copyright 2022-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef HEADER_A5CBF2A5_33C7_4A38_8AE6_AFFD7AA2E37E_INCLUDED
+#define HEADER_A5CBF2A5_33C7_4A38_8AE6_AFFD7AA2E37E_INCLUDED
+
+#include <functional>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <gennylib/v1/PhaseBarrier.hpp>
+
+namespace genny::driver {
+
+/**
+ * Run `runWorker` in `workers` forked child processes, each with its own WorkerIdentity,
+ * while this process serves the PhaseBarrierServer that keeps their phases in step.
+ *
+ * If a worker fails the others are told to abort at their next barrier.
+ *
+ * Call before starting any threads since the children are forked without exec'ing. Each child
+ * flushes its output and `_exit`s with `runWorker`'s result rather than returning.
+ *
+ * @throws std::logic_error if this process already has other threads.
+ * @return the exit code of the first worker to fail or 0 if they all succeeded.
+ *   A worker killed by a signal counts as exit code 3 (an internal exception).
+ */
+int fanOut(size_t workers, const std::function<int(const genny::v1::WorkerIdentity&)>& runWorker);
+
+/**
+ * @return where a worker writes its CSV metrics given the registry's path prefix.
+ *   Workers that aren't part of a fan-out write straight to `<prefix>.csv`.
+ */
+std::string workerCsvPath(const std::string& pathPrefix, const genny::v1::WorkerIdentity& worker);
+
+/**
+ * The metrics options the workers resolved from the workload, which the parent needs to find
+ * and merge their output.
+ */
+struct WorkerMetricsInfo {
+    // MetricsFormat::toString().
+    std::string format;
+    std::string pathPrefix;
+};
+
+/**
+ * Write `info` to `path` as `key=value` lines, replacing it atomically so a reader never sees
+ * part of it.
+ */
+void writeWorkerMetricsInfo(const std::string& path, const WorkerMetricsInfo& info);
+
+/**
+ * @return the info written by writeWorkerMetricsInfo() or nullopt if `path` doesn't exist.
+ * @throws std::runtime_error if the file is missing a key.
+ */
+std::optional<WorkerMetricsInfo> readWorkerMetricsInfo(const std::string& path);
+
+/**
+ * Merge the CSV metrics written by each worker into one report in the same format.
+ *
+ * Operations and other rows are concatenated. Their thread ids are already distinct since
+ * each worker runs different Actor threads. `OperationThreadCounts` are summed and `Clocks` are taken
+ * from the first input.
+ */
+void mergeWorkerCsv(const std::vector<std::string>& inputs, std::ostream& out);
+
+/**
+ * Concatenate the histogram interval logs written by each worker, keeping only the first one's
+ * header lines. The workers must have used the same histogram options.
+ */
+void mergeWorkerHistogramLogs(const std::vector<std::string>& inputs, std::ostream& out);
+
+/**
+ * Concatenate every `<name>.worker-<index>.ftdc` file under `directory` into `<name>.ftdc`
+ * and remove them. FTDC chunks are self-contained so the result reads like one worker wrote it.
+ */
+void mergeWorkerFtdcFiles(const std::string& directory);
+
+}  // namespace genny::driver
+
+#endif  // HEADER_A5CBF2A5_33C7_4A38_8AE6_AFFD7AA2E37E_INCLUDED
@@ -14,6 +14,7 @@
 
 #include <algorithm>
 #include <fstream>
+#include <memory>
 #include <sstream>
 #include <thread>
 #include <vector>
@@ -40,6 +41,8 @@
 #include <metrics/metrics.hpp>
 
 #include <driver/v1/DefaultDriver.hpp>
+#include <driver/v1/LiveReporter.hpp>
+#include <driver/v1/WorkerFanOut.hpp>
 
 namespace genny::driver {
 namespace {
@@ -93,6 +96,15 @@ void reportMetrics(genny::metrics::Registry& metrics,
     actorSetup.report(std::move(finishTime), std::move(duration), std::move(outcome));
 }
 
+/**
+ * Merge the intervals in a histogram log into one line per operation in `<prefix>.summary.csv`.
+ */
+void writeHistogramSummary(const std::string& logPath, const std::string& pathPrefix) {
+    std::ifstream in{logPath};
+    std::ofstream out{pathPrefix + ".summary.csv", std::ofstream::out | std::ofstream::trunc};
+    metrics::internals::v1::summarizeHistogramLog(in, out);
+}
+
 /**
  * Filter to remove any nodes inside dedicated "ignore" values.
  *
@@ -154,7 +166,30 @@ void reportUnused(const NodeSource& nodeSource, const bool dryrun) {
     }
 }
 
-DefaultDriver::OutcomeCode doRunLogic(const DefaultDriver::ProgramOptions& options) {
+YAML::Node loadWorkload(const DefaultDriver::ProgramOptions& options) {
+    if (options.workloadSourceType == DefaultDriver::ProgramOptions::YamlSource::kFile) {
+        return loadFile(options.workloadSource);
+    } else if (options.workloadSourceType == DefaultDriver::ProgramOptions::YamlSource::kString) {
+        return YAML::Load(options.workloadSource);
+    } else {
+        throw std::invalid_argument("Unrecognized workload source type.");
+    }
+}
+
+/**
+ * Wait for every worker to reach `barrier`. Throws if they've been told to abort so the
+ * Actor that called the Orchestrator hook aborts this worker too.
+ */
+void awaitWorkers(genny::v1::PhaseBarrierClient& phaseBarrier, const std::string& barrier) {
+    if (!phaseBarrier.await(barrier)) {
+        BOOST_THROW_EXCEPTION(
+            std::runtime_error("Another worker failed before '" + barrier + "'. Aborting."));
+    }
+}
+
+DefaultDriver::OutcomeCode doRunLogic(const DefaultDriver::ProgramOptions& options,
+                                      const genny::v1::WorkerIdentity& worker,
+                                      const std::string& metricsInfoPath) {
     // setup logging as the first thing we do.
     boost::log::core::get()->set_filter(boost::log::trivial::severity >= options.logVerbosity);
 
@@ -191,14 +226,20 @@ DefaultDriver::OutcomeCode doRunLogic(const DefaultDriver::ProgramOptions& optio
         phaseConfigSource = fs::path(options.workloadSource).parent_path();
     }
 
-    YAML::Node yaml;
-    if (options.workloadSourceType == DefaultDriver::ProgramOptions::YamlSource::kFile) {
-        yaml = loadFile(options.workloadSource);
-    } else if (options.workloadSourceType == DefaultDriver::ProgramOptions::YamlSource::kString) {
-        yaml = YAML::Load(options.workloadSource);
-    } else {
-        throw std::invalid_argument("Unrecognized workload source type.");
+    YAML::Node yaml = loadWorkload(options);
+
+    // Keeps this worker's phases in step with the other workers'. Declared before the
+    // WorkloadContext so it outlives the metrics registry, which waits on it before closing
+    // the collectors the workers share.
+    std::unique_ptr<genny::v1::PhaseBarrierClient> phaseBarrier;
+    if (worker.isFanOut()) {
+        phaseBarrier = std::make_unique<genny::v1::PhaseBarrierClient>(worker.socketPath);
+        metrics::internals::v2::grpcStreamsFinishedHook() = [barrier = phaseBarrier.get()]() {
+            barrier->await("flushed");
+        };
     }
+    auto unhook = Loki::MakeGuard(
+        []() { metrics::internals::v2::grpcStreamsFinishedHook() = nullptr; });
 
     auto orchestrator = Orchestrator{};
 
@@ -213,10 +254,17 @@ DefaultDriver::OutcomeCode doRunLogic(const DefaultDriver::ProgramOptions& optio
                                            orchestrator,
                                            globalCast(),
                                            {},
-                                           options.runMode == DefaultDriver::RunMode::kDryRun};
+                                           options.runMode == DefaultDriver::RunMode::kDryRun,
+                                           worker};
 
     genny::metrics::Registry& metrics = workloadContext.getMetrics();
 
+    if (worker.isFanOut() && worker.index == 0) {
+        // Every worker resolved the same metrics options so the first tells the parent.
+        writeWorkerMetricsInfo(metricsInfoPath,
+                               {metrics.getFormat().toString(), metrics.getPathPrefix().string()});
+    }
+
     if (options.runMode == DefaultDriver::RunMode::kDryRun) {
         BOOST_LOG_TRIVIAL(info) << "Workload context constructed without errors.";
         reportMetrics(metrics, workloadName, "Setup", true, startTime);
@@ -236,16 +284,57 @@ DefaultDriver::OutcomeCode doRunLogic(const DefaultDriver::ProgramOptions& optio
     orchestrator.addRequiredTokens(
         int(std::distance(workloadContext.actors().begin(), workloadContext.actors().end())));
 
+    if (phaseBarrier) {
+        // Added after the WorkloadContext's hooks so every worker has finished its own
+        // preparation for the phase before any of them starts it.
+        orchestrator.addPrePhaseStartHook([&](const Orchestrator*, PhaseNumber phase) {
+            awaitWorkers(*phaseBarrier, "start " + std::to_string(phase));
+        });
+        orchestrator.addPostPhaseStopHook([&](const Orchestrator*, PhaseNumber phase) {
+            awaitWorkers(*phaseBarrier, "stop " + std::to_string(phase));
+        });
+    }
+
     reportMetrics(metrics, workloadName, "Setup", true, startTime);
 
     auto startedActors = metrics.operation(workloadName, "ActorStarted", 0u, std::nullopt, true);
     auto finishedActors = metrics.operation(workloadName, "ActorFinished", 0u, std::nullopt, true);
 
+    // How long after each phase started (or ended) each Actor noticed.
+    auto phaseStartSkew =
+        metrics.operation(workloadName, "PhaseStartSkew", 0u, std::nullopt, true);
+    auto phaseStopSkew = metrics.operation(workloadName, "PhaseStopSkew", 0u, std::nullopt, true);
+
     std::atomic<DefaultDriver::OutcomeCode> outcomeCode = DefaultDriver::OutcomeCode::kSuccess;
 
     std::mutex reporting;
+    auto reportSkewTo = [&](auto& operation) {
+        return [&](PhaseNumber, Duration skew) {
+            const auto finished = metrics::clock::now();
+            std::lock_guard<std::mutex> lk{reporting};
+            operation.report(finished,
+                             std::chrono::duration_cast<std::chrono::microseconds>(skew),
+                             metrics::OutcomeType::kSuccess);
+        };
+    };
+    orchestrator.setPhaseSkewCallbacks(reportSkewTo(phaseStartSkew), reportSkewTo(phaseStopSkew));
+
+    // Time the Actors with the TSC if the workload allows it, keeping it in step with
+    // steady_clock while they run.
+    std::unique_ptr<metrics::internals::v1::TscCalibrator> tscCalibrator;
+    if (workloadContext.useTscClock() && metrics::clock::useTsc(true)) {
+        tscCalibrator = std::make_unique<metrics::internals::v1::TscCalibrator>(
+            *metrics::internals::v1::TscClock::invariant());
+    }
+    auto stopTsc = Loki::MakeGuard([]() { metrics::clock::useTsc(false); });
+
+    std::unique_ptr<LiveReporter> liveReporter;
+    if (const auto& liveOptions = metrics.getLiveOptions(); liveOptions) {
+        liveReporter = std::make_unique<LiveReporter>(metrics, *liveOptions);
+    }
     parallelRun(workloadContext.actors(),
                 [&](const auto& actor) {
+                   workloadContext.placeActorThread(actor->id());
                    {
                        auto ctx = startedActors.start();
                        ctx.addDocuments(1);
@@ -263,23 +352,62 @@ DefaultDriver::OutcomeCode doRunLogic(const DefaultDriver::ProgramOptions& optio
                        std::lock_guard<std::mutex> lk{reporting};
                        ctx.success();
                    }
-               });
+               },
+               workloadContext.executionOptions());
+
+    // Record the samples and buckets the Actors were still reducing when they stopped.
+    metrics.flushReductions();
+
+    if (liveReporter) {
+        // One last look so the log ends with the workload's last interval.
+        liveReporter->stop();
+        liveReporter->collect();
+    }
+
+    if (phaseBarrier && !phaseBarrier->await("done")) {
+        BOOST_LOG_TRIVIAL(error) << "Another worker didn't finish the workload";
+    }
 
     if (metrics.getFormat().useCsv()) {
+        metrics.flushEventSpill();
         const auto reporter = genny::metrics::Reporter{metrics};
 
         {
             std::ofstream metricsOutput;
-            metricsOutput.open(metrics.getPathPrefix().string() + ".csv",
+            metricsOutput.open(workerCsvPath(metrics.getPathPrefix().string(), worker),
                                std::ofstream::out | std::ofstream::trunc);
             reporter.report(metricsOutput, metrics.getFormat());
         }
     }
 
+    if (const auto dropped = metrics.getDroppedEvents(); dropped > 0) {
+        BOOST_LOG_TRIVIAL(warning) << "Dropped " << dropped
+                                   << " metrics events because the metrics buffers were full";
+        auto droppedEvents =
+            metrics.operation(workloadName, "MetricsDropped", 0u, std::nullopt, true);
+        droppedEvents.report(metrics::clock::now(),
+                             std::chrono::microseconds{0},
+                             metrics::OutcomeType::kFailure,
+                             1,
+                             0,
+                             metrics::count_type(dropped));
+    }
+
     // We don't use the workload name because downstream sources may expect consistent
     // names for timing files.
     reportMetrics(metrics, "WorkloadTimingRecorder", "Workload", true, startTime);
 
+    metrics.closeArrowFiles();
+
+    if (const auto* histogramLog = metrics.getHistogramLog(); histogramLog) {
+        metrics.closeHistogramLog();
+        if (!worker.isFanOut()) {
+            // Fanned-out workers are summarized together once they've all finished.
+            writeHistogramSummary(histogramLog->options().logPath.string(),
+                                  metrics.getPathPrefix().string());
+        }
+    }
+
     reportUnused(nodeSource, false);
     return outcomeCode;
 }
@@ -287,11 +415,15 @@ DefaultDriver::OutcomeCode doRunLogic(const DefaultDriver::ProgramOptions& optio
 }  // namespace
 
 
-DefaultDriver::OutcomeCode DefaultDriver::run(const DefaultDriver::ProgramOptions& options) const {
+namespace {
+
+DefaultDriver::OutcomeCode runWorker(const DefaultDriver::ProgramOptions& options,
+                                     const genny::v1::WorkerIdentity& worker,
+                                     const std::string& metricsInfoPath = "") {
     try {
         // Wrap doRunLogic in another catch block in case it throws an exception of its own e.g.
         // file not found or io errors etc - exceptions not thrown by ActorProducers.
-        return doRunLogic(options);
+        return doRunLogic(options, worker, metricsInfoPath);
     } catch (const boost::exception& x) {
         BOOST_LOG_TRIVIAL(error) << "Caught boost::exception "
                                  << boost::diagnostic_information(x, true)
@@ -304,6 +436,88 @@ DefaultDriver::OutcomeCode DefaultDriver::run(const DefaultDriver::ProgramOption
     return DefaultDriver::OutcomeCode::kInternalException;
 }
 
+/**
+ * Combine the CSV or histogram metrics the workers wrote, if any, into the files a single
+ * process would have written.
+ */
+void mergeWorkerMetrics(const WorkerMetricsInfo& info, size_t workers) {
+    const auto format = metrics::MetricsFormat(info.format);
+    const auto& prefix = info.pathPrefix;
+    if (format.useNativeFtdc()) {
+        mergeWorkerFtdcFiles(prefix);
+        return;
+    }
+    if (!format.useCsv() && !format.useHistogram()) {
+        // Workers stream FTDC to the same collectors so it's already merged.
+        return;
+    }
+    const auto extension = format.useHistogram() ? ".intervals.csv" : ".csv";
+
+    std::vector<std::string> inputs;
+    for (size_t i = 0; i < workers; ++i) {
+        auto path = genny::v1::WorkerIdentity{i, workers}.filePath(prefix, extension);
+        if (fs::exists(path)) {
+            inputs.push_back(std::move(path));
+        }
+    }
+    {
+        std::ofstream out{prefix + extension, std::ofstream::out | std::ofstream::trunc};
+        if (format.useHistogram()) {
+            mergeWorkerHistogramLogs(inputs, out);
+        } else {
+            mergeWorkerCsv(inputs, out);
+        }
+    }
+    if (format.useHistogram()) {
+        writeHistogramSummary(prefix + extension, prefix);
+    }
+    for (const auto& input : inputs) {
+        fs::remove(input);
+    }
+}
+
+DefaultDriver::OutcomeCode runWorkers(const DefaultDriver::ProgramOptions& options) {
+    boost::log::core::get()->set_filter(boost::log::trivial::severity >= options.logVerbosity);
+    const auto metricsInfoPath =
+        (fs::temp_directory_path() / fs::unique_path("genny-metrics-%%%%-%%%%-%%%%.info"))
+            .string();
+    auto removeInfo = Loki::MakeGuard([&]() {
+        boost::system::error_code ec;
+        fs::remove(metricsInfoPath, ec);
+    });
+
+    int code = 0;
+    try {
+        code = fanOut(options.workers, [&](const genny::v1::WorkerIdentity& worker) {
+            return static_cast<int>(runWorker(options, worker, metricsInfoPath));
+        });
+    } catch (const std::logic_error& x) {
+        BOOST_LOG_TRIVIAL(error) << "Couldn't start the workers: " << x.what();
+        return DefaultDriver::OutcomeCode::kInternalException;
+    }
+    try {
+        // The first worker didn't get as far as setting up its metrics so there's nothing to
+        // merge.
+        if (const auto info = readWorkerMetricsInfo(metricsInfoPath); info) {
+            mergeWorkerMetrics(*info, options.workers);
+        }
+    } catch (const std::exception& x) {
+        BOOST_LOG_TRIVIAL(error) << "Couldn't merge the workers' metrics: " << x.what();
+        return code == 0 ? DefaultDriver::OutcomeCode::kStandardException
+                         : static_cast<DefaultDriver::OutcomeCode>(code);
+    }
+    return static_cast<DefaultDriver::OutcomeCode>(code);
+}
+
+}  // namespace
+
+DefaultDriver::OutcomeCode DefaultDriver::run(const DefaultDriver::ProgramOptions& options) const {
+    if (options.workers > 1 && options.runMode == RunMode::kNormal) {
+        return runWorkers(options);
+    }
+    return runWorker(options, {});
+}
+
 
 namespace {
 
@@ -384,7 +598,11 @@ DefaultDriver::ProgramOptions::ProgramOptions(int argc, char** argv) {
              "Can also specify as the last positional argument.")
             ("verbosity,v",
               po::value<std::string>()->default_value("info"),
-              "Log severity for boost logging. Valid values are trace/debug/info/warning/error/fatal.");
+              "Log severity for boost logging. Valid values are trace/debug/info/warning/error/fatal.")
+            ("workers",
+             po::value<size_t>()->default_value(1),
+             "Run the workload in this many processes at once. Their phases start and end "
+             "together and their metrics are merged.");
 
     positional.add("subcommand", 1);
     positional.add("workload-file", -1);
@@ -432,6 +650,7 @@ DefaultDriver::ProgramOptions::ProgramOptions(int argc, char** argv) {
         this->runMode = RunMode::kHelp;
 
     this->logVerbosity = parseVerbosity(vm["verbosity"].as<std::string>());
+    this->workers = std::max<size_t>(1, vm["workers"].as<size_t>());
 
     if (vm.count("workload-file") > 0) {
         this->workloadSource = vm["workload-file"].as<std::string>();
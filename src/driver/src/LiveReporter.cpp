@@ -0,0 +1,413 @@
+// Copyright 2022-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <driver/v1/LiveReporter.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <boost/log/trivial.hpp>
+
+namespace genny::driver {
+namespace {
+
+// Requests are a request line and a few headers. Anything longer isn't for us.
+constexpr size_t kMaxRequest = 8192;
+
+std::string millis(int64_t nanos) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(3) << double(nanos) / 1e6 << "ms";
+    return out.str();
+}
+
+std::string seconds(int64_t nanos) {
+    std::ostringstream out;
+    out << std::setprecision(15) << double(nanos) / 1e9;
+    return out.str();
+}
+
+std::string prometheusEscape(const std::string& value) {
+    std::string out;
+    for (const char c : value) {
+        if (c == '\\' || c == '"') {
+            out += '\\';
+            out += c;
+        } else if (c == '\n') {
+            out += "\\n";
+        } else {
+            out += c;
+        }
+    }
+    return out;
+}
+
+std::string jsonEscape(const std::string& value) {
+    std::string out;
+    for (const char c : value) {
+        if (c == '\\' || c == '"') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", unsigned(c));
+            out += escaped;
+        } else {
+            out += c;
+        }
+    }
+    return out;
+}
+
+std::string httpResponse(const std::string& status,
+                         const std::string& contentType,
+                         const std::string& body,
+                         bool includeBody) {
+    std::ostringstream out;
+    out << "HTTP/1.1 " << status << "\r\n"
+        << "Content-Type: " << contentType << "\r\n"
+        << "Content-Length: " << body.size() << "\r\n"
+        << "Connection: close\r\n"
+        << "\r\n";
+    if (includeBody) {
+        out << body;
+    }
+    return out.str();
+}
+
+void writeAll(int fd, const std::string& data) {
+    size_t written = 0;
+    while (written < data.size()) {
+        const auto n = ::send(fd, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return;
+        }
+        written += size_t(n);
+    }
+}
+
+}  // namespace
+
+LiveReporter::LiveReporter(metrics::Registry& registry, LiveOptions options)
+    : _registry{registry},
+      _options{std::move(options)},
+      _lastCollect{std::chrono::steady_clock::now()} {
+    if (_options.interval <= std::chrono::nanoseconds::zero() || _options.window == 0) {
+        throw std::invalid_argument("Live metrics need a positive interval and window");
+    }
+
+    if (_options.port) {
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(*_options.port);
+        if (::inet_pton(AF_INET, _options.host.c_str(), &addr.sin_addr) != 1) {
+            throw std::runtime_error("Live metrics Host must be an IPv4 address, got " +
+                                     _options.host);
+        }
+        const int reuse = 1;
+        _listener = ::socket(AF_INET, SOCK_STREAM, 0);
+        socklen_t length = sizeof(addr);
+        if (_listener < 0 ||
+            ::setsockopt(_listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) != 0 ||
+            ::bind(_listener, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0 ||
+            ::listen(_listener, 16) != 0 ||
+            ::getsockname(_listener, reinterpret_cast<sockaddr*>(&addr), &length) != 0) {
+            const std::string error = ::strerror(errno);
+            if (_listener >= 0) {
+                ::close(_listener);
+            }
+            throw std::runtime_error("Couldn't serve live metrics on " + _options.host + ":" +
+                                     std::to_string(*_options.port) + ": " + error);
+        }
+        _port = ntohs(addr.sin_port);
+        _serving = true;
+        _serveThread = std::thread{[this]() { serve(); }};
+        BOOST_LOG_TRIVIAL(info) << "Serving live metrics on http://" << _options.host << ":"
+                                << _port << "/metrics";
+    }
+
+    _collecting = std::thread{[this]() { run(); }};
+}
+
+LiveReporter::~LiveReporter() {
+    stop();
+}
+
+void LiveReporter::stop() {
+    {
+        std::lock_guard<std::mutex> lk{_mutex};
+        _stopping = true;
+    }
+    _stopped.notify_all();
+    if (_collecting.joinable()) {
+        _collecting.join();
+    }
+    _serving = false;
+    if (_serveThread.joinable()) {
+        _serveThread.join();
+    }
+    if (_listener >= 0) {
+        ::close(_listener);
+        _listener = -1;
+    }
+}
+
+void LiveReporter::run() {
+    std::unique_lock<std::mutex> lk{_mutex};
+    while (!_stopped.wait_for(lk, _options.interval, [&]() { return _stopping; })) {
+        lk.unlock();
+        try {
+            collect();
+        } catch (const std::exception& x) {
+            BOOST_LOG_TRIVIAL(error) << "Couldn't collect live metrics: " << x.what();
+        }
+        lk.lock();
+    }
+}
+
+void LiveReporter::collect() {
+    auto drained = _registry.drainLiveStats();
+    const auto now = std::chrono::steady_clock::now();
+
+    std::lock_guard<std::mutex> lk{_mutex};
+    const auto length = std::chrono::duration_cast<std::chrono::nanoseconds>(now - _lastCollect);
+    _lastCollect = now;
+
+    Interval interval;
+    for (auto& op : drained) {
+        Key key{op.actorName, op.opName};
+        _totals[key].add(op.counters);
+        interval.emplace(std::move(key), std::move(op));
+    }
+    _intervals.emplace_back(length, std::move(interval));
+    while (_intervals.size() > _options.window) {
+        _intervals.pop_front();
+    }
+
+    Interval window;
+    std::chrono::nanoseconds windowLength{0};
+    for (const auto& [intervalLength, ops] : _intervals) {
+        windowLength += intervalLength;
+        for (const auto& [key, op] : ops) {
+            auto& into = window[key];
+            into.counters.add(op.counters);
+            into.durations.add(op.durations);
+            // The latest interval knows best.
+            into.threads = op.threads;
+        }
+    }
+    _windowSeconds = double(windowLength.count()) / 1e9;
+
+    const auto& latest = _intervals.back().second;
+    _rows.clear();
+    for (const auto& [key, total] : _totals) {
+        Row row;
+        row.actorName = key.first;
+        row.opName = key.second;
+        row.total = total;
+        if (const auto it = window.find(key); it != window.end()) {
+            const auto& durations = it->second.durations;
+            row.threads = it->second.threads;
+            row.window = it->second.counters;
+            row.throughput = _windowSeconds > 0 ? double(row.window.count) / _windowSeconds : 0;
+            row.p50 = durations.valueAtPercentile(50);
+            row.p90 = durations.valueAtPercentile(90);
+            row.p99 = durations.valueAtPercentile(99);
+            row.p999 = durations.valueAtPercentile(99.9);
+            row.max = durations.max();
+        }
+
+        // Only log operations that are running so idle ones don't drown out the rest.
+        const auto ran = latest.find(key);
+        if (ran == latest.end() || ran->second.counters.count == 0) {
+            _rows.push_back(std::move(row));
+            continue;
+        }
+        BOOST_LOG_TRIVIAL(info) << "Live " << row.actorName << "." << row.opName << ": "
+                                << std::fixed << std::setprecision(1) << row.throughput
+                                << "/s over " << _windowSeconds << "s on " << row.threads
+                                << " threads, mean "
+                                << millis(row.window.totalDuration / row.window.count)
+                                << ", p50 " << millis(row.p50) << ", p99 " << millis(row.p99)
+                                << ", max " << millis(row.max) << ", " << row.window.errors
+                                << " errors, " << row.window.failures << " failures, "
+                                << row.total.count << " total";
+        _rows.push_back(std::move(row));
+    }
+}
+
+std::string LiveReporter::prometheus() const {
+    std::lock_guard<std::mutex> lk{_mutex};
+    std::ostringstream out;
+    out << std::setprecision(15);
+
+    const auto family = [&](const std::string& name,
+                            const std::string& type,
+                            const std::string& help,
+                            const std::function<void(const Row&, const std::string&)>& write) {
+        out << "# HELP " << name << " " << help << "\n# TYPE " << name << " " << type << "\n";
+        for (const auto& row : _rows) {
+            write(row,
+                  "actor=\"" + prometheusEscape(row.actorName) + "\",operation=\"" +
+                      prometheusEscape(row.opName) + "\"");
+        }
+    };
+    const auto counter = [&](const std::string& name,
+                             const std::string& help,
+                             int64_t metrics::internals::v1::IntervalCounters::*field) {
+        family(name, "counter", help, [&](const Row& row, const std::string& labels) {
+            out << name << "{" << labels << "} " << row.total.*field << "\n";
+        });
+    };
+
+    using Counters = metrics::internals::v1::IntervalCounters;
+    out << "# HELP genny_live_window_seconds How far back throughput and latencies look.\n"
+        << "# TYPE genny_live_window_seconds gauge\n"
+        << "genny_live_window_seconds " << _windowSeconds << "\n";
+    family("genny_operation_threads",
+           "gauge",
+           "Threads running the operation.",
+           [&](const Row& row, const std::string& labels) {
+               out << "genny_operation_threads{" << labels << "} " << row.threads << "\n";
+           });
+    counter("genny_operations_total", "Operations reported.", &Counters::count);
+    counter("genny_operation_iterations_total", "Iterations reported.", &Counters::ops);
+    counter("genny_operation_documents_total", "Documents reported.", &Counters::documents);
+    counter("genny_operation_bytes_total", "Bytes reported.", &Counters::bytes);
+    counter("genny_operation_errors_total", "Errors reported.", &Counters::errors);
+    counter("genny_operation_failures_total", "Operations that failed.", &Counters::failures);
+    family("genny_operation_throughput",
+           "gauge",
+           "Operations per second over the window.",
+           [&](const Row& row, const std::string& labels) {
+               out << "genny_operation_throughput{" << labels << "} " << row.throughput << "\n";
+           });
+    family("genny_operation_latency_seconds",
+           "summary",
+           "Operation latency. Quantiles are over the window.",
+           [&](const Row& row, const std::string& labels) {
+               for (const auto& [quantile, value] : {std::make_pair("0.5", row.p50),
+                                                     std::make_pair("0.9", row.p90),
+                                                     std::make_pair("0.99", row.p99),
+                                                     std::make_pair("0.999", row.p999),
+                                                     std::make_pair("1", row.max)}) {
+                   out << "genny_operation_latency_seconds{" << labels << ",quantile=\""
+                       << quantile << "\"} " << seconds(value) << "\n";
+               }
+               out << "genny_operation_latency_seconds_sum{" << labels << "} "
+                   << seconds(row.total.totalDuration) << "\n"
+                   << "genny_operation_latency_seconds_count{" << labels << "} "
+                   << row.total.count << "\n";
+           });
+    return out.str();
+}
+
+std::string LiveReporter::json() const {
+    std::lock_guard<std::mutex> lk{_mutex};
+    std::ostringstream out;
+    out << std::setprecision(15);
+    out << "{\"intervalSeconds\":" << seconds(_options.interval.count())
+        << ",\"windowSeconds\":" << _windowSeconds << ",\"operations\":[";
+    bool first = true;
+    for (const auto& row : _rows) {
+        if (!first) {
+            out << ",";
+        }
+        first = false;
+        const auto counters = [&](const metrics::internals::v1::IntervalCounters& c) {
+            out << "{\"count\":" << c.count << ",\"iterations\":" << c.ops
+                << ",\"documents\":" << c.documents << ",\"bytes\":" << c.bytes
+                << ",\"errors\":" << c.errors << ",\"failures\":" << c.failures
+                << ",\"duration\":" << c.totalDuration;
+        };
+        out << "{\"actor\":\"" << jsonEscape(row.actorName) << "\",\"operation\":\""
+            << jsonEscape(row.opName) << "\",\"threads\":" << row.threads << ",\"total\":";
+        counters(row.total);
+        out << "},\"window\":";
+        counters(row.window);
+        out << ",\"throughput\":" << row.throughput << ",\"p50\":" << row.p50
+            << ",\"p90\":" << row.p90 << ",\"p99\":" << row.p99 << ",\"p99.9\":" << row.p999
+            << ",\"max\":" << row.max << "}}";
+    }
+    out << "]}";
+    return out.str();
+}
+
+std::string LiveReporter::respond(const std::string& request) const {
+    std::istringstream in{request};
+    std::string method;
+    std::string target;
+    in >> method >> target;
+    const auto path = target.substr(0, target.find('?'));
+
+    if (method != "GET" && method != "HEAD") {
+        return httpResponse(
+            "405 Method Not Allowed", "text/plain", "Only GET is supported\n", true);
+    }
+    const bool includeBody = method == "GET";
+    if (path == "/metrics") {
+        return httpResponse(
+            "200 OK", "text/plain; version=0.0.4; charset=utf-8", prometheus(), includeBody);
+    }
+    if (path == "/metrics.json") {
+        return httpResponse("200 OK", "application/json", json(), includeBody);
+    }
+    return httpResponse(
+        "404 Not Found", "text/plain", "Try /metrics or /metrics.json\n", includeBody);
+}
+
+void LiveReporter::serve() {
+    while (_serving) {
+        pollfd listener{_listener, POLLIN, 0};
+        if (::poll(&listener, 1, 100) <= 0) {
+            continue;
+        }
+        const int client = ::accept(_listener, nullptr, nullptr);
+        if (client < 0) {
+            continue;
+        }
+        std::string request;
+        char chunk[1024];
+        while (request.find("\r\n\r\n") == std::string::npos && request.size() < kMaxRequest) {
+            // Don't let a client that never finishes its request hold up the others for long.
+            pollfd readable{client, POLLIN, 0};
+            if (::poll(&readable, 1, 1000) <= 0) {
+                break;
+            }
+            const auto n = ::read(client, chunk, sizeof(chunk));
+            if (n <= 0) {
+                break;
+            }
+            request.append(chunk, size_t(n));
+        }
+        writeAll(client, respond(request));
+        ::close(client);
+    }
+}
+
+}  // namespace genny::driver
@@ -0,0 +1,336 @@
+// Copyright 2022-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <driver/v1/WorkerFanOut.hpp>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <regex>
+#include <thread>
+#include <utility>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <boost/filesystem.hpp>
+#include <boost/log/core.hpp>
+#include <boost/log/trivial.hpp>
+
+namespace genny::driver {
+namespace {
+
+// DefaultDriver::OutcomeCode::kInternalException.
+constexpr int kKilledCode = 3;
+
+struct CsvSection {
+    std::string title;
+    std::vector<std::string> rows;
+};
+
+std::vector<CsvSection> readSections(const std::string& path) {
+    std::ifstream in{path};
+    if (!in) {
+        throw std::runtime_error("Couldn't read worker metrics from " + path);
+    }
+    std::vector<CsvSection> sections;
+    bool inSection = false;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty()) {
+            inSection = false;
+        } else if (!inSection) {
+            sections.push_back({line, {}});
+            inSection = true;
+        } else {
+            sections.back().rows.push_back(std::move(line));
+        }
+    }
+    return sections;
+}
+
+// The number of threads in this process, or 0 if we can't tell (e.g. there's no /proc).
+size_t threadCount() {
+    namespace fs = boost::filesystem;
+    boost::system::error_code ec;
+    fs::directory_iterator tasks{"/proc/self/task", ec};
+    if (ec) {
+        return 0;
+    }
+    size_t count = 0;
+    for (; tasks != fs::directory_iterator{}; tasks.increment(ec)) {
+        if (ec) {
+            return 0;
+        }
+        ++count;
+    }
+    return count;
+}
+
+// Flush what the worker wrote and leave without running atexit handlers or static destructors.
+// Those belong to the parent: they may wait on threads that only exist in the parent or tear
+// down state (like the PhaseBarrierServer's socket) that the other workers still use.
+[[noreturn]] void exitWorker(int code) {
+    boost::log::core::get()->flush();
+    std::cout.flush();
+    std::cerr.flush();
+    std::fflush(nullptr);
+    ::_exit(code);
+}
+
+const CsvSection* findSection(const std::vector<CsvSection>& sections, const std::string& title) {
+    for (const auto& section : sections) {
+        if (section.title == title) {
+            return &section;
+        }
+    }
+    return nullptr;
+}
+
+}  // namespace
+
+int fanOut(size_t workers, const std::function<int(const genny::v1::WorkerIdentity&)>& runWorker) {
+    // A forked child only gets the forking thread. Locks other threads held at the time stay
+    // locked in it forever.
+    if (const auto threads = threadCount(); threads > 1) {
+        throw std::logic_error("Can't start workers from a process with " +
+                               std::to_string(threads) + " threads");
+    }
+
+    const auto socketPath = (boost::filesystem::temp_directory_path() /
+                             ("genny-phases-" + std::to_string(::getpid()) + ".sock"))
+                                .string();
+    genny::v1::PhaseBarrierServer server{socketPath, workers};
+
+    BOOST_LOG_TRIVIAL(info) << "Running " << workers << " worker processes";
+
+    size_t started = 0;
+    for (; started < workers; ++started) {
+        const pid_t pid = ::fork();
+        if (pid < 0) {
+            BOOST_LOG_TRIVIAL(error) << "Couldn't start worker " << started << ": "
+                                     << ::strerror(errno);
+            server.abort();
+            break;
+        }
+        if (pid == 0) {
+            // Exit without returning so the child doesn't unwind into the parent's
+            // PhaseBarrierServer and remove the socket out from under the others.
+            int code = kKilledCode;
+            try {
+                code = runWorker(genny::v1::WorkerIdentity{started, workers, socketPath});
+            } catch (const std::exception& x) {
+                BOOST_LOG_TRIVIAL(error) << "Worker " << started << " failed: " << x.what();
+            }
+            exitWorker(code);
+        }
+    }
+
+    std::thread serving{[&]() { server.serve(); }};
+
+    int outcome = started == workers ? 0 : kKilledCode;
+    for (size_t remaining = started; remaining > 0;) {
+        int status = 0;
+        if (::waitpid(-1, &status, 0) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            BOOST_LOG_TRIVIAL(error) << "Lost track of the workers: " << ::strerror(errno);
+            outcome = kKilledCode;
+            break;
+        }
+        --remaining;
+        const int code = WIFEXITED(status) ? WEXITSTATUS(status) : kKilledCode;
+        if (code != 0) {
+            BOOST_LOG_TRIVIAL(error) << "A worker exited with code " << code
+                                     << ". Aborting the others.";
+            server.abort();
+            if (outcome == 0) {
+                outcome = code;
+            }
+        }
+    }
+
+    server.stop();
+    serving.join();
+    return outcome;
+}
+
+std::string workerCsvPath(const std::string& pathPrefix, const genny::v1::WorkerIdentity& worker) {
+    return worker.filePath(pathPrefix, ".csv");
+}
+
+void writeWorkerMetricsInfo(const std::string& path, const WorkerMetricsInfo& info) {
+    const auto partial = path + ".partial";
+    {
+        std::ofstream out{partial, std::ofstream::out | std::ofstream::trunc};
+        out << "format=" << info.format << std::endl;
+        out << "pathPrefix=" << info.pathPrefix << std::endl;
+        if (!out) {
+            throw std::runtime_error("Couldn't write worker metrics info to " + partial);
+        }
+    }
+    boost::filesystem::rename(partial, path);
+}
+
+std::optional<WorkerMetricsInfo> readWorkerMetricsInfo(const std::string& path) {
+    std::ifstream in{path};
+    if (!in) {
+        return std::nullopt;
+    }
+    std::map<std::string, std::string> values;
+    std::string line;
+    while (std::getline(in, line)) {
+        const auto equals = line.find('=');
+        if (equals != std::string::npos) {
+            values[line.substr(0, equals)] = line.substr(equals + 1);
+        }
+    }
+    for (const auto* key : {"format", "pathPrefix"}) {
+        if (values.count(key) == 0) {
+            throw std::runtime_error("Worker metrics info " + path + " has no " + key);
+        }
+    }
+    return WorkerMetricsInfo{values["format"], values["pathPrefix"]};
+}
+
+void mergeWorkerCsv(const std::vector<std::string>& inputs, std::ostream& out) {
+    std::vector<std::vector<CsvSection>> workers;
+    for (const auto& input : inputs) {
+        workers.push_back(readSections(input));
+    }
+    if (workers.empty()) {
+        return;
+    }
+
+    bool first = true;
+    for (const auto& section : workers.front()) {
+        if (!first) {
+            out << std::endl;
+        }
+        first = false;
+        out << section.title << std::endl;
+
+        if (section.title == "Clocks") {
+            for (const auto& row : section.rows) {
+                out << row << std::endl;
+            }
+            continue;
+        }
+
+        // Cedar CSV sections start with a header row.
+        const bool hasHeader = section.title == "OperationThreadCounts" ||
+            section.title == "Operations";
+        if (hasHeader && !section.rows.empty()) {
+            out << section.rows.front() << std::endl;
+        }
+        const size_t skip = hasHeader ? 1 : 0;
+
+        if (section.title == "OperationThreadCounts") {
+            // actor,operation,workers
+            std::map<std::string, size_t> counts;
+            for (const auto& worker : workers) {
+                const auto* theirs = findSection(worker, section.title);
+                for (size_t i = skip; theirs && i < theirs->rows.size(); ++i) {
+                    const auto& row = theirs->rows[i];
+                    const auto comma = row.rfind(',');
+                    counts[row.substr(0, comma)] += std::stoul(row.substr(comma + 1));
+                }
+            }
+            for (const auto& [key, count] : counts) {
+                out << key << "," << count << std::endl;
+            }
+            continue;
+        }
+
+        for (const auto& worker : workers) {
+            const auto* theirs = findSection(worker, section.title);
+            for (size_t i = skip; theirs && i < theirs->rows.size(); ++i) {
+                out << theirs->rows[i] << std::endl;
+            }
+        }
+    }
+}
+
+void mergeWorkerHistogramLogs(const std::vector<std::string>& inputs, std::ostream& out) {
+    // The options and the column names.
+    constexpr size_t kHeaderLines = 2;
+
+    std::string header;
+    for (const auto& input : inputs) {
+        std::ifstream in{input};
+        if (!in) {
+            throw std::runtime_error("Couldn't read worker metrics from " + input);
+        }
+        std::string line;
+        for (size_t i = 0; i < kHeaderLines && std::getline(in, line); ++i) {
+            if (i == 0 && header.empty()) {
+                header = line;
+            } else if (i == 0 && line != header) {
+                throw std::runtime_error("Workers wrote histograms with different options: " +
+                                         input);
+            }
+            if (&input == &inputs.front()) {
+                out << line << std::endl;
+            }
+        }
+        while (std::getline(in, line)) {
+            out << line << std::endl;
+        }
+    }
+}
+
+void mergeWorkerFtdcFiles(const std::string& directory) {
+    namespace fs = boost::filesystem;
+    if (!fs::is_directory(directory)) {
+        return;
+    }
+    const std::regex workerFile{R"((.*)\.worker-([0-9]+)\.ftdc)"};
+
+    // merged file -> worker index -> worker's file
+    std::map<fs::path, std::map<size_t, fs::path>> merges;
+    for (const auto& entry : fs::recursive_directory_iterator{directory}) {
+        std::smatch match;
+        const auto name = entry.path().filename().string();
+        if (fs::is_regular_file(entry.status()) && std::regex_match(name, match, workerFile)) {
+            merges[entry.path().parent_path() / (match[1].str() + ".ftdc")].emplace(
+                std::stoul(match[2].str()), entry.path());
+        }
+    }
+
+    for (const auto& [merged, inputs] : merges) {
+        std::ofstream out{merged.string(), std::ofstream::binary | std::ofstream::trunc};
+        for (const auto& [index, input] : inputs) {
+            std::ifstream in{input.string(), std::ifstream::binary};
+            if (!in) {
+                throw std::runtime_error("Couldn't read worker metrics from " + input.string());
+            }
+            out << in.rdbuf();
+        }
+        if (!out) {
+            throw std::runtime_error("Couldn't write merged metrics to " + merged.string());
+        }
+        out.close();
+        for (const auto& [index, input] : inputs) {
+            fs::remove(input);
+        }
+    }
+}
+
+}  // namespace genny::driver
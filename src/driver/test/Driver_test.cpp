@@ -13,8 +13,10 @@
 // limitations under the License.
 
 #include <fstream>
+#include <map>
 #include <mutex>
 #include <set>
+#include <sstream>
 #include <stdio.h>
 #include <streambuf>
 #include <string>
@@ -92,7 +94,7 @@ struct Fails : public genny::Actor {
     genny::PhaseLoop<PhaseConfig> loop;
     static StaticFailsInfo state;
 
-    explicit Fails(genny::ActorContext& ctx) : Actor(ctx), loop{ctx} {}
+    explicit Fails(genny::ActorContext& ctx) : Actor(ctx), loop{*this, ctx} {}
 
     static std::string_view defaultName() {
         return "Fails";
@@ -125,6 +127,54 @@ auto registerFails = genny::Cast::registerDefault<Fails>();
 // initialize static member of Fails
 StaticFailsInfo Fails::state = {};
 
+struct Counts : public genny::Actor {
+    struct PhaseConfig {
+        genny::metrics::Operation count;
+        PhaseConfig(genny::PhaseContext& phaseContext, genny::ActorId id)
+            : count{phaseContext.operation("Count", id)} {}
+    };
+    genny::PhaseLoop<PhaseConfig> loop;
+
+    explicit Counts(genny::ActorContext& ctx) : Actor(ctx), loop{*this, ctx, Actor::id()} {}
+
+    static std::string_view defaultName() {
+        return "Counts";
+    }
+    void run() override {
+        for (auto&& config : loop) {
+            for (auto&& _ : config) {
+                auto ctx = config->count.start();
+                ctx.addDocuments(1);
+                ctx.success();
+            }
+        }
+    }
+};
+
+namespace {
+auto registerCounts = genny::Cast::registerDefault<Counts>();
+}  // namespace
+
+// The documents each Counts thread recorded, by metric name, from a legacy csv metrics file.
+std::map<std::string, long long> countedDocs(const std::string& metricsPath) {
+    std::map<std::string, long long> out;
+    std::istringstream lines{metricsContents(metricsPath)};
+    std::string line;
+    while (std::getline(lines, line)) {
+        const auto nameStart = line.find(',');
+        const auto nameEnd = line.rfind(',');
+        if (nameStart == std::string::npos || nameStart == nameEnd) {
+            continue;
+        }
+        const auto name = line.substr(nameStart + 1, nameEnd - nameStart - 1);
+        if (name.rfind("Counts.", 0) == 0 && name.size() > 5 &&
+            name.compare(name.size() - 5, 5, "_docs") == 0) {
+            out[name] += std::stoll(line.substr(nameEnd + 1));
+        }
+    }
+    return out;
+}
+
 
 DefaultDriver::ProgramOptions create(const std::string& yaml) {
     DefaultDriver::ProgramOptions opts;
@@ -135,7 +185,8 @@ DefaultDriver::ProgramOptions create(const std::string& yaml) {
     return opts;
 }
 
-std::pair<DefaultDriver::OutcomeCode, std::string> outcome(const std::string& yaml) {
+std::pair<DefaultDriver::OutcomeCode, std::string> outcome(const std::string& yaml,
+                                                           size_t workers = 1) {
     Fails::state.clear();
 
     boost::filesystem::path ph =
@@ -151,6 +202,7 @@ std::pair<DefaultDriver::OutcomeCode, std::string> outcome(const std::string& ya
         )";
     DefaultDriver driver;
     auto opts = create(yaml + metricsSection);
+    opts.workers = workers;
     return {driver.run(opts), metricsPath + ".csv"};
 }
 
@@ -372,3 +424,91 @@ TEST_CASE("Various Actor Behaviors") {
         REQUIRE(hasMetrics(opts));
     }
 }
+
+TEST_CASE("Running in several worker processes") {
+    boost::filesystem::current_path(genny::findRepoRoot());
+
+    SECTION("Metrics are merged") {
+        auto [code, metricsPath] = outcome(R"(
+        SchemaVersion: 2018-07-01
+        Clients:
+          Default:
+            URI: mongodb://localhost:27017
+        Actors:
+        - Type: Fails
+          Name: Fails
+          Threads: 3
+          Phases:
+          - Mode: NoException
+            Repeat: 1
+          - Mode: NoException
+            Repeat: 1
+        )",
+                                           3);
+        REQUIRE(code == DefaultDriver::OutcomeCode::kSuccess);
+        REQUIRE(hasMetrics(metricsPath));
+        for (int i = 0; i < 3; ++i) {
+            const auto prefix = metricsPath.substr(0, metricsPath.size() - 4);
+            REQUIRE(!boost::filesystem::exists(prefix + ".worker-" + std::to_string(i) + ".csv"));
+        }
+    }
+
+    SECTION("Workers split the work of one process") {
+        const auto yaml = R"(
+        SchemaVersion: 2018-07-01
+        Clients:
+          Default:
+            URI: mongodb://localhost:27017
+        Actors:
+        - Type: Counts
+          Name: Counts
+          Threads: 3
+          Phases:
+          - Repeat: 5
+          - Repeat: 2
+        )";
+        auto [oneCode, onePath] = outcome(yaml, 1);
+        REQUIRE(oneCode == DefaultDriver::OutcomeCode::kSuccess);
+        const auto one = countedDocs(onePath);
+        REQUIRE(one.size() == 3);
+
+        auto [twoCode, twoPath] = outcome(yaml, 2);
+        REQUIRE(twoCode == DefaultDriver::OutcomeCode::kSuccess);
+        REQUIRE(countedDocs(twoPath) == one);
+    }
+
+    SECTION("More workers than Actor threads is an error") {
+        auto [code, metricsPath] = outcome(R"(
+        SchemaVersion: 2018-07-01
+        Clients:
+          Default:
+            URI: mongodb://localhost:27017
+        Actors:
+        - Type: Counts
+          Name: Counts
+          Threads: 1
+          Phases:
+          - Repeat: 1
+        )",
+                                           2);
+        REQUIRE(code != DefaultDriver::OutcomeCode::kSuccess);
+    }
+
+    SECTION("A failing worker fails the run") {
+        auto [code, metricsPath] = outcome(R"(
+        SchemaVersion: 2018-07-01
+        Clients:
+          Default:
+            URI: mongodb://localhost:27017
+        Actors:
+        - Type: Fails
+          Name: Fails
+          Threads: 2
+          Phases:
+          - Mode: StdException
+            Repeat: 1
+        )",
+                                           2);
+        REQUIRE(code == DefaultDriver::OutcomeCode::kStandardException);
+    }
+}
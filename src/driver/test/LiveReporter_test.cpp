@@ -0,0 +1,133 @@
+// Copyright 2022-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <chrono>
+#include <string>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <driver/v1/LiveReporter.hpp>
+
+#include <testlib/helpers.hpp>
+
+namespace genny::driver {
+namespace {
+
+using namespace std::chrono_literals;
+
+std::string get(uint16_t port, const std::string& path) {
+    const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    REQUIRE(fd >= 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    ::inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    REQUIRE(::connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) == 0);
+
+    const std::string request = "GET " + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    REQUIRE(::send(fd, request.data(), request.size(), 0) == ssize_t(request.size()));
+    std::string response;
+    char chunk[1024];
+    for (ssize_t n; (n = ::read(fd, chunk, sizeof(chunk))) > 0;) {
+        response.append(chunk, size_t(n));
+    }
+    ::close(fd);
+    return response;
+}
+
+bool contains(const std::string& haystack, const std::string& needle) {
+    return haystack.find(needle) != std::string::npos;
+}
+
+TEST_CASE("Live metrics") {
+    metrics::Registry registry;
+    metrics::internals::v1::LiveOptions options;
+    // Long enough that only the test collects.
+    options.interval = 1h;
+    options.window = 2;
+    options.port = 0;
+    registry.enableLiveStats(options);
+
+    auto insert = registry.operation("Loader", "Insert", 1u);
+    auto insert2 = registry.operation("Loader", "Insert", 2u);
+    auto find = registry.operation("Reader", "Find", 3u);
+
+    const auto now = metrics::clock::now();
+    insert.report(now, 1000us, metrics::OutcomeType::kSuccess, 1, 0, 10, 100);
+    insert2.report(now, 3000us, metrics::OutcomeType::kFailure, 1, 2, 10, 100);
+
+    LiveReporter reporter{registry, options};
+    REQUIRE(reporter.port() != 0);
+
+    // A Prometheus sample for the Insert operation.
+    const auto inserts = [](const std::string& name, const std::string& value) {
+        return name + "{actor=\"Loader\",operation=\"Insert\"} " + value + "\n";
+    };
+
+    SECTION("Sums every thread since the last collection") {
+        reporter.collect();
+        const auto text = reporter.prometheus();
+        REQUIRE(contains(text, "# TYPE genny_operations_total counter\n"));
+        REQUIRE(contains(text, inserts("genny_operations_total", "2")));
+        REQUIRE(contains(text, inserts("genny_operation_threads", "2")));
+        REQUIRE(contains(text, "genny_operations_total{actor=\"Reader\",operation=\"Find\"} 0\n"));
+        REQUIRE(contains(text, inserts("genny_operation_documents_total", "20")));
+        REQUIRE(contains(text, inserts("genny_operation_errors_total", "2")));
+        REQUIRE(contains(text, inserts("genny_operation_failures_total", "1")));
+        REQUIRE(contains(text, inserts("genny_operation_latency_seconds_sum", "0.004")));
+
+        const auto json = reporter.json();
+        REQUIRE(contains(json, "\"actor\":\"Loader\",\"operation\":\"Insert\",\"threads\":2"));
+        REQUIRE(contains(json, "\"max\":3000000"));
+    }
+
+    SECTION("Percentiles only cover the window") {
+        reporter.collect();
+        find.report(metrics::clock::now(), 5us, metrics::OutcomeType::kSuccess);
+        reporter.collect();
+        reporter.collect();
+
+        const auto json = reporter.json();
+        // The Insert events fell out of the two-interval window but still count.
+        REQUIRE(contains(json,
+                         "\"operation\":\"Insert\",\"threads\":2,\"total\":{\"count\":2,"));
+        REQUIRE(contains(json, "\"window\":{\"count\":0,"));
+        REQUIRE(contains(json,
+                         "\"operation\":\"Find\",\"threads\":1,\"total\":{\"count\":1,"));
+        REQUIRE(contains(json, "\"p50\":5000,"));
+    }
+
+    SECTION("Serves Prometheus text and JSON over HTTP") {
+        reporter.collect();
+        const auto text = get(reporter.port(), "/metrics");
+        REQUIRE(text.rfind("HTTP/1.1 200 OK\r\n", 0) == 0);
+        REQUIRE(contains(text, "Content-Type: text/plain; version=0.0.4"));
+        REQUIRE(contains(text, inserts("genny_operations_total", "2")));
+
+        const auto json = get(reporter.port(), "/metrics.json");
+        REQUIRE(json.rfind("HTTP/1.1 200 OK\r\n", 0) == 0);
+        REQUIRE(contains(json, "Content-Type: application/json"));
+        REQUIRE(contains(json, "\"operations\":[{\"actor\":\"Loader\""));
+
+        REQUIRE(get(reporter.port(), "/nope").rfind("HTTP/1.1 404 Not Found\r\n", 0) == 0);
+    }
+
+    reporter.stop();
+}
+
+}  // namespace
+}  // namespace genny::driver
@@ -29,6 +29,13 @@ TEST_CASE("ProgramOptions behavior") {
         REQUIRE(opts.parseOutcome == genny::driver::DefaultDriver::OutcomeCode::kUserException);
     }
 
+    SECTION("workers") {
+        const char* argv[] = {"run-genny", "run", "--workers", "4"};
+        auto opts = genny::driver::DefaultDriver::ProgramOptions(4, (char**)argv);
+        REQUIRE(opts.parseOutcome == genny::driver::DefaultDriver::OutcomeCode::kSuccess);
+        REQUIRE(opts.workers == 4);
+    }
+
     SECTION("valid subcommand") {
         const char* argv[] = {"run-genny", "dry-run"};
         auto opts = genny::driver::DefaultDriver::ProgramOptions(2, (char**)argv);
@@ -0,0 +1,202 @@
+// Copyright 2022-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <fstream>
+#include <future>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <boost/filesystem.hpp>
+
+#include <driver/v1/WorkerFanOut.hpp>
+
+#include <testlib/helpers.hpp>
+
+namespace genny::driver {
+namespace {
+
+std::string writeTemp(const std::string& contents) {
+    const auto path =
+        (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()).string();
+    std::ofstream{path} << contents;
+    return path;
+}
+
+TEST_CASE("Worker CSV paths") {
+    REQUIRE(workerCsvPath("out/metrics", genny::v1::WorkerIdentity{}) == "out/metrics.csv");
+    REQUIRE(workerCsvPath("out/metrics", genny::v1::WorkerIdentity{2, 4}) ==
+            "out/metrics.worker-2.csv");
+    REQUIRE(genny::v1::WorkerIdentity{2, 4}.filePath("out/metrics", ".intervals.csv") ==
+            "out/metrics.worker-2.intervals.csv");
+}
+
+TEST_CASE("Starting workers") {
+    SECTION("The first failing worker's exit code is returned") {
+        REQUIRE(fanOut(3, [](const genny::v1::WorkerIdentity& worker) {
+                    return worker.index == 1 ? 5 : 0;
+                }) == 5);
+        REQUIRE(fanOut(2, [](const genny::v1::WorkerIdentity&) { return 0; }) == 0);
+    }
+
+    SECTION("Workers aren't forked from a process with other threads") {
+        if (!boost::filesystem::exists("/proc/self/task")) {
+            return;
+        }
+        std::promise<void> done;
+        std::thread other{[finished = done.get_future()]() { finished.wait(); }};
+        REQUIRE_THROWS_AS(fanOut(2, [](const genny::v1::WorkerIdentity&) { return 0; }),
+                          std::logic_error);
+        done.set_value();
+        other.join();
+    }
+}
+
+TEST_CASE("Worker metrics info") {
+    const auto path =
+        (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()).string();
+    REQUIRE(!readWorkerMetricsInfo(path));
+
+    writeWorkerMetricsInfo(path, {"cedar-csv", "out/a=b metrics"});
+    const auto info = readWorkerMetricsInfo(path);
+    REQUIRE(info);
+    REQUIRE(info->format == "cedar-csv");
+    REQUIRE(info->pathPrefix == "out/a=b metrics");
+
+    std::ofstream{path} << "format=csv" << std::endl;
+    REQUIRE_THROWS_AS(readWorkerMetricsInfo(path), std::runtime_error);
+    boost::filesystem::remove(path);
+}
+
+TEST_CASE("Merging worker CSV metrics") {
+    SECTION("Cedar CSV") {
+        const auto first = writeTemp(
+            "Clocks\n"
+            "clock,nanoseconds\n"
+            "SystemTime,100\n"
+            "MetricsTime,10\n"
+            "\n"
+            "OperationThreadCounts\n"
+            "actor,operation,workers\n"
+            "Insert,Insert,2\n"
+            "\n"
+            "Operations\n"
+            "timestamp,actor,thread,operation,duration,outcome,n,ops,errors,size\n"
+            "5,Insert,1,Insert,7,0,1,1,0,0\n");
+        const auto second = writeTemp(
+            "Clocks\n"
+            "clock,nanoseconds\n"
+            "SystemTime,200\n"
+            "MetricsTime,20\n"
+            "\n"
+            "OperationThreadCounts\n"
+            "actor,operation,workers\n"
+            "Find,Find,1\n"
+            "Insert,Insert,2\n"
+            "\n"
+            "Operations\n"
+            "timestamp,actor,thread,operation,duration,outcome,n,ops,errors,size\n"
+            "6,Insert,1048577,Insert,8,0,1,1,0,0\n");
+
+        std::stringstream out;
+        mergeWorkerCsv({first, second}, out);
+        REQUIRE(out.str() ==
+                "Clocks\n"
+                "clock,nanoseconds\n"
+                "SystemTime,100\n"
+                "MetricsTime,10\n"
+                "\n"
+                "OperationThreadCounts\n"
+                "actor,operation,workers\n"
+                "Find,Find,1\n"
+                "Insert,Insert,4\n"
+                "\n"
+                "Operations\n"
+                "timestamp,actor,thread,operation,duration,outcome,n,ops,errors,size\n"
+                "5,Insert,1,Insert,7,0,1,1,0,0\n"
+                "6,Insert,1048577,Insert,8,0,1,1,0,0\n");
+    }
+
+    SECTION("Legacy CSV") {
+        const auto first = writeTemp(
+            "Clocks\nSystemTime,100\nMetricsTime,10\n\n"
+            "Counters\n5,Insert.id-1.Insert_docs,1\n\n"
+            "Gauges\n\n"
+            "Timers\n5,Insert.id-1.Insert_timer,7\n\n");
+        const auto second = writeTemp(
+            "Clocks\nSystemTime,200\nMetricsTime,20\n\n"
+            "Counters\n6,Insert.id-1048577.Insert_docs,1\n\n"
+            "Gauges\n\n"
+            "Timers\n6,Insert.id-1048577.Insert_timer,8\n\n");
+
+        std::stringstream out;
+        mergeWorkerCsv({first, second}, out);
+        REQUIRE(out.str() ==
+                "Clocks\nSystemTime,100\nMetricsTime,10\n\n"
+                "Counters\n5,Insert.id-1.Insert_docs,1\n6,Insert.id-1048577.Insert_docs,1\n\n"
+                "Gauges\n\n"
+                "Timers\n5,Insert.id-1.Insert_timer,7\n6,Insert.id-1048577.Insert_timer,8\n");
+    }
+
+    SECTION("Histogram interval logs") {
+        const auto header =
+            "#genny-histogram-log,significant-digits=3,interval-ns=1000000000\n"
+            "start,actor,operation,thread,count,ops,documents,bytes,errors,failures,duration,min,"
+            "max,counts\n";
+        const auto first =
+            writeTemp(std::string{header} + "0,Insert,Insert,1,1,1,1,0,0,0,7,7,7,7:1\n");
+        const auto second =
+            writeTemp(std::string{header} + "0,Insert,Insert,1048577,1,1,1,0,0,0,8,8,8,8:1\n");
+
+        std::stringstream out;
+        mergeWorkerHistogramLogs({first, second}, out);
+        REQUIRE(out.str() ==
+                std::string{header} +
+                    "0,Insert,Insert,1,1,1,1,0,0,0,7,7,7,7:1\n"
+                    "0,Insert,Insert,1048577,1,1,1,0,0,0,8,8,8,8:1\n");
+
+        const auto otherPrecision = writeTemp(
+            "#genny-histogram-log,significant-digits=2,interval-ns=1000000000\n"
+            "start,actor,operation,thread,count,ops,documents,bytes,errors,failures,duration,min,"
+            "max,counts\n");
+        std::stringstream ignored;
+        REQUIRE_THROWS(mergeWorkerHistogramLogs({first, otherPrecision}, ignored));
+    }
+
+    SECTION("Native FTDC files") {
+        namespace fs = boost::filesystem;
+        const auto dir = fs::temp_directory_path() / fs::unique_path();
+        fs::create_directories(dir / "internal");
+        std::ofstream{(dir / "Insert.Insert.worker-1.ftdc").string()} << "second";
+        std::ofstream{(dir / "Insert.Insert.worker-0.ftdc").string()} << "first";
+        std::ofstream{(dir / "internal" / "Setup.worker-1.ftdc").string()} << "only";
+
+        mergeWorkerFtdcFiles(dir.string());
+
+        const auto contents = [](const fs::path& path) {
+            std::stringstream out;
+            out << std::ifstream{path.string()}.rdbuf();
+            return out.str();
+        };
+        REQUIRE(contents(dir / "Insert.Insert.ftdc") == "firstsecond");
+        REQUIRE(contents(dir / "internal" / "Setup.ftdc") == "only");
+        REQUIRE_FALSE(fs::exists(dir / "Insert.Insert.worker-0.ftdc"));
+        REQUIRE_FALSE(fs::exists(dir / "internal" / "Setup.worker-1.ftdc"));
+        fs::remove_all(dir);
+    }
+}
+
+}  // namespace
+}  // namespace genny::driver
@@ -13,6 +13,12 @@
 // limitations under the License.
 #include <boost/log/trivial.hpp>
 
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <gennylib/GlobalRateLimiter.hpp>
 #include <gennylib/PhaseLoop.hpp>
 
 #include <testlib/ActorHelper.hpp>
@@ -30,7 +36,7 @@ TEST_CASE("Find max performance of rate limiter", "[benchmark]") {
 
         IncActor(genny::ActorContext& ac)
             : Actor(ac),
-              _loop{ac},
+              _loop{*this, ac},
               _counter{WorkloadContext::getActorSharedState<IncActor, IncCounter>()} {
             _counter.store(0);
         };
@@ -99,5 +105,88 @@ Actors:
     // Print out the result if both REQUIRE pass.
     BOOST_LOG_TRIVIAL(info) << getCurState();
 }
+TEST_CASE("Rate limiter contention", "[benchmark]") {
+    using namespace std::chrono_literals;
+
+    // Hammer a single limiter from many threads at a rate higher than they can
+    // reach so the limiter itself is the bottleneck.
+    auto run = [](int64_t numThreads, bool leased) {
+        GlobalRateLimiter limiter{BaseRateSpec{1, 1}};  // 1 per nanosecond.
+        for (int64_t i = 0; i < numThreads; ++i) {
+            limiter.addUser();
+        }
+        limiter.resetLastEmptied();
+
+        std::atomic_int64_t total = 0;
+        const auto start = SteadyClock::now();
+        const auto end = start + 500ms;
+
+        std::vector<std::thread> threads;
+        for (int64_t i = 0; i < numThreads; ++i) {
+            threads.emplace_back([&]() {
+                GlobalRateLimiter::Lease lease;
+                int64_t ops = 0;
+                for (auto now = SteadyClock::now(); now < end; now = SteadyClock::now()) {
+                    const auto success = leased ? limiter.consumeIfWithinRate(now, lease)
+                                                : limiter.consumeIfWithinRate(now);
+                    ops += success;
+                }
+                total += ops;
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        const auto seconds =
+            std::chrono::duration<double>(SteadyClock::now() - start).count();
+        BOOST_LOG_TRIVIAL(info) << numThreads << " threads " << (leased ? "leased" : "unleased")
+                                << ": " << int64_t(total / seconds) << " tokens/s";
+        return total.load();
+    };
+
+    SECTION("Throughput by thread count") {
+        for (int64_t numThreads : {1, 4, 16, 64, 256}) {
+            REQUIRE(run(numThreads, false) > 0);
+            REQUIRE(run(numThreads, true) > 0);
+        }
+    }
+
+    SECTION("Leases don't exceed the rate") {
+        // 200k tokens/s for half a second.
+        GlobalRateLimiter limiter{BaseRateSpec{5000, 1}};
+        const int64_t numThreads = 256;
+        for (int64_t i = 0; i < numThreads; ++i) {
+            limiter.addUser();
+        }
+        limiter.resetLastEmptied();
+        const auto start = SteadyClock::now();
+
+        std::atomic_int64_t total = 0;
+        std::vector<std::thread> threads;
+        for (int64_t i = 0; i < numThreads; ++i) {
+            threads.emplace_back([&]() {
+                GlobalRateLimiter::Lease lease;
+                while (SteadyClock::now() < start + 500ms) {
+                    if (limiter.consumeIfWithinRate(SteadyClock::now(), lease)) {
+                        ++total;
+                    } else {
+                        std::this_thread::sleep_for(limiter.backoffDuration());
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        const int64_t expected = 100 * 1000;
+        BOOST_LOG_TRIVIAL(info) << total << " of " << expected << " tokens used";
+        // Threads that checked the time just before the end can still take a token or two.
+        REQUIRE(total <= expected * 1.01);
+        REQUIRE(total > expected * 0.90);
+    }
+}
+
 }  // namespace
 }  // namespace genny::testing
@@ -23,6 +23,7 @@
 #include <yaml-cpp/yaml.h>
 
 #include <boost/format.hpp>
+#include <boost/log/trivial.hpp>
 #include <boost/thread/barrier.hpp>
 
 #include <gennylib/Orchestrator.hpp>
@@ -49,7 +50,7 @@ struct IncrementsActor : public Actor {
 
     PhaseLoop<PhaseConfig> _loop;
 
-    IncrementsActor(ActorContext& ctx) : Actor(ctx), _loop{ctx} {}
+    IncrementsActor(ActorContext& ctx) : Actor(ctx), _loop{*this, ctx} {}
 
     void run() override {
         for (auto&& config : _loop) {
@@ -60,6 +61,32 @@ struct IncrementsActor : public Actor {
     }
 };
 
+// Like IncrementsActor but only touches shared state once at the end of its run.
+// Used to measure the scaling of the PhaseLoop machinery itself without every
+// thread fighting over the `increments` cache-line.
+struct LocalIncrementsActor : public Actor {
+
+    struct PhaseConfig {
+        PhaseConfig(PhaseContext& phaseContext) {}
+    };
+
+    static atomic_long increments;
+
+    PhaseLoop<PhaseConfig> _loop;
+
+    LocalIncrementsActor(ActorContext& ctx) : Actor(ctx), _loop{*this, ctx} {}
+
+    void run() override {
+        long local = 0;
+        for (auto&& config : _loop) {
+            for (auto&& _ : config) {
+                ++local;
+            }
+        }
+        increments += local;
+    }
+};
+
 struct VirtualRunnable {
     virtual void run() = 0;
 };
@@ -88,6 +115,7 @@ struct IncrementsRunnable : public VirtualRunnable {
 
 atomic_bool IncrementsRunnable::stop = false;
 atomic_int IncrementsActor::increments = 0;
+atomic_long LocalIncrementsActor::increments = 0;
 atomic_int IncrementsRunnable::increments = 0;
 
 using clock = std::chrono::steady_clock;
@@ -152,6 +180,32 @@ auto runActors(int threads, long iterations) {
     return actorDur;
 }
 
+auto runLocalActors(int threads, long iterations) {
+    LocalIncrementsActor::increments = 0;
+    auto configString = boost::format(R"(
+    SchemaVersion: 2018-07-01
+    Actors:
+    - Type: LocalIncrements
+      Name: LocalIncrements
+      Threads: %i
+      Phases:
+      - Repeat: %i
+    )") %
+        threads % iterations;
+    auto config = NodeSource(configString.str(), "");
+
+    auto incProducer =
+        std::make_shared<DefaultActorProducer<LocalIncrementsActor>>("LocalIncrements");
+
+    int64_t actorDur;
+
+    ActorHelper ac(config.root(), threads, {{"LocalIncrements", incProducer}});
+    ac.run([&actorDur](const WorkloadContext& wc) { actorDur = timedRun(wc.actors()); });
+
+    REQUIRE(LocalIncrementsActor::increments == threads * iterations);
+    return actorDur;
+}
+
 void comparePerformance(int threads, long iterations, int tolerance) {
     // just do the stupid simple thing and run it 5 times and take the mean, no need to make it
     // fancy...
@@ -194,3 +248,25 @@ TEST_CASE("PhaseLoop performance", "[benchmark]") {
     // higher tolerance for added latency with more threads
     comparePerformance(500, 10000, 100);
 }
+
+TEST_CASE("PhaseLoop throughput scaling", "[benchmark]") {
+    // Every iteration of the inner loop reads the Orchestrator's phase state
+    // (ActorPhaseIterator checks continueRunning() and currentPhase()), so
+    // any locking there shows up as throughput that flattens or drops as
+    // threads are added. Report aggregate iterations/second so regressions
+    // are visible in the benchmark output.
+    const long iterations = 100000;
+
+    for (int threads = 1; threads <= 1024; threads *= 2) {
+        auto nanos = runLocalActors(threads, iterations);
+        auto total = double(threads) * double(iterations);
+        auto perSecond = total / (double(nanos) / 1e9);
+
+        BOOST_LOG_TRIVIAL(info) << "threads=" << threads << ", iterations=" << iterations
+                                << ", duration=" << nanos << "ns"
+                                << ", throughput=" << static_cast<int64_t>(perSecond)
+                                << " iterations/s"
+                                << ", per-thread=" << static_cast<int64_t>(perSecond / threads)
+                                << " iterations/s";
+    }
+}
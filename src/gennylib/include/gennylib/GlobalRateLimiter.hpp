@@ -18,9 +18,19 @@
 #include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <cmath>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <random>
 #include <thread>
+#include <type_traits>
 
 #include <gennylib/conventions.hpp>
+#include <gennylib/v1/FiberPool.hpp>
+#include <gennylib/v1/LatencyHistogram.hpp>
+
+#include <metrics/operation.hpp>
 
 namespace genny {
 
@@ -38,6 +48,41 @@ using SteadyClock = std::chrono::steady_clock;
  * use case for each class. If you're unsure and "just need
  * a rate limiter", use this one.
  *
+ * A rate of `B per T` makes B tokens available at the start of the phase and B more
+ * every T after that. Token `i` (counting from zero at the start of the phase) is due
+ * at `start + (i / B) * T`, so the whole bucket is a single counter of how many tokens
+ * have been handed out. Tokens that aren't claimed when they're due stay available.
+ *
+ * A RateProfileSpec instead makes one token available at the start of the phase and then
+ * however many the profile's rate integrates to as the phase goes on. Token `i` is due once
+ * `RateProfileSpec::operationsBy(now - start) >= i`.
+ *
+ * A LatencyTargetRateSpec starts each phase at its `Start` rate and re-evaluates it every
+ * `Adjust` interval from the latencies of the operations reported while the limiter is in
+ * use (see latencyObserver()). If the chosen percentile was under the target and the Actors
+ * used the tokens they were given, the rate goes up; if it was over, the rate goes down. The
+ * size of each step halves whenever the direction changes and doubles after several
+ * consecutive increases, so the rate settles just under the highest rate that meets the
+ * target and can still follow the system under test if its capacity changes.
+ *
+ * Callers that hold a Lease take a share of the tokens that are already due in one
+ * compare-and-swap and hand them out locally on subsequent calls. This keeps threads off
+ * the shared cache line when the rate is high.
+ *
+ * Accuracy
+ * 1. The number of tokens handed out (including those sitting in leases) never exceeds
+ * the number due by the schedule at the time they're handed out. Leases can't run ahead
+ * of the rate, only behind it.
+ *
+ * 2. A lease is at most `kMaxLease` tokens and is at most a `1/getNumUsers()` share of the
+ * tokens due at that moment, so when the limiter keeps up with its schedule each lease is a
+ * single token and behavior is identical to handing out tokens one at a time. Leases only
+ * grow when a backlog of due tokens has built up.
+ *
+ * 3. Leases are invalidated when the limiter is reset at the start of a phase. Tokens still
+ * in leases at that point are dropped, so a phase can fall short of its rate by at most
+ * `kMaxLease` tokens per thread.
+ *
  * Notes
  * 1. There can be multiple global rate limiters each responsible for
  * a subset of threads. Coordinating across multiple global rate limiters
@@ -52,7 +97,7 @@ using SteadyClock = std::chrono::steady_clock;
  * https://github.com/facebook/folly/blob/7c6897aa18e71964e097fc238c93b3efa98b2c61/folly/TokenBucket.h
  */
 template <typename ClockT = std::chrono::steady_clock>
-class BaseGlobalRateLimiter {
+class BaseGlobalRateLimiter : private metrics::internals::v1::LatencyObserver {
 public:
     // This should be replaced with std::hardware_destructive_interference_size, which is
     // part of c++17 but not part of any (major) standard library. Search P0154R1
@@ -61,10 +106,32 @@ public:
     // 64 is the cache line size for recent Intel and AMD processors.
     static const int CacheLineSize = 64;
 
+    // Upper bound on the number of tokens a single Lease holds.
+    static constexpr int64_t kMaxLease = 64;
+
+    // How often a profiled rate reports its current target.
+    static constexpr int64_t kTargetRateIntervalNS = 1000 * 1000 * 1000;
+
+    /**
+     * Receives the current target rate, in operations per second, of a profiled rate.
+     */
+    using TargetRateGauge = std::function<void(double)>;
+
     static_assert(ClockT::is_steady, "Clock must be steady");
     static_assert(std::is_same<typename ClockT::duration, std::chrono::nanoseconds>::value,
                   "Clock representation must be nano seconds");
 
+    /**
+     * Tokens taken from the bucket by one caller but not yet used.
+     *
+     * Each thread (or fiber) should have its own. A Lease is only valid for the phase it was
+     * taken in.
+     */
+    struct Lease {
+        int64_t generation = -1;
+        int64_t tokens = 0;
+    };
+
 public:
     explicit BaseGlobalRateLimiter(const RateSpec& rs) {
         if (auto spec = rs.getBaseSpec()) {
@@ -76,6 +143,16 @@ public:
             _rateNS = 0;
             _percent = spec->percent;
             _fullSpeed = true;
+        } else if (auto spec = rs.getProfileSpec()) {
+            _burstSize = 1;
+            _rateNS = 0;
+            _profile = std::move(spec);
+            _fullSpeed = false;
+        } else if (auto spec = rs.getLatencyTargetSpec()) {
+            _burstSize = 1;
+            _latencyTarget.emplace(*spec);
+            _rateNS = _latencyTarget->startRateNS();
+            _fullSpeed = false;
         }
     }
 
@@ -86,7 +163,7 @@ public:
     BaseGlobalRateLimiter(BaseGlobalRateLimiter&& other) = delete;
     BaseGlobalRateLimiter& operator=(BaseGlobalRateLimiter&& other) = delete;
 
-    ~BaseGlobalRateLimiter() = default;
+    ~BaseGlobalRateLimiter() override = default;
 
     /**
      * Request to consume 1 token from the bucket. Does not block
@@ -97,58 +174,77 @@ public:
      * appropriate back-off strategy if this function returns false.
      */
     bool consumeIfWithinRate(const typename ClockT::time_point& now) {
+        if (auto breakIn = this->isBreakin()) {
+            return *breakIn;
+        }
+        this->maybeAdjust(now);
+        return this->acquire(now, 1) > 0;
+    }
 
+    /**
+     * Like consumeIfWithinRate(now) but takes the token from `lease` if it has one, and
+     * otherwise refills `lease` with a share of the tokens that are due.
+     */
+    bool consumeIfWithinRate(const typename ClockT::time_point& now, Lease& lease) {
         if (auto breakIn = this->isBreakin()) {
             return *breakIn;
         }
+        this->maybeAdjust(now);
 
-        // This if-block deviates from the "burst" behavior of the default token-bucket
-        // algorithm. Instead of having the caller burst, we parallelize the burst
-        // behavior by granting one token to each consumer thread across as many threads
-        // as possible, up to "_burstSize".
-        //
-        // This means we basically have two serial token bucket rate limiters. We first
-        // check the bucket for _burstCount, and proceeed if there are tokens available
-        // (i.e. canBurst is true). If not, we fallback to the token bucket for
-        // _lastEmptiedTimeNS and check if the emptied time is in the future.
-        if (_burstSize > 1) {
-            int64_t curBurstCount = _burstCount.load();
-            const bool canBurst = (curBurstCount % _burstSize) != 0;
-            if (canBurst) {
-                return _burstCount.compare_exchange_weak(curBurstCount, curBurstCount + 1);
+        const auto generation = _generation.load(std::memory_order_acquire);
+        if (lease.generation != generation) {
+            lease = Lease{generation, 0};
+        }
+        if (lease.tokens == 0) {
+            lease.tokens = this->acquire(now, this->leaseSize(now));
+            if (lease.tokens == 0) {
+                return false;
             }
         }
+        --lease.tokens;
+        return true;
+    }
 
-        // The time the bucket was emptied before this consumeIfWithinRate() call.
-        int64_t curEmptiedTime = _lastEmptiedTimeNS.load();
-
-        // The time the bucket was emptied after this consumeIfWithinRate() call.
-        const auto newEmptiedTime = curEmptiedTime + getRate();
-
-        // If the new emptied time is in the future, the bucket is empty. Return early.
-        if (now.time_since_epoch().count() < newEmptiedTime) {
-            return false;
+    /**
+     * @return the current number of nanoseconds between tokens. Profiled rates are evaluated
+     * at the current time.
+     */
+    int64_t getRate() const {
+        if (_profile) {
+            const auto perSecond =
+                this->operationsPerSecondAt(ClockT::now().time_since_epoch().count());
+            // Back off as if the rate were at least 1 per second.
+            return perSecond > 1 ? int64_t(1e9 / perSecond) : int64_t(1e9);
         }
+        return _rateNS;
+    }
 
-        // Use the "weak" version for performance at the expense of false negatives (i.e.
-        // `compare_exchange` not comparing equal when it should).
-        const auto success =
-            _lastEmptiedTimeNS.compare_exchange_weak(curEmptiedTime, newEmptiedTime);
-
-
-        // Note that incrementing _burstCount is *not* atomic with incrementing _lastEmptiedTimeNS.
-        // This may cause some threads to see an outdated _burstCount, causing unnecessary waiting
-        // in the caller. For this reason, the caller should ensure the number of tokens does not
-        // greatly exceed _burstSize.
-        if (success) {
-            _burstCount++;
-        }
-        return success;
+    /**
+     * @return where the PhaseLoop should send the latencies of operations paced by this
+     * limiter, or nullptr if it doesn't use them.
+     */
+    metrics::internals::v1::LatencyObserver* latencyObserver() {
+        return _latencyTarget ? this : nullptr;
     }
 
+    /**
+     * @return the highest rate, in operations per second, at which the latency target was
+     * met in the current or most recent phase. Only meaningful for latency targets.
+     */
+    double convergedRate() const {
+        std::lock_guard<std::mutex> lock{_targetRateMutex};
+        return _latencyTarget ? _latencyTarget->bestPerSecond : 0;
+    }
 
-    constexpr int64_t getRate() const {
-        return _rateNS;
+    /**
+     * Report the target rate to `gauge` at the start of every phase and about once a second
+     * after that. Only profiled and latency-target rates report their target.
+     *
+     * Must be called before the limiter is used. The gauge is called by whichever thread
+     * happens to notice a report is due, but never by two threads at once.
+     */
+    void setTargetRateGauge(TargetRateGauge gauge) {
+        _targetRateGauge = std::move(gauge);
     }
 
     /**
@@ -168,8 +264,27 @@ public:
         _numUsers++;
     }
 
+    /**
+     * Issue only `fraction` of a fixed rate, for when other processes issue the rest and run
+     * the other users. A percentile rate keeps its percent since it only measures the threads
+     * that use it here.
+     *
+     * Must be called after every addUser() and before the limiter is used. Profiled and
+     * latency-target rates can't be split.
+     */
+    void splitRate(double fraction) {
+        _numUsers = std::max(int64_t{1}, int64_t(std::llround(double(_numUsers) * fraction)));
+        if (!_percent) {
+            _rateNS = std::max(int64_t{1}, int64_t(double(_rateNS.load()) / fraction));
+        }
+    }
+
     void notifyOfIteration() {
-        _iters++;
+        // Only the percentile break-in looks at the iteration count. Don't make every
+        // iteration of every thread write to a shared cache line for it.
+        if (_fullSpeed.load(std::memory_order_relaxed)) {
+            _iters++;
+        }
     }
 
     /**
@@ -177,30 +292,32 @@ public:
      * the start of each phase.
      */
     void resetLastEmptied() noexcept {
-        _lastEmptiedTimeNS = ClockT::now().time_since_epoch().count() - _rateNS;
+        this->restartSchedule(ClockT::now().time_since_epoch().count());
         _iters = 0;
         if (_percent) {
             _fullSpeed = true;
         }
     }
 
-    void simpleLimitRate() {
-        while (true) {
-            const auto now = SteadyClock::now();
-            const auto success = this->consumeIfWithinRate(now);
-            if (!success) {
-
-                // Don't sleep for more than 1 second (1e9 nanoseconds). Otherwise rates
-                // specified in seconds or lower resolution can cause the workloads to
-                // run visibly longer than the specified duration.
-                const auto rate = this->getRate() > 1e9 ? 1e9 : this->getRate();
+    /**
+     * @return how long to back off after consumeIfWithinRate() returns false.
+     */
+    std::chrono::nanoseconds backoffDuration() const {
+        // Don't sleep for more than 1 second (1e9 nanoseconds). Otherwise rates
+        // specified in seconds or lower resolution can cause the workloads to
+        // run visibly longer than the specified duration.
+        const auto rate = this->getRate() > 1e9 ? 1e9 : this->getRate();
+
+        // Add ±5% jitter to avoid threads waking up at once. Each thread has its own
+        // generator; rand() takes a process-wide lock.
+        thread_local std::minstd_rand rng{std::random_device{}()};
+        std::uniform_real_distribution<double> jitter{0.95, 1.05};
+        return std::chrono::nanoseconds(int64_t(rate * jitter(rng)));
+    }
 
-                // Add ±5% jitter to avoid threads waking up at once.
-                std::this_thread::sleep_for(std::chrono::nanoseconds(
-                    int64_t(rate * (0.95 + 0.1 * (double(rand()) / RAND_MAX)))));
-                continue;
-            }
-            break;
+    void simpleLimitRate() {
+        while (!this->consumeIfWithinRate(ClockT::now())) {
+            v1::sleepFor(this->backoffDuration());
         }
         this->notifyOfIteration();
     }
@@ -219,7 +336,7 @@ private:
         }
 
         _burstCount++;
-        auto nsSincePhaseStarted = ClockT::now().time_since_epoch().count() - _lastEmptiedTimeNS;
+        auto nsSincePhaseStarted = ClockT::now().time_since_epoch().count() - _startNS;
 
         // 3 iterations or 1 minute, whichever is longer.
         if (_iters >= _numUsers * 3 && nsSincePhaseStarted >= _nsPerMinute) {
@@ -230,31 +347,243 @@ private:
             // Reconfigure as a "normal" rate limiter running for the first time.
             _burstSize = _burstCount * _percent.value() / 100;
             _rateNS = nsSincePhaseStarted;
-            _lastEmptiedTimeNS = ClockT::now().time_since_epoch().count() - _rateNS;
+            this->restartSchedule(ClockT::now().time_since_epoch().count());
             _burstCount = 0;
             _fullSpeed = false;
         }
         return true;
     }
 
+    /**
+     * State of the controller for a LatencyTargetRateSpec. Guarded by _targetRateMutex.
+     */
+    struct LatencyTarget {
+        // Steps are a fraction of the current rate.
+        static constexpr double kMaxStep = 0.5;
+        static constexpr double kMinStep = 0.01;
+        // Consecutive moves in one direction before the step grows again.
+        static constexpr int kMovesBeforeGrowing = 3;
+        // Too few latencies to trust the percentile; wait for more.
+        static constexpr uint64_t kMinSamples = 20;
+
+        explicit LatencyTarget(LatencyTargetRateSpec spec) : spec{spec} {
+            this->restart();
+        }
 
-    // Manually align _lastEmptiedTimeNS and _burstCount here to vastly improve performance.
-    // Lazily initialized by the first call to consumeIfWithinRate().
-    // Note that std::chrono::time_point is not trivially copyable and can't be used here.
-    alignas(BaseGlobalRateLimiter::CacheLineSize) std::atomic_int64_t _lastEmptiedTimeNS = 0;
-    // _burstCount stores the remaining
+        int64_t startRateNS() const {
+            return std::max(int64_t{1}, spec.start.per.count() / spec.start.operations);
+        }
+
+        void restart() {
+            step = kMaxStep;
+            direction = 0;
+            movesInDirection = 0;
+            bestPerSecond = 0;
+        }
+
+        const LatencyTargetRateSpec spec;
+        v1::LatencyHistogram latencies;
+        v1::LatencyHistogram::Counts lastCounts =
+            v1::LatencyHistogram::Counts(v1::LatencyHistogram::kBuckets, 0);
+        double step;
+        int direction;
+        int movesInDirection;
+        double bestPerSecond;
+    };
+
+    void observe(std::chrono::nanoseconds latency) override {
+        _latencyTarget->latencies.record(latency);
+    }
+
+    void restartSchedule(int64_t nowNS) noexcept {
+        if (_latencyTarget) {
+            std::lock_guard<std::mutex> lock{_targetRateMutex};
+            _latencyTarget->restart();
+            _latencyTarget->lastCounts = _latencyTarget->latencies.snapshot();
+            _rateNS = _latencyTarget->startRateNS();
+            _nextAdjustNS = nowNS + _latencyTarget->spec.interval.count();
+        }
+        _startNS = nowNS;
+        _issued = 0;
+        _generation++;
+        _nextTargetRateNS = nowNS;
+    }
+
+    double operationsPerSecondAt(int64_t nowNS) const {
+        if (_profile) {
+            const auto elapsed = std::chrono::nanoseconds{std::max(int64_t{0}, nowNS - _startNS)};
+            return _profile->operationsPerNanosecond(elapsed) * 1e9;
+        }
+        return 1e9 / std::max(int64_t{1}, _rateNS.load());
+    }
+
+    void maybeAdjust(const typename ClockT::time_point& now) {
+        if (!(_profile || _latencyTarget)) {
+            return;
+        }
+        const int64_t nowNS = now.time_since_epoch().count();
+        if (nowNS < _nextTargetRateNS.load(std::memory_order_relaxed) &&
+            (!_latencyTarget || nowNS < _nextAdjustNS.load(std::memory_order_relaxed))) {
+            return;
+        }
+        // Whoever gets the lock does the work; everyone else carries on.
+        std::unique_lock<std::mutex> lock{_targetRateMutex, std::try_to_lock};
+        if (!lock) {
+            return;
+        }
+        if (_latencyTarget && nowNS >= _nextAdjustNS.load()) {
+            this->adjustToLatencyTarget(nowNS);
+        }
+        if (_targetRateGauge && nowNS >= _nextTargetRateNS.load()) {
+            _nextTargetRateNS = nowNS + kTargetRateIntervalNS;
+            _targetRateGauge(this->operationsPerSecondAt(nowNS));
+        }
+    }
+
+    // Call with _targetRateMutex held.
+    void adjustToLatencyTarget(int64_t nowNS) {
+        auto& target = *_latencyTarget;
+        auto total = target.latencies.snapshot();
+        auto counts = total;
+        uint64_t samples = 0;
+        for (size_t i = 0; i < counts.size(); ++i) {
+            counts[i] -= target.lastCounts[i];
+            samples += counts[i];
+        }
+        _nextAdjustNS = nowNS + target.spec.interval.count();
+        if (samples < LatencyTarget::kMinSamples) {
+            // Keep accumulating into the same window.
+            return;
+        }
+        target.lastCounts = std::move(total);
+
+        const auto rateNS = _rateNS.load();
+        const double perSecond = 1e9 / rateNS;
+        const bool metTarget = v1::LatencyHistogram::percentile(counts, target.spec.percentile) <=
+            target.spec.target;
+        // Were the Actors keeping up with the tokens? If not, a higher rate wouldn't change
+        // anything.
+        const double expected = double(nowNS - _startNS) / rateNS + 1;
+        const bool limited = _issued.load() >= 0.9 * expected;
+
+        if (metTarget && limited) {
+            target.bestPerSecond = perSecond;
+        }
+        if (metTarget && !limited) {
+            return;
+        }
+
+        const int direction = metTarget ? 1 : -1;
+        if (direction == target.direction) {
+            // Only grow the step while probing upwards. Backing off keeps its step so a
+            // run of windows over the target doesn't throw away what was learned.
+            if (metTarget && ++target.movesInDirection >= LatencyTarget::kMovesBeforeGrowing) {
+                target.step = std::min(LatencyTarget::kMaxStep, target.step * 2);
+                target.movesInDirection = 0;
+            }
+        } else {
+            if (target.direction != 0) {
+                target.step = std::max(LatencyTarget::kMinStep, target.step / 2);
+            }
+            target.direction = direction;
+            target.movesInDirection = 0;
+        }
+        const double newPerSecond =
+            metTarget ? perSecond * (1 + target.step) : perSecond / (1 + target.step);
+
+        // Start a new schedule at the new rate so tokens that weren't used at the old
+        // rate don't come out in a burst. Callers racing with this may see a mix of the
+        // old and new schedule for one acquire(); that's at most a lease's worth of tokens.
+        _rateNS = std::max(int64_t{1}, int64_t(1e9 / newPerSecond));
+        _startNS = nowNS;
+        _issued = 0;
+    }
+
+    /**
+     * @return the number of tokens, at most `limit`, that are due at `now` and haven't
+     * been handed out yet assuming `issued` have been.
+     */
+    int64_t tokensDue(const typename ClockT::time_point& now,
+                      int64_t issued,
+                      int64_t limit) const {
+        const int64_t burst = std::max(int64_t{1}, _burstSize);
+        const int64_t elapsed = now.time_since_epoch().count() - _startNS;
+        if (elapsed < 0) {
+            return 0;
+        }
+        if (_profile) {
+            const auto due = int64_t(_profile->operationsBy(std::chrono::nanoseconds{elapsed})) + 1;
+            return std::clamp(due - issued, int64_t{0}, limit);
+        }
+        const int64_t rateNS = _rateNS.load(std::memory_order_relaxed);
+        if (rateNS <= 0) {
+            // A zero period doesn't limit anything.
+            return limit;
+        }
+        // Tokens in period p are due at _startNS + p * _rateNS.
+        const int64_t duePeriods = elapsed / rateNS;
+        const int64_t issuedPeriods = issued / burst;
+        if (duePeriods < issuedPeriods) {
+            return 0;
+        }
+        // Cap the whole periods before multiplying so a long backlog can't overflow.
+        const int64_t backlogPeriods = std::min(duePeriods - issuedPeriods, limit);
+        return std::min(limit, burst - issued % burst + backlogPeriods * burst);
+    }
+
+    /**
+     * Size of the next lease: a fair share of what's due now.
+     */
+    int64_t leaseSize(const typename ClockT::time_point& now) const {
+        const auto due = this->tokensDue(now, _issued.load(std::memory_order_relaxed),
+                                         kMaxLease * std::max(int64_t{1}, _numUsers));
+        return std::clamp(due / std::max(int64_t{1}, _numUsers), int64_t{1}, kMaxLease);
+    }
+
+    /**
+     * Take up to `wanted` tokens that are due at `now`.
+     * @return the number of tokens taken.
+     */
+    int64_t acquire(const typename ClockT::time_point& now, int64_t wanted) {
+        int64_t issued = _issued.load(std::memory_order_relaxed);
+        while (true) {
+            const auto granted = this->tokensDue(now, issued, wanted);
+            if (granted <= 0) {
+                return 0;
+            }
+            // Failure reloads `issued` so we only retry while there are tokens due.
+            if (_issued.compare_exchange_weak(issued, issued + granted)) {
+                return granted;
+            }
+        }
+    }
+
+    // Manually align the hot atomics on their own cache lines to vastly improve performance.
+    // Number of tokens handed out since _startNS.
+    alignas(BaseGlobalRateLimiter::CacheLineSize) std::atomic_int64_t _issued = 0;
+    // Used only while breaking in a percentile rate.
     alignas(BaseGlobalRateLimiter::CacheLineSize) std::atomic_int64_t _burstCount = 0;
     // number of iterations this phase
     alignas(BaseGlobalRateLimiter::CacheLineSize) std::atomic_int64_t _iters = 0;
 
-    // Note that the rate limiter as-is doesn't use the burst size, but it is cleaner to
-    // store the burst size and the rate together, since they're specified together in
-    // the YAML as RateSpec.
+    // Read-mostly; changed only when the schedule restarts.
+    // Note that std::chrono::time_point is not trivially copyable and can't be used here.
+    alignas(BaseGlobalRateLimiter::CacheLineSize) std::atomic_int64_t _startNS = 0;
+    std::atomic_int64_t _generation = 0;
+
     int64_t _burstSize;
-    int64_t _rateNS;
+    // Atomic because latency targets change it mid-phase.
+    std::atomic_int64_t _rateNS;
     std::optional<int64_t> _percent;
+    std::optional<RateProfileSpec> _profile;
+    std::optional<LatencyTarget> _latencyTarget;
     std::atomic<bool> _fullSpeed;
 
+    TargetRateGauge _targetRateGauge;
+    mutable std::mutex _targetRateMutex;
+    std::atomic_int64_t _nextTargetRateNS = 0;
+    std::atomic_int64_t _nextAdjustNS = 0;
+
     // Number of threads using this rate limiter.
     int64_t _numUsers = 0;
 };
@@ -16,12 +16,15 @@
 #define HEADER_8615FA7A_9344_43E1_A102_889F47CCC1A6_INCLUDED
 
 #include <atomic>
-#include <condition_variable>
+#include <cstdint>
 #include <functional>
+#include <optional>
 #include <shared_mutex>
 #include <vector>
 
 #include <gennylib/conventions.hpp>
+#include <gennylib/v1/EventCount.hpp>
+#include <gennylib/v1/FiberPool.hpp>
 
 namespace genny {
 
@@ -31,6 +34,11 @@ class Orchestrator;
 
 using OrchestratorCB = std::function<void(const Orchestrator*, const PhaseNumber)>;
 
+/**
+ * Called with how long after a phase started (or ended) an Actor noticed.
+ */
+using PhaseSkewCB = std::function<void(PhaseNumber, Duration)>;
+
 /**
  * Responsible for the synchronization of actors
  * across a workload's lifecycle.
@@ -118,23 +126,121 @@ public:
      */
     void sleepUntilOrPhaseEnd(SteadyClock::time_point deadline, const PhaseNumber pn);
 
+    /**
+     * Report phase start and stop skew to the given callbacks. Only call during setup.
+     *
+     * The callbacks are called on the Actor's own thread from actorStartedPhase() and
+     * actorLeftPhase() so they must be thread-safe.
+     */
+    void setPhaseSkewCallbacks(PhaseSkewCB onStart, PhaseSkewCB onStop);
+
+    /**
+     * Signal from an actor that it has returned from a blocking awaitPhaseStart() for
+     * `phase`. Records how long it has been since the phase started.
+     */
+    void actorStartedPhase(PhaseNumber phase);
+
+    /**
+     * Signal from an actor that it has left `phase`, either by returning from a blocking
+     * awaitPhaseEnd() or by noticing the phase ended while not blocking on it. Records how long
+     * it has been since the phase ended, if it has.
+     */
+    void actorLeftPhase(PhaseNumber phase);
+
 private:
+    // The phase number, the phase state, and the error flag are packed into a single word so
+    // that the accessors called on every Actor iteration (currentPhase(), morePhases(), and
+    // continueRunning()) are a single acquire-load rather than a shared_mutex acquisition.
+    // Taking even a reader lock makes every Actor thread write to the mutex's cache-line,
+    // which stops scaling well before a few hundred threads.
+    //
+    // The word is only ever written while holding _mutex (in awaitPhaseStart(), awaitPhaseEnd(),
+    // and abort()) and each write is followed by notifyPhaseChange().
+    //
+    //     bits  0-31: the current PhaseNumber
+    //     bit     32: set while the current phase is started
+    //     bit     33: set once abort() has been called
+    using Epoch = uint64_t;
+
+    static constexpr Epoch kPhaseMask = 0xFFFFFFFF;
+    static constexpr Epoch kPhaseStartedBit = Epoch{1} << 32;
+    static constexpr Epoch kErrorsBit = Epoch{1} << 33;
+
+    static_assert(sizeof(PhaseNumber) <= 4, "PhaseNumber must fit in the low bits of the epoch");
+
+    static constexpr PhaseNumber phaseOf(Epoch epoch) {
+        return static_cast<PhaseNumber>(epoch & kPhaseMask);
+    }
+
+    static constexpr bool isStarted(Epoch epoch) {
+        return (epoch & kPhaseStartedBit) != 0;
+    }
+
+    static constexpr bool hasErrors(Epoch epoch) {
+        return (epoch & kErrorsBit) != 0;
+    }
+
+    Epoch loadEpoch() const {
+        return _epoch.load(std::memory_order_acquire);
+    }
+
+    // Only call while holding a writer lock on _mutex.
+    void storeEpoch(Epoch epoch) {
+        _epoch.store(epoch, std::memory_order_release);
+    }
+
+    // Block until `done(loadEpoch())` or `deadline`. Returns with `lock` released.
+    //
+    // Plain threads release `lock` straight away and wait on _phaseChange so a phase change
+    // doesn't have them all queue up for _mutex. v1::FiberPool workers wait on
+    // _fiberPhaseChange instead since blocking a worker thread would stop every other fiber
+    // on it.
+    template <typename Lock, typename Done>
+    void waitForEpoch(Lock& lock,
+                      Done done,
+                      std::optional<SteadyClock::time_point> deadline = std::nullopt);
+
+    // Only call while holding a writer lock on _mutex.
+    void notifyPhaseChange();
+
     mutable std::shared_mutex _mutex;
-    std::condition_variable_any _phaseChange;
+    v1::EventCount _phaseChange;
+    v1::FiberWaitList _fiberPhaseChange;
 
     int _requireTokens = 0;
     int _currentTokens = 0;
 
-    PhaseNumber _max = 0;
-    PhaseNumber _current = 0;
-
-    // Having this lets us avoid locking on _mutex for every call of
-    // continueRunning(). This gave two orders of magnitude speedup.
-    std::atomic_bool _errors = false;
-
-    enum class State { PhaseEnded, PhaseStarted };
-
-    State state = State::PhaseEnded;
+    // Only changed during setup but read by morePhases() on every iteration.
+    std::atomic<PhaseNumber> _max = 0;
+
+    alignas(64) std::atomic<Epoch> _epoch = 0;
+
+    // When the current (or last) phase started and ended, in SteadyClock nanoseconds. Written
+    // before the epoch store that announces the change so Actors that see it see these too.
+    std::atomic<int64_t> _phaseStartedAt = 0;
+    std::atomic<int64_t> _phaseEndedAt = 0;
+
+    // Start skew across all Actors in the current phase. Logged when the phase ends.
+    struct SkewSummary {
+        std::atomic<int64_t> count = 0;
+        std::atomic<int64_t> maxNS = 0;
+
+        void add(int64_t ns) {
+            count.fetch_add(1, std::memory_order_relaxed);
+            auto max = maxNS.load(std::memory_order_relaxed);
+            while (ns > max && !maxNS.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {
+            }
+        }
+
+        void reset() {
+            count = 0;
+            maxNS = 0;
+        }
+    };
+    alignas(64) SkewSummary _startSkew;
+
+    PhaseSkewCB _onStartSkew;
+    PhaseSkewCB _onStopSkew;
 
     // These hooks fire just before the current phase starts. The phase number in the invocation is the
     // phase that is about to start, so 0, 1, 2 ... etc.
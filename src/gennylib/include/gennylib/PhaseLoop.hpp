@@ -19,6 +19,7 @@
 #include <chrono>
 #include <iterator>
 #include <optional>
+#include <random>
 #include <sstream>
 #include <thread>
 #include <type_traits>
@@ -28,12 +29,15 @@
 #include <boost/exception/exception.hpp>
 #include <boost/throw_exception.hpp>
 
+#include <gennylib/Actor.hpp>
 #include <gennylib/GlobalRateLimiter.hpp>
 #include <gennylib/InvalidConfigurationException.hpp>
 #include <gennylib/Orchestrator.hpp>
 #include <gennylib/context.hpp>
 #include <gennylib/v1/Sleeper.hpp>
 
+#include <metrics/operation.hpp>
+
 /**
  * @file
  * This file provides the `PhaseLoop<T>` type and the collaborator classes that make it iterable.
@@ -47,6 +51,85 @@ namespace genny {
  */
 namespace v1 {
 
+/**
+ * The intended start times of iterations in an open-loop phase.
+ *
+ * Configured with `ArrivalRate: N per T` which is the rate across all of an Actor's
+ * threads. Each thread gets an independent schedule at `1/threads` of the rate:
+ *
+ * - `ArrivalDistribution: Fixed` (the default) spaces arrivals evenly. Threads start at
+ *   a random offset within the first interval so their arrivals interleave.
+ * - `ArrivalDistribution: Poisson` uses exponentially-distributed gaps. The sum of
+ *   independent Poisson processes is itself a Poisson process at the summed rate.
+ *
+ * The schedule never skips or delays arrivals when a thread falls behind; the late
+ * iterations run back-to-back and their latency is measured from when they should
+ * have started.
+ *
+ * Its random draws are seeded from the Actor thread's RNG (see `PhaseLoop`) so a workload
+ * with a `RandomSeed` gets the same arrivals every run.
+ */
+class ArrivalSchedule final {
+public:
+    enum class Distribution { kFixed, kPoisson };
+
+    ArrivalSchedule(BaseRateSpec rate, int64_t threads, Distribution distribution)
+        : _meanGapNanos{double(rate.per.count()) * std::max(int64_t{1}, threads) /
+                        double(rate.operations)},
+          _distribution{distribution} {
+        if (rate.operations <= 0 || rate.per.count() <= 0) {
+            std::stringstream str;
+            str << "ArrivalRate must be positive. Gave " << rate.operations << " per "
+                << rate.per.count() << " nanoseconds";
+            throw InvalidConfigurationException(str.str());
+        }
+    }
+
+    /**
+     * Seed the schedule of the given phase of an Actor thread whose RNG drew `actorSeed`.
+     */
+    void seed(uint64_t actorSeed, PhaseNumber phase) {
+        std::seed_seq seq{uint32_t(actorSeed), uint32_t(actorSeed >> 32), uint32_t(phase)};
+        _rng.seed(seq);
+    }
+
+    /**
+     * Begin the schedule. Called when the phase starts.
+     */
+    void start(SteadyClock::time_point now) {
+        _start = now;
+        _offsetNanos = _distribution == Distribution::kFixed
+            ? std::uniform_real_distribution<double>{0, _meanGapNanos}(_rng)
+            : nextGap();
+    }
+
+    /**
+     * @return the intended start of the next iteration.
+     */
+    SteadyClock::time_point next() const {
+        return _start + std::chrono::nanoseconds{int64_t(_offsetNanos)};
+    }
+
+    void advance() {
+        // Accumulate in floating-point so rounding errors don't accumulate into rate drift.
+        _offsetNanos += nextGap();
+    }
+
+private:
+    double nextGap() {
+        if (_distribution == Distribution::kFixed) {
+            return _meanGapNanos;
+        }
+        return std::exponential_distribution<double>{1.0 / _meanGapNanos}(_rng);
+    }
+
+    const double _meanGapNanos;
+    const Distribution _distribution;
+    std::mt19937_64 _rng;
+    SteadyClock::time_point _start;
+    double _offsetNanos = 0;
+};
+
 /**
  * Determine the conditions for continuing to iterate a given Phase.
  *
@@ -73,6 +156,8 @@ public:
           // If it is a nop then should iterate 0 times.
           _minIterations{isNop ? IntegerSpec(0l) : minIterations},
           _doesBlock{_minIterations || _minDuration},
+          _sleepsBefore{bool(sleepBefore)},
+          _sleepsAfter{bool(sleepAfter)},
           _sleepUntil{SteadyClock::now()} {
         if (minDuration && minDuration->count() < 0) {
             std::stringstream str;
@@ -126,8 +211,29 @@ public:
             const auto rateLimiterName =
                 phaseContext["RateLimiterName"].maybe<std::string>().value_or(defaultRLName.str());
 
-            _rateLimiter =
-                phaseContext.workload().getRateLimiter(rateLimiterName, rateSpec.value());
+            _rateLimiter = phaseContext.workload().getRateLimiter(
+                rateLimiterName, rateSpec.value(), phaseContext.actor());
+        }
+
+        if (const auto arrivalRate = phaseContext["ArrivalRate"].maybe<BaseRateSpec>()) {
+            if (rateSpec || phaseContext["SleepBefore"] || phaseContext["SleepAfter"]) {
+                throw InvalidConfigurationException(
+                    "ArrivalRate must *not* be specified alongside GlobalRate, SleepBefore, or "
+                    "SleepAfter. An open-loop phase's iterations are paced only by its arrivals.");
+            }
+            const auto distributionName =
+                phaseContext["ArrivalDistribution"].maybe<std::string>().value_or("Fixed");
+            ArrivalSchedule::Distribution distribution;
+            if (distributionName == "Fixed") {
+                distribution = ArrivalSchedule::Distribution::kFixed;
+            } else if (distributionName == "Poisson") {
+                distribution = ArrivalSchedule::Distribution::kPoisson;
+            } else {
+                throw InvalidConfigurationException(
+                    "ArrivalDistribution must be Fixed or Poisson. Gave " + distributionName);
+            }
+            const auto threads = phaseContext.actor()["Threads"].maybe<int>().value_or(1);
+            _arrivals.emplace(*arrivalRate, threads, distribution);
         }
     }
 
@@ -138,23 +244,15 @@ public:
         if (_rateLimiter) {
             while (true) {
                 const auto now = SteadyClock::now();
-                auto success = _rateLimiter->consumeIfWithinRate(now);
+                auto success = _rateLimiter->consumeIfWithinRate(now, _lease);
                 // If we don't block, we can trust the sleeper to check if the phase ended.
                 bool phaseStillGoing =
                     !_doesBlock || !isDone(referenceStartingPoint, currentIteration, now);
                 if (!success && phaseStillGoing) {
-
-                    // Don't sleep for more than 1 second (1e9 nanoseconds). Otherwise rates
-                    // specified in seconds or lower resolution can cause the workloads to
-                    // run visibly longer than the specified duration.
-                    const auto rate = _rateLimiter->getRate() > 1e9 ? 1e9 : _rateLimiter->getRate();
-
-                    // Add ±5% jitter to avoid threads waking up at once.
-                    _sleeper->sleepFor(orchestrator,
-                                       inPhase,
-                                       std::chrono::nanoseconds(int64_t(
-                                           rate * (0.95 + 0.1 * (double(rand()) / RAND_MAX)))),
-                                       !_doesBlock);
+                    waiting([&]() {
+                        _sleeper->sleepFor(
+                            orchestrator, inPhase, _rateLimiter->backoffDuration(), !_doesBlock);
+                    });
                     continue;
                 }
                 break;
@@ -163,6 +261,69 @@ public:
         }
     }
 
+    /**
+     * Start the open-loop schedule, if any. Called at the start of each phase.
+     */
+    void startArrivals() {
+        if (_arrivals) {
+            _arrivals->start(SteadyClock::now());
+        }
+    }
+
+    /**
+     * @return whether this is an open-loop phase, paced by `ArrivalRate`.
+     */
+    bool isOpenLoop() const {
+        return _arrivals.has_value();
+    }
+
+    /**
+     * Seed the open-loop schedule, if any. See ArrivalSchedule::seed().
+     */
+    void seedArrivals(uint64_t actorSeed, PhaseNumber phase) {
+        if (_arrivals) {
+            _arrivals->seed(actorSeed, phase);
+        }
+    }
+
+    /**
+     * In open-loop phases, wait for the next scheduled arrival and publish it as the
+     * intended start of the operations in this iteration.
+     */
+    void awaitArrival(Orchestrator& o,
+                      SteadyClock::time_point startedAt,
+                      int64_t currentIteration,
+                      const PhaseNumber pn) {
+        if (!_arrivals) {
+            return;
+        }
+        // Don't let an arrival an earlier iteration didn't use leak into
+        // whatever runs on this thread while we sleep.
+        metrics::internals::v1::IntendedStart::clear();
+
+        const auto intended = _arrivals->next();
+        _arrivals->advance();
+
+        const auto now = SteadyClock::now();
+        if (intended > now && o.continueRunning()) {
+            auto wakeAt = intended;
+            // As in sleepForActor(), don't sleep past the end of the phase.
+            if (doesBlockCompletion() && isDone(startedAt, currentIteration, intended)) {
+                wakeAt = _minDuration ? (startedAt + _minDuration->value) : now;
+            }
+            waiting([&]() { o.sleepUntilOrPhaseEnd(wakeAt, pn); });
+        }
+        metrics::internals::v1::IntendedStart::set(intended);
+    }
+
+    /**
+     * Where the latencies of this iteration's operations go, if the rate limiter
+     * adjusts its rate to them.
+     */
+    metrics::internals::v1::LatencyObserver* latencyObserver() const {
+        return _rateLimiter ? _rateLimiter->latencyObserver() : nullptr;
+    }
+
     constexpr SteadyClock::time_point computeReferenceStartingPoint() const {
         // avoid doing now() if no minDuration configured
         return _minDuration ? SteadyClock::now() : SteadyClock::time_point::min();
@@ -206,19 +367,50 @@ public:
                               : now);
         }
         // Don't block completion and wouldn't otherwise be done at _sleepUntil.
-        o.sleepUntilOrPhaseEnd(_sleepUntil, pn);
+        waiting([&]() { o.sleepUntilOrPhaseEnd(_sleepUntil, pn); });
+    }
+
+
+    /**
+     * Add the time spent between iterations to `overhead`, which belongs to the Actor thread
+     * running this phase, leaving out the waits the phase is configured to make.
+     */
+    void accountPacing(metrics::internals::v1::Overhead* overhead) {
+        _pacing = overhead;
     }
 
+    metrics::internals::v1::Overhead* pacingOverhead() const {
+        return _pacing;
+    }
 
     constexpr void sleepBefore(const Orchestrator& o, const PhaseNumber pn) const {
-        _sleeper->before(o, pn);
+        if (_sleepsBefore) {
+            waiting([&]() { _sleeper->before(o, pn); });
+        }
     }
 
     constexpr void sleepAfter(const Orchestrator& o, const PhaseNumber pn) const {
-        _sleeper->after(o, pn);
+        if (_sleepsAfter) {
+            waiting([&]() { _sleeper->after(o, pn); });
+        }
     }
 
 private:
+    // Run `wait`, taking the time it takes back out of the pacing overhead. The PacingTimer
+    // around it only counts the time genny spends deciding how long to wait.
+    template <typename Wait>
+    void waiting(Wait&& wait) const {
+        if (!_pacing) {
+            wait();
+            return;
+        }
+        const auto started = metrics::clock::now();
+        wait();
+        _pacing->pacingNanos -=
+            std::chrono::duration_cast<std::chrono::nanoseconds>(metrics::clock::now() - started)
+                .count();
+    }
+
     // Debatable about whether this should also track the current iteration and
     // referenceStartingPoint time (versus having those in the ActorPhaseIterator). BUT: even
     // the .end() iterator needs an instance of this, so it's weird
@@ -228,9 +420,50 @@ private:
 
     // The rate limiter is owned by the workload context.
     GlobalRateLimiter* _rateLimiter = nullptr;
+    // Tokens this thread has taken from _rateLimiter but not used yet.
+    GlobalRateLimiter::Lease _lease;
     const bool _doesBlock;  // Computed/cached value. Computed at ctor time.
     std::optional<v1::Sleeper> _sleeper;
+    const bool _sleepsBefore;
+    const bool _sleepsAfter;
     SteadyClock::time_point _sleepUntil;
+
+    // Set iff the phase is open-loop.
+    std::optional<ArrivalSchedule> _arrivals;
+
+    // Owned by the metrics registry. Only set if `Metrics: Overhead` is on.
+    metrics::internals::v1::Overhead* _pacing = nullptr;
+};
+
+
+/**
+ * Adds the time until it's destroyed to an Actor thread's pacing overhead, if it's being
+ * accounted for. The IterationChecker takes its configured waits back out.
+ */
+class PacingTimer final {
+public:
+    PacingTimer(const IterationChecker* iterationCheck, bool countIteration)
+        : _overhead{iterationCheck ? iterationCheck->pacingOverhead() : nullptr},
+          _started{_overhead ? metrics::clock::now() : metrics::clock::time_point{}} {
+        if (_overhead && countIteration) {
+            ++_overhead->pacingIterations;
+        }
+    }
+
+    ~PacingTimer() {
+        if (_overhead) {
+            _overhead->pacingNanos += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                          metrics::clock::now() - _started)
+                                          .count();
+        }
+    }
+
+    PacingTimer(const PacingTimer&) = delete;
+    PacingTimer& operator=(const PacingTimer&) = delete;
+
+private:
+    metrics::internals::v1::Overhead* const _overhead;
+    const metrics::clock::time_point _started;
 };
 
 
@@ -262,6 +495,9 @@ public:
           _currentIteration{0} {
         // iterationCheck should only be null if we're end() iterator.
         assert(isEndIterator == (iterationCheck == nullptr));
+        if (!isEndIterator) {
+            _iterationCheck->startArrivals();
+        }
     }
 
     // iterator concept value-type
@@ -272,7 +508,8 @@ public:
         return Value();
     }
 
-    constexpr ActorPhaseIterator& operator++() {
+    ActorPhaseIterator& operator++() {
+        PacingTimer pacing{_iterationCheck, true};
         if (_iterationCheck) {
             _iterationCheck->sleepAfter(*_orchestrator, _inPhase);
         }
@@ -281,12 +518,20 @@ public:
     }
 
     bool operator==(const ActorPhaseIterator& rhs) const {
+        // Includes the isDone() check below.
+        PacingTimer pacing{_iterationCheck, false};
         if (_iterationCheck) {
+            // Latencies of whatever runs on this thread while we wait aren't ours.
+            metrics::internals::v1::LatencyObserver::set(nullptr);
             _iterationCheck->sleepBefore(*_orchestrator, _inPhase);
             _iterationCheck->limitRate(
                 _referenceStartingPoint, _currentIteration, *_orchestrator, _inPhase);
             _iterationCheck->sleepForActor(
                 *_orchestrator, _referenceStartingPoint, _currentIteration, _inPhase);
+            _iterationCheck->awaitArrival(
+                *_orchestrator, _referenceStartingPoint, _currentIteration, _inPhase);
+            // Set after the last point that can yield so fibers don't see each other's.
+            metrics::internals::v1::LatencyObserver::set(_iterationCheck->latencyObserver());
         }
         // clang-format off
         return
@@ -298,7 +543,7 @@ public:
                      // if we block, then check to see if we're done in current phase
                      // else check to see if current phase has expired
                      (_iterationCheck->doesBlockCompletion()
-                            ? _iterationCheck->isDone(_referenceStartingPoint, _currentIteration, SteadyClock::now())
+                            ? _iterationCheck->isDone(_referenceStartingPoint, _currentIteration, metrics::clock::now())
                             : _orchestrator->currentPhase() != _inPhase)))
 
                 // Below checks are mostly for pure correctness;
@@ -472,6 +717,21 @@ public:
         _iterationCheck->setSleepUntil(SteadyClock::now() + timeout);
     }
 
+    /**
+     * Add the time spent between this phase's iterations to `overhead`.
+     */
+    void accountPacing(metrics::internals::v1::Overhead* overhead) {
+        _iterationCheck->accountPacing(overhead);
+    }
+
+    bool isOpenLoop() const {
+        return _iterationCheck->isOpenLoop();
+    }
+
+    void seedArrivals(uint64_t actorSeed) {
+        _iterationCheck->seedArrivals(actorSeed, _currentPhase);
+    }
+
 private:
     Orchestrator& _orchestrator;
     const PhaseNumber _currentPhase;
@@ -481,6 +741,53 @@ private:
 };  // class ActorPhase
 
 
+/**
+ * Reports how long one Actor thread spent in genny's metrics and PhaseLoop code during each
+ * phase as the internal MetricsOverhead and PacingOverhead operations. Each event's duration is
+ * the total time and its ops are how many operations were recorded or iterations paced.
+ */
+class OverheadReporter final {
+public:
+    OverheadReporter(ActorContext& context, ActorId id, metrics::internals::v1::Overhead& overhead)
+        : _overhead{overhead},
+          _metrics{context.operation("MetricsOverhead", id, true)},
+          _pacing{context.operation("PacingOverhead", id, true)} {}
+
+    metrics::internals::v1::Overhead* overhead() const {
+        return std::addressof(_overhead);
+    }
+
+    /**
+     * Report what's been accounted for since the last report.
+     */
+    void report() {
+        const auto now = metrics::clock::now();
+        auto micros = [](int64_t nanos) {
+            return std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::nanoseconds{nanos});
+        };
+        if (_overhead.metricsReports > 0) {
+            _metrics.report(now,
+                            micros(_overhead.metricsNanos),
+                            metrics::OutcomeType::kSuccess,
+                            _overhead.metricsReports);
+        }
+        if (_overhead.pacingIterations > 0) {
+            _pacing.report(now,
+                           micros(_overhead.pacingNanos),
+                           metrics::OutcomeType::kSuccess,
+                           _overhead.pacingIterations);
+        }
+        _overhead = {};
+    }
+
+private:
+    metrics::internals::v1::Overhead& _overhead;
+    metrics::Operation _metrics;
+    metrics::Operation _pacing;
+};
+
+
 /**
  * Maps from PhaseNumber to the ActorPhase<T> to be used in that PhaseNumber.
  */
@@ -504,18 +811,23 @@ template <class T>
 class PhaseLoopIterator final {
 
 public:
-    PhaseLoopIterator(Orchestrator& orchestrator, PhaseMap<T>& phaseMap, bool isEnd)
+    PhaseLoopIterator(Orchestrator& orchestrator,
+                      PhaseMap<T>& phaseMap,
+                      bool isEnd,
+                      OverheadReporter* overhead = nullptr)
         : _orchestrator{orchestrator},
           _phaseMap{phaseMap},
           _isEnd{isEnd},
           _currentPhase{0},
-          _awaitingPlusPlus{false} {}
+          _awaitingPlusPlus{false},
+          _overhead{overhead} {}
 
     ActorPhase<T>& operator*() /* cannot be const */ {
         assert(!_awaitingPlusPlus);
         // Intentionally don't bother with cases where user didn't call operator++()
         // between invocations of operator*() and vice-versa.
         _currentPhase = this->_orchestrator.awaitPhaseStart();
+        this->_orchestrator.actorStartedPhase(_currentPhase);
         if (!this->doesBlockOn(_currentPhase)) {
             this->_orchestrator.awaitPhaseEnd(false);
         }
@@ -539,9 +851,20 @@ public:
         assert(_awaitingPlusPlus);
         // Intentionally don't bother with cases where user didn't call operator++()
         // between invocations of operator*() and vice-versa.
+
+        // The last arrival of an open-loop phase may not have been used.
+        metrics::internals::v1::IntendedStart::clear();
+        metrics::internals::v1::LatencyObserver::set(nullptr);
+
+        if (_overhead) {
+            _overhead->report();
+        }
+
         if (this->doesBlockOn(_currentPhase)) {
             this->_orchestrator.awaitPhaseEnd(true);
         }
+        // A non-blocking Actor gets here once it notices the phase ended.
+        this->_orchestrator.actorLeftPhase(_currentPhase);
 
         _awaitingPlusPlus = false;
         return *this;
@@ -585,6 +908,9 @@ private:
     // between, we'll fail (and similarly for operator++()).
     bool _awaitingPlusPlus;
 
+    // Owned by the PhaseLoop. Only set if `Metrics: Overhead` is on.
+    OverheadReporter* _overhead;
+
     // These are intentionally commented-out because this type
     // should not be used by any std algorithms that may rely on them.
     // This type should only be used by range-based for loops (which doesn't
@@ -639,9 +965,9 @@ private:
  *
  *     public:
  *         MyActor(ActorContext& actorContext)
- *         : _loop{actorContext} {}
+ *         : Actor{actorContext}, _loop{*this, actorContext} {}
  *         // if your MyActorConfig takes other ctor args, pass them through
- *         // here e.g. _loop{actorContext, someOtherParam}
+ *         // here e.g. _loop{*this, actorContext, someOtherParam}
  *
  *         void run() {
  *             for(auto&& [phaseNum, actorPhase] : _loop) {     // (1)
@@ -669,6 +995,12 @@ template <class T>
 class PhaseLoop final {
 
 public:
+    /**
+     * A loop that isn't tied to an Actor thread. It can't run open-loop phases since their
+     * arrivals are seeded from the thread's RNG; use the constructor below for those.
+     *
+     * @throws InvalidConfigurationException if a phase has an `ArrivalRate`.
+     */
     template <class... Args>
     explicit PhaseLoop(ActorContext& context, Args&&... args)
         : PhaseLoop(context.orchestrator(),
@@ -679,6 +1011,46 @@ public:
         // Don't do this at the class level because tests want to be able to
         // construct a simple PhaseLoop<int>.
         static_assert(std::is_constructible_v<T, PhaseContext&, Args...>);
+        for (auto&& [num, actorPhase] : _phaseMap) {
+            if (actorPhase.isOpenLoop()) {
+                // Unseeded, every thread's arrivals would line up.
+                throw InvalidConfigurationException(
+                    "Phase " + std::to_string(num) + " of Actor " + context.getName() +
+                    " has an ArrivalRate, so its PhaseLoop must be constructed with the Actor: "
+                    "_loop{*this, context, ...}");
+            }
+        }
+    }
+
+    /**
+     * The loop of the given Actor. Its pacing overhead is accounted to the Actor's thread and
+     * its open-loop arrivals are seeded from the thread's RNG.
+     *
+     * `args` are forwarded as the T value's constructor-args as above.
+     */
+    template <class... Args>
+    PhaseLoop(const Actor& actor, ActorContext& context, Args&&... args)
+        : PhaseLoop(context.orchestrator(),
+                    std::move(constructPhaseMap(context, std::forward<Args>(args)...))) {
+        static_assert(std::is_constructible_v<T, PhaseContext&, Args...>);
+        const auto id = actor.id();
+        // Only draw from the RNG if there are arrivals, so the Actor's other random values don't
+        // change. One draw seeds every phase, so it doesn't matter what order they're seeded in.
+        std::optional<uint64_t> arrivalSeed;
+        for (auto&& [num, actorPhase] : _phaseMap) {
+            if (actorPhase.isOpenLoop()) {
+                if (!arrivalSeed) {
+                    arrivalSeed = context.rng(id)();
+                }
+                actorPhase.seedArrivals(*arrivalSeed);
+            }
+        }
+        if (auto* overhead = context.overhead(id); overhead) {
+            _overhead.emplace(context, id, *overhead);
+            for (auto&& [num, actorPhase] : _phaseMap) {
+                actorPhase.accountPacing(overhead);
+            }
+        }
     }
 
     // Only visible for testing
@@ -688,7 +1060,8 @@ public:
     }
 
     v1::PhaseLoopIterator<T> begin() {
-        return v1::PhaseLoopIterator<T>{this->_orchestrator, this->_phaseMap, false};
+        return v1::PhaseLoopIterator<T>{
+            this->_orchestrator, this->_phaseMap, false, _overhead ? &*_overhead : nullptr};
     }
 
     v1::PhaseLoopIterator<T> end() {
@@ -730,6 +1103,8 @@ private:
 
     Orchestrator& _orchestrator;
     v1::PhaseMap<T> _phaseMap;
+    // Only set if `Metrics: Overhead` is on.
+    std::optional<v1::OverheadReporter> _overhead;
     // _phaseMap cannot be const since we don't want to enforce
     // the wrapped unique_ptr<T> in ActorPhase<T> to be const.
 
@@ -19,6 +19,7 @@
 #include <map>
 #include <memory>
 #include <fstream>
+#include <functional>
 #include <sstream>
 #include <string>
 #include <type_traits>
@@ -50,6 +51,9 @@
 #include <gennylib/Node.hpp>
 #include <gennylib/Orchestrator.hpp>
 #include <gennylib/conventions.hpp>
+#include <gennylib/v1/CpuPlacement.hpp>
+#include <gennylib/v1/FiberPool.hpp>
+#include <gennylib/v1/PhaseBarrier.hpp>
 #include <gennylib/v1/PoolManager.hpp>
 
 #include <metrics/metrics.hpp>
@@ -211,12 +215,14 @@ public:
      * `mongocxx::events::command_started_event`
      * @param dryRun whether the workload is a dry run, meaning operations that
      * require a server connection are skipped.
+     * @param worker which of `genny run --workers N`'s processes this is, if any.
      */
     WorkloadContext(const Node& node,
                     Orchestrator& orchestrator,
                     const Cast& cast,
                     v1::PoolManager::OnCommandStartCallback apmCallback = {},
-                    bool dryRun = false);
+                    bool dryRun = false,
+                    v1::WorkerIdentity worker = {});
 
     // no copy or move
     WorkloadContext(WorkloadContext&) = delete;
@@ -269,6 +275,13 @@ public:
         return toReturn;
     }
 
+    /**
+     * @return which of `genny run --workers N`'s processes this is.
+     */
+    const v1::WorkerIdentity& worker() const {
+        return _worker;
+    }
+
     /**
      * Return a named connection pool instance.
      *
@@ -329,23 +342,53 @@ public:
      *   rate spec to use if creating a new instance. it is undefined what will
      *   be returned if the getRateLimiter() is called twice with the same name but with different
      *   ratespecs.
+     * @param user
+     *   the Actor one of whose threads will use the rate-limiter. When the workload is split
+     *   across `genny run --workers N` each worker issues its threads' share of the rate.
      * @return
      *   the existing Subsequent calls with the same name will return the same instance.
      *
      * @private
      */
-    GlobalRateLimiter* getRateLimiter(const std::string& name, const RateSpec& spec);
+    GlobalRateLimiter* getRateLimiter(const std::string& name,
+                                      const RateSpec& spec,
+                                      const ActorContext& user);
 
     metrics::Registry& getMetrics() {
         return _registry;
     }
 
+    /**
+     * @return how Actors should be mapped onto threads, from the `Execution:` block.
+     *   Workload drivers pass this to parallelRun() when running actors().
+     */
+    const v1::ExecutionOptions& executionOptions() const {
+        return _executionOptions;
+    }
+
+    /**
+     * @return whether the `Metrics: Clock:` option lets metrics read the invariant TSC.
+     *   Workload drivers pass this to metrics::clock::useTsc() before running actors().
+     */
+    bool useTscClock() const {
+        return _useTscClock;
+    }
+
     /**
      * @return PhaseContexts for active actors in each Phase
      */
     std::map<PhaseNumber, std::vector<std::reference_wrapper<const PhaseContext>>>
     getActivePhaseContexts() const;
 
+    /**
+     * Pin the calling thread to the CPUs chosen for the given Actor by its `CpuSet:` or
+     * `NumaNode:`, or by the workload's `Placement:` policy. Does nothing if the Actor
+     * isn't placed or runs on a fiber.
+     *
+     * Workload drivers call this at the start of each Actor's thread.
+     */
+    void placeActorThread(ActorId id) const;
+
 private:
     friend class ActorContext;
     friend class PhaseContext;
@@ -356,11 +399,30 @@ private:
 
     void _constructRngsToId(ActorId id);
 
+    std::function<void(size_t)> _metricsThreadStartHook(
+        const std::optional<std::string>& metricsCpus,
+        const std::vector<v1::CpuSet>& numaNodes) const;
+
+    void _placeActors(std::vector<std::pair<ActorId, const ActorContext*>> actors,
+                      const std::vector<v1::CpuSet>& numaNodes);
+
+    void _splitRateLimiters();
+
+    // Where the given Actor thread records its operations. Threads that other workers run are
+    // constructed but never run here, so their operations go to a registry that keeps nothing.
+    metrics::Registry& _metricsOf(ActorId id) {
+        return _worker.runs(id) ? _registry : _otherWorkersMetrics;
+    }
+
     metrics::Registry _registry;
+    metrics::Registry _otherWorkersMetrics{
+        metrics::MetricsFormat{metrics::MetricsFormat::Format::kNone}, {}};
     Orchestrator* _orchestrator;
 
     v1::PoolManager _poolManager;
 
+    v1::WorkerIdentity _worker;
+
     // We start at 1 because, if we send ID 0 to Poplar, the field
     // gets used as a monotonically-increasing value.
     std::atomic<ActorId> _nextWorkloadActorId{1};
@@ -380,8 +442,21 @@ private:
     std::unordered_map<std::string, std::unique_ptr<GlobalRateLimiter>> _rateLimiters;
     std::mutex _limiterLock;
 
+    // How many threads use each rate-limiter and how many of them this worker runs.
+    struct RateLimiterShare {
+        size_t users = 0;
+        double here = 0;
+    };
+    std::unordered_map<std::string, RateLimiterShare> _rateLimiterShares;
+
     std::string _workloadPath;
     ExternalPhaseCoordinator _coordinator;
+
+    v1::ExecutionOptions _executionOptions;
+    bool _useTscClock = false;
+
+    v1::CpuPlacement _placement;
+    std::unordered_map<ActorId, v1::CpuSet> _actorCpus;
 };
 
 /**
@@ -419,10 +494,13 @@ public:
     ActorContext(const Node& node, WorkloadContext& workloadContext)
         : v1::HasNode{node}, _workload{&workloadContext}, _phaseContexts{} {
         _phaseContexts = constructPhaseContexts(_node, this);
-        auto threads = (*this)["Threads"].maybe<int>().value_or(1);
+        _threads = (*this)["Threads"].maybe<int>().value_or(1);
         _actorType = (*this)["Type"].maybe<std::string>().value_or("no_type");
         _actorName = (*this)["Name"].maybe<std::string>().value_or("no_name");
-        _nextActorId = this->workload().claimActorIds(threads);
+        _firstActorId = this->workload().claimActorIds(_threads);
+        _nextActorId = _firstActorId;
+        enableServiceTimeIfOpenLoop();
+        configureMetricsReduction();
     }
 
     // no copy or move
@@ -438,6 +516,20 @@ public:
         return _nextActorId++;
     }
 
+    /**
+     * @return the fraction of this Actor's threads that this worker runs. 1 unless the workload
+     *   is split across `genny run --workers N`.
+     */
+    double workerShare() const;
+
+    /**
+     * @return where the given Actor thread adds up the time it spends in genny's metrics and
+     *   PhaseLoop code, or nullptr unless `Metrics: Overhead` is on.
+     */
+    metrics::internals::v1::Overhead* overhead(ActorId id) const {
+        return this->_workload->_metricsOf(id).overhead(_actorName, id);
+    }
+
     /**
      * @param id for this actor
      * @return info string containing the actor type, name and id
@@ -544,11 +636,17 @@ public:
      * @param internal whether this operation is Genny-internal.
      */
     auto operation(const std::string& operationName, ActorId id, bool internal = false) const {
-        return this->_workload->_registry.operation(
+        return this->_workload->_metricsOf(id).operation(
             this->_node["Name"].to<std::string>(), operationName, id, std::nullopt, internal);
     }
 
 private:
+    // Open-loop phases report response time so also record service time.
+    void enableServiceTimeIfOpenLoop();
+
+    // Apply the Actor's MetricsSampling or MetricsAggregation, if any.
+    void configureMetricsReduction();
+
     static std::unordered_map<genny::PhaseNumber, std::unique_ptr<PhaseContext>>
 
     constructPhaseContexts(const Node&, ActorContext*);
@@ -558,6 +656,8 @@ private:
 
     std::string _actorType;
     std::string _actorName;
+    size_t _threads;
+    ActorId _firstActorId;
     std::atomic<ActorId> _nextActorId;
 };
 
@@ -633,7 +733,7 @@ public:
             stm << defaultMetricsName << "." << _phaseNumber;
         }
 
-        return this->workload()._registry.operation(
+        return this->workload()._metricsOf(id).operation(
             this->_actor->operator[]("Name").to<std::string>(),
             stm.str(),
             id,
@@ -656,7 +756,7 @@ public:
      */
     auto namedOperation(const std::string& metricsName, ActorId id, bool internal = false) const {
 
-        return this->workload()._registry.operation(
+        return this->workload()._metricsOf(id).operation(
             this->_actor->operator[]("Name").to<std::string>(),
             metricsName,
             id,
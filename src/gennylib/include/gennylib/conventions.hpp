@@ -19,6 +19,7 @@
 #include <climits>
 #include <cmath>
 #include <sstream>
+#include <vector>
 
 #include <mongocxx/read_concern.hpp>
 #include <mongocxx/read_preference.hpp>
@@ -152,7 +153,147 @@ inline bool operator==(const PercentileRateSpec& lhs, const PercentileRateSpec&
 }
 
 /**
- * RateSpec defined as either X operations per Y duration or Z% of max throughput each phase.
+ * RateProfileSpec is a rate that changes over the course of a phase. Time is measured from
+ * the start of the phase.
+ *
+ * - kRamp goes linearly from `from` to `to` over `over` and then holds at `to`.
+ * - kSteps holds each step's rate for its duration. The last rate holds until the phase ends.
+ * - kSine oscillates around `mean` by up to `amplitude` with the given `period`.
+ */
+struct RateProfileSpec {
+    enum class Shape { kRamp, kSteps, kSine };
+
+    struct Step {
+        BaseRateSpec rate;
+        std::chrono::nanoseconds duration;
+    };
+
+    Shape shape = Shape::kRamp;
+
+    // kRamp
+    BaseRateSpec from{1, 0};
+    BaseRateSpec to{1, 0};
+    std::chrono::nanoseconds over{0};
+
+    // kSteps
+    std::vector<Step> steps;
+
+    // kSine
+    BaseRateSpec mean{1, 0};
+    BaseRateSpec amplitude{1, 0};
+    std::chrono::nanoseconds period{0};
+
+    /**
+     * @return the target rate `elapsed` into the phase, in operations per nanosecond.
+     */
+    double operationsPerNanosecond(std::chrono::nanoseconds elapsed) const {
+        const double t = elapsed.count();
+        switch (shape) {
+            case Shape::kRamp: {
+                const double fraction = std::min(1.0, t / over.count());
+                return perNanosecond(from) + fraction * (perNanosecond(to) - perNanosecond(from));
+            }
+            case Shape::kSteps: {
+                for (const auto& step : steps) {
+                    if (elapsed < step.duration) {
+                        return perNanosecond(step.rate);
+                    }
+                    elapsed -= step.duration;
+                }
+                return perNanosecond(steps.back().rate);
+            }
+            case Shape::kSine:
+                return perNanosecond(mean) +
+                    perNanosecond(amplitude) * std::sin(2 * M_PI * t / period.count());
+        }
+        return 0;
+    }
+
+    /**
+     * @return the number of operations the profile allows in the first `elapsed` of the phase.
+     * This is the integral of operationsPerNanosecond().
+     */
+    double operationsBy(std::chrono::nanoseconds elapsed) const {
+        const double t = elapsed.count();
+        switch (shape) {
+            case Shape::kRamp: {
+                const double r0 = perNanosecond(from);
+                const double r1 = perNanosecond(to);
+                const double d = over.count();
+                if (t < d) {
+                    return r0 * t + (r1 - r0) * t * t / (2 * d);
+                }
+                return (r0 + r1) * d / 2 + r1 * (t - d);
+            }
+            case Shape::kSteps: {
+                double total = 0;
+                for (const auto& step : steps) {
+                    if (elapsed < step.duration) {
+                        return total + perNanosecond(step.rate) * elapsed.count();
+                    }
+                    total += perNanosecond(step.rate) * step.duration.count();
+                    elapsed -= step.duration;
+                }
+                return total + perNanosecond(steps.back().rate) * elapsed.count();
+            }
+            case Shape::kSine: {
+                const double p = period.count();
+                return perNanosecond(mean) * t +
+                    perNanosecond(amplitude) * p / (2 * M_PI) * (1 - std::cos(2 * M_PI * t / p));
+            }
+        }
+        return 0;
+    }
+
+    static double perNanosecond(const BaseRateSpec& rate) {
+        return double(rate.operations) / rate.per.count();
+    }
+};
+
+inline bool operator==(const RateProfileSpec::Step& lhs, const RateProfileSpec::Step& rhs) {
+    return lhs.rate == rhs.rate && lhs.duration == rhs.duration;
+}
+
+inline bool operator==(const RateProfileSpec& lhs, const RateProfileSpec& rhs) {
+    if (lhs.shape != rhs.shape) {
+        return false;
+    }
+    switch (lhs.shape) {
+        case RateProfileSpec::Shape::kRamp:
+            return lhs.from == rhs.from && lhs.to == rhs.to && lhs.over == rhs.over;
+        case RateProfileSpec::Shape::kSteps:
+            return lhs.steps == rhs.steps;
+        case RateProfileSpec::Shape::kSine:
+            return lhs.mean == rhs.mean && lhs.amplitude == rhs.amplitude &&
+                lhs.period == rhs.period;
+    }
+    return false;
+}
+
+/**
+ * LatencyTargetRateSpec is a rate that adjusts itself during a phase to find the highest
+ * throughput at which the given percentile of operation latencies stays under `target`.
+ */
+struct LatencyTargetRateSpec {
+    // E.g. 99 for the 99th percentile.
+    double percentile = 99;
+    std::chrono::nanoseconds target{0};
+
+    // The rate each phase starts at.
+    BaseRateSpec start{1000 * 1000 * 1000, 100};
+
+    // How often the rate is re-evaluated.
+    std::chrono::nanoseconds interval = std::chrono::seconds{1};
+};
+
+inline bool operator==(const LatencyTargetRateSpec& lhs, const LatencyTargetRateSpec& rhs) {
+    return lhs.percentile == rhs.percentile && lhs.target == rhs.target &&
+        lhs.start == rhs.start && lhs.interval == rhs.interval;
+}
+
+/**
+ * RateSpec defined as either X operations per Y duration, Z% of max throughput each phase,
+ * a RateProfileSpec, or a LatencyTargetRateSpec.
  */
 class RateSpec {
 public:
@@ -163,6 +304,10 @@ public:
 
     RateSpec(PercentileRateSpec s) : _spec{s} {}
 
+    RateSpec(RateProfileSpec s) : _spec{std::move(s)} {}
+
+    RateSpec(LatencyTargetRateSpec s) : _spec{s} {}
+
     std::optional<BaseRateSpec> getBaseSpec() const {
         if (auto pval = std::get_if<BaseRateSpec>(&_spec)) {
             return *pval;
@@ -179,13 +324,34 @@ public:
         }
     }
 
+    std::optional<RateProfileSpec> getProfileSpec() const {
+        if (auto pval = std::get_if<RateProfileSpec>(&_spec)) {
+            return *pval;
+        } else {
+            return std::nullopt;
+        }
+    }
+
+    std::optional<LatencyTargetRateSpec> getLatencyTargetSpec() const {
+        if (auto pval = std::get_if<LatencyTargetRateSpec>(&_spec)) {
+            return *pval;
+        } else {
+            return std::nullopt;
+        }
+    }
+
     bool operator==(const RateSpec& rhs) {
         // Equality is well-behaved for variants if it is for their contents.
         return _spec == rhs._spec;
     }
 
 private:
-    std::variant<std::monostate, BaseRateSpec, PercentileRateSpec> _spec;
+    std::variant<std::monostate,
+                 BaseRateSpec,
+                 PercentileRateSpec,
+                 RateProfileSpec,
+                 LatencyTargetRateSpec>
+        _spec;
 };
 
 
@@ -534,14 +700,160 @@ struct convert<genny::PercentileRateSpec> {
     }
 };
 
+/**
+ * Convert between YAML and genny::RateProfileSpec
+ *
+ * The YAML syntax is a map with exactly one of the following keys:
+ *
+ * ```yaml
+ * Ramp: {From: 1000 per 1 second, To: 50000 per 1 second, Over: 10 minutes}
+ * Steps: [{Rate: 1000 per 1 second, For: 1 minute}, {Rate: 2000 per 1 second, For: 1 minute}]
+ * Sine: {Mean: 10000 per 1 second, Amplitude: 5000 per 1 second, Period: 1 minute}
+ * ```
+ */
+template <>
+struct convert<genny::RateProfileSpec> {
+    using Shape = genny::RateProfileSpec::Shape;
+
+    static Node encode(const genny::RateProfileSpec& rhs) {
+        Node node;
+        switch (rhs.shape) {
+            case Shape::kRamp:
+                node["Ramp"]["From"] = rhs.from;
+                node["Ramp"]["To"] = rhs.to;
+                node["Ramp"]["Over"] = genny::TimeSpec{rhs.over};
+                break;
+            case Shape::kSteps:
+                for (const auto& step : rhs.steps) {
+                    Node stepNode;
+                    stepNode["Rate"] = step.rate;
+                    stepNode["For"] = genny::TimeSpec{step.duration};
+                    node["Steps"].push_back(stepNode);
+                }
+                break;
+            case Shape::kSine:
+                node["Sine"]["Mean"] = rhs.mean;
+                node["Sine"]["Amplitude"] = rhs.amplitude;
+                node["Sine"]["Period"] = genny::TimeSpec{rhs.period};
+                break;
+        }
+        return node;
+    }
+
+    static bool decode(const Node& node, genny::RateProfileSpec& rhs) {
+        if (!node.IsMap() || node.size() != 1) {
+            return false;
+        }
+        genny::RateProfileSpec spec;
+        if (const auto ramp = node["Ramp"]) {
+            spec.shape = Shape::kRamp;
+            spec.from = ramp["From"].as<genny::BaseRateSpec>();
+            spec.to = ramp["To"].as<genny::BaseRateSpec>();
+            spec.over = ramp["Over"].as<genny::TimeSpec>().value;
+            if (spec.over.count() <= 0) {
+                throw genny::InvalidConfigurationException("GlobalRate Ramp needs a positive Over");
+            }
+        } else if (const auto steps = node["Steps"]) {
+            spec.shape = Shape::kSteps;
+            if (!steps.IsSequence() || steps.size() == 0) {
+                throw genny::InvalidConfigurationException(
+                    "GlobalRate Steps must be a non-empty list of {Rate, For}");
+            }
+            for (const auto& step : steps) {
+                spec.steps.push_back({step["Rate"].as<genny::BaseRateSpec>(),
+                                      step["For"].as<genny::TimeSpec>().value});
+            }
+        } else if (const auto sine = node["Sine"]) {
+            spec.shape = Shape::kSine;
+            spec.mean = sine["Mean"].as<genny::BaseRateSpec>();
+            spec.amplitude = sine["Amplitude"].as<genny::BaseRateSpec>();
+            spec.period = sine["Period"].as<genny::TimeSpec>().value;
+            if (spec.period.count() <= 0) {
+                throw genny::InvalidConfigurationException(
+                    "GlobalRate Sine needs a positive Period");
+            }
+            if (genny::RateProfileSpec::perNanosecond(spec.amplitude) >
+                genny::RateProfileSpec::perNanosecond(spec.mean)) {
+                throw genny::InvalidConfigurationException(
+                    "GlobalRate Sine Amplitude can't be larger than its Mean");
+            }
+        } else {
+            return false;
+        }
+        rhs = std::move(spec);
+        return true;
+    }
+};
+
+/**
+ * Convert between YAML and genny::LatencyTargetRateSpec
+ *
+ * The YAML syntax is a map with a `TargetP<percentile>` key and optional `Start` and `Adjust`:
+ *
+ * ```yaml
+ * {TargetP99: 20 milliseconds, Start: 1000 per 1 second, Adjust: 1 second}
+ * ```
+ */
+template <>
+struct convert<genny::LatencyTargetRateSpec> {
+    static constexpr std::string_view prefix = "TargetP";
+
+    static Node encode(const genny::LatencyTargetRateSpec& rhs) {
+        std::stringstream key;
+        key << prefix << rhs.percentile;
+        Node node;
+        node[key.str()] = genny::TimeSpec{rhs.target};
+        node["Start"] = rhs.start;
+        node["Adjust"] = genny::TimeSpec{rhs.interval};
+        return node;
+    }
+
+    static bool decode(const Node& node, genny::LatencyTargetRateSpec& rhs) {
+        if (!node.IsMap()) {
+            return false;
+        }
+        genny::LatencyTargetRateSpec spec;
+        bool sawTarget = false;
+        for (const auto& kvp : node) {
+            const auto key = kvp.first.as<std::string>();
+            if (key == "Start") {
+                spec.start = kvp.second.as<genny::BaseRateSpec>();
+            } else if (key == "Adjust") {
+                spec.interval = kvp.second.as<genny::TimeSpec>().value;
+            } else if (key.rfind(prefix, 0) == 0 && !sawTarget) {
+                spec.percentile = Load(key.substr(prefix.size())).as<double>();
+                spec.target = kvp.second.as<genny::TimeSpec>().value;
+                sawTarget = true;
+            } else {
+                return false;
+            }
+        }
+        if (!sawTarget) {
+            return false;
+        }
+        if (spec.percentile <= 0 || spec.percentile >= 100) {
+            throw genny::InvalidConfigurationException(
+                "GlobalRate TargetP percentile must be between 0 and 100");
+        }
+        if (spec.target.count() <= 0 || spec.interval.count() <= 0 ||
+            spec.start.operations <= 0 || spec.start.per.count() <= 0) {
+            throw genny::InvalidConfigurationException(
+                "GlobalRate TargetP, Start, and Adjust must be positive");
+        }
+        rhs = spec;
+        return true;
+    }
+};
+
 /**
  * Convert between YAML and genny::RateSpec
  *
  * The YAML syntax accepts either [genny::Integer] per [genny::Time]
- * or [genny::Integer]%
+ * or [genny::Integer]% or a map as described for genny::RateProfileSpec or
+ * genny::LatencyTargetRateSpec.
  *
- * The syntax is interpreted as operations per unit of time or
- * percentage of max throughput.
+ * The syntax is interpreted as operations per unit of time,
+ * percentage of max throughput, or a rate that changes over the phase.
  */
 template <>
 struct convert<genny::RateSpec> {
@@ -552,6 +864,10 @@ struct convert<genny::RateSpec> {
             msg << spec->operations << " per " << spec->per.count() << " nanoseconds";
         } else if (auto spec = rhs.getPercentileSpec()) {
             msg << spec->percent << "%";
+        } else if (auto spec = rhs.getProfileSpec()) {
+            return Node{*spec};
+        } else if (auto spec = rhs.getLatencyTargetSpec()) {
+            return Node{*spec};
         } else {
             throw genny::InvalidConfigurationException("Cannot encode empty RateSpec.");
         }
@@ -560,7 +876,22 @@ struct convert<genny::RateSpec> {
     }
 
     static bool decode(const Node& node, genny::RateSpec& rhs) {
-        if (node.IsSequence() || node.IsMap()) {
+        if (node.IsMap()) {
+            genny::LatencyTargetRateSpec latencyTarget;
+            if (convert<genny::LatencyTargetRateSpec>::decode(node, latencyTarget)) {
+                rhs = genny::RateSpec(latencyTarget);
+                return true;
+            }
+            genny::RateProfileSpec profile;
+            if (!convert<genny::RateProfileSpec>::decode(node, profile)) {
+                throw genny::InvalidConfigurationException(
+                    "Invalid value for RateSpec field, expected a map with exactly one of Ramp, "
+                    "Steps, or Sine, or with a TargetP<percentile> latency target.");
+            }
+            rhs = genny::RateSpec(std::move(profile));
+            return true;
+        }
+        if (node.IsSequence()) {
             return false;
         }
 
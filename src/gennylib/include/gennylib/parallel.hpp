@@ -27,6 +27,9 @@
 #include <vector>
 #include <deque>
 #include <sstream>
+#include <functional>
+
+#include <gennylib/v1/FiberPool.hpp>
 
 namespace genny {
 
@@ -165,6 +168,37 @@ void parallelRun(IterableT& iterable, BinaryOperation op) {
     caughtExc.throwIfExceptions();
 }
 
+/**
+ * Like parallelRun() above but honors the workload's `Execution:` options. With
+ * `Mode: Fibers` each element runs as a fiber on a v1::FiberPool rather than getting
+ * its own thread. Either way the threads sleep as `options.sleep` says.
+ *
+ * Any exception thrown by any element is gathered and rethrown in the calling thread.
+ */
+template<typename IterableT, typename BinaryOperation>
+void parallelRun(IterableT& iterable, BinaryOperation op, const v1::ExecutionOptions& options) {
+    if (options.mode != v1::ExecutionOptions::Mode::kFibers) {
+        parallelRun(iterable, [&](const typename IterableT::value_type& value) {
+            v1::setSleepOptions(options.sleep);
+            op(value);
+        });
+        return;
+    }
+    ExceptionBucket caughtExc;
+    std::vector<std::function<void()>> tasks;
+    for (const auto& value : iterable) {
+        tasks.emplace_back([&caughtExc, &op, &value]() {
+            try {
+                op(value);
+            } catch(...) {
+                caughtExc.addException(std::move(std::current_exception()));
+            }
+        });
+    }
+    v1::FiberPool{options}.run(std::move(tasks));
+    caughtExc.throwIfExceptions();
+}
+
 } // namespace genny::v1
 
 #endif // HEADER_5129031F_B241_46DD_8285_64596CB0C155_INCLUDED
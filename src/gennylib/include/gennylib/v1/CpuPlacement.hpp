@@ -0,0 +1,111 @@
+// Copyright 2022-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef HEADER_E43A6B1C_2F9D_4C75_8A0B_61D7C3E95F28_INCLUDED
+#define HEADER_E43A6B1C_2F9D_4C75_8A0B_61D7C3E95F28_INCLUDED
+
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace genny::v1 {
+
+/**
+ * CPU numbers, as used by sched_setaffinity(2).
+ */
+using CpuSet = std::vector<int>;
+
+/**
+ * Parse the Linux "cpulist" syntax, e.g. `0-3,8,10-11`.
+ *
+ * @throws InvalidConfigurationException if `list` isn't valid.
+ */
+CpuSet parseCpuList(const std::string& list);
+
+/**
+ * @return the CPUs of each NUMA node that this process is allowed to run on, in node order.
+ *   Nodes without any such CPUs are left out. If the topology isn't known (e.g. not on Linux)
+ *   this is a single "node" of every allowed CPU.
+ */
+std::vector<CpuSet> numaNodes();
+
+/**
+ * Restrict the calling thread to `cpus`.
+ *
+ * Memory the thread touches first after this is allocated on the node it runs on, so
+ * buffers a pinned thread fills for itself stay local to it.
+ *
+ * @return whether the thread was pinned. Failure is logged but not fatal since placement is
+ *   only a performance hint.
+ */
+bool pinThisThread(const CpuSet& cpus);
+
+/**
+ * Hands out NUMA nodes to threads according to a workload's placement policy.
+ *
+ * Configured by the top-level `Placement:` block of a workload:
+ *
+ * ```yaml
+ * Placement:
+ *   Policy: Spread        # None (the default), Compact, Spread, or PerActorType
+ *   MetricsCpuSet: 0-1    # optional, where metrics senders run
+ * ```
+ *
+ * Threads are pinned to all the CPUs of a node rather than to a single CPU so the scheduler
+ * can still balance them within the node.
+ */
+class CpuPlacement {
+public:
+    enum class Policy {
+        // Don't pin threads.
+        kNone,
+        // Fill the first node's CPUs with threads, then the next node's, and so on.
+        kCompact,
+        // Put each thread on the next node round-robin.
+        kSpread,
+        // Keep all threads of the same Actor Type on one node, with Types round-robin.
+        kPerActorType,
+    };
+
+    CpuPlacement() = default;
+
+    CpuPlacement(Policy policy, std::vector<CpuSet> nodes);
+
+    /**
+     * @param name one of the `Policy:` values above.
+     * @throws InvalidConfigurationException if `name` isn't one.
+     */
+    static Policy parsePolicy(const std::string& name);
+
+    /**
+     * @param group threads in the same group (the Actor Type) share a node under kPerActorType.
+     * @return the CPUs for the next thread, or nullopt if threads shouldn't be pinned.
+     */
+    std::optional<CpuSet> next(const std::string& group = "");
+
+    Policy policy() const {
+        return _policy;
+    }
+
+private:
+    Policy _policy = Policy::kNone;
+    std::vector<CpuSet> _nodes;
+    size_t _assigned = 0;
+    std::map<std::string, size_t> _groupNodes;
+};
+
+}  // namespace genny::v1
+
+#endif  // HEADER_E43A6B1C_2F9D_4C75_8A0B_61D7C3E95F28_INCLUDED
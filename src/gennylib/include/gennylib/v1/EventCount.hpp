@@ -0,0 +1,79 @@
+// Copyright 2022-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef HEADER_B7C4E2A9_1D3F_4E86_9A5B_0C8F7D6E4A13_INCLUDED
+#define HEADER_B7C4E2A9_1D3F_4E86_9A5B_0C8F7D6E4A13_INCLUDED
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+
+namespace genny::v1 {
+
+/**
+ * Lets many threads wait for "something changed" without a shared mutex.
+ *
+ * Waiters call prepareWait(), re-check whatever they're waiting for, and only then call
+ * wait() with the key they got. A notifyAll() between prepareWait() and wait() makes wait()
+ * return immediately so wakeups can't be lost.
+ *
+ * Unlike a condition variable, woken threads don't have to re-acquire a mutex before they can
+ * re-check, so waking thousands of threads at once doesn't serialize them. On Linux this is
+ * a futex; elsewhere it falls back to a condition variable.
+ *
+ * ```c++
+ * while (true) {
+ *     auto key = events.prepareWait();
+ *     if (done()) {
+ *         break;
+ *     }
+ *     events.wait(key);
+ * }
+ * ```
+ */
+class EventCount {
+public:
+    using Key = uint32_t;
+
+    Key prepareWait() const {
+        return _count.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Block until notifyAll() has been called since `key` was taken, or `deadline`.
+     * May return spuriously.
+     */
+    void wait(Key key,
+              std::optional<std::chrono::steady_clock::time_point> deadline = std::nullopt);
+
+    /**
+     * Wake every waiter. Changes to what the waiters are checking must be made before this.
+     */
+    void notifyAll();
+
+private:
+    static_assert(sizeof(std::atomic<Key>) == sizeof(Key), "futex needs a plain 32-bit word");
+    std::atomic<Key> _count = 0;
+
+    // Only used where there's no futex.
+    std::mutex _mutex;
+    std::condition_variable _cv;
+};
+
+}  // namespace genny::v1
+
+#endif  // HEADER_B7C4E2A9_1D3F_4E86_9A5B_0C8F7D6E4A13_INCLUDED
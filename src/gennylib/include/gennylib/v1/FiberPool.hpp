@@ -0,0 +1,201 @@
+// Copyright 2022-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef HEADER_3C0E2F57_8D6B_4F7A_9E1C_2B5A7D4E6F10_INCLUDED
+#define HEADER_3C0E2F57_8D6B_4F7A_9E1C_2B5A7D4E6F10_INCLUDED
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include <boost/fiber/condition_variable.hpp>
+
+namespace genny::v1 {
+
+/**
+ * How Genny's own sleeps (`SleepBefore`, `SleepAfter`, rate-limiter backoff, and arrivals)
+ * are carried out.
+ */
+struct SleepOptions {
+    enum class Mode {
+        // Sleep with the OS's default timer slack. Sleeps typically overshoot by 50-100
+        // microseconds. This is the historical behavior.
+        kCoarse,
+        // Turn the thread's timer slack down to the minimum and sleep until `spin` before
+        // the deadline, then spin (or, on a FiberPool, yield) for the rest. Accurate to a
+        // few microseconds at the cost of some CPU.
+        kPrecise,
+    };
+
+    Mode mode = Mode::kCoarse;
+
+    std::chrono::nanoseconds spin = std::chrono::microseconds{50};
+};
+
+/**
+ * Set how sleepFor() and sleepUntil() sleep on the calling thread. parallelRun() and FiberPool
+ * set the workload's options on the threads they run Actors on.
+ */
+void setSleepOptions(SleepOptions options);
+
+/**
+ * @return the time a sleep with the given `deadline` should block until before switching to
+ *   sleepUntil() for the final stretch. This is `deadline` itself unless sleeps are precise.
+ *   Lets callers that wait on condition variables sleep as precisely as sleepUntil().
+ */
+std::chrono::steady_clock::time_point coarseDeadline(
+    std::chrono::steady_clock::time_point deadline);
+
+/**
+ * How a workload's Actors are mapped onto OS threads.
+ *
+ * Configured by the top-level `Execution:` block of a workload:
+ *
+ * ```yaml
+ * Execution:
+ *   Mode: Fibers      # or Threads (the default)
+ *   Workers: 8        # defaults to one per core
+ *   StackSizeKiB: 256
+ *   Sleep: Precise    # or Coarse (the default)
+ *   SleepSpin: 50 microseconds
+ * ```
+ */
+struct ExecutionOptions {
+    enum class Mode {
+        // One OS thread per Actor. This is the historical behavior.
+        kThreads,
+        // Actors are stackful fibers multiplexed onto a fixed pool of worker threads.
+        kFibers,
+    };
+
+    Mode mode = Mode::kThreads;
+
+    // Number of worker threads. Zero means std::thread::hardware_concurrency().
+    size_t workers = 0;
+
+    // Size of each fiber's stack. Stacks are mmap'd so untouched pages don't cost anything.
+    size_t stackSize = 256 * 1024;
+
+    SleepOptions sleep;
+
+    // CPUs for each worker thread, from the workload's `Placement:`. Empty means don't pin.
+    std::vector<std::vector<int>> workerCpus;
+};
+
+/**
+ * @return if the caller is running on a FiberPool worker thread. Blocking calls
+ *   made from such a thread should yield the fiber rather than the thread.
+ */
+bool onFiberPool();
+
+/**
+ * Sleep the calling Actor.
+ *
+ * On a FiberPool worker this suspends only the current fiber so other Actors
+ * can run on the worker; otherwise it is `std::this_thread::sleep_for`.
+ *
+ * @see SleepOptions for how precise the sleep is.
+ */
+void sleepFor(std::chrono::nanoseconds duration);
+
+/**
+ * @see sleepFor
+ */
+void sleepUntil(std::chrono::steady_clock::time_point deadline);
+
+/**
+ * Fiber counterpart of a std::condition_variable_any that many fibers wait on at once.
+ *
+ * boost::fibers::condition_variable_any unlinks a timed-out waiter by walking its whole
+ * wait-queue, so thousands of fibers each doing a timed wait on the same condition
+ * variable is quadratic. Here every waiter gets its own condition variable in a std::list
+ * so both timeouts and notifications are constant-time per waiter.
+ *
+ * As with a condition variable, callers must hold `lock` while checking their predicate
+ * and notifiers must hold the same lock exclusively while calling notifyAll().
+ */
+class FiberWaitList {
+public:
+    template <typename Lock>
+    void wait(Lock& lock,
+              std::optional<std::chrono::steady_clock::time_point> deadline = std::nullopt) {
+        Waiter self;
+        std::list<Waiter*>::iterator it;
+        {
+            std::lock_guard<std::mutex> lk{_mutex};
+            it = _waiters.insert(_waiters.end(), &self);
+        }
+        if (deadline) {
+            self.cv.wait_until(lock, *deadline);
+        } else {
+            self.cv.wait(lock);
+        }
+        std::lock_guard<std::mutex> lk{_mutex};
+        _waiters.erase(it);
+    }
+
+    void notifyAll() {
+        std::lock_guard<std::mutex> lk{_mutex};
+        for (auto* waiter : _waiters) {
+            waiter->cv.notify_all();
+        }
+    }
+
+private:
+    struct Waiter {
+        boost::fibers::condition_variable_any cv;
+    };
+
+    std::mutex _mutex;
+    std::list<Waiter*> _waiters;
+};
+
+/**
+ * Runs tasks as fibers on a fixed number of worker threads.
+ *
+ * Fibers are scheduled from a single shared ready-queue so a fiber that wakes up
+ * (e.g. from a sleep or a phase change) runs on whichever worker is free first.
+ *
+ * Only Genny's own blocking points (phase transitions in the Orchestrator, `SleepBefore`,
+ * `SleepAfter`, and rate-limiter backoff) yield. Anything else that blocks, such as
+ * a synchronous driver call, blocks the whole worker so fiber mode is best suited to
+ * workloads that spend most of their time in those places.
+ */
+class FiberPool {
+public:
+    explicit FiberPool(ExecutionOptions options);
+
+    /**
+     * Run every task to completion. Tasks must not throw.
+     */
+    void run(std::vector<std::function<void()>> tasks);
+
+    size_t workers() const {
+        return _workers;
+    }
+
+private:
+    size_t _workers;
+    size_t _stackSize;
+    SleepOptions _sleep;
+    std::vector<std::vector<int>> _workerCpus;
+};
+
+}  // namespace genny::v1
+
+#endif  // HEADER_3C0E2F57_8D6B_4F7A_9E1C_2B5A7D4E6F10_INCLUDED
@@ -0,0 +1,118 @@
+// Copyright 2022-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef HEADER_7A2D9C41_5E3B_4B8F_A1D6_0F4C8E2B9D37_INCLUDED
+#define HEADER_7A2D9C41_5E3B_4B8F_A1D6_0F4C8E2B9D37_INCLUDED
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace genny::v1 {
+
+/**
+ * Histogram of latencies that many threads can record into at once.
+ *
+ * Buckets are log-linear: each power of two is split into 8 buckets so a bucket's
+ * upper bound is within 12.5% of any value in it. Threads are spread over a fixed number
+ * of shards so recording is a relaxed increment that rarely shares a cache line.
+ *
+ * Counts are cumulative. Callers that want the distribution over an interval take
+ * a snapshot() at each end and subtract.
+ */
+class LatencyHistogram {
+public:
+    static constexpr size_t kSubBucketBits = 3;
+    static constexpr size_t kSubBuckets = 1 << kSubBucketBits;
+    static constexpr size_t kBuckets = (64 - kSubBucketBits + 1) * kSubBuckets;
+    static constexpr size_t kShards = 16;
+
+    using Counts = std::vector<uint64_t>;
+
+    void record(std::chrono::nanoseconds latency) {
+        thread_local const size_t shard = _nextShard++ % kShards;
+        _shards[shard].counts[bucketOf(latency.count())].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * @return the counts recorded so far, summed over all shards.
+     */
+    Counts snapshot() const {
+        Counts counts(kBuckets, 0);
+        for (const auto& shard : _shards) {
+            for (size_t i = 0; i < kBuckets; ++i) {
+                counts[i] += shard.counts[i].load(std::memory_order_relaxed);
+            }
+        }
+        return counts;
+    }
+
+    /**
+     * @return the upper bound of the bucket holding the given percentile of `counts`,
+     *   or zero if `counts` is empty.
+     */
+    static std::chrono::nanoseconds percentile(const Counts& counts, double percentile) {
+        uint64_t total = 0;
+        for (auto count : counts) {
+            total += count;
+        }
+        if (total == 0) {
+            return std::chrono::nanoseconds{0};
+        }
+        // The rank of the percentile, rounded up so p100 is the largest value.
+        const auto rank = uint64_t(percentile / 100 * (total - 1)) + 1;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts.size(); ++i) {
+            seen += counts[i];
+            if (seen >= rank) {
+                return std::chrono::nanoseconds{upperBoundOf(i)};
+            }
+        }
+        return std::chrono::nanoseconds{upperBoundOf(counts.size() - 1)};
+    }
+
+    static size_t bucketOf(int64_t value) {
+        if (value < int64_t(kSubBuckets)) {
+            return value < 0 ? 0 : size_t(value);
+        }
+        const size_t exponent = 63 - __builtin_clzll(uint64_t(value));
+        const size_t shift = exponent - kSubBucketBits;
+        const size_t subBucket = (uint64_t(value) >> shift) & (kSubBuckets - 1);
+        return (shift + 1) * kSubBuckets + subBucket;
+    }
+
+    static int64_t upperBoundOf(size_t bucket) {
+        if (bucket < kSubBuckets) {
+            return int64_t(bucket);
+        }
+        const size_t shift = bucket / kSubBuckets - 1;
+        const uint64_t subBucket = bucket % kSubBuckets;
+        const uint64_t upper = ((kSubBuckets + subBucket + 1) << shift) - 1;
+        return upper > uint64_t(INT64_MAX) ? INT64_MAX : int64_t(upper);
+    }
+
+private:
+    struct alignas(64) Shard {
+        std::array<std::atomic<uint64_t>, kBuckets> counts{};
+    };
+
+    static inline std::atomic<size_t> _nextShard = 0;
+    std::array<Shard, kShards> _shards{};
+};
+
+}  // namespace genny::v1
+
+#endif  // HEADER_7A2D9C41_5E3B_4B8F_A1D6_0F4C8E2B9D37_INCLUDED
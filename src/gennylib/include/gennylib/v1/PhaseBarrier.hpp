@@ -0,0 +1,147 @@
+// Copyright 2022-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef HEADER_A331BA02_AA01_42E9_B1E6_82BA53338D47_INCLUDED
+#define HEADER_A331BA02_AA01_42E9_B1E6_82BA53338D47_INCLUDED
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+
+#include <gennylib/Actor.hpp>
+
+namespace genny::v1 {
+
+/**
+ * Which of the worker processes started by `genny run --workers N` this is.
+ *
+ * Every worker constructs the whole workload, so each Actor thread gets the same ActorId, random
+ * seed, and share of its Actor's work (e.g. a Loader thread's documents) as in a single process.
+ * The Actor threads are dealt out round-robin and each worker only runs its own, so the workers
+ * do the work of one process between them.
+ */
+struct WorkerIdentity {
+    size_t index = 0;
+    size_t count = 1;
+
+    // The PhaseBarrierServer to connect to. Empty if this is the only process.
+    std::string socketPath;
+
+    bool isFanOut() const {
+        return count > 1;
+    }
+
+    /**
+     * @return whether this worker runs the Actor thread with the given id.
+     */
+    bool runs(ActorId id) const {
+        // ActorIds start at 1.
+        return (id - 1) % count == index;
+    }
+
+    /**
+     * @return `prefix + extension` with this worker's index in between when fanning out, so
+     *   workers don't write over each other's output files.
+     */
+    std::string filePath(const std::string& prefix, const std::string& extension) const {
+        if (!isFanOut()) {
+            return prefix + extension;
+        }
+        return prefix + ".worker-" + std::to_string(index) + extension;
+    }
+};
+
+/**
+ * Keeps the Orchestrators of several worker processes in step.
+ *
+ * Each worker sends the name of the barrier it's at (e.g. "start 2") and blocks until every
+ * worker has sent one. If they all sent the same thing they are told to go on. If they didn't,
+ * or a worker went away without saying goodbye, or abort() was called, every worker is told to
+ * abort from then on.
+ *
+ * The protocol is newline-delimited text over a Unix-domain stream socket.
+ */
+class PhaseBarrierServer {
+public:
+    /**
+     * Listen on `path`. Workers may connect as soon as this returns, even before serve() is
+     * called, so this can be created before forking them.
+     */
+    PhaseBarrierServer(std::string path, size_t workers);
+
+    ~PhaseBarrierServer();
+
+    PhaseBarrierServer(const PhaseBarrierServer&) = delete;
+    PhaseBarrierServer& operator=(const PhaseBarrierServer&) = delete;
+
+    /**
+     * Answer barriers until every worker has said goodbye or stop() is called.
+     */
+    void serve();
+
+    /**
+     * Tell every worker to abort at its next barrier. Thread-safe.
+     */
+    void abort();
+
+    /**
+     * Make serve() return. Thread-safe.
+     */
+    void stop();
+
+    const std::string& path() const {
+        return _path;
+    }
+
+private:
+    const std::string _path;
+    const size_t _workers;
+    int _listener = -1;
+    std::atomic_bool _aborted = false;
+    std::atomic_bool _stopped = false;
+};
+
+/**
+ * A worker's connection to a PhaseBarrierServer.
+ */
+class PhaseBarrierClient {
+public:
+    /**
+     * @throws std::runtime_error if the server can't be reached.
+     */
+    explicit PhaseBarrierClient(const std::string& path);
+
+    /**
+     * Says goodbye so the server doesn't treat this worker leaving as a failure.
+     */
+    ~PhaseBarrierClient();
+
+    PhaseBarrierClient(const PhaseBarrierClient&) = delete;
+    PhaseBarrierClient& operator=(const PhaseBarrierClient&) = delete;
+
+    /**
+     * Wait for every worker to reach the barrier named `barrier`.
+     *
+     * @return true to go on or false if the workers should abort.
+     */
+    bool await(const std::string& barrier);
+
+private:
+    int _socket = -1;
+    std::string _buffer;
+};
+
+}  // namespace genny::v1
+
+#endif  // HEADER_A331BA02_AA01_42E9_B1E6_82BA53338D47_INCLUDED
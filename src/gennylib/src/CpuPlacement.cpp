@@ -0,0 +1,197 @@
+// Copyright 2022-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gennylib/v1/CpuPlacement.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include <boost/log/trivial.hpp>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <gennylib/InvalidConfigurationException.hpp>
+
+namespace genny::v1 {
+namespace {
+
+CpuSet allowedCpus() {
+    CpuSet out;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) {
+                out.push_back(cpu);
+            }
+        }
+        return out;
+    }
+#endif
+    const auto count = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned cpu = 0; cpu < count; ++cpu) {
+        out.push_back(int(cpu));
+    }
+    return out;
+}
+
+}  // namespace
+
+CpuSet parseCpuList(const std::string& list) {
+    CpuSet out;
+    std::stringstream ranges{list};
+    std::string range;
+    while (std::getline(ranges, range, ',')) {
+        range.erase(std::remove_if(range.begin(), range.end(), ::isspace), range.end());
+        if (range.empty()) {
+            continue;
+        }
+        try {
+            const auto dash = range.find('-');
+            const int first = std::stoi(range.substr(0, dash));
+            const int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+            if (first < 0 || last < first) {
+                throw std::invalid_argument(range);
+            }
+            for (int cpu = first; cpu <= last; ++cpu) {
+                out.push_back(cpu);
+            }
+        } catch (const std::logic_error&) {
+            throw InvalidConfigurationException("Invalid CPU list '" + list +
+                                                "'. Expected e.g. 0-3,8,10-11");
+        }
+    }
+    if (out.empty()) {
+        throw InvalidConfigurationException("CPU list '" + list + "' is empty");
+    }
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+    return out;
+}
+
+std::vector<CpuSet> numaNodes() {
+    const auto allowed = allowedCpus();
+    std::vector<CpuSet> nodes;
+#ifdef __linux__
+    // Node numbers can have gaps but are small; stop after a run of missing ones.
+    for (int node = 0, missing = 0; missing < 8; ++node) {
+        std::ifstream file{"/sys/devices/system/node/node" + std::to_string(node) + "/cpulist"};
+        std::string list;
+        if (!file || !std::getline(file, list) || list.empty()) {
+            ++missing;
+            continue;
+        }
+        missing = 0;
+        CpuSet cpus;
+        for (auto cpu : parseCpuList(list)) {
+            if (std::binary_search(allowed.begin(), allowed.end(), cpu)) {
+                cpus.push_back(cpu);
+            }
+        }
+        if (!cpus.empty()) {
+            nodes.push_back(std::move(cpus));
+        }
+    }
+#endif
+    if (nodes.empty()) {
+        nodes.push_back(allowed);
+    }
+    return nodes;
+}
+
+bool pinThisThread(const CpuSet& cpus) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (auto cpu : cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    if (const auto err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set); err != 0) {
+        BOOST_LOG_TRIVIAL(warning) << "Couldn't pin thread to CPUs: " << std::strerror(err);
+        return false;
+    }
+    return true;
+#else
+    static bool warned = false;
+    if (!warned) {
+        BOOST_LOG_TRIVIAL(warning) << "Thread placement isn't supported on this platform";
+        warned = true;
+    }
+    return false;
+#endif
+}
+
+CpuPlacement::CpuPlacement(Policy policy, std::vector<CpuSet> nodes)
+    : _policy{policy}, _nodes{std::move(nodes)} {
+    if (_nodes.empty()) {
+        _policy = Policy::kNone;
+    }
+}
+
+CpuPlacement::Policy CpuPlacement::parsePolicy(const std::string& name) {
+    if (name == "None") {
+        return Policy::kNone;
+    } else if (name == "Compact") {
+        return Policy::kCompact;
+    } else if (name == "Spread") {
+        return Policy::kSpread;
+    } else if (name == "PerActorType") {
+        return Policy::kPerActorType;
+    }
+    throw InvalidConfigurationException(
+        "Placement Policy must be None, Compact, Spread, or PerActorType, got '" + name + "'");
+}
+
+std::optional<CpuSet> CpuPlacement::next(const std::string& group) {
+    size_t node = 0;
+    switch (_policy) {
+        case Policy::kNone:
+            return std::nullopt;
+        case Policy::kCompact: {
+            size_t total = 0;
+            for (const auto& cpus : _nodes) {
+                total += cpus.size();
+            }
+            // Once every CPU has a thread, start filling from the first node again.
+            auto slot = _assigned % total;
+            while (slot >= _nodes[node].size()) {
+                slot -= _nodes[node].size();
+                ++node;
+            }
+            break;
+        }
+        case Policy::kSpread:
+            node = _assigned % _nodes.size();
+            break;
+        case Policy::kPerActorType: {
+            const auto nextNode = _groupNodes.size() % _nodes.size();
+            node = _groupNodes.try_emplace(group, nextNode).first->second;
+            break;
+        }
+    }
+    ++_assigned;
+    return _nodes[node];
+}
+
+}  // namespace genny::v1
@@ -0,0 +1,76 @@
+// Copyright 2022-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gennylib/v1/EventCount.hpp>
+
+#include <climits>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+namespace genny::v1 {
+
+#ifdef __linux__
+
+void EventCount::wait(Key key, std::optional<std::chrono::steady_clock::time_point> deadline) {
+    timespec timeout;
+    timespec* timeoutPtr = nullptr;
+    if (deadline) {
+        const auto remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                   *deadline - std::chrono::steady_clock::now())
+                                   .count();
+        if (remaining <= 0) {
+            return;
+        }
+        // FUTEX_WAIT takes a relative CLOCK_MONOTONIC timeout.
+        timeout.tv_sec = remaining / (1000 * 1000 * 1000);
+        timeout.tv_nsec = remaining % (1000 * 1000 * 1000);
+        timeoutPtr = &timeout;
+    }
+    // Returns immediately (EAGAIN) if _count is no longer `key`.
+    syscall(SYS_futex, &_count, FUTEX_WAIT_PRIVATE, key, timeoutPtr, nullptr, 0);
+}
+
+void EventCount::notifyAll() {
+    _count.fetch_add(1, std::memory_order_release);
+    syscall(SYS_futex, &_count, FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+}
+
+#else
+
+void EventCount::wait(Key key, std::optional<std::chrono::steady_clock::time_point> deadline) {
+    std::unique_lock<std::mutex> lock{_mutex};
+    auto changed = [&]() { return _count.load(std::memory_order_acquire) != key; };
+    if (deadline) {
+        _cv.wait_until(lock, *deadline, changed);
+    } else {
+        _cv.wait(lock, changed);
+    }
+}
+
+void EventCount::notifyAll() {
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        _count.fetch_add(1, std::memory_order_release);
+    }
+    _cv.notify_all();
+}
+
+#endif
+
+}  // namespace genny::v1
@@ -0,0 +1,286 @@
+// Copyright 2022-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gennylib/v1/FiberPool.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include <boost/fiber/algo/algorithm.hpp>
+#include <boost/fiber/condition_variable.hpp>
+#include <boost/fiber/context.hpp>
+#include <boost/fiber/fiber.hpp>
+#include <boost/fiber/mutex.hpp>
+#include <boost/fiber/operations.hpp>
+#include <boost/fiber/protected_fixedsize_stack.hpp>
+#include <boost/fiber/scheduler.hpp>
+#include <boost/log/trivial.hpp>
+
+#ifdef __linux__
+#include <sys/prctl.h>
+#include <time.h>
+#endif
+
+#include <gennylib/v1/CpuPlacement.hpp>
+
+namespace genny::v1 {
+namespace {
+
+thread_local bool isFiberPoolWorker = false;
+
+// Set on each Actor's thread or fiber-pool worker before the Actors run.
+thread_local SleepOptions sleepOptions;
+
+/**
+ * Let a sibling hyperthread have the core while we spin.
+ */
+inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield" ::: "memory");
+#endif
+}
+
+/**
+ * Block the thread until `deadline` with as little overshoot as the OS allows.
+ */
+void sleepThreadUntil(std::chrono::steady_clock::time_point deadline) {
+#ifdef __linux__
+    // The default 50us of slack lets the kernel coalesce our wakeup with others, which is
+    // exactly the overshoot we're trying to avoid. The setting is per-thread.
+    thread_local const bool slackSet = prctl(PR_SET_TIMERSLACK, 1UL, 0, 0, 0) == 0;
+    (void)slackSet;
+
+    // steady_clock is CLOCK_MONOTONIC. Sleeping to an absolute time means an interrupted
+    // sleep can resume without drifting.
+    const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        deadline.time_since_epoch())
+                        .count();
+    timespec ts;
+    ts.tv_sec = ns / (1000 * 1000 * 1000);
+    ts.tv_nsec = ns % (1000 * 1000 * 1000);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+    }
+#else
+    std::this_thread::sleep_until(deadline);
+#endif
+}
+
+void preciseSleepUntil(std::chrono::steady_clock::time_point deadline) {
+    const auto coarse = deadline - sleepOptions.spin;
+    if (std::chrono::steady_clock::now() < coarse) {
+        if (isFiberPoolWorker) {
+            boost::this_fiber::sleep_until(coarse);
+        } else {
+            sleepThreadUntil(coarse);
+        }
+    }
+    // Spinning on a FiberPool worker would hold up every other fiber on it, so yield instead.
+    // A yield only takes as long as whatever else is ready needs to run.
+    while (std::chrono::steady_clock::now() < deadline) {
+        if (isFiberPoolWorker) {
+            boost::this_fiber::yield();
+        } else {
+            cpuRelax();
+        }
+    }
+}
+
+/**
+ * State shared by every worker's SharedQueueAlgorithm.
+ */
+struct ReadyQueue {
+    std::mutex mutex;
+    std::condition_variable idle;
+    std::deque<boost::fibers::context*> contexts;
+};
+
+/**
+ * Like boost::fibers::algo::shared_work but scoped to a single FiberPool and with idle workers
+ * woken as soon as there's work for them. (shared_work's idle workers only wake up for their
+ * own timers and remote wakeups so newly-readied fibers can sit in the queue while cores idle.)
+ */
+class SharedQueueAlgorithm : public boost::fibers::algo::algorithm {
+public:
+    explicit SharedQueueAlgorithm(ReadyQueue* queue) : _queue{queue} {}
+
+    void awakened(boost::fibers::context* ctx) noexcept override {
+        if (ctx->is_context(boost::fibers::type::pinned_context)) {
+            // Main and dispatcher contexts must stay on their own thread.
+            ctx->ready_link(_local);
+            return;
+        }
+        ctx->detach();
+        {
+            std::lock_guard<std::mutex> lk{_queue->mutex};
+            _queue->contexts.push_back(ctx);
+        }
+        _queue->idle.notify_one();
+    }
+
+    boost::fibers::context* pick_next() noexcept override {
+        std::unique_lock<std::mutex> lk{_queue->mutex};
+        if (!_queue->contexts.empty()) {
+            auto* ctx = _queue->contexts.front();
+            _queue->contexts.pop_front();
+            lk.unlock();
+            boost::fibers::context::active()->attach(ctx);
+            return ctx;
+        }
+        lk.unlock();
+        if (!_local.empty()) {
+            auto* ctx = &_local.front();
+            _local.pop_front();
+            return ctx;
+        }
+        return nullptr;
+    }
+
+    bool has_ready_fibers() const noexcept override {
+        std::lock_guard<std::mutex> lk{_queue->mutex};
+        return !_queue->contexts.empty() || !_local.empty();
+    }
+
+    void suspend_until(std::chrono::steady_clock::time_point const& deadline) noexcept override {
+        std::unique_lock<std::mutex> lk{_queue->mutex};
+        auto ready = [&]() { return _notified || !_queue->contexts.empty(); };
+        if (deadline == (std::chrono::steady_clock::time_point::max)()) {
+            _queue->idle.wait(lk, ready);
+        } else {
+            _queue->idle.wait_until(lk, deadline, ready);
+        }
+        _notified = false;
+    }
+
+    void notify() noexcept override {
+        {
+            std::lock_guard<std::mutex> lk{_queue->mutex};
+            _notified = true;
+        }
+        // We don't know which worker is sleeping on our behalf so wake them all.
+        // This only happens for remote wakeups and timers, not for every yield.
+        _queue->idle.notify_all();
+    }
+
+private:
+    ReadyQueue* _queue;
+    boost::fibers::scheduler::ready_queue_type _local;
+
+    // Guarded by _queue->mutex.
+    bool _notified = false;
+};
+
+}  // namespace
+
+bool onFiberPool() {
+    return isFiberPoolWorker;
+}
+
+void setSleepOptions(SleepOptions options) {
+    sleepOptions = options;
+}
+
+std::chrono::steady_clock::time_point coarseDeadline(
+    std::chrono::steady_clock::time_point deadline) {
+    return sleepOptions.mode == SleepOptions::Mode::kPrecise ? deadline - sleepOptions.spin
+                                                             : deadline;
+}
+
+void sleepFor(std::chrono::nanoseconds duration) {
+    if (sleepOptions.mode == SleepOptions::Mode::kPrecise) {
+        preciseSleepUntil(std::chrono::steady_clock::now() + duration);
+    } else if (isFiberPoolWorker) {
+        boost::this_fiber::sleep_for(duration);
+    } else {
+        std::this_thread::sleep_for(duration);
+    }
+}
+
+void sleepUntil(std::chrono::steady_clock::time_point deadline) {
+    if (sleepOptions.mode == SleepOptions::Mode::kPrecise) {
+        preciseSleepUntil(deadline);
+    } else if (isFiberPoolWorker) {
+        boost::this_fiber::sleep_until(deadline);
+    } else {
+        std::this_thread::sleep_until(deadline);
+    }
+}
+
+FiberPool::FiberPool(ExecutionOptions options)
+    : _workers{options.workers > 0 ? options.workers
+                                   : std::max(1u, std::thread::hardware_concurrency())},
+      _stackSize{options.stackSize},
+      _sleep{options.sleep},
+      _workerCpus{std::move(options.workerCpus)} {}
+
+void FiberPool::run(std::vector<std::function<void()>> tasks) {
+    if (tasks.empty()) {
+        return;
+    }
+
+    ReadyQueue queue;
+
+    boost::fibers::mutex doneMutex;
+    boost::fibers::condition_variable doneCv;
+    size_t remaining = tasks.size();
+
+    BOOST_LOG_TRIVIAL(info) << "Running " << tasks.size() << " fibers on " << _workers
+                            << " worker threads";
+
+    std::vector<std::thread> threads;
+    threads.reserve(_workers);
+    for (size_t worker = 0; worker < _workers; ++worker) {
+        threads.emplace_back([&, worker]() {
+            if (!_workerCpus.empty()) {
+                pinThisThread(_workerCpus[worker % _workerCpus.size()]);
+            }
+            isFiberPoolWorker = true;
+            setSleepOptions(_sleep);
+            boost::fibers::use_scheduling_algorithm<SharedQueueAlgorithm>(&queue);
+
+            // Each worker launches a stride of the tasks. They go into the shared
+            // queue so they don't stay on the worker that launched them.
+            for (size_t i = worker; i < tasks.size(); i += _workers) {
+                boost::fibers::fiber{std::allocator_arg,
+                                     boost::fibers::protected_fixedsize_stack{_stackSize},
+                                     [&, i]() {
+                                         tasks[i]();
+                                         std::lock_guard<boost::fibers::mutex> lk{doneMutex};
+                                         if (--remaining == 0) {
+                                             doneCv.notify_all();
+                                         }
+                                     }}
+                    .detach();
+            }
+
+            // Suspending the worker's main fiber lets its dispatcher run the shared fibers.
+            std::unique_lock<boost::fibers::mutex> lk{doneMutex};
+            doneCv.wait(lk, [&]() { return remaining == 0; });
+            isFiberPoolWorker = false;
+            setSleepOptions(SleepOptions{});
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+}  // namespace genny::v1
@@ -29,6 +29,12 @@ inline constexpr bool morePhaseLogic(genny::PhaseNumber currentPhase,
     return currentPhase <= maxPhase && !errors;
 }
 
+int64_t nowNS() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               genny::SteadyClock::now().time_since_epoch())
+        .count();
+}
+
 }  // namespace
 
 
@@ -43,10 +49,52 @@ using reader = std::shared_lock<std::shared_mutex>;
 /** @private */
 using writer = std::unique_lock<std::shared_mutex>;
 
-PhaseNumber Orchestrator::currentPhase() const {
-    reader lock{_mutex};
+template <typename Lock, typename Done>
+void Orchestrator::waitForEpoch(Lock& lock,
+                                Done done,
+                                std::optional<SteadyClock::time_point> deadline) {
+    const bool onFibers = v1::onFiberPool();
+    if (!onFibers && lock.owns_lock()) {
+        // The event count doesn't need the lock. Dropping it means woken threads don't queue
+        // up for it one at a time just to look at the epoch.
+        lock.unlock();
+    }
+    while (!done(loadEpoch())) {
+        std::optional<SteadyClock::time_point> coarse;
+        if (deadline) {
+            coarse = v1::coarseDeadline(*deadline);
+            if (SteadyClock::now() >= *coarse) {
+                // Precise sleeps finish the last stretch without waiting on the phase. A phase
+                // change in that window is noticed when it ends.
+                if (lock.owns_lock()) {
+                    lock.unlock();
+                }
+                v1::sleepUntil(*deadline);
+                return;
+            }
+        }
+        if (onFibers) {
+            _fiberPhaseChange.wait(lock, coarse);
+        } else {
+            const auto key = _phaseChange.prepareWait();
+            if (done(loadEpoch())) {
+                break;
+            }
+            _phaseChange.wait(key, coarse);
+        }
+    }
+    if (lock.owns_lock()) {
+        lock.unlock();
+    }
+}
+
+void Orchestrator::notifyPhaseChange() {
+    _phaseChange.notifyAll();
+    _fiberPhaseChange.notifyAll();
+}
 
-    return this->_current;
+PhaseNumber Orchestrator::currentPhase() const {
+    return phaseOf(loadEpoch());
 }
 
 bool Orchestrator::continueRunning() const {
@@ -62,38 +110,41 @@ bool Orchestrator::continueRunning() const {
     //
     // Hence only allowed to read std::atomic values.
     //
-    // PhaseLoop_perf_test.cpp deals heavily with the performance
+    // PhaseLoop_benchmark.cpp deals heavily with the performance
     // implications of this method.
     //
-    return !this->_errors;
+    return !hasErrors(loadEpoch());
 }
 
 bool Orchestrator::morePhases() const {
-    reader lock{_mutex};
-
-    return morePhaseLogic(this->_current, this->_max, this->_errors);
+    // Same constraints as continueRunning(): this is called by every Actor
+    // between phases and by ActorPhaseIterator so must not take _mutex.
+    const auto epoch = loadEpoch();
+    return morePhaseLogic(phaseOf(epoch), _max.load(std::memory_order_relaxed), hasErrors(epoch));
 }
 
 // we start once we have required number of tokens
 PhaseNumber Orchestrator::awaitPhaseStart(bool block, int addTokens) {
     writer lock{_mutex};
-    assert(state == State::PhaseEnded || this->_errors);
+    const auto epoch = loadEpoch();
+    assert(!isStarted(epoch) || hasErrors(epoch));
 
     _currentTokens += addTokens;
 
-    const auto currentPhase = this->_current;
+    const auto currentPhase = phaseOf(epoch);
     if (_currentTokens >= _requireTokens) {
         for (auto&& cb : _prePhaseStartHooks) {
             cb(this, currentPhase);
         }
         BOOST_LOG_TRIVIAL(info) << "Beginning phase " << currentPhase;
-        _phaseChange.notify_all();
-        state = State::PhaseStarted;
+        _phaseStartedAt = nowNS();
+        _startSkew.reset();
+        // Re-load since a hook may have called abort().
+        storeEpoch(loadEpoch() | kPhaseStartedBit);
+        notifyPhaseChange();
     } else {
         if (block) {
-            while (state != State::PhaseStarted && !this->_errors) {
-                _phaseChange.wait(lock);
-            }
+            waitForEpoch(lock, [](Epoch epoch) { return isStarted(epoch) || hasErrors(epoch); });
         }
     }
     return currentPhase;
@@ -107,13 +158,13 @@ void Orchestrator::addRequiredTokens(int tokens) {
 
 void Orchestrator::phasesAtLeastTo(PhaseNumber minPhase) {
     writer lock{_mutex};
-    this->_max = std::max(this->_max, minPhase);
+    this->_max.store(std::max(this->_max.load(), minPhase));
 }
 
 // we end once no more tokens left
 bool Orchestrator::awaitPhaseEnd(bool block, int removeTokens) {
     writer lock{_mutex};
-    assert(State::PhaseStarted == state || this->_errors);
+    assert(isStarted(loadEpoch()) || hasErrors(loadEpoch()));
 
     _currentTokens -= removeTokens;
 
@@ -138,21 +189,28 @@ bool Orchestrator::awaitPhaseEnd(bool block, int removeTokens) {
     if (_currentTokens <= 0) {
         // Fire the phase stop callbacks before updating the current phase counter to indicate that
         // the current phase is complete.
-        BOOST_LOG_TRIVIAL(info) << "Ended phase " << _current;
+        const auto current = phaseOf(loadEpoch());
+        BOOST_LOG_TRIVIAL(info) << "Ended phase " << current;
+        if (const auto count = _startSkew.count.load(); count > 0) {
+            BOOST_LOG_TRIVIAL(info)
+                << "Phase " << current << " start skew across " << count
+                << " actors: max " << _startSkew.maxNS.load() / 1000 << "us";
+        }
         for (auto&& cb : _postPhaseStopHooks) {
-            cb(this, _current);
+            cb(this, current);
         }
-        ++_current;
-        _phaseChange.notify_all();
-        state = State::PhaseEnded;
+        _phaseEndedAt = nowNS();
+        // Advance the phase and clear the started bit in one store so readers
+        // never observe the next phase as already started.
+        storeEpoch((loadEpoch() & kErrorsBit) | (current + 1));
+        notifyPhaseChange();
     } else {
         if (block) {
-            while (state != State::PhaseEnded && !this->_errors) {
-                _phaseChange.wait(lock);
-            }
+            waitForEpoch(lock, [](Epoch epoch) { return !isStarted(epoch) || hasErrors(epoch); });
         }
     }
-    return morePhaseLogic(this->_current, this->_max, this->_errors);
+    const auto epoch = loadEpoch();
+    return morePhaseLogic(phaseOf(epoch), this->_max.load(), hasErrors(epoch));
 }
 
 
@@ -168,42 +226,62 @@ void Orchestrator::addPostPhaseStopHook(const OrchestratorCB& f) {
 
 void Orchestrator::abort() {
     writer lock{_mutex};
-    this->_errors = true;
-    _phaseChange.notify_all();
+    storeEpoch(loadEpoch() | kErrorsBit);
+    notifyPhaseChange();
 }
 
-void Orchestrator::sleepToPhaseEnd(Duration timeout, const PhaseNumber pn) {
-    using SteadyClock = std::chrono::steady_clock;
-    const auto sleepEnd = SteadyClock::now() + timeout;
+void Orchestrator::setPhaseSkewCallbacks(PhaseSkewCB onStart, PhaseSkewCB onStop) {
+    writer lock{_mutex};
+    _onStartSkew = std::move(onStart);
+    _onStopSkew = std::move(onStop);
+}
 
-    reader lock{_mutex};
+void Orchestrator::actorStartedPhase(PhaseNumber phase) {
+    const auto epoch = loadEpoch();
+    if (phaseOf(epoch) != phase || !isStarted(epoch)) {
+        // The phase already ended so _phaseStartedAt may be for a later one.
+        return;
+    }
+    // Clamp in case the phase ended and another started since we loaded the epoch.
+    const auto skew = std::max<int64_t>(0, nowNS() - _phaseStartedAt.load());
+    _startSkew.add(skew);
+    if (_onStartSkew) {
+        _onStartSkew(phase, Duration{skew});
+    }
+}
 
-    // While loop to handle spurious wakeups.
-    while (this->_current == pn && state != State::PhaseEnded) {
-        const auto waitTimeout = sleepEnd - SteadyClock::now();
-        // If we've already passed the timeout then exit.
-        if (waitTimeout < Duration::zero()) {
-            return;
-        }
-        _phaseChange.wait_for(lock, waitTimeout);
+void Orchestrator::actorLeftPhase(PhaseNumber phase) {
+    if (phaseOf(loadEpoch()) != phase + 1) {
+        // Either the phase hasn't ended (we're not blocking on it) or a later one has.
+        return;
+    }
+    const auto skew = std::max<int64_t>(0, nowNS() - _phaseEndedAt.load());
+    if (_onStopSkew) {
+        _onStopSkew(phase, Duration{skew});
     }
 }
 
+void Orchestrator::sleepToPhaseEnd(Duration timeout, const PhaseNumber pn) {
+    this->sleepUntilOrPhaseEnd(SteadyClock::now() + timeout, pn);
+}
+
 void Orchestrator::sleepUntilOrPhaseEnd(std::chrono::time_point<SteadyClock> deadline,
                                         const PhaseNumber pn) {
-    using SteadyClock = std::chrono::steady_clock;
-
-    reader lock{_mutex};
+    // Don't bother with the lock if the phase has already moved on.
+    const auto epoch = loadEpoch();
+    if (phaseOf(epoch) != pn || !isStarted(epoch)) {
+        return;
+    }
 
-    // While loop to handle spurious wakeups.
-    while (this->_current == pn && state != State::PhaseEnded) {
-        const auto waitTimeout = deadline - SteadyClock::now();
-        // If we've already passed the timeout then exit.
-        if (waitTimeout < Duration::zero()) {
-            return;
-        }
-        _phaseChange.wait_for(lock, waitTimeout);
+    // Only fibers need the lock to wait.
+    reader lock{_mutex, std::defer_lock};
+    if (v1::onFiberPool()) {
+        lock.lock();
     }
+    waitForEpoch(
+        lock,
+        [pn](Epoch epoch) { return phaseOf(epoch) != pn || !isStarted(epoch); },
+        deadline);
 }
 
 }  // namespace genny
@@ -0,0 +1,262 @@
+// Copyright 2022-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gennylib/v1/PhaseBarrier.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <boost/log/trivial.hpp>
+
+namespace genny::v1 {
+namespace {
+
+const std::string kGo = "go";
+const std::string kAbort = "abort";
+const std::string kBye = "bye";
+
+sockaddr_un addressOf(const std::string& path) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        throw std::runtime_error("Phase barrier socket path is too long: " + path);
+    }
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    return addr;
+}
+
+bool writeLine(int fd, const std::string& line) {
+    const auto message = line + "\n";
+    size_t written = 0;
+    while (written < message.size()) {
+        // A worker that has gone away shouldn't take the server down with SIGPIPE.
+        const auto n =
+            ::send(fd, message.data() + written, message.size() - written, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        written += size_t(n);
+    }
+    return true;
+}
+
+/**
+ * Move complete lines from the front of `buffer` to `lines`.
+ */
+void takeLines(std::string& buffer, std::vector<std::string>& lines) {
+    size_t newline;
+    while ((newline = buffer.find('\n')) != std::string::npos) {
+        lines.push_back(buffer.substr(0, newline));
+        buffer.erase(0, newline + 1);
+    }
+}
+
+}  // namespace
+
+PhaseBarrierServer::PhaseBarrierServer(std::string path, size_t workers)
+    : _path{std::move(path)}, _workers{workers} {
+    const auto addr = addressOf(_path);
+    ::unlink(_path.c_str());
+    _listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (_listener < 0 ||
+        ::bind(_listener, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        ::listen(_listener, int(workers)) != 0) {
+        const auto error = std::string{::strerror(errno)};
+        if (_listener >= 0) {
+            ::close(_listener);
+        }
+        throw std::runtime_error("Couldn't listen on " + _path + ": " + error);
+    }
+}
+
+PhaseBarrierServer::~PhaseBarrierServer() {
+    ::close(_listener);
+    ::unlink(_path.c_str());
+}
+
+void PhaseBarrierServer::abort() {
+    _aborted = true;
+}
+
+void PhaseBarrierServer::stop() {
+    _stopped = true;
+}
+
+void PhaseBarrierServer::serve() {
+    struct Worker {
+        int fd;
+        std::string buffer;
+        std::optional<std::string> waitingAt;
+        bool saidBye = false;
+        bool closed = false;
+    };
+    std::vector<Worker> workers;
+    size_t accepted = 0;
+
+    while (!_stopped) {
+        const bool accepting = accepted < _workers;
+        if (!accepting && workers.empty()) {
+            // Everyone has left.
+            break;
+        }
+
+        std::vector<pollfd> fds;
+        for (const auto& worker : workers) {
+            fds.push_back({worker.fd, POLLIN, 0});
+        }
+        if (accepting) {
+            fds.push_back({_listener, POLLIN, 0});
+        }
+        // Wake up now and then to notice stop() and abort().
+        if (::poll(fds.data(), fds.size(), 100) < 0 && errno != EINTR) {
+            BOOST_LOG_TRIVIAL(error) << "Phase barrier poll failed: " << ::strerror(errno);
+            _aborted = true;
+            break;
+        }
+
+        for (size_t i = 0; i < workers.size(); ++i) {
+            auto& worker = workers[i];
+            if (fds[i].revents == 0) {
+                continue;
+            }
+            char chunk[256];
+            const auto n = ::read(worker.fd, chunk, sizeof(chunk));
+            if (n <= 0) {
+                if (n < 0 && errno == EINTR) {
+                    continue;
+                }
+                worker.closed = true;
+                continue;
+            }
+            worker.buffer.append(chunk, size_t(n));
+            std::vector<std::string> lines;
+            takeLines(worker.buffer, lines);
+            for (auto& line : lines) {
+                if (line == kBye) {
+                    worker.saidBye = true;
+                } else {
+                    worker.waitingAt = std::move(line);
+                }
+            }
+        }
+        if (accepting && (fds.back().revents & POLLIN)) {
+            if (const int fd = ::accept(_listener, nullptr, nullptr); fd >= 0) {
+                workers.push_back({fd});
+                ++accepted;
+            }
+        }
+
+        // Drop workers that have gone away.
+        for (auto& worker : workers) {
+            if (worker.closed) {
+                if (!worker.saidBye && !_aborted) {
+                    BOOST_LOG_TRIVIAL(error) << "A genny worker disconnected unexpectedly. "
+                                             << "Aborting the others.";
+                    _aborted = true;
+                }
+                ::close(worker.fd);
+            }
+        }
+        workers.erase(
+            std::remove_if(workers.begin(), workers.end(), [](auto& w) { return w.closed; }),
+            workers.end());
+
+        // See if everyone still running has reached the same barrier.
+        const auto running = std::count_if(
+            workers.begin(), workers.end(), [](auto& w) { return !w.saidBye; });
+        const auto waiting = std::count_if(
+            workers.begin(), workers.end(), [](auto& w) { return w.waitingAt.has_value(); });
+        if (waiting == 0 || (!_aborted && (accepted < _workers || waiting < running))) {
+            continue;
+        }
+        if (!_aborted) {
+            const auto& first = *std::find_if(workers.begin(), workers.end(), [](auto& w) {
+                                     return w.waitingAt.has_value();
+                                 })->waitingAt;
+            for (const auto& worker : workers) {
+                if (worker.waitingAt && *worker.waitingAt != first) {
+                    BOOST_LOG_TRIVIAL(error)
+                        << "genny workers disagree on the next barrier: '" << first << "' and '"
+                        << *worker.waitingAt << "'. Aborting them all.";
+                    _aborted = true;
+                    break;
+                }
+            }
+        }
+        for (auto& worker : workers) {
+            if (worker.waitingAt) {
+                writeLine(worker.fd, _aborted ? kAbort : kGo);
+                worker.waitingAt.reset();
+            }
+        }
+    }
+
+    for (auto& worker : workers) {
+        ::close(worker.fd);
+    }
+}
+
+PhaseBarrierClient::PhaseBarrierClient(const std::string& path) {
+    const auto addr = addressOf(path);
+    _socket = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (_socket < 0 ||
+        ::connect(_socket, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0) {
+        const auto error = std::string{::strerror(errno)};
+        if (_socket >= 0) {
+            ::close(_socket);
+        }
+        throw std::runtime_error("Couldn't connect to phase barrier at " + path + ": " + error);
+    }
+}
+
+PhaseBarrierClient::~PhaseBarrierClient() {
+    writeLine(_socket, kBye);
+    ::close(_socket);
+}
+
+bool PhaseBarrierClient::await(const std::string& barrier) {
+    if (!writeLine(_socket, barrier)) {
+        return false;
+    }
+    std::vector<std::string> lines;
+    while (lines.empty()) {
+        char chunk[64];
+        const auto n = ::read(_socket, chunk, sizeof(chunk));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            BOOST_LOG_TRIVIAL(error) << "Lost the phase barrier while waiting at '" << barrier
+                                     << "'";
+            return false;
+        }
+        _buffer.append(chunk, size_t(n));
+        takeLines(_buffer, lines);
+    }
+    return lines.front() == kGo;
+}
+
+}  // namespace genny::v1
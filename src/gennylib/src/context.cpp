@@ -14,6 +14,7 @@
 
 #include <gennylib/context.hpp>
 
+#include <algorithm>
 #include <memory>
 #include <set>
 #include <filesystem>
@@ -26,6 +27,7 @@
 
 #include <gennylib/Cast.hpp>
 #include <gennylib/parallel.hpp>
+#include <gennylib/v1/CpuPlacement.hpp>
 #include <gennylib/v1/Sleeper.hpp>
 #include <metrics/metrics.hpp>
 
@@ -42,11 +44,13 @@ WorkloadContext::WorkloadContext(const Node& node,
                                  Orchestrator& orchestrator,
                                  const Cast& cast,
                                  v1::PoolManager::OnCommandStartCallback apmCallback,
-                                 bool dryRun)
+                                 bool dryRun,
+                                 v1::WorkerIdentity worker)
     : v1::HasNode{node},
       _orchestrator{&orchestrator},
       _rateLimiters{10},
       _poolManager{apmCallback, dryRun},
+      _worker{std::move(worker)},
       _workloadPath{node.key()} ,
       _coordinator{"",4400} {
     std::set<std::string> validSchemaVersions{"2018-07-01"};
@@ -68,40 +72,283 @@ WorkloadContext::WorkloadContext(const Node& node,
                       .maybe<metrics::MetricsFormat>()
                       .value_or(metrics::MetricsFormat("ftdc"));
 
-    if (format != genny::metrics::MetricsFormat("ftdc")) {
+    if (format != genny::metrics::MetricsFormat("ftdc") && !format.useHistogram() &&
+        !format.useNativeFtdc() && !format.useArrow()) {
         BOOST_LOG_TRIVIAL(info) << "Metrics format " << format.toString()
                                 << " is deprecated in favor of ftdc.";
     }
 
+    // The TSC is read by default when the CPU has an invariant one. The driver switches to it
+    // when the Actors start so workloads that never run don't pay for calibrating it.
+    _useTscClock = metrics::internals::v1::TscClock::hasInvariantTsc();
+    if (const auto clock = (*this)["Metrics"]["Clock"].maybe<std::string>(); clock) {
+        if (*clock == "steady") {
+            _useTscClock = false;
+        } else if (*clock == "tsc") {
+            if (!_useTscClock) {
+                throw InvalidConfigurationException(
+                    "Metrics Clock tsc needs a CPU with the constant_tsc and nonstop_tsc flags");
+            }
+        } else if (*clock != "auto") {
+            throw InvalidConfigurationException("Metrics Clock must be auto, steady or tsc, got '" +
+                                                *clock + "'");
+        }
+    }
+
     auto metricsPath =
         ((*this)["Metrics"]["Path"]).maybe<std::string>().value_or("build/WorkloadOutput/CedarMetrics");
 
-    _registry = genny::metrics::Registry(std::move(format), std::move(metricsPath));
+    metrics::internals::v1::HistogramOptions histogramOptions;
+    if (format.useHistogram()) {
+        const auto& histogram = (*this)["Metrics"]["Histogram"];
+        histogramOptions.significantDigits =
+            histogram["SignificantDigits"].maybe<int>().value_or(3);
+        if (histogramOptions.significantDigits < 1 || histogramOptions.significantDigits > 5) {
+            throw InvalidConfigurationException(
+                "Metrics Histogram SignificantDigits must be between 1 and 5");
+        }
+        if (const auto interval = histogram["Interval"].maybe<TimeSpec>(); interval) {
+            if (interval->count() <= 0) {
+                throw InvalidConfigurationException("Metrics Histogram Interval must be positive");
+            }
+            histogramOptions.interval = interval->value;
+        }
+        histogramOptions.logPath = _worker.filePath(metricsPath, ".intervals.csv");
+    }
+
+    std::optional<metrics::internals::v1::SpillOptions> spillOptions;
+    if (const auto& spill = (*this)["Metrics"]["Spill"]; spill) {
+        if (!format.useCsv() || format.get() == metrics::MetricsFormat::Format::kCsv) {
+            throw InvalidConfigurationException(
+                "Metrics Spill only works with the cedar-csv and csv-ftdc formats");
+        }
+        spillOptions.emplace();
+        // Each worker spills to its own directory since each removes its own when it's done.
+        spillOptions->directory = _worker.filePath(metricsPath, ".spill");
+        if (const auto directory = spill["Directory"].maybe<std::string>(); directory) {
+            spillOptions->directory =
+                boost::filesystem::path{*directory} / _worker.filePath("genny", ".spill");
+        }
+        spillOptions->compress = spill["Compress"].maybe<bool>().value_or(false);
+        if (const auto bytes = spill["BufferSize"].maybe<int64_t>(); bytes) {
+            if (*bytes <= 0) {
+                throw InvalidConfigurationException("Metrics Spill BufferSize must be positive");
+            }
+            spillOptions->bufferBytes = size_t(*bytes);
+        }
+    }
+
+    metrics::internals::v1::ArrowOptions arrowOptions;
+    if (const auto rows = (*this)["Metrics"]["Arrow"]["BatchRows"].maybe<int64_t>(); rows) {
+        if (*rows <= 0) {
+            throw InvalidConfigurationException("Metrics Arrow BatchRows must be positive");
+        }
+        arrowOptions.batchRows = size_t(*rows);
+    }
+    arrowOptions.extension = _worker.filePath("", ".arrow");
+
+    // Placement applies to threads that don't exist yet, so work out the nodes up front.
+    const auto placementPolicy = v1::CpuPlacement::parsePolicy(
+        (*this)["Placement"]["Policy"].maybe<std::string>().value_or("None"));
+    const auto metricsCpus = (*this)["Placement"]["MetricsCpuSet"].maybe<std::string>();
+    const auto numaNodes = v1::numaNodes();
+    _placement = v1::CpuPlacement{placementPolicy, numaNodes};
+
+    metrics::internals::v2::GrpcOptions grpcOptions;
+    if (const auto policy = (*this)["Metrics"]["BufferOverflow"].maybe<std::string>(); policy) {
+        try {
+            grpcOptions.overflow = metrics::internals::v2::overflowPolicyFromString(*policy);
+        } catch (const std::invalid_argument&) {
+            throw InvalidConfigurationException(
+                "Metrics BufferOverflow must be Fail, Block, Drop or Grow, got '" + *policy + "'");
+        }
+    }
+    if (const auto senders = (*this)["Metrics"]["SenderThreads"].maybe<int>(); senders) {
+        if (*senders < 0) {
+            throw InvalidConfigurationException("Metrics SenderThreads must not be negative");
+        }
+        grpcOptions.senderThreads = size_t(*senders);
+    }
+    // Workers can't share the files like they share poplar's collectors. The driver merges them.
+    grpcOptions.ftdcExtension = _worker.filePath("", ".ftdc");
+    grpcOptions.threadStartHook = this->_metricsThreadStartHook(metricsCpus, numaNodes);
+
+    _registry = genny::metrics::Registry(std::move(format),
+                                         std::move(metricsPath),
+                                         grpcOptions,
+                                         std::move(histogramOptions),
+                                         std::move(spillOptions),
+                                         std::move(arrowOptions));
+
+    if ((*this)["Metrics"]["Overhead"].maybe<bool>().value_or(false)) {
+        _registry.enableOverhead();
+    }
+
+    if (const auto& live = (*this)["Metrics"]["Live"]; live) {
+        metrics::internals::v1::LiveOptions liveOptions;
+        if (const auto interval = live["Interval"].maybe<TimeSpec>(); interval) {
+            if (interval->count() <= 0) {
+                throw InvalidConfigurationException("Metrics Live Interval must be positive");
+            }
+            liveOptions.interval = interval->value;
+        }
+        if (const auto window = live["Window"].maybe<int>(); window) {
+            if (*window <= 0) {
+                throw InvalidConfigurationException("Metrics Live Window must be positive");
+            }
+            liveOptions.window = size_t(*window);
+        }
+        if (const auto port = live["Port"].maybe<int>(); port) {
+            // Each worker serves its own operations on the next port up.
+            const auto workerPort = *port == 0 ? 0 : *port + int(_worker.index);
+            if (*port < 0 || workerPort > 65535) {
+                throw InvalidConfigurationException("Metrics Live Port must be between 0 and " +
+                                                    std::to_string(65535 - _worker.index));
+            }
+            liveOptions.port = uint16_t(workerPort);
+        }
+        liveOptions.host = live["Host"].maybe<std::string>().value_or(liveOptions.host);
+        _registry.enableLiveStats(std::move(liveOptions));
+    }
 
     _seedGenerator.seed((*this)["RandomSeed"].maybe<long>().value_or(RNG_SEED_BASE));
 
+    if (const auto mode = (*this)["Execution"]["Mode"].maybe<std::string>(); mode) {
+        if (*mode == "Fibers") {
+            _executionOptions.mode = v1::ExecutionOptions::Mode::kFibers;
+        } else if (*mode != "Threads") {
+            throw InvalidConfigurationException("Execution Mode must be Threads or Fibers, got '" +
+                                                *mode + "'");
+        }
+    }
+    _executionOptions.workers = (*this)["Execution"]["Workers"].maybe<int>().value_or(0);
+    if (const auto stackKiB = (*this)["Execution"]["StackSizeKiB"].maybe<int>(); stackKiB) {
+        _executionOptions.stackSize = size_t(*stackKiB) * 1024;
+    }
+    if (const auto sleep = (*this)["Execution"]["Sleep"].maybe<std::string>(); sleep) {
+        if (*sleep == "Precise") {
+            _executionOptions.sleep.mode = v1::SleepOptions::Mode::kPrecise;
+        } else if (*sleep != "Coarse") {
+            throw InvalidConfigurationException("Execution Sleep must be Coarse or Precise, got '" +
+                                                *sleep + "'");
+        }
+    }
+    if (const auto spin = (*this)["Execution"]["SleepSpin"].maybe<TimeSpec>(); spin) {
+        _executionOptions.sleep.spin = spin->value;
+    }
+    if (_executionOptions.sleep.mode == v1::SleepOptions::Mode::kPrecise) {
+        BOOST_LOG_TRIVIAL(info) << "Using precise sleeps that spin for the last "
+                                << _executionOptions.sleep.spin.count() << "ns";
+    }
+
+    if (_executionOptions.mode == v1::ExecutionOptions::Mode::kFibers) {
+        // Actor fibers move between workers so pin the workers instead. PerActorType
+        // doesn't mean anything for workers.
+        const auto workerPolicy = placementPolicy == v1::CpuPlacement::Policy::kPerActorType
+            ? v1::CpuPlacement::Policy::kSpread
+            : placementPolicy;
+        v1::CpuPlacement workers{workerPolicy, numaNodes};
+        const auto count = v1::FiberPool{_executionOptions}.workers();
+        for (size_t i = 0; i < count; ++i) {
+            if (auto cpus = workers.next()) {
+                _executionOptions.workerCpus.push_back(std::move(*cpus));
+            }
+        }
+    }
+
     // Make a bunch of actor contexts
     for (const auto& [k, actor] : (*this)["Actors"]) {
         _actorContexts.emplace_back(std::make_unique<genny::ActorContext>(actor, *this));
     }
 
     ActorBucket bucket;
+    ParallelBucket<std::pair<ActorId, const ActorContext*>> actorIds;
     parallelRun(_actorContexts,
                    [&](const auto& actorContext) {
                        auto rawActors = _constructActors(cast, actorContext);
                        for (auto&& actor : rawActors) {
+                           if (!_worker.runs(actor->id())) {
+                               // Another worker runs this thread. It was only constructed so
+                               // the threads after it are set up as in a single process.
+                               continue;
+                           }
+                           actorIds.addItem({actor->id(), actorContext.get()});
                            bucket.addItem(std::move(actor));
                        }
                    });
 
     _actors = std::move(bucket.extractItems());
-    this->_orchestrator->addPrePhaseStartHook(
-        [&](const Orchestrator*orchestrator, PhaseNumber phase) { this->_coordinator.onPhaseStart(phase); });
-    this->_orchestrator->addPostPhaseStopHook(
-        [&](const Orchestrator*orchestrator, PhaseNumber phase) { this->_coordinator.onPhaseStop(phase); });
+    if (_worker.isFanOut() && _actors.empty()) {
+        throw InvalidConfigurationException(
+            "Running with " + std::to_string(_worker.count) +
+            " workers needs at least that many Actor threads so each worker has one to run");
+    }
+    this->_splitRateLimiters();
+    this->_placeActors(actorIds.extractItems(), numaNodes);
+    // Workers move through phases together so only the first needs to tell the coordinator.
+    if (_worker.index == 0) {
+        this->_orchestrator->addPrePhaseStartHook(
+            [&](const Orchestrator* orchestrator, PhaseNumber phase) {
+                this->_coordinator.onPhaseStart(phase);
+            });
+        this->_orchestrator->addPostPhaseStopHook(
+            [&](const Orchestrator* orchestrator, PhaseNumber phase) {
+                this->_coordinator.onPhaseStop(phase);
+            });
+    }
     _done = true;
 }
 
+std::function<void(size_t)> WorkloadContext::_metricsThreadStartHook(
+    const std::optional<std::string>& metricsCpus, const std::vector<v1::CpuSet>& numaNodes) const {
+    if (metricsCpus) {
+        return [cpus = v1::parseCpuList(*metricsCpus)](size_t) { v1::pinThisThread(cpus); };
+    }
+    if (_placement.policy() != v1::CpuPlacement::Policy::kNone) {
+        // Spread senders over the nodes like the Actors whose metrics they send.
+        return [numaNodes](size_t index) {
+            v1::pinThisThread(numaNodes[index % numaNodes.size()]);
+        };
+    }
+    return nullptr;
+}
+
+void WorkloadContext::_placeActors(std::vector<std::pair<ActorId, const ActorContext*>> actors,
+                                   const std::vector<v1::CpuSet>& numaNodes) {
+    // Actors are constructed in parallel. Place them in ActorId order so placement is the
+    // same from run to run.
+    std::sort(actors.begin(), actors.end());
+    for (const auto& [id, actorContext] : actors) {
+        std::optional<v1::CpuSet> cpus;
+        if (auto list = (*actorContext)["CpuSet"].maybe<std::string>()) {
+            cpus = v1::parseCpuList(*list);
+        } else if (auto node = (*actorContext)["NumaNode"].maybe<int>()) {
+            if (*node < 0 || size_t(*node) >= numaNodes.size()) {
+                throw InvalidConfigurationException(
+                    "NumaNode " + std::to_string(*node) + " for " + actorContext->actorInfo(id) +
+                    " is out of range. This host has " + std::to_string(numaNodes.size()) +
+                    " usable NUMA nodes.");
+            }
+            cpus = numaNodes[*node];
+        } else {
+            cpus = _placement.next(actorContext->getType());
+        }
+        if (cpus) {
+            _actorCpus.emplace(id, std::move(*cpus));
+        }
+    }
+}
+
+void WorkloadContext::placeActorThread(ActorId id) const {
+    if (v1::onFiberPool()) {
+        // Fibers move between workers; the workers themselves are pinned.
+        return;
+    }
+    if (auto it = _actorCpus.find(id); it != _actorCpus.end()) {
+        v1::pinThisThread(it->second);
+    }
+}
+
 ActorVector WorkloadContext::_constructActors(const Cast& cast,
                                               const std::unique_ptr<ActorContext>& actorContext) {
     auto actors = ActorVector{};
@@ -128,7 +375,9 @@ mongocxx::pool::entry WorkloadContext::getClient(const std::string& name, size_t
     return _poolManager.createClient(name, instance, this->_node);
 }
 
-GlobalRateLimiter* WorkloadContext::getRateLimiter(const std::string& name, const RateSpec& spec) {
+GlobalRateLimiter* WorkloadContext::getRateLimiter(const std::string& name,
+                                                   const RateSpec& spec,
+                                                   const ActorContext& user) {
     if (this->isDone()) {
         BOOST_THROW_EXCEPTION(
             std::logic_error("Cannot create rate-limiters after setup. Name tried: " + name));
@@ -136,10 +385,42 @@ GlobalRateLimiter* WorkloadContext::getRateLimiter(const std::string& name, cons
 
     std::lock_guard<std::mutex> lk(_limiterLock);
     if (_rateLimiters.count(name) == 0) {
-        _rateLimiters.emplace(std::make_pair(name, std::make_unique<GlobalRateLimiter>(spec)));
+        if (_worker.isFanOut() && (spec.getProfileSpec() || spec.getLatencyTargetSpec())) {
+            throw InvalidConfigurationException(
+                "GlobalRate " + name +
+                " can't be split across workers. Only fixed and percentile rates can.");
+        }
+        auto limiter = std::make_unique<GlobalRateLimiter>(spec);
+        if (spec.getProfileSpec() || spec.getLatencyTargetSpec()) {
+            // Publish the changing target as the "ops" of an internal GlobalRate.<name> operation.
+            // It's on id 0 like the driver's own operations so the Actors' ids don't shift.
+            auto gauge = _registry.operation("GlobalRate", name, 0u, std::nullopt, true);
+            limiter->setTargetRateGauge([gauge](double perSecond) mutable {
+                gauge.report(metrics::clock::now(),
+                             std::chrono::microseconds{0},
+                             metrics::OutcomeType::kSuccess,
+                             metrics::count_type(perSecond));
+            });
+        }
+        if (spec.getLatencyTargetSpec()) {
+            auto rl = limiter.get();
+            this->_orchestrator->addPostPhaseStopHook(
+                [rl, name](const Orchestrator*, PhaseNumber phase) {
+                    // Zero if the limiter wasn't used (or never met its target) this phase.
+                    if (const auto converged = rl->convergedRate(); converged > 0) {
+                        BOOST_LOG_TRIVIAL(info)
+                            << "GlobalRate " << name << " converged to " << converged
+                            << " operations per second in phase " << phase;
+                    }
+                });
+        }
+        _rateLimiters.emplace(std::make_pair(name, std::move(limiter)));
     }
     auto rl = _rateLimiters[name].get();
     rl->addUser();
+    auto& share = _rateLimiterShares[name];
+    ++share.users;
+    share.here += user.workerShare();
 
     // Reset the rate-limiter at the start of every Phase
     this->_orchestrator->addPrePhaseStartHook(
@@ -147,6 +428,18 @@ GlobalRateLimiter* WorkloadContext::getRateLimiter(const std::string& name, cons
     return rl;
 }
 
+void WorkloadContext::_splitRateLimiters() {
+    if (!_worker.isFanOut()) {
+        return;
+    }
+    for (const auto& [name, share] : _rateLimiterShares) {
+        // A rate-limiter that none of this worker's threads use is never consumed here.
+        if (share.here > 0) {
+            _rateLimiters[name]->splitRate(share.here / double(share.users));
+        }
+    }
+}
+
 std::map<PhaseNumber, std::vector<std::reference_wrapper<const PhaseContext>>>
 WorkloadContext::getActivePhaseContexts() const {
     auto phasesMap =
@@ -215,6 +508,64 @@ std::unordered_map<PhaseNumber, std::unique_ptr<PhaseContext>> ActorContext::con
     return out;
 }
 
+double ActorContext::workerShare() const {
+    if (_threads == 0) {
+        return 0;
+    }
+    size_t here = 0;
+    for (ActorId id = _firstActorId; id < _firstActorId + _threads; ++id) {
+        here += this->_workload->worker().runs(id) ? 1 : 0;
+    }
+    return double(here) / double(_threads);
+}
+
+void ActorContext::enableServiceTimeIfOpenLoop() {
+    for (const auto& [phaseNumber, phaseContext] : _phaseContexts) {
+        if ((*phaseContext)["ArrivalRate"]) {
+            this->_workload->_registry.enableServiceTime(_actorName);
+            return;
+        }
+    }
+}
+
+void ActorContext::configureMetricsReduction() {
+    const auto& sampling = (*this)["MetricsSampling"];
+    const auto& aggregation = (*this)["MetricsAggregation"];
+    if (!sampling && !aggregation) {
+        return;
+    }
+    if (sampling && aggregation) {
+        throw InvalidConfigurationException(
+            "Actor " + _actorName + " can't have both MetricsSampling and MetricsAggregation");
+    }
+
+    metrics::internals::v1::ReductionOptions options;
+    if (sampling) {
+        options.sampleEvery = sampling["Every"].to<int64_t>();
+        if (options.sampleEvery <= 0) {
+            throw InvalidConfigurationException("MetricsSampling Every must be positive");
+        }
+    } else {
+        options.bucket = aggregation["Bucket"].to<TimeSpec>().value;
+        if (options.bucket <= Duration::zero()) {
+            throw InvalidConfigurationException("MetricsAggregation Bucket must be positive");
+        }
+        options.bucketLogPath = this->_workload->worker().filePath(
+            this->_workload->_registry.getPathPrefix().string(), ".buckets.csv");
+    }
+
+    auto& registry = this->_workload->_registry;
+    const auto& reduced = sampling ? sampling : aggregation;
+    const auto operations = reduced["Operations"].maybe<std::vector<std::string>>();
+    if (!operations) {
+        registry.reduceEvents(_actorName, "", std::move(options));
+        return;
+    }
+    for (const auto& operation : *operations) {
+        registry.reduceEvents(_actorName, operation, options);
+    }
+}
+
 // The SleepContext class is basically an actor-friendly adapter
 // for the Sleeper.
 void SleepContext::sleep_for(Duration duration) const {
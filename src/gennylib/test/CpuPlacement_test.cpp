@@ -0,0 +1,91 @@
+// Copyright 2022-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gennylib/InvalidConfigurationException.hpp>
+#include <gennylib/v1/CpuPlacement.hpp>
+
+#include <testlib/helpers.hpp>
+
+namespace genny {
+namespace {
+
+using namespace genny::v1;
+using Policy = CpuPlacement::Policy;
+
+TEST_CASE("CPU lists") {
+    SECTION("Parses ranges and single CPUs") {
+        REQUIRE(parseCpuList("0-3,8,10-11") == CpuSet{0, 1, 2, 3, 8, 10, 11});
+        REQUIRE(parseCpuList("5") == CpuSet{5});
+    }
+
+    SECTION("Sorts and removes duplicates") {
+        REQUIRE(parseCpuList("4, 0-2, 1") == CpuSet{0, 1, 2, 4});
+    }
+
+    SECTION("Barfs on invalid lists") {
+        REQUIRE_THROWS_AS(parseCpuList(""), InvalidConfigurationException);
+        REQUIRE_THROWS_AS(parseCpuList("3-1"), InvalidConfigurationException);
+        REQUIRE_THROWS_AS(parseCpuList("zero"), InvalidConfigurationException);
+    }
+
+    SECTION("NUMA nodes cover only allowed CPUs") {
+        const auto nodes = numaNodes();
+        REQUIRE(!nodes.empty());
+        for (const auto& cpus : nodes) {
+            REQUIRE(!cpus.empty());
+        }
+    }
+}
+
+TEST_CASE("CPU placement policies") {
+    const std::vector<CpuSet> nodes{{0, 1}, {2, 3, 4}};
+
+    SECTION("None doesn't pin") {
+        CpuPlacement placement{Policy::kNone, nodes};
+        REQUIRE(!placement.next());
+    }
+
+    SECTION("Compact fills each node before the next") {
+        CpuPlacement placement{Policy::kCompact, nodes};
+        std::vector<CpuSet> got;
+        for (int i = 0; i < 6; ++i) {
+            got.push_back(*placement.next());
+        }
+        REQUIRE(got == std::vector<CpuSet>{nodes[0], nodes[0], nodes[1], nodes[1], nodes[1],
+                                           nodes[0]});
+    }
+
+    SECTION("Spread alternates nodes") {
+        CpuPlacement placement{Policy::kSpread, nodes};
+        REQUIRE(*placement.next() == nodes[0]);
+        REQUIRE(*placement.next() == nodes[1]);
+        REQUIRE(*placement.next() == nodes[0]);
+    }
+
+    SECTION("PerActorType keeps a type together") {
+        CpuPlacement placement{Policy::kPerActorType, nodes};
+        REQUIRE(*placement.next("Insert") == nodes[0]);
+        REQUIRE(*placement.next("Find") == nodes[1]);
+        REQUIRE(*placement.next("Insert") == nodes[0]);
+        REQUIRE(*placement.next("Update") == nodes[0]);
+    }
+
+    SECTION("Parses policy names") {
+        REQUIRE(CpuPlacement::parsePolicy("Spread") == Policy::kSpread);
+        REQUIRE_THROWS_AS(CpuPlacement::parsePolicy("Everywhere"), InvalidConfigurationException);
+    }
+}
+
+}  // namespace
+}  // namespace genny
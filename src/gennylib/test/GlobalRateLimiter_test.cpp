@@ -17,6 +17,7 @@
 #include <chrono>
 #include <ratio>
 #include <thread>
+#include <vector>
 
 #include <gennylib/GlobalRateLimiter.hpp>
 #include <gennylib/PhaseLoop.hpp>
@@ -78,6 +79,200 @@ TEST_CASE("Global rate limiter") {
         }
         REQUIRE(!grl.consumeIfWithinRate(now));
     }
+
+    SECTION("Splits Rate") {
+        // Half of the rate is 2 operations per 6 ticks.
+        grl.splitRate(0.5);
+        grl.resetLastEmptied();
+        for (int i = 0; i < burst; i++) {
+            REQUIRE(grl.consumeIfWithinRate(MyDummyClock::now()));
+        }
+
+        MyDummyClock::nowRaw += per;
+        REQUIRE(!grl.consumeIfWithinRate(MyDummyClock::now()));
+
+        MyDummyClock::nowRaw += per;
+        REQUIRE(grl.consumeIfWithinRate(MyDummyClock::now()));
+    }
+}
+
+TEST_CASE("Global rate limiter leases") {
+    struct DummyTemplateValue {};
+    using MyDummyClock = DummyClock<DummyTemplateValue>;
+    using Lease = BaseGlobalRateLimiter<MyDummyClock>::Lease;
+
+    const int64_t per = 10;
+    const BaseRateSpec rs{per, 1};  // 1 operation per 10 ticks.
+    BaseGlobalRateLimiter<MyDummyClock> grl{rs};
+    const int64_t users = 4;
+    for (int i = 0; i < users; i++) {
+        grl.addUser();
+    }
+    grl.resetLastEmptied();
+
+    Lease first;
+    Lease second;
+
+    SECTION("Leases one token at a time when keeping up") {
+        REQUIRE(grl.consumeIfWithinRate(MyDummyClock::now(), first));
+        REQUIRE(first.tokens == 0);
+        REQUIRE(!grl.consumeIfWithinRate(MyDummyClock::now(), second));
+
+        MyDummyClock::nowRaw += per;
+        REQUIRE(grl.consumeIfWithinRate(MyDummyClock::now(), second));
+        REQUIRE(second.tokens == 0);
+        REQUIRE(!grl.consumeIfWithinRate(MyDummyClock::now(), first));
+    }
+
+    SECTION("Leases a fair share of a backlog without exceeding it") {
+        REQUIRE(grl.consumeIfWithinRate(MyDummyClock::now(), first));
+
+        // 100 more tokens are due.
+        MyDummyClock::nowRaw += 100 * per;
+        REQUIRE(grl.consumeIfWithinRate(MyDummyClock::now(), first));
+        REQUIRE(first.tokens == 100 / users - 1);
+        REQUIRE(grl.consumeIfWithinRate(MyDummyClock::now(), second));
+        REQUIRE(second.tokens == 75 / users - 1);
+
+        // Three consumed plus the leftovers in the leases plus whatever remains in the
+        // bucket is exactly the 101 tokens that are due.
+        int64_t granted = 3 + first.tokens + second.tokens;
+        first.tokens = second.tokens = 0;
+        while (grl.consumeIfWithinRate(MyDummyClock::now())) {
+            ++granted;
+        }
+        REQUIRE(granted == 101);
+        REQUIRE(!grl.consumeIfWithinRate(MyDummyClock::now(), first));
+    }
+
+    SECTION("Leases are dropped when the phase changes") {
+        MyDummyClock::nowRaw += 100 * per;
+        REQUIRE(grl.consumeIfWithinRate(MyDummyClock::now(), first));
+        REQUIRE(first.tokens > 0);
+
+        grl.resetLastEmptied();
+        REQUIRE(grl.consumeIfWithinRate(MyDummyClock::now(), first));
+        REQUIRE(first.tokens == 0);
+        REQUIRE(!grl.consumeIfWithinRate(MyDummyClock::now(), first));
+    }
+}
+
+TEST_CASE("Profiled rate limiting") {
+    struct DummyTemplateValue {};
+    using MyDummyClock = DummyClock<DummyTemplateValue>;
+
+    // 1 per millisecond ramping up to 3 per millisecond over 10 milliseconds.
+    RateProfileSpec ramp;
+    ramp.shape = RateProfileSpec::Shape::kRamp;
+    ramp.from = BaseRateSpec{1000 * 1000, 1};
+    ramp.to = BaseRateSpec{1000 * 1000, 3};
+    ramp.over = std::chrono::milliseconds{10};
+
+    BaseGlobalRateLimiter<MyDummyClock> grl{RateSpec{ramp}};
+    grl.addUser();
+
+    std::vector<double> targets;
+    grl.setTargetRateGauge([&](double perSecond) { targets.push_back(perSecond); });
+
+    grl.resetLastEmptied();
+    const auto start = MyDummyClock::nowRaw;
+    auto drain = [&]() {
+        int64_t granted = 0;
+        while (grl.consumeIfWithinRate(MyDummyClock::now())) {
+            ++granted;
+        }
+        return granted;
+    };
+
+    SECTION("Follows the profile") {
+        // One token is available immediately.
+        REQUIRE(drain() == 1);
+
+        // Integral of the ramp over 10ms is 20 operations.
+        MyDummyClock::nowRaw = start + 10 * 1000 * 1000;
+        REQUIRE(drain() == 20);
+
+        // Then it holds at 3 per millisecond.
+        MyDummyClock::nowRaw = start + 12 * 1000 * 1000;
+        REQUIRE(drain() == 6);
+        REQUIRE(grl.getRate() == 1000 * 1000 / 3);
+    }
+
+    SECTION("Reports its target rate") {
+        drain();
+        REQUIRE(targets.size() == 1);
+        REQUIRE(targets.back() == Catch::Approx(1000));
+
+        // Not reported again until a second has passed.
+        MyDummyClock::nowRaw = start + 5 * 1000 * 1000;
+        drain();
+        REQUIRE(targets.size() == 1);
+
+        MyDummyClock::nowRaw = start + BaseGlobalRateLimiter<MyDummyClock>::kTargetRateIntervalNS;
+        drain();
+        REQUIRE(targets.size() == 2);
+        REQUIRE(targets.back() == Catch::Approx(3000));
+    }
+}
+
+TEST_CASE("Latency-targeted rate limiting") {
+    struct DummyTemplateValue {};
+    using MyDummyClock = DummyClock<DummyTemplateValue>;
+    using namespace std::chrono_literals;
+
+    // Start at 1 per millisecond and adjust every 100 milliseconds.
+    LatencyTargetRateSpec spec;
+    spec.target = 20ms;
+    spec.start = BaseRateSpec{1000 * 1000, 1};
+    spec.interval = 100ms;
+
+    BaseGlobalRateLimiter<MyDummyClock> grl{RateSpec{spec}};
+    grl.addUser();
+    REQUIRE(grl.latencyObserver() != nullptr);
+
+    grl.resetLastEmptied();
+    const auto start = MyDummyClock::nowRaw;
+
+    // Run the limiter flat out for a window, reporting `latency` for every operation.
+    auto runWindow = [&](int window, std::chrono::nanoseconds latency) {
+        for (int ms = 0; ms < 100; ++ms) {
+            MyDummyClock::nowRaw = start + (window * 100 + ms) * 1000 * 1000;
+            while (grl.consumeIfWithinRate(MyDummyClock::now())) {
+                grl.latencyObserver()->observe(latency);
+            }
+        }
+    };
+
+    SECTION("Speeds up while under the target") {
+        runWindow(0, 1ms);
+        runWindow(1, 1ms);
+        REQUIRE(grl.getRate() < 1000 * 1000);
+        REQUIRE(grl.convergedRate() == Catch::Approx(1000));
+    }
+
+    SECTION("Slows down while over the target") {
+        runWindow(0, 50ms);
+        runWindow(1, 50ms);
+        REQUIRE(grl.getRate() > 1000 * 1000);
+        REQUIRE(grl.convergedRate() == 0);
+    }
+
+    SECTION("Settles near the highest rate that meets the target") {
+        // Latency goes over the target above 5 per millisecond.
+        for (int window = 0; window < 200; ++window) {
+            const auto latency = grl.getRate() < 1000 * 1000 / 5 ? 50ms : 1ms;
+            runWindow(window, latency);
+        }
+        REQUIRE(grl.convergedRate() == Catch::Approx(5000).epsilon(0.05));
+    }
+
+    SECTION("Starts each phase over") {
+        runWindow(0, 1ms);
+        runWindow(1, 1ms);
+        grl.resetLastEmptied();
+        REQUIRE(grl.getRate() == 1000 * 1000);
+        REQUIRE(grl.convergedRate() == 0);
+    }
 }
 
 TEST_CASE("Percentile rate limiting") {
@@ -136,7 +331,7 @@ public:
 
     IncActor(genny::ActorContext& ac)
         : Actor(ac),
-          _loop{ac},
+          _loop{*this, ac},
           _counter{WorkloadContext::getActorSharedState<IncActor, IncCounter>()} {
         _counter.store(0);
     };
@@ -0,0 +1,117 @@
+// Copyright 2022-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <boost/filesystem.hpp>
+
+#include <gennylib/v1/PhaseBarrier.hpp>
+
+#include <testlib/helpers.hpp>
+
+namespace genny {
+namespace {
+
+using namespace genny::v1;
+
+std::string socketPath() {
+    return (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()).string();
+}
+
+TEST_CASE("Phase barriers") {
+    const auto path = socketPath();
+
+    SECTION("Workers at the same barriers go on together") {
+        PhaseBarrierServer server{path, 3};
+        std::thread serving{[&]() { server.serve(); }};
+
+        std::atomic_int gone = 0;
+        std::vector<std::thread> workers;
+        for (int i = 0; i < 3; ++i) {
+            workers.emplace_back([&]() {
+                PhaseBarrierClient client{path};
+                for (int phase = 0; phase < 10; ++phase) {
+                    gone += client.await("start " + std::to_string(phase));
+                    gone += client.await("stop " + std::to_string(phase));
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        serving.join();
+        REQUIRE(gone == 60);
+    }
+
+    SECTION("Workers at different barriers abort") {
+        PhaseBarrierServer server{path, 2};
+        std::thread serving{[&]() { server.serve(); }};
+
+        bool first = true;
+        bool second = true;
+        std::thread a{[&]() { first = PhaseBarrierClient{path}.await("start 1"); }};
+        std::thread b{[&]() { second = PhaseBarrierClient{path}.await("done"); }};
+        a.join();
+        b.join();
+        serving.join();
+        REQUIRE(!first);
+        REQUIRE(!second);
+    }
+
+    SECTION("Abort tells waiting workers to abort") {
+        PhaseBarrierServer server{path, 2};
+        std::thread serving{[&]() { server.serve(); }};
+
+        // The second worker never shows up.
+        bool went = true;
+        std::thread a{[&]() { went = PhaseBarrierClient{path}.await("start 0"); }};
+        server.abort();
+        a.join();
+        server.stop();
+        serving.join();
+        REQUIRE(!went);
+    }
+
+    SECTION("A worker going away without saying bye aborts the others") {
+        PhaseBarrierServer server{path, 2};
+        std::thread serving{[&]() { server.serve(); }};
+
+        bool went = true;
+        std::thread a{[&]() { went = PhaseBarrierClient{path}.await("start 0"); }};
+        {
+            // Connect and hang up without saying bye like a crashed worker would.
+            sockaddr_un addr{};
+            addr.sun_family = AF_UNIX;
+            std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+            const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+            REQUIRE(::connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) == 0);
+            ::close(fd);
+        }
+        a.join();
+        server.stop();
+        serving.join();
+        REQUIRE(!went);
+    }
+}
+
+}  // namespace
+}  // namespace genny
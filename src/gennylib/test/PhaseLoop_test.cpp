@@ -15,6 +15,7 @@
 #include <chrono>
 #include <iostream>
 #include <optional>
+#include <vector>
 
 #include "NopActor.hpp"
 #include <gennylib/Orchestrator.hpp>
@@ -241,6 +242,26 @@ TEST_CASE("Can do without either iterations or duration") {
     REQUIRE(o.currentPhase() == 0);
 }
 
+TEST_CASE("Open-loop arrivals are reproducible") {
+    // 100 per millisecond with Poisson gaps.
+    auto arrivals = [](uint64_t actorSeed, PhaseNumber phase) {
+        v1::ArrivalSchedule schedule{
+            BaseRateSpec{1000000, 100}, 1, v1::ArrivalSchedule::Distribution::kPoisson};
+        schedule.seed(actorSeed, phase);
+        schedule.start(SteadyClock::time_point{});
+        std::vector<SteadyClock::time_point> out;
+        for (int i = 0; i < 10; ++i) {
+            out.push_back(schedule.next());
+            schedule.advance();
+        }
+        return out;
+    };
+
+    REQUIRE(arrivals(42, 1) == arrivals(42, 1));
+    REQUIRE(arrivals(42, 1) != arrivals(42, 2));
+    REQUIRE(arrivals(42, 1) != arrivals(43, 1));
+}
+
 TEST_CASE("Iterator concept correctness") {
     genny::metrics::Registry metrics;
     genny::Orchestrator o{};
@@ -327,7 +348,7 @@ protected:
 
 public:
     IncrementsMapValues(ActorContext& actorContext, std::unordered_map<int, int>& counters)
-        : Actor(actorContext), _loop{actorContext, 1}, _counters{counters} {}
+        : Actor(actorContext), _loop{*this, actorContext, 1}, _counters{counters} {}
     //                        ↑ is forwarded to the IncrementsMapValues ctor as the
     //                        keyOffset param.
 
@@ -341,6 +362,24 @@ public:
 };
 
 
+// Builds its PhaseLoop without the Actor, as Actors written before open-loop phases did.
+class WithoutActorLoop : public Actor {
+    struct PhaseConfig {
+        explicit PhaseConfig(PhaseContext&) {}
+    };
+    PhaseLoop<PhaseConfig> _loop;
+
+public:
+    explicit WithoutActorLoop(ActorContext& actorContext)
+        : Actor(actorContext), _loop{actorContext} {}
+
+    static std::string_view defaultName() {
+        return "WithoutActorLoop";
+    }
+
+    void run() override {}
+};
+
 TEST_CASE("Actual Actor Example") {
     SECTION("Simple Actor") {
         // ////////
@@ -489,6 +528,53 @@ TEST_CASE("Actual Actor Example") {
                             Catch::Matchers::ContainsSubstring("GlobalRate must *not* be specified alongside"));
     }
 
+    SECTION("ArrivalRate and SleepBefore") {
+        NodeSource config(R"(
+            SchemaVersion: 2018-07-01
+            Actors:
+            - Type: Inc
+              Name: Inc
+              Phases:
+              - Repeat: 3
+                SleepBefore: 10 milliseconds
+                ArrivalRate: 1 per 10 milliseconds
+                Key: 71
+        )",
+                          "");
+
+        auto imvProducer = std::make_shared<CounterProducer<IncrementsMapValues>>("Inc");
+
+        REQUIRE_THROWS_WITH(([&]() {
+                                ActorHelper ah(config.root(), 1, {{"Inc", imvProducer}});
+                                ah.run();
+                            }()),
+                            Catch::Matchers::ContainsSubstring("ArrivalRate must *not* be specified alongside"));
+    }
+
+    SECTION("ArrivalRate without the Actor") {
+        NodeSource config(R"(
+            SchemaVersion: 2018-07-01
+            Actors:
+            - Type: WithoutActorLoop
+              Name: WithoutActorLoop
+              Threads: 2
+              Phases:
+              - Repeat: 3
+                ArrivalRate: 1 per 10 milliseconds
+        )",
+                          "");
+
+        auto producer = std::make_shared<DefaultActorProducer<WithoutActorLoop>>();
+
+        REQUIRE_THROWS_WITH(([&]() {
+                                ActorHelper ah(
+                                    config.root(), 2, {{"WithoutActorLoop", producer}});
+                                ah.run();
+                            }()),
+                            Catch::Matchers::ContainsSubstring(
+                                "must be constructed with the Actor"));
+    }
+
     SECTION("Missing explicit Blocking = None") {
         using namespace std::literals::chrono_literals;
         NodeSource config(R"(
@@ -569,4 +655,33 @@ TEST_CASE("Actual Actor Example, IgnoredOnMacOs") {
         REQUIRE(duration < 350ms);
     }
 
+    SECTION("ArrivalRate") {
+        using namespace std::literals::chrono_literals;
+        NodeSource config(R"(
+            SchemaVersion: 2018-07-01
+            Actors:
+            - Type: Inc
+              Name: Inc
+              Threads: 1
+              Phases:
+              - Repeat: 20
+                ArrivalRate: 1 per 10 milliseconds
+                ArrivalDistribution: Fixed
+                Key: 71
+        )",
+                          "");
+
+        auto imvProducer = std::make_shared<CounterProducer<IncrementsMapValues>>("Inc");
+        ActorHelper ah(config.root(), 1, {{"Inc", imvProducer}});
+
+        auto start = std::chrono::high_resolution_clock::now();
+        ah.run();
+
+        auto duration = std::chrono::high_resolution_clock::now() - start;
+
+        // 20 arrivals 10ms apart starting at a random offset within the first gap.
+        REQUIRE(duration > 190ms);
+        REQUIRE(duration < 300ms);
+    }
+
 }
@@ -17,8 +17,10 @@
 #include <iomanip>
 #include <iostream>
 #include <optional>
+#include <sstream>
 #include <string_view>
 #include <thread>
+#include <vector>
 
 #include <yaml-cpp/yaml.h>
 
@@ -28,12 +30,16 @@
 #include <gennylib/PhaseLoop.hpp>
 #include <gennylib/context.hpp>
 
+#include <metrics/MetricsReporter.hpp>
+
 #include <testlib/ActorHelper.hpp>
 #include <testlib/helpers.hpp>
 #include <testlib/yamlToBson.hpp>
 
 #include <value_generators/DocumentGenerator.hpp>
 
+#include "NopActor.hpp"
+
 using namespace genny;
 using namespace std;
 
@@ -514,7 +520,7 @@ TEST_CASE("Actors Share WorkloadContext State") {
 
         DummyInsert(ActorContext& actorContext)
             : Actor(actorContext),
-              _loop{actorContext},
+              _loop{*this, actorContext},
               _iCounter{WorkloadContext::getActorSharedState<DummyInsert, InsertCounter>()} {}
 
         void run() override {
@@ -539,7 +545,7 @@ TEST_CASE("Actors Share WorkloadContext State") {
     public:
         DummyFind(ActorContext& actorContext)
             : Actor(actorContext),
-              _loop{actorContext},
+              _loop{*this, actorContext},
               _iCounter{
                   WorkloadContext::getActorSharedState<DummyInsert, DummyInsert::InsertCounter>()} {
         }
@@ -689,6 +695,77 @@ Actors: [{}]
     });
 }
 
+TEST_CASE("Rate profiles don't take ActorIds") {
+    genny::Orchestrator orchestrator{};
+    NodeSource ns{R"(
+SchemaVersion: 2018-07-01
+Clients: {Default: {URI: 'mongodb://localhost:27017'}}
+Actors:
+- Type: Nop
+  Name: Nop
+  Threads: 2
+  Phases:
+  - Repeat: 1
+    GlobalRate: {Ramp: {From: 10 per 1 second, To: 100 per 1 second, Over: 1 second}}
+Metrics:
+  Format: csv
+  Path: build/genny-metrics
+)",
+                  ""};
+    auto cast = Cast{{"Nop", genny::actor::NopActor::producer()}};
+
+    WorkloadContext context{ns.root(), orchestrator, cast};
+    // The Nop threads are 1 and 2 and the rate's gauge is reported on id 0.
+    REQUIRE(context.claimActorIds(1) == 3);
+}
+
+TEST_CASE("Workers only record the Actor threads they run") {
+    genny::Orchestrator orchestrator{};
+    NodeSource ns{R"(
+SchemaVersion: 2018-07-01
+Clients: {Default: {URI: 'mongodb://localhost:27017'}}
+Actors:
+- Type: Nop
+  Name: Nop
+  Threads: 2
+  Phases:
+  - Repeat: 1
+- Type: Op
+  Name: Recorder
+  Threads: 4
+Metrics:
+  Format: csv
+  Path: build/genny-metrics
+)",
+                  ""};
+
+    std::vector<genny::metrics::Operation> ops;
+    auto cast = Cast{
+        {"Nop", genny::actor::NopActor::producer()},
+        {"Op", std::make_shared<OpProducer>([&](ActorContext& a) {
+             for (int i = 0; i < 4; ++i) {
+                 ops.push_back(a.operation("Op", a.nextActorId()));
+             }
+         })},
+    };
+
+    // Nop's threads are ActorIds 1 and 2 and Recorder's 3 to 6. Worker 0 of 2 runs 1, 3 and 5.
+    WorkloadContext context{ns.root(), orchestrator, cast, {}, false, v1::WorkerIdentity{0, 2}};
+    REQUIRE(std::distance(context.actors().begin(), context.actors().end()) == 1);
+    for (auto& op : ops) {
+        op.report(
+            metrics::clock::now(), std::chrono::microseconds{1}, metrics::OutcomeType::kSuccess);
+    }
+
+    std::ostringstream out;
+    metrics::Reporter{context.getMetrics()}.report(out, metrics::MetricsFormat("csv"));
+    const auto csv = out.str();
+    REQUIRE_THAT(csv, Catch::Matchers::ContainsSubstring("Recorder.id-3.Op_timer"));
+    REQUIRE_THAT(csv, Catch::Matchers::ContainsSubstring("Recorder.id-5.Op_timer"));
+    REQUIRE_THAT(csv, !Catch::Matchers::ContainsSubstring("Recorder.id-4.Op_timer"));
+    REQUIRE_THAT(csv, !Catch::Matchers::ContainsSubstring("Recorder.id-6.Op_timer"));
+}
+
 TEST_CASE("If no producer exists for an actor, then we should throw an error") {
     genny::Orchestrator orchestrator{};
 
@@ -225,6 +225,125 @@ TEST_CASE("genny::RateSpec conversions") {
 }
 
 
+TEST_CASE("genny::RateProfileSpec conversions") {
+    using namespace std::chrono_literals;
+    using Catch::Approx;
+    using Shape = RateProfileSpec::Shape;
+
+    SECTION("Can convert a Ramp") {
+        auto spec = YAML::Load(R"(
+GlobalRate:
+  Ramp: {From: 1000 per 1 second, To: 3000 per 1 second, Over: 10 seconds}
+)")["GlobalRate"]
+                        .as<RateSpec>()
+                        .getProfileSpec();
+        REQUIRE(spec);
+        REQUIRE(spec->shape == Shape::kRamp);
+        REQUIRE(spec->operationsPerNanosecond(0s) * 1e9 == Approx(1000));
+        REQUIRE(spec->operationsPerNanosecond(5s) * 1e9 == Approx(2000));
+        REQUIRE(spec->operationsPerNanosecond(20s) * 1e9 == Approx(3000));
+        REQUIRE(spec->operationsBy(10s) == Approx(20000));
+        REQUIRE(spec->operationsBy(12s) == Approx(26000));
+    }
+
+    SECTION("Can convert Steps") {
+        auto spec = YAML::Load(R"(
+GlobalRate:
+  Steps:
+  - {Rate: 100 per 1 second, For: 1 second}
+  - {Rate: 200 per 1 second, For: 1 second}
+)")["GlobalRate"]
+                        .as<RateSpec>()
+                        .getProfileSpec();
+        REQUIRE(spec);
+        REQUIRE(spec->shape == Shape::kSteps);
+        REQUIRE(spec->steps.size() == 2);
+        REQUIRE(spec->operationsPerNanosecond(1500ms) * 1e9 == Approx(200));
+        // The last step holds.
+        REQUIRE(spec->operationsBy(3s) == Approx(500));
+    }
+
+    SECTION("Can convert a Sine") {
+        auto spec = YAML::Load(R"(
+GlobalRate:
+  Sine: {Mean: 1000 per 1 second, Amplitude: 500 per 1 second, Period: 4 seconds}
+)")["GlobalRate"]
+                        .as<RateSpec>()
+                        .getProfileSpec();
+        REQUIRE(spec);
+        REQUIRE(spec->shape == Shape::kSine);
+        REQUIRE(spec->operationsPerNanosecond(1s) * 1e9 == Approx(1500));
+        REQUIRE(spec->operationsPerNanosecond(3s) * 1e9 == Approx(500));
+        // Whole periods average out to the mean.
+        REQUIRE(spec->operationsBy(8s) == Approx(8000));
+    }
+
+    SECTION("Barfs on invalid values") {
+        REQUIRE_THROWS(YAML::Load("{Ramp: {From: 1 per 1 second}}").as<RateSpec>());
+        REQUIRE_THROWS(YAML::Load(
+                           "{Ramp: {From: 1 per 1 second, To: 2 per 1 second, Over: 0 seconds}}")
+                           .as<RateSpec>());
+        REQUIRE_THROWS(YAML::Load("{Steps: []}").as<RateSpec>());
+        REQUIRE_THROWS(YAML::Load("{Sine: {Mean: 1 per 1 second, Amplitude: 2 per 1 second, "
+                                  "Period: 1 second}}")
+                           .as<RateSpec>());
+        REQUIRE_THROWS(YAML::Load("{Wiggle: {}}").as<RateSpec>());
+        REQUIRE_THROWS(YAML::Load("{Ramp: {}, Sine: {}}").as<RateSpec>());
+    }
+
+    SECTION("Can encode") {
+        auto spec = YAML::Load(
+                        "{Ramp: {From: 1000 per 1 second, To: 3000 per 1 second, Over: 10 seconds}}")
+                        .as<RateSpec>();
+        YAML::Node n;
+        n["GlobalRate"] = spec;
+        REQUIRE(n["GlobalRate"].as<RateSpec>() == spec);
+    }
+}
+
+TEST_CASE("genny::LatencyTargetRateSpec conversions") {
+    using namespace std::chrono_literals;
+
+    SECTION("Can convert with defaults") {
+        auto spec =
+            YAML::Load("{TargetP99: 20 milliseconds}").as<RateSpec>().getLatencyTargetSpec();
+        REQUIRE(spec);
+        REQUIRE(spec->percentile == 99);
+        REQUIRE(spec->target == 20ms);
+        REQUIRE(spec->start == BaseRateSpec{1000 * 1000 * 1000, 100});
+        REQUIRE(spec->interval == 1s);
+    }
+
+    SECTION("Can convert with Start and Adjust") {
+        auto spec = YAML::Load(
+                        "{TargetP99.9: 5 milliseconds, Start: 10 per 1 millisecond, Adjust: 500 "
+                        "milliseconds}")
+                        .as<RateSpec>()
+                        .getLatencyTargetSpec();
+        REQUIRE(spec);
+        REQUIRE(spec->percentile == 99.9);
+        REQUIRE(spec->target == 5ms);
+        REQUIRE(spec->start == BaseRateSpec{1000 * 1000, 10});
+        REQUIRE(spec->interval == 500ms);
+    }
+
+    SECTION("Barfs on invalid values") {
+        REQUIRE_THROWS(YAML::Load("{TargetP100: 20 milliseconds}").as<RateSpec>());
+        REQUIRE_THROWS(YAML::Load("{TargetP99: 0 milliseconds}").as<RateSpec>());
+        REQUIRE_THROWS(YAML::Load("{Start: 1 per 1 second}").as<RateSpec>());
+        REQUIRE_THROWS(
+            YAML::Load("{TargetP99: 20 milliseconds, Adjust: 0 seconds}").as<RateSpec>());
+    }
+
+    SECTION("Can encode") {
+        auto spec =
+            YAML::Load("{TargetP95: 20 milliseconds, Start: 500 per 1 second}").as<RateSpec>();
+        YAML::Node n;
+        n["GlobalRate"] = spec;
+        REQUIRE(n["GlobalRate"].as<RateSpec>() == spec);
+    }
+}
+
 TEST_CASE("genny::PhaseRangeSpec conversions") {
     SECTION("Can convert to genny::PhaseRangeSpec") {
         auto yaml = YAML::Load("Phase: 0..20");
@@ -25,6 +25,7 @@
 #include <gennylib/Orchestrator.hpp>
 #include <gennylib/PhaseLoop.hpp>
 #include <gennylib/context.hpp>
+#include <gennylib/v1/FiberPool.hpp>
 
 #include <testlib/helpers.hpp>
 
@@ -549,3 +550,128 @@ TEST_CASE("Multi-threaded Range-based for loops") {
 
     REQUIRE(failures == 0);
 }
+
+TEST_CASE("Phases advance with more fibers than workers") {
+    genny::Orchestrator o{};
+    o.phasesAtLeastTo(2);
+
+    // Every fiber holds each phase open so awaitPhaseStart() and awaitPhaseEnd()
+    // only return once all 64 have arrived. This would deadlock if waiting
+    // blocked the 2 worker threads rather than yielding the fibers.
+    std::vector<int> actors(64);
+    o.addRequiredTokens(int(actors.size()));
+
+    v1::ExecutionOptions options;
+    options.mode = v1::ExecutionOptions::Mode::kFibers;
+    options.workers = 2;
+
+    std::atomic_int failures = 0;
+    std::vector<std::function<void()>> tasks;
+    for (auto&& _ : actors) {
+        tasks.emplace_back([&]() {
+            while (o.morePhases()) {
+                const auto phase = o.awaitPhaseStart();
+                if (o.currentPhase() != phase) {
+                    ++failures;
+                }
+                o.sleepToPhaseEnd(milliseconds{1}, phase);
+                o.awaitPhaseEnd();
+            }
+        });
+    }
+    v1::FiberPool{options}.run(std::move(tasks));
+
+    REQUIRE(failures == 0);
+    REQUIRE(o.currentPhase() == 3);
+}
+
+TEST_CASE("Sleeping threads wake up when the phase ends") {
+    genny::Orchestrator o{};
+    o.addRequiredTokens(1);
+    REQUIRE(o.awaitPhaseStart() == 0);
+
+    auto sleeper = std::thread([&]() {
+        const auto started = steady_clock::now();
+        o.sleepToPhaseEnd(seconds{30}, 0);
+        const auto slept = steady_clock::now() - started;
+        std::unique_lock<std::mutex> lk(asserting);
+        REQUIRE(slept < seconds{10});
+    });
+
+    std::this_thread::sleep_for(milliseconds{20});
+    o.awaitPhaseEnd(false);
+    sleeper.join();
+}
+
+TEST_CASE("Phase start and stop skew is reported for each Actor") {
+    genny::Orchestrator o{};
+    o.phasesAtLeastTo(1);
+
+    constexpr int kActors = 16;
+    o.addRequiredTokens(kActors);
+
+    std::mutex reported;
+    std::unordered_map<PhaseNumber, int> starts;
+    std::unordered_map<PhaseNumber, int> stops;
+    Duration maxSkew{0};
+    auto record = [&](std::unordered_map<PhaseNumber, int>& counts) {
+        return [&](PhaseNumber phase, Duration skew) {
+            std::lock_guard<std::mutex> lk{reported};
+            ++counts[phase];
+            maxSkew = std::max(maxSkew, skew);
+        };
+    };
+    o.setPhaseSkewCallbacks(record(starts), record(stops));
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < kActors; ++i) {
+        threads.emplace_back([&]() {
+            while (o.morePhases()) {
+                const auto phase = o.awaitPhaseStart();
+                o.actorStartedPhase(phase);
+                o.awaitPhaseEnd();
+                o.actorLeftPhase(phase);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    // Not started (or left) on behalf of a phase that's no longer current.
+    o.actorStartedPhase(0);
+    o.actorLeftPhase(0);
+
+    REQUIRE(starts == std::unordered_map<PhaseNumber, int>{{0, kActors}, {1, kActors}});
+    REQUIRE(stops == std::unordered_map<PhaseNumber, int>{{0, kActors}, {1, kActors}});
+    REQUIRE(maxSkew >= Duration::zero());
+    REQUIRE(maxSkew < seconds{10});
+}
+
+TEST_CASE("Phase stop skew is reported for non-blocking Actors") {
+    genny::Orchestrator o{};
+    o.addRequiredTokens(2);
+
+    std::mutex reported;
+    std::unordered_map<PhaseNumber, int> stops;
+    o.setPhaseSkewCallbacks(nullptr, [&](PhaseNumber phase, Duration) {
+        std::lock_guard<std::mutex> lk{reported};
+        ++stops[phase];
+    });
+
+    // t1 blocks phase 0 for 20ms and t2 runs until it notices the phase ended.
+    auto t1 = std::thread([&]() {
+        for (auto&& h : PhaseLoop<int>{o, makePhaseConfig(o, {{0, 0, nullopt, 20_ots}})})
+            for (auto _ : h) {
+            }  // nop
+    });
+    auto t2 = std::thread([&]() {
+        for (auto&& h : PhaseLoop<int>{o, makePhaseConfig(o, {{0, 0, nullopt, nullopt}})})
+            for (auto _ : h) {
+            }  // nop
+    });
+    t1.join();
+    t2.join();
+
+    REQUIRE(stops == std::unordered_map<PhaseNumber, int>{{0, 2}});
+}
@@ -15,6 +15,7 @@
 #include <chrono>
 #include <iostream>
 #include <mutex>
+#include <numeric>
 #include <thread>
 #include <unordered_map>
 #include <unordered_set>
@@ -58,3 +59,67 @@ TEST_CASE("Parallel runner reraises exceptions") {
     };
     REQUIRE_THROWS_WITH(test(), ContainsSubstring("This should be reraised."));
 }
+
+TEST_CASE("Parallel runner in fiber mode") {
+    v1::ExecutionOptions options;
+    options.mode = v1::ExecutionOptions::Mode::kFibers;
+    options.workers = 2;
+
+    SECTION("Runs more elements than workers") {
+        std::vector<int> integers(100);
+        std::iota(integers.begin(), integers.end(), 0);
+
+        std::atomic_int sum = 0;
+        parallelRun(integers, [&](const auto& integer) { sum += integer; }, options);
+
+        REQUIRE(sum == 4950);
+    }
+
+    SECTION("Sleeps yield the worker") {
+        // 100 fibers sleeping 50ms each on 2 workers would take 2.5s if sleeps
+        // blocked the worker threads.
+        std::vector<int> integers(100);
+        const auto start = std::chrono::steady_clock::now();
+        parallelRun(
+            integers,
+            [&](const auto&) { v1::sleepFor(std::chrono::milliseconds{50}); },
+            options);
+        REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::seconds{1});
+    }
+
+    SECTION("Reraises exceptions") {
+        std::vector<int> integers = {1, 2, 3, 4, 5};
+        auto test = [&]() {
+            parallelRun(
+                integers,
+                [&](const auto& integer) {
+                    throw std::logic_error("This should be reraised.");
+                },
+                options);
+        };
+        REQUIRE_THROWS_WITH(test(), ContainsSubstring("This should be reraised."));
+    }
+}
+
+TEST_CASE("Parallel runner sleeps as the options say") {
+    const auto deadline = std::chrono::steady_clock::time_point{std::chrono::seconds{1}};
+
+    v1::ExecutionOptions options;
+    options.sleep.mode = v1::SleepOptions::Mode::kPrecise;
+    options.sleep.spin = std::chrono::microseconds{10};
+    const auto mode = GENERATE(v1::ExecutionOptions::Mode::kThreads,
+                               v1::ExecutionOptions::Mode::kFibers);
+    options.mode = mode;
+
+    std::vector<int> integers = {1, 2};
+    std::atomic_int precise = 0;
+    parallelRun(integers,
+                [&](const auto&) {
+                    precise += v1::coarseDeadline(deadline) == deadline - options.sleep.spin;
+                },
+                options);
+    REQUIRE(precise == 2);
+
+    // Only the Actors' threads were changed.
+    REQUIRE(v1::coarseDeadline(deadline) == deadline);
+}
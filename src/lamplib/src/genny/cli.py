@@ -385,6 +385,17 @@ def benchmark_test(ctx: click.Context) -> None:
         "Does all the poplar/curator/preprocessing stuff but then hangs indefinitely."
     ),
 )
+@click.option(
+    "-n",
+    "--workers",
+    required=False,
+    default=1,
+    type=int,
+    help=(
+        "Split the workload's Actor threads across this many genny_core processes. "
+        "Their phases start and end together and their metrics are merged."
+    ),
+)
 @click.pass_context
 def workload(
     ctx: click.Context,
@@ -397,6 +408,7 @@ def workload(
     smoke_test: bool,
     calculate_rollups: bool,
     debug: bool,
+    workers: int,
 ):
     from genny.tasks import genny_runner
 
@@ -415,6 +427,7 @@ def workload(
         cleanup_metrics=True,
         hang=debug,
         should_calculate_rollups=calculate_rollups,
+        workers=workers,
     )
 
 
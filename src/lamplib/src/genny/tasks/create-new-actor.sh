@@ -241,8 +241,8 @@ namespace genny::actor {
 // We'll automatically construct 2 ${q}PhaseConfig${q}s.
 //
 // You can pass additional parameters to your ${q}PhaseConfig${q} type by adding
-// them to the ${q}_loop{}${q} initializer in the ${q}${actor_name}${q} constructor
-// below. The first constructor parameter must always be a ${q}PhaseContext&${q}
+// them after ${q}*this${q} and ${q}context${q} in the ${q}_loop{}${q} initializer in the
+// ${q}${actor_name}${q} constructor below. The first constructor parameter must always be a ${q}PhaseContext&${q}
 // which lets you access the per-Phase configuration. In this example, the
 // constructor also requires a ${q}database&${q} and the ${q}ActorId${q} which we pass
 // along in the initializer.
@@ -421,11 +421,15 @@ ${actor_name}::${actor_name}(genny::ActorContext& context)
       //
       // Pass any additional constructor parameters that your ${q}PhaseConfig${q} needs.
       //
-      // The first argument passed in here is actually the ${q}ActorContext${q} but the
-      // ${q}PhaseLoop${q} reads the ${q}PhaseContext${q}s from there and constructs one
-      // instance for each Phase.
+      // The first two arguments passed in here are the Actor itself and its
+      // ${q}ActorContext${q}. The ${q}PhaseLoop${q} reads the ${q}PhaseContext${q}s from the
+      // latter and constructs one instance for each Phase. It needs the Actor to seed
+      // ${q}ArrivalRate${q} phases from this thread's random seed.
       //
-      _loop{context, (*_client)[context["Database"].to<std::string>()], ${actor_name}::id()} {}
+      _loop{*this,
+            context,
+            (*_client)[context["Database"].to<std::string>()],
+            ${actor_name}::id()} {}
 
 namespace {
 //
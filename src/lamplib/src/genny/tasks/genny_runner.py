@@ -24,6 +24,7 @@ def main_genny_runner(
     should_calculate_rollups: bool,
     hang: bool = False,
     mongostream_uri: Optional[str] = None,
+    workers: int = 1,
 ):
     """
     Intended to be the main entry point for running Genny.
@@ -53,6 +54,10 @@ def main_genny_runner(
         cmd.append("--verbosity")
         cmd.append(verbosity)
 
+        if workers > 1:
+            cmd.append("--workers")
+            cmd.append(str(workers))
+
         output_dir = os.path.join(workspace_root, "build/WorkloadOutput")
         preprocessed_dir = os.path.join(output_dir, "workload")
         os.makedirs(preprocessed_dir, exist_ok=True)
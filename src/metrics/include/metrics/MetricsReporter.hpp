@@ -310,6 +310,10 @@ private:
 
         out << "Operations" << std::endl;
         out << "timestamp,actor,thread,operation,duration,outcome,n,ops,errors,size" << std::endl;
+        if (const auto* spill = _registry->getEventSpill(perm); spill) {
+            spill->writeCedarCsv(out, shouldSkipReporting);
+            return;
+        }
         for (const auto& [actorName, opsByType] : _registry->getOps(perm)) {
             for (const auto& [opName, opsByThread] : opsByType) {
                 if (shouldSkipReporting(actorName, opName)) {
@@ -328,13 +332,15 @@ private:
                         out << event.second.number << ",";
                         out << event.second.ops << ",";
                         out << event.second.errors << ",";
-                        out << event.second.size << std::endl;
+                        // Not std::endl: flushing every line makes long runs take minutes.
+                        out << event.second.size << '\n';
 
                         logMaybe(++iter, actorName, opName);
                     }
                 }
             }
         }
+        out.flush();
     }
 
     static bool shouldSkipReporting(const std::string& actorName, const std::string& opName) {
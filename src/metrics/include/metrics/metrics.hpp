@@ -15,16 +15,26 @@
 #ifndef HEADER_058638D3_7069_42DC_809F_5DB533FCFBA3_INCLUDED
 #define HEADER_058638D3_7069_42DC_809F_5DB533FCFBA3_INCLUDED
 
+#include <atomic>
 #include <boost/filesystem.hpp>
 #include <chrono>
+#include <map>
 #include <optional>
 #include <type_traits>
 #include <unordered_map>
+#include <unordered_set>
 
 #include <gennylib/Node.hpp>
 #include <gennylib/conventions.hpp>
 
 #include <metrics/operation.hpp>
+#include <metrics/v1/ArrowFile.hpp>
+#include <metrics/v1/EventReduction.hpp>
+#include <metrics/v1/EventSpill.hpp>
+#include <metrics/v1/HistogramLog.hpp>
+#include <metrics/v1/LiveStats.hpp>
+#include <metrics/v1/Overhead.hpp>
+#include <metrics/v1/TscClock.hpp>
 #include <metrics/v1/passkey.hpp>
 
 
@@ -43,10 +53,17 @@ public:
         kCedarCsv,
         kFtdc,
         kCsvFtdc,
+        kHistogram,
+        kFtdcNative,
+        kArrow,
+        // Records nothing. Not accepted in a workload.
+        kNone,
     };
 
     MetricsFormat() : _format{Format::kCsv} {}
 
+    explicit MetricsFormat(Format format) : _format{format} {}
+
     MetricsFormat(const Node& node) : _format{strToEnum(node.to<std::string>())} {}
 
     MetricsFormat(const std::string& toConvert) : _format{strToEnum(toConvert)} {}
@@ -55,11 +72,30 @@ public:
         return _format == Format::kFtdc || _format == Format::kCsvFtdc;
     }
 
+    /**
+     * @return whether operations are written as FTDC, by poplar or by genny itself.
+     */
+    bool useFtdc() const {
+        return useGrpc() || useNativeFtdc();
+    }
+
+    bool useNativeFtdc() const {
+        return _format == Format::kFtdcNative;
+    }
+
     bool useCsv() const {
         return _format == Format::kCsv || _format == Format::kCedarCsv ||
             _format == Format::kCsvFtdc;
     }
 
+    bool useHistogram() const {
+        return _format == Format::kHistogram;
+    }
+
+    bool useArrow() const {
+        return _format == Format::kArrow;
+    }
+
     Format get() const {
         return _format;
     }
@@ -78,6 +114,14 @@ public:
                 return "ftdc";
             case Format::kCsvFtdc:
                 return "csv-ftdc";
+            case Format::kHistogram:
+                return "histogram";
+            case Format::kFtdcNative:
+                return "ftdc-native";
+            case Format::kArrow:
+                return "arrow";
+            case Format::kNone:
+                return "none";
         }
         BOOST_THROW_EXCEPTION(InvalidConfigurationException("Impossible"));
     }
@@ -93,6 +137,12 @@ private:
             return Format::kFtdc;
         } else if (toConvert == "csv-ftdc") {
             return Format::kCsvFtdc;
+        } else if (toConvert == "histogram") {
+            return Format::kHistogram;
+        } else if (toConvert == "ftdc-native") {
+            return Format::kFtdcNative;
+        } else if (toConvert == "arrow") {
+            return Format::kArrow;
         } else {
             throw std::invalid_argument(std::string("Unknown metrics format ") + toConvert);
         }
@@ -121,9 +171,28 @@ public:
     using report_time_point = std::chrono::time_point<report_clock_type>;
 
     static time_point now() {
+        if (const auto* tsc = _tsc.load(std::memory_order_relaxed); tsc) {
+            return tsc->now();
+        }
         return clock_type::now();
     }
 
+    /**
+     * Read the invariant TSC instead of steady_clock, or stop reading it. steady_clock is read
+     * until this is called, and the TSC is calibrated the first time it's asked for. Both give
+     * the same time_points so this can be called at any time.
+     *
+     * @return whether the TSC is now being read.
+     */
+    static bool useTsc(bool use) {
+        _tsc.store(use ? v1::TscClock::invariant() : nullptr);
+        return usingTsc();
+    }
+
+    static bool usingTsc() {
+        return _tsc.load() != nullptr;
+    }
+
     /**
      * Translate a given time point to a one suitable for
      * external reporting.
@@ -136,6 +205,7 @@ public:
 
 private:
     // Inlining lets us initialize these in the header.
+    inline static std::atomic<const v1::TscClock*> _tsc{nullptr};
     inline static time_point _timeStarted = now();
     inline static report_time_point _reportTimeStarted = report_clock_type::now();
 };
@@ -183,18 +253,43 @@ public:
 
     explicit RegistryT() = default;
 
-    explicit RegistryT(bool assertMetricsBuffer) : RegistryT({}, {}, assertMetricsBuffer) {}
+    // Not asserting on the metrics buffer lets it grow as it did before it had an overflow policy.
+    explicit RegistryT(bool assertMetricsBuffer)
+        : RegistryT({},
+                    {},
+                    v2::GrpcOptions{assertMetricsBuffer ? v2::OverflowPolicy::kFail
+                                                        : v2::OverflowPolicy::kGrow}) {}
 
     explicit RegistryT(MetricsFormat format,
                        boost::filesystem::path pathPrefix,
-                       bool assertMetricsBuffer = true)
+                       v2::GrpcOptions grpcOptions = {},
+                       v1::HistogramOptions histogramOptions = {},
+                       std::optional<v1::SpillOptions> spillOptions = std::nullopt,
+                       v1::ArrowOptions arrowOptions = {})
         : _format{std::move(format)},
           _pathPrefix{std::move(pathPrefix)},
           _internalPathPrefix{_pathPrefix / INTERNAL_DIR} {
-        if (_format.useGrpc()) {
+        if (_format.useFtdc()) {
             boost::filesystem::create_directories(_pathPrefix);
             boost::filesystem::create_directories(_internalPathPrefix);
-            _grpcClient = std::make_unique<GrpcClient>(assertMetricsBuffer);
+            grpcOptions.nativeFtdc = _format.useNativeFtdc();
+            _grpcClient = std::make_unique<GrpcClient>(std::move(grpcOptions));
+        }
+        if (_format.useHistogram()) {
+            if (histogramOptions.logPath.empty()) {
+                histogramOptions.logPath = _pathPrefix.string() + ".intervals.csv";
+            }
+            _histogramLog = std::make_unique<v1::HistogramLog>(std::move(histogramOptions));
+        }
+        // The legacy csv format reads events back in several passes so keeps them in memory.
+        if (spillOptions && _format.useCsv() && _format.get() != MetricsFormat::Format::kCsv) {
+            if (spillOptions->directory.empty()) {
+                spillOptions->directory = _pathPrefix.string() + ".spill";
+            }
+            _eventSpill = std::make_unique<v1::EventSpill>(std::move(*spillOptions));
+        }
+        if (_format.useArrow()) {
+            _arrowFiles = std::make_unique<v1::ArrowFiles>(std::move(arrowOptions));
         }
     }
 
@@ -210,13 +305,21 @@ public:
         auto pathPrefix = internal ? _internalPathPrefix : _pathPrefix;
         OperationsByType& opsByType = this->_ops[actorName];
         OperationsByThread& opsByThread = opsByType[opName];
-        if (_format.useGrpc() && opsByThread.find(actorId) == opsByThread.end()) {
+        if (_format.useFtdc() && opsByThread.find(actorId) == opsByThread.end()) {
             auto name = createName(actorName, opName, phase, internal);
             stream = _grpcClient->createStream(actorId, name, phase, pathPrefix);
         }
         OperationImpl<ClockSource>& op =
-            opsByThread.try_emplace(actorId, std::move(actorName), *this, std::move(opName), stream)
-               .first->second;
+            opsByThread.try_emplace(actorId, actorName, *this, opName, stream).first->second;
+        attachHistogram(op, actorId);
+        attachSpill(op, actorName, opName, actorId);
+        attachArrow(op, actorName, opName, actorId, internal);
+        attachLive(op);
+        attachReduction(op, actorName, opName, actorId);
+        attachServiceTime(op, actorName, opName, actorId, phase, internal);
+        if (!internal) {
+            op.accountOverhead(overheadOf(actorName, actorId));
+        }
         return OperationT{op};
     }
 
@@ -232,7 +335,7 @@ public:
         OperationsByThread& opsByThread = opsByType[opName];
         auto pathPrefix = internal ? _internalPathPrefix : _pathPrefix;
         StreamPtr stream = nullptr;
-        if (_format.useGrpc() && opsByThread.find(actorId) == opsByThread.end()) {
+        if (_format.useFtdc() && opsByThread.find(actorId) == opsByThread.end()) {
             auto name = createName(actorName, opName, phase, internal);
             stream = _grpcClient->createStream(actorId, name, phase, pathPrefix);
         }
@@ -240,16 +343,151 @@ public:
             opsByThread
                 .try_emplace(
                     actorId,
-                    std::move(actorName),
+                    actorName,
                     *this,
-                    std::move(opName),
+                    opName,
                     stream,
                     std::make_optional<typename OperationImpl<ClockSource>::OperationThreshold>(
                         threshold, percentage))
                 .first->second;
+        attachHistogram(op, actorId);
+        attachSpill(op, actorName, opName, actorId);
+        attachArrow(op, actorName, opName, actorId, internal);
+        attachLive(op);
+        attachReduction(op, actorName, opName, actorId);
+        attachServiceTime(op, actorName, opName, actorId, phase, internal);
+        if (!internal) {
+            op.accountOverhead(overheadOf(actorName, actorId));
+        }
         return OperationT{op};
     }
 
+    /**
+     * Record service time alongside response time for operations of the given Actor.
+     *
+     * Operations started in open-loop (`ArrivalRate:`) phases report the time since they were
+     * scheduled to start as their duration. With this enabled, each operation `Op` gets a
+     * sibling `Op.ServiceTime` whose duration is the time since they actually started.
+     *
+     * Must be called before the Actor's operations are created.
+     */
+    void enableServiceTime(const std::string& actorName) {
+        std::lock_guard<std::mutex> lk(*_opLock);
+        _serviceTimeActors.insert(actorName);
+    }
+
+    /**
+     * Sample or sum the events of the given operation, or of every operation of the given Actor
+     * if `opName` is empty, before recording them to the formats that keep every event. See
+     * OperationImpl::reduceWith().
+     *
+     * Must be called before the operations are created.
+     */
+    void reduceEvents(const std::string& actorName,
+                      const std::string& opName,
+                      v1::ReductionOptions options) {
+        std::lock_guard<std::mutex> lk(*_opLock);
+        _reductions.insert_or_assign({actorName, opName}, std::move(options));
+    }
+
+    /**
+     * Account for the time each Actor thread spends in genny's own code. See overhead().
+     *
+     * Must be called before the operations are created.
+     */
+    void enableOverhead() {
+        std::lock_guard<std::mutex> lk(*_opLock);
+        _overheadEnabled = true;
+    }
+
+    /**
+     * @return where the given Actor thread adds up the time it spends recording its operations
+     *   and between its iterations, or nullptr unless enableOverhead() was called. Only that
+     *   thread may use it.
+     */
+    v1::Overhead* overhead(const std::string& actorName, ActorId actorId) {
+        std::lock_guard<std::mutex> lk(*_opLock);
+        return overheadOf(actorName, actorId);
+    }
+
+    /**
+     * Record the events every operation is still sampling or summing and close the log of
+     * bucket durations. Only call this once every Actor has stopped reporting operations.
+     */
+    void flushReductions() {
+        std::lock_guard<std::mutex> lk(*_opLock);
+        for (auto& [actorName, opsByType] : _ops) {
+            for (auto& [opName, opsByThread] : opsByType) {
+                for (auto& [actorId, op] : opsByThread) {
+                    op.flushReduction();
+                }
+            }
+        }
+        if (_bucketLog) {
+            _bucketLog->close();
+        }
+    }
+
+    /**
+     * Keep live stats for every operation so a live reporter can see how the workload is doing
+     * while it runs. See drainLiveStats().
+     *
+     * Call before the Actors' operations are created so none are missed.
+     */
+    void enableLiveStats(v1::LiveOptions options) {
+        std::lock_guard<std::mutex> lk(*_opLock);
+        _liveOptions = std::move(options);
+        for (auto& [actorName, opsByType] : _ops) {
+            for (auto& [opName, opsByThread] : opsByType) {
+                for (auto& [actorId, op] : opsByThread) {
+                    attachLive(op);
+                }
+            }
+        }
+    }
+
+    /**
+     * @return the options passed to enableLiveStats(), if it was called.
+     */
+    const std::optional<v1::LiveOptions>& getLiveOptions() const {
+        return _liveOptions;
+    }
+
+    /**
+     * Collect what every operation recorded since the last call, summed over the threads running
+     * it and ordered by actor and operation name. Operations that haven't recorded anything
+     * since are included with zero counts.
+     *
+     * Thread-safe. Actors keep running while this drains them.
+     */
+    std::vector<v1::LiveOperation> drainLiveStats() {
+        std::map<std::pair<std::string, std::string>, v1::LiveOperation> drained;
+        {
+            std::lock_guard<std::mutex> lk(*_opLock);
+            for (auto& [actorName, opsByType] : _ops) {
+                for (auto& [opName, opsByThread] : opsByType) {
+                    for (auto& [actorId, op] : opsByThread) {
+                        auto& into = drained[{actorName, opName}];
+                        if (op.drainLive(into)) {
+                            ++into.threads;
+                        }
+                    }
+                }
+            }
+        }
+        std::vector<v1::LiveOperation> out;
+        out.reserve(drained.size());
+        for (auto& [key, op] : drained) {
+            if (op.threads == 0) {
+                continue;
+            }
+            op.actorName = key.first;
+            op.opName = key.second;
+            out.push_back(std::move(op));
+        }
+        return out;
+    }
+
     [[nodiscard]] const OperationsMap& getOps(v1::Permission) const {
         return this->_ops;
     };
@@ -275,7 +513,184 @@ public:
         return _pathPrefix;
     }
 
+    /**
+     * @return how many events the ftdc format has dropped because an operation's buffer was full.
+     *   Always 0 unless the overflow policy drops events.
+     */
+    uint64_t getDroppedEvents() const {
+        return _grpcClient ? _grpcClient->dropped() : 0;
+    }
+
+    /**
+     * @return where the `histogram` format is writing its intervals, or nullptr for other formats.
+     */
+    const v1::HistogramLog* getHistogramLog() const {
+        return _histogramLog.get();
+    }
+
+    /**
+     * Write out every operation's last interval and close the histogram log.
+     * Only call this once every Actor has stopped reporting operations.
+     */
+    void closeHistogramLog() {
+        if (!_histogramLog) {
+            return;
+        }
+        std::lock_guard<std::mutex> lk(*_opLock);
+        for (auto& [actorName, opsByType] : _ops) {
+            for (auto& [opName, opsByThread] : opsByType) {
+                for (auto& [actorId, op] : opsByThread) {
+                    op.flushHistogram();
+                }
+            }
+        }
+        _histogramLog->close();
+    }
+
+    /**
+     * Write out every operation's last record batch and close the `arrow` format's files.
+     * Only call this once every Actor has stopped reporting operations.
+     */
+    void closeArrowFiles() {
+        if (!_arrowFiles) {
+            return;
+        }
+        std::lock_guard<std::mutex> lk(*_opLock);
+        for (auto& [actorName, opsByType] : _ops) {
+            for (auto& [opName, opsByThread] : opsByType) {
+                for (auto& [actorId, op] : opsByThread) {
+                    op.flushArrow();
+                }
+            }
+        }
+        _arrowFiles->close();
+    }
+
+    /**
+     * @return where the cedar CSV formats are spilling events, or nullptr if they're kept in
+     *   memory.
+     */
+    const v1::EventSpill* getEventSpill(v1::Permission) const {
+        return _eventSpill.get();
+    }
+
+    /**
+     * Write out every spilled event still buffered so a Reporter can read them.
+     * Only call this once every Actor has stopped reporting operations.
+     */
+    void flushEventSpill() {
+        if (_eventSpill) {
+            _eventSpill->flush();
+        }
+    }
+
 private:
+    // Call with _opLock held.
+    void attachSpill(OperationImpl<ClockSource>& op,
+                     const std::string& actorName,
+                     const std::string& opName,
+                     ActorId actorId) {
+        if (_eventSpill && !op.isSpilled()) {
+            const auto [writer, index] = _eventSpill->attach(actorName, opName, actorId);
+            op.spillTo(writer, index);
+        }
+    }
+
+    // Call with _opLock held.
+    void attachArrow(OperationImpl<ClockSource>& op,
+                     const std::string& actorName,
+                     const std::string& opName,
+                     ActorId actorId,
+                     bool internal) {
+        if (_arrowFiles) {
+            op.recordArrow(
+                _arrowFiles->open(internal ? _internalPathPrefix : _pathPrefix, actorName, opName),
+                actorId,
+                _arrowFiles->options().batchRows);
+        }
+    }
+
+    // Call with _opLock held.
+    void attachLive(OperationImpl<ClockSource>& op) {
+        if (_liveOptions) {
+            op.recordLive();
+        }
+    }
+
+    // Call with _opLock held.
+    void attachReduction(OperationImpl<ClockSource>& op,
+                         const std::string& actorName,
+                         const std::string& opName,
+                         ActorId actorId) {
+        auto it = _reductions.find({actorName, opName});
+        if (it == _reductions.end()) {
+            it = _reductions.find({actorName, ""});
+        }
+        if (it == _reductions.end()) {
+            return;
+        }
+        const auto& options = it->second;
+        if (options.bucket > std::chrono::nanoseconds::zero() && !_bucketLog) {
+            v1::HistogramOptions logOptions;
+            logOptions.significantDigits = v1::ReductionOptions::kSignificantDigits;
+            // Operations can have different buckets.
+            logOptions.interval = std::chrono::nanoseconds::zero();
+            logOptions.logPath = options.bucketLogPath.empty()
+                ? boost::filesystem::path{_pathPrefix.string() + ".buckets.csv"}
+                : options.bucketLogPath;
+            _bucketLog = std::make_unique<v1::HistogramLog>(std::move(logOptions));
+        }
+        op.reduceWith(options, _bucketLog.get(), actorId);
+    }
+
+    // Call with _opLock held.
+    v1::Overhead* overheadOf(const std::string& actorName, ActorId actorId) {
+        if (!_overheadEnabled) {
+            return nullptr;
+        }
+        auto& overhead = _overheads[{actorName, actorId}];
+        if (!overhead) {
+            overhead = std::make_unique<v1::Overhead>();
+        }
+        return overhead.get();
+    }
+
+    // Call with _opLock held.
+    void attachHistogram(OperationImpl<ClockSource>& op, ActorId actorId) {
+        if (_histogramLog) {
+            op.recordHistogram(_histogramLog.get(), actorId);
+        }
+    }
+
+    // Call with _opLock held.
+    void attachServiceTime(OperationImpl<ClockSource>& op,
+                           const std::string& actorName,
+                           const std::string& opName,
+                           ActorId actorId,
+                           const std::optional<genny::PhaseNumber>& phase,
+                           bool internal) {
+        if (_serviceTimeActors.count(actorName) == 0) {
+            return;
+        }
+        const auto serviceOpName = opName + ".ServiceTime";
+        OperationsByThread& opsByThread = this->_ops[actorName][serviceOpName];
+        StreamPtr stream = nullptr;
+        if (_format.useFtdc() && opsByThread.find(actorId) == opsByThread.end()) {
+            auto name = createName(actorName, serviceOpName, phase, internal);
+            stream = _grpcClient->createStream(
+                actorId, name, phase, internal ? _internalPathPrefix : _pathPrefix);
+        }
+        OperationImpl<ClockSource>& serviceOp =
+            opsByThread.try_emplace(actorId, actorName, *this, serviceOpName, stream)
+                .first->second;
+        attachHistogram(serviceOp, actorId);
+        attachSpill(serviceOp, actorName, serviceOpName, actorId);
+        attachArrow(serviceOp, actorName, serviceOpName, actorId, internal);
+        attachLive(serviceOp);
+        attachReduction(serviceOp, actorName, opName, actorId);
+        op.setServiceTime(&serviceOp);
+    }
+
     std::string createName(const std::string& actorName,
                            const std::string& opName,
                            const std::optional<genny::PhaseNumber>& phase,
@@ -298,7 +713,18 @@ private:
     // Must be a ptr to keep the registry moveable.
     std::unique_ptr<std::mutex> _opLock = std::make_unique<std::mutex>();
     std::unique_ptr<GrpcClient> _grpcClient;
+    std::unique_ptr<v1::HistogramLog> _histogramLog;
+    std::unique_ptr<v1::EventSpill> _eventSpill;
+    std::unique_ptr<v1::ArrowFiles> _arrowFiles;
+    std::unique_ptr<v1::HistogramLog> _bucketLog;
     OperationsMap _ops;
+    std::unordered_set<std::string> _serviceTimeActors;
+    std::optional<v1::LiveOptions> _liveOptions;
+    // (actor name, operation name or "" for all of the Actor's operations) -> options.
+    std::map<std::pair<std::string, std::string>, v1::ReductionOptions> _reductions;
+    bool _overheadEnabled = false;
+    // Pointers to them are handed out so they can't move.
+    std::map<std::pair<std::string, ActorId>, std::unique_ptr<v1::Overhead>> _overheads;
     MetricsFormat _format;
     boost::filesystem::path _pathPrefix;
     boost::filesystem::path _internalPathPrefix;
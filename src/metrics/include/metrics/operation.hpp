@@ -15,11 +15,16 @@
 #ifndef HEADER_3D319F23_C539_4B6B_B4E7_23D23E2DCD52_INCLUDED
 #define HEADER_3D319F23_C539_4B6B_B4E7_23D23E2DCD52_INCLUDED
 
+#include <algorithm>
+#include <chrono>
 #include <cstdint>
 #include <exception>
 #include <memory>
+#include <optional>
 #include <ostream>
 #include <string>
+#include <type_traits>
+#include <utility>
 
 #include <boost/core/noncopyable.hpp>
 #include <boost/filesystem.hpp>
@@ -29,6 +34,12 @@
 #include <gennylib/Orchestrator.hpp>
 
 #include <metrics/Period.hpp>
+#include <metrics/v1/ArrowFile.hpp>
+#include <metrics/v1/EventReduction.hpp>
+#include <metrics/v1/EventSpill.hpp>
+#include <metrics/v1/HistogramLog.hpp>
+#include <metrics/v1/LiveStats.hpp>
+#include <metrics/v1/Overhead.hpp>
 #include <metrics/v1/TimeSeries.hpp>
 #include <metrics/v2/event.hpp>
 
@@ -119,6 +130,72 @@ struct OperationEventT final {
 namespace internals {
 
 
+namespace v1 {
+
+/**
+ * When the current Actor iteration was scheduled to start.
+ *
+ * Phases with an `ArrivalRate:` are open-loop: iterations are scheduled independently of how
+ * long previous iterations took. The PhaseLoop publishes each iteration's scheduled start here
+ * and the next OperationContextT started on the same thread measures its latency from it
+ * rather than from when it actually started. Otherwise time spent queued behind a slow
+ * operation would be silently dropped from the latency distribution ("coordinated omission").
+ */
+class IntendedStart final {
+public:
+    using time_point = std::chrono::steady_clock::time_point;
+
+    static void set(time_point intended) {
+        _intended = intended;
+    }
+
+    static void clear() {
+        _intended.reset();
+    }
+
+    /**
+     * @return the intended start, if any, and clear it so only the first operation
+     *   started in an iteration is measured from it.
+     */
+    static std::optional<time_point> take() {
+        return std::exchange(_intended, std::nullopt);
+    }
+
+private:
+    static inline thread_local std::optional<time_point> _intended;
+};
+
+/**
+ * Receives the latency of every operation the current Actor iteration reports.
+ *
+ * The PhaseLoop installs one for the duration of each iteration of a phase whose
+ * `GlobalRate` adjusts itself to meet a latency target.
+ */
+class LatencyObserver {
+public:
+    virtual ~LatencyObserver() = default;
+
+    virtual void observe(std::chrono::nanoseconds latency) = 0;
+
+    /**
+     * Install `observer` for the current thread, or remove it if `nullptr`.
+     */
+    static void set(LatencyObserver* observer) {
+        _current = observer;
+    }
+
+    static void notify(std::chrono::nanoseconds latency) {
+        if (_current) {
+            _current->observe(latency);
+        }
+    }
+
+private:
+    static inline thread_local LatencyObserver* _current = nullptr;
+};
+
+}  // namespace v1
+
 namespace v2 {
 
 class StreamInterfaceImpl;
@@ -188,6 +265,8 @@ public:
     using OptionalOperationThreshold = std::optional<OperationThreshold>;
     using OptionalPhaseNumber = std::optional<genny::PhaseNumber>;
     using StreamPtr = internals::v2::EventStream<ClockSource, v2::StreamInterfaceImpl>*;
+    using Sampler = v1::EventSampler<ClockSource, OperationEventT<ClockSource>>;
+    using Buckets = v1::BucketAggregator<ClockSource, OperationEventT<ClockSource>>;
 
     OperationImpl(std::string actorName,
                   const RegistryT<ClockSource>& registry,
@@ -228,15 +307,167 @@ public:
     }
 
     void reportAt(time_point started, time_point finished, OperationEventT<ClockSource>&& event) {
-        if (_threshold) {
-            _threshold->check(started, finished);
+        v1::LatencyObserver::notify(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                typename ClockSource::duration(event.duration)));
+        this->record(started, finished, std::move(event));
+    }
+
+    /**
+     * Report an operation from an open-loop phase. The event's duration is the response time
+     * (from when the operation was scheduled to start) and, if service time is being recorded
+     * for this operation, the time from when it actually started is reported separately.
+     */
+    void reportAt(time_point intendedStart,
+                  time_point started,
+                  time_point finished,
+                  OperationEventT<ClockSource>&& event) {
+        if (_serviceTime) {
+            auto serviceEvent = event;
+            serviceEvent.duration = finished - started;
+            _serviceTime->record(started, finished, std::move(serviceEvent));
         }
-        if (_stream) {
-            _stream->addAt(
-                finished, std::move(event), _registry.getWorkerCount(_actorName, _opName));
+        this->reportAt(intendedStart, finished, std::move(event));
+    }
+
+    /**
+     * Also report service time for operations started in open-loop phases to `serviceTime`.
+     * Only call this during setup.
+     */
+    void setServiceTime(OperationImpl<ClockSource>* serviceTime) {
+        _serviceTime = serviceTime;
+    }
+
+    /**
+     * Add the time spent recording each operation reported with start() to `overhead`, which
+     * belongs to the thread running this operation. Only call this during setup.
+     */
+    void accountOverhead(v1::Overhead* overhead) {
+        _overhead = overhead;
+    }
+
+    /**
+     * Account for the time since `finished` as spent recording an operation that finished then.
+     */
+    void addOverhead(time_point finished) {
+        if (_overhead) {
+            _overhead->metricsNanos +=
+                std::chrono::duration_cast<std::chrono::nanoseconds>(ClockSource::now() - finished)
+                    .count();
+            ++_overhead->metricsReports;
         }
-        if (_useCsv) {
-            _events->addAt(finished, event);
+    }
+
+    /**
+     * Aggregate this operation into an HdrHistogram per interval written to `log` instead of
+     * keeping every event. Only call this during setup.
+     */
+    void recordHistogram(v1::HistogramLog* log, ActorId thread) {
+        if (!_histogram) {
+            _histogram = std::make_unique<v1::HistogramWindow<ClockSource>>(log, thread);
+        }
+    }
+
+    /**
+     * Also write this operation's events to `file` in record batches of `batchRows`.
+     * Only call this during setup.
+     */
+    void recordArrow(v1::ArrowFile* file, ActorId thread, size_t batchRows) {
+        if (!_arrow) {
+            _arrow = std::make_unique<v1::ArrowRecorder<ClockSource>>(file, thread, batchRows);
+        }
+    }
+
+    /**
+     * Write out the events not yet in a record batch, if any.
+     */
+    void flushArrow() {
+        if (_arrow) {
+            _arrow->flush();
+        }
+    }
+
+    /**
+     * Append this operation's events to `writer` instead of keeping them in getEvents().
+     * Only call this during setup.
+     */
+    void spillTo(v1::SpillWriter* writer, uint32_t index) {
+        if (!_spill) {
+            _spill = writer;
+            _spillIndex = index;
+            _events.reset();
+        }
+    }
+
+    bool isSpilled() const {
+        return _spill != nullptr;
+    }
+
+    /**
+     * Also keep counters and durations the live reporter can drain while the workload runs.
+     * Only call this during setup.
+     */
+    void recordLive() {
+        if (!_live) {
+            _live = std::make_unique<v1::LiveStats>();
+        }
+    }
+
+    /**
+     * Add what's been recorded since the last call to `into`, if recordLive() was called.
+     * Thread-safe.
+     *
+     * @return whether this operation keeps live stats.
+     */
+    bool drainLive(v1::LiveOperation& into) {
+        if (!_live) {
+            return false;
+        }
+        _live->drainInto(into);
+        return true;
+    }
+
+    /**
+     * Only record a sample or per-bucket sum of this operation's events as in `options` to the
+     * formats that keep every event. Histograms, live stats and thresholds still see every event.
+     * Only call this during setup.
+     *
+     * @param bucketLog where each bucket's durations are written if `options.bucket` is set.
+     */
+    void reduceWith(const v1::ReductionOptions& options,
+                    v1::HistogramLog* bucketLog,
+                    ActorId thread) {
+        if (_sampler || _buckets) {
+            return;
+        }
+        if (options.bucket > std::chrono::nanoseconds::zero()) {
+            _buckets = std::make_unique<Buckets>(options.bucket, bucketLog, thread);
+        } else if (options.sampleEvery > 1) {
+            _sampler = std::make_unique<Sampler>(options.sampleEvery);
+        }
+    }
+
+    /**
+     * Record the counts of the events not yet sampled and the bucket being summed, if any.
+     */
+    void flushReduction() {
+        std::optional<std::pair<time_point, OperationEventT<ClockSource>>> pending;
+        if (_sampler) {
+            pending = _sampler->flush();
+        } else if (_buckets) {
+            pending = _buckets->flush(_actorName, _opName);
+        }
+        if (pending) {
+            this->recordEvent(pending->first, std::move(pending->second));
+        }
+    }
+
+    /**
+     * Write out the interval being aggregated, if any.
+     */
+    void flushHistogram() {
+        if (_histogram) {
+            _histogram->flush(_actorName, _opName);
         }
     }
 
@@ -255,6 +486,61 @@ public:
     }
 
 private:
+    void record(time_point started, time_point finished, OperationEventT<ClockSource>&& event) {
+        if (_threshold) {
+            _threshold->check(started, finished);
+        }
+        if (_histogram) {
+            _histogram->record(_actorName, _opName, finished, event);
+        }
+        if (_live) {
+            _live->record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                              typename ClockSource::duration(event.duration))
+                              .count(),
+                          event);
+        }
+        if (_sampler && !_sampler->sample(finished, event)) {
+            return;
+        }
+        if (_buckets) {
+            if (auto bucket = _buckets->add(_actorName, _opName, finished, event); bucket) {
+                this->recordEvent(bucket->first, std::move(bucket->second));
+            }
+            return;
+        }
+        this->recordEvent(finished, std::move(event));
+    }
+
+    /**
+     * Record an event, or a sample or sum of events, to the formats that keep every event.
+     */
+    void recordEvent(time_point finished, OperationEventT<ClockSource>&& event) {
+        if (_arrow) {
+            _arrow->record(finished, event);
+        }
+        if (_spill) {
+            using std::chrono::duration_cast;
+            using std::chrono::nanoseconds;
+            _spill->append(v1::SpilledEvent{
+                duration_cast<nanoseconds>(finished.time_since_epoch()).count(),
+                duration_cast<nanoseconds>(typename ClockSource::duration(event.duration))
+                    .count(),
+                event.number,
+                event.ops,
+                event.errors,
+                event.size,
+                _spillIndex,
+                static_cast<uint8_t>(event.outcome)});
+        }
+        if (_stream) {
+            _stream->addAt(
+                finished, std::move(event), _registry.getWorkerCount(_actorName, _opName));
+        }
+        if (_useCsv && !_spill) {
+            _events->addAt(finished, event);
+        }
+    }
+
     /*
      * Actor count and phase number will be used in Poplar metrics. Right now they
      * are unused.
@@ -267,6 +553,20 @@ private:
     StreamPtr _stream;  // Streams are owned by the grpc client.
     OptionalOperationThreshold _threshold;
     std::unique_ptr<EventSeries> _events;
+    std::unique_ptr<v1::HistogramWindow<ClockSource>> _histogram;
+    std::unique_ptr<v1::ArrowRecorder<ClockSource>> _arrow;
+    std::unique_ptr<v1::LiveStats> _live;
+    std::unique_ptr<Sampler> _sampler;
+    std::unique_ptr<Buckets> _buckets;
+    // Owned by the registry's EventSpill.
+    v1::SpillWriter* _spill = nullptr;
+    uint32_t _spillIndex = 0;
+
+    // Owned by the registry. Only set for Actors with open-loop phases.
+    OperationImpl<ClockSource>* _serviceTime = nullptr;
+
+    // Owned by the registry. Only set if `Metrics: Overhead` is on.
+    v1::Overhead* _overhead = nullptr;
 };
 
 /**
@@ -280,11 +580,12 @@ public:
     using time_point = typename ClockSource::time_point;
 
     explicit OperationContextT(internals::OperationImpl<ClockSource>* op)
-        : _op{op}, _started{ClockSource::now()} {}
+        : _op{op}, _started{ClockSource::now()}, _intendedStart{takeIntendedStart(_started)} {}
 
     OperationContextT(OperationContextT<ClockSource>&& other) noexcept
         : _op{std::move(other._op)},
           _started{std::move(other._started)},
+          _intendedStart{std::move(other._intendedStart)},
           _event{std::move(other._event)},
           _isClosed{std::exchange(other._isClosed, true)} {}
 
@@ -356,9 +657,20 @@ public:
     }
 
 private:
+    static std::optional<time_point> takeIntendedStart(time_point started) {
+        // Only the real clock source shares a time_point type with the PhaseLoop's schedule.
+        if constexpr (std::is_same_v<time_point, internals::v1::IntendedStart::time_point>) {
+            if (auto intended = internals::v1::IntendedStart::take()) {
+                // Can't have been scheduled to start after we actually started.
+                return std::min(*intended, started);
+            }
+        }
+        return std::nullopt;
+    }
+
     void reportOutcome(OutcomeType outcome) {
         auto finished = ClockSource::now();
-        _event.duration = finished - _started;
+        _event.duration = finished - (_intendedStart ? *_intendedStart : _started);
         _event.outcome = outcome;
 
         if (_event.ops == 0) {
@@ -367,13 +679,21 @@ private:
             _event.ops = 1;
         }
 
-        _op->reportAt(_started, finished, std::move(_event));
+        if (_intendedStart) {
+            _op->reportAt(*_intendedStart, _started, finished, std::move(_event));
+        } else {
+            _op->reportAt(_started, finished, std::move(_event));
+        }
+        _op->addOverhead(finished);
         _isClosed = true;
     }
 
     internals::OperationImpl<ClockSource>* const _op;
     const time_point _started;
 
+    // Set if started in an open-loop phase.
+    const std::optional<time_point> _intendedStart;
+
     OperationEventT<ClockSource> _event;
     bool _isClosed = false;
 };
@@ -0,0 +1,624 @@
+// Copyright 2022-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef HEADER_59A2317E_19FA_43F5_B4D3_C7A85086A8CB_INCLUDED
+#define HEADER_59A2317E_19FA_43F5_B4D3_C7A85086A8CB_INCLUDED
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/core/noncopyable.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/log/trivial.hpp>
+
+#include <gennylib/Actor.hpp>
+
+namespace genny::metrics::internals::v1 {
+
+/**
+ * How the `arrow` metrics format writes operations.
+ */
+struct ArrowOptions {
+    // Each thread buffers this many events per operation before writing them as a record batch.
+    size_t batchRows = 4096;
+
+    // Appended to `<Actor>.<Operation>` to get the file an operation is written to.
+    std::string extension = ".arrow";
+};
+
+/**
+ * Builds a FlatBuffer, the serialization Arrow uses for its metadata, back to front like the
+ * reference FlatBufferBuilder does: objects are added before the objects that refer to them and
+ * offsets are counted from the end of the buffer.
+ *
+ * Only what the Arrow IPC metadata needs is supported.
+ */
+class FlatBufferBuilder {
+public:
+    using Offset = uint32_t;
+
+    template <typename T>
+    void addScalar(int field, T value) {
+        push(value);
+        _fields.emplace_back(field, size());
+    }
+
+    void addOffset(int field, Offset offset) {
+        push(referTo(offset));
+        _fields.emplace_back(field, size());
+    }
+
+    void startTable() {
+        _fields.clear();
+        _tableStart = size();
+    }
+
+    Offset endTable() {
+        // Filled in with the distance to the vtable once it's written.
+        push(int32_t{0});
+        const auto table = size();
+
+        int fieldCount = 0;
+        for (const auto& [field, at] : _fields) {
+            fieldCount = std::max(fieldCount, field + 1);
+        }
+        std::vector<uint16_t> vtable(size_t(2 + fieldCount), 0);
+        vtable[0] = uint16_t(vtable.size() * sizeof(uint16_t));
+        vtable[1] = uint16_t(table - _tableStart);
+        for (const auto& [field, at] : _fields) {
+            vtable[size_t(2 + field)] = uint16_t(table - at);
+        }
+        for (auto it = vtable.rbegin(); it != vtable.rend(); ++it) {
+            push(*it);
+        }
+
+        const int32_t toVtable = int32_t(size() - table);
+        std::memcpy(&_data[_data.size() - table], &toVtable, sizeof(toVtable));
+        _fields.clear();
+        return table;
+    }
+
+    Offset createString(const std::string& value) {
+        preAlign(value.size() + 1, sizeof(uint32_t));
+        prepend(std::string(1, '\0'));
+        prepend(value);
+        push(uint32_t(value.size()));
+        return size();
+    }
+
+    Offset createOffsetVector(const std::vector<Offset>& offsets) {
+        preAlign(offsets.size() * sizeof(Offset), sizeof(Offset));
+        for (auto it = offsets.rbegin(); it != offsets.rend(); ++it) {
+            push(referTo(*it));
+        }
+        push(uint32_t(offsets.size()));
+        return size();
+    }
+
+    /**
+     * @param structs the little-endian bytes of `count` structs with the given alignment.
+     */
+    Offset createStructVector(const std::string& structs, size_t count, size_t alignment) {
+        preAlign(structs.size(), sizeof(uint32_t));
+        preAlign(structs.size(), alignment);
+        prepend(structs);
+        push(uint32_t(count));
+        return size();
+    }
+
+    std::string finish(Offset root) {
+        preAlign(sizeof(Offset), _minAlign);
+        push(referTo(root));
+        return _data;
+    }
+
+private:
+    uint32_t size() const {
+        return uint32_t(_data.size());
+    }
+
+    // Pad so the buffer is aligned to `alignment` once `length` more bytes are added.
+    void preAlign(size_t length, size_t alignment) {
+        _minAlign = std::max(_minAlign, alignment);
+        const auto padding = (~(_data.size() + length) + 1) & (alignment - 1);
+        prepend(std::string(padding, '\0'));
+    }
+
+    template <typename T>
+    void push(T value) {
+        preAlign(sizeof(T), sizeof(T));
+        std::string bytes(sizeof(T), '\0');
+        std::memcpy(&bytes[0], &value, sizeof(T));
+        prepend(bytes);
+    }
+
+    uint32_t referTo(Offset offset) {
+        preAlign(sizeof(Offset), sizeof(Offset));
+        return size() - offset + uint32_t(sizeof(Offset));
+    }
+
+    void prepend(const std::string& bytes) {
+        _data.insert(0, bytes);
+    }
+
+    // Metadata is small so prepending to a string is cheap enough.
+    std::string _data;
+    size_t _minAlign = 1;
+    uint32_t _tableStart = 0;
+    std::vector<std::pair<int, uint32_t>> _fields;
+};
+
+/**
+ * One thread's events of one operation that haven't been written yet, column by column.
+ */
+struct ArrowBatch {
+    std::vector<int64_t> timestamps;
+    std::vector<int64_t> durations;
+    std::vector<uint8_t> outcomes;
+    std::vector<int64_t> numbers;
+    std::vector<int64_t> ops;
+    std::vector<int64_t> errors;
+    std::vector<int64_t> sizes;
+
+    size_t rows() const {
+        return timestamps.size();
+    }
+
+    void clear() {
+        timestamps.clear();
+        durations.clear();
+        outcomes.clear();
+        numbers.clear();
+        ops.clear();
+        errors.clear();
+        sizes.clear();
+    }
+};
+
+/**
+ * An Arrow IPC file (also known as Feather V2) of one operation's events, so analysis tools can
+ * memory-map it and read only the columns they need. The columns are:
+ *
+ * | column      | type                            |
+ * |-------------|---------------------------------|
+ * | `timestamp` | timestamp[ns, UTC], when it finished |
+ * | `actor`     | dictionary<int32, utf8>         |
+ * | `operation` | dictionary<int32, utf8>         |
+ * | `thread`    | uint32                          |
+ * | `duration`  | duration[ns]                    |
+ * | `outcome`   | uint8, 0 success, 1 failure, 2 unknown |
+ * | `n`, `ops`, `errors`, `size` | int64          |
+ *
+ * Each record batch is one thread's next `batchRows` events, so batches are in time order per
+ * thread but not across threads. The actor and operation dictionaries only have one entry and
+ * are written up front. The footer that makes the file readable is written by close().
+ *
+ * write() is thread-safe since every thread running an operation writes to the operation's file.
+ *
+ * @see https://arrow.apache.org/docs/format/Columnar.html#ipc-file-format
+ */
+class ArrowFile : private boost::noncopyable {
+public:
+    ArrowFile(const boost::filesystem::path& path, std::string actorName, std::string opName)
+        : _path{path}, _actorName{std::move(actorName)}, _opName{std::move(opName)} {
+        if (_path.has_parent_path()) {
+            boost::filesystem::create_directories(_path.parent_path());
+        }
+        _out.open(_path.string(),
+                  std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+        if (!_out) {
+            throw std::runtime_error("Couldn't open Arrow file " + _path.string());
+        }
+        writeBytes(std::string(kMagic, sizeof(kMagic)));
+
+        FlatBufferBuilder schema;
+        const auto header = addSchema(schema);
+        writeMessage(finishMessage(schema, kSchemaHeader, header, 0), {});
+
+        _dictionaries.push_back(writeDictionary(kActorDictionary, _actorName));
+        _dictionaries.push_back(writeDictionary(kOperationDictionary, _opName));
+    }
+
+    ~ArrowFile() {
+        try {
+            close();
+        } catch (const std::exception& x) {
+            BOOST_LOG_TRIVIAL(error) << x.what();
+        }
+    }
+
+    void write(ActorId thread, const ArrowBatch& batch) {
+        const auto rows = batch.rows();
+        if (rows == 0) {
+            return;
+        }
+        Body body;
+        body.column(batch.timestamps);
+        body.column(std::vector<int32_t>(rows, 0));
+        body.column(std::vector<int32_t>(rows, 0));
+        body.column(std::vector<uint32_t>(rows, thread));
+        body.column(batch.durations);
+        body.column(batch.outcomes);
+        body.column(batch.numbers);
+        body.column(batch.ops);
+        body.column(batch.errors);
+        body.column(batch.sizes);
+
+        FlatBufferBuilder message;
+        const auto header = addRecordBatch(message, int64_t(rows), body);
+
+        std::lock_guard<std::mutex> lk{_mutex};
+        if (!_out.is_open()) {
+            return;
+        }
+        _recordBatches.push_back(writeMessage(
+            finishMessage(message, kRecordBatchHeader, header, body.data.size()), body.data));
+    }
+
+    /**
+     * Write the footer. Batches written after this are ignored.
+     */
+    void close() {
+        std::lock_guard<std::mutex> lk{_mutex};
+        if (!_out.is_open()) {
+            return;
+        }
+        // End-of-stream marker so the file can also be read as a stream.
+        writeUint32(kContinuation);
+        writeUint32(0);
+
+        FlatBufferBuilder footer;
+        const auto schema = addSchema(footer);
+        const auto dictionaries = addBlocks(footer, _dictionaries);
+        const auto recordBatches = addBlocks(footer, _recordBatches);
+        footer.startTable();
+        footer.addScalar(0, kMetadataVersion);
+        footer.addOffset(1, schema);
+        footer.addOffset(2, dictionaries);
+        footer.addOffset(3, recordBatches);
+        const auto bytes = footer.finish(footer.endTable());
+        writeBytes(bytes);
+        writeUint32(uint32_t(bytes.size()));
+        writeBytes(std::string(kMagic, 6));
+        _out.close();
+        if (!_out) {
+            throw std::runtime_error("Couldn't write Arrow file " + _path.string());
+        }
+    }
+
+private:
+    static constexpr char kMagic[8] = {'A', 'R', 'R', 'O', 'W', '1', '\0', '\0'};
+    static constexpr uint32_t kContinuation = 0xFFFFFFFF;
+    static constexpr int16_t kMetadataVersion = 4;  // V5.
+
+    // MessageHeader union.
+    static constexpr uint8_t kSchemaHeader = 1;
+    static constexpr uint8_t kDictionaryBatchHeader = 2;
+    static constexpr uint8_t kRecordBatchHeader = 3;
+
+    // Type union.
+    static constexpr uint8_t kIntType = 2;
+    static constexpr uint8_t kUtf8Type = 5;
+    static constexpr uint8_t kTimestampType = 10;
+    static constexpr uint8_t kDurationType = 18;
+
+    static constexpr int16_t kNanosecond = 3;
+    static constexpr int64_t kActorDictionary = 0;
+    static constexpr int64_t kOperationDictionary = 1;
+
+    // Where a message is in the file, for the footer.
+    struct Block {
+        int64_t offset;
+        int32_t metadataLength;
+        int64_t bodyLength;
+    };
+
+    // The buffers of a record batch, each aligned to 8 bytes.
+    struct Body {
+        std::string data;
+        // FieldNode structs: length, null count.
+        std::vector<std::pair<int64_t, int64_t>> nodes;
+        // Buffer structs: offset, length.
+        std::vector<std::pair<int64_t, int64_t>> buffers;
+
+        template <typename T>
+        void column(const std::vector<T>& values) {
+            nodes.emplace_back(int64_t(values.size()), 0);
+            // Nothing is null so the validity bitmap can be left out.
+            buffers.emplace_back(int64_t(data.size()), 0);
+            buffer(values.data(), values.size() * sizeof(T));
+        }
+
+        void buffer(const void* bytes, size_t length) {
+            buffers.emplace_back(int64_t(data.size()), int64_t(length));
+            data.append(static_cast<const char*>(bytes), length);
+            data.append((8 - data.size() % 8) % 8, '\0');
+        }
+    };
+
+    template <typename T>
+    static void appendLittleEndian(std::string& out, T value) {
+        char bytes[sizeof(T)];
+        std::memcpy(bytes, &value, sizeof(T));
+        out.append(bytes, sizeof(T));
+    }
+
+    static FlatBufferBuilder::Offset addInt(FlatBufferBuilder& builder, int bits, bool isSigned) {
+        builder.startTable();
+        builder.addScalar(0, int32_t(bits));
+        builder.addScalar(1, uint8_t(isSigned));
+        return builder.endTable();
+    }
+
+    static FlatBufferBuilder::Offset addField(FlatBufferBuilder& builder,
+                                              const std::string& name,
+                                              uint8_t typeType,
+                                              FlatBufferBuilder::Offset type,
+                                              std::optional<int64_t> dictionary = std::nullopt) {
+        const auto nameOffset = builder.createString(name);
+        const auto children = builder.createOffsetVector({});
+        std::optional<FlatBufferBuilder::Offset> encoding;
+        if (dictionary) {
+            const auto indexType = addInt(builder, 32, true);
+            builder.startTable();
+            builder.addScalar(0, *dictionary);
+            builder.addOffset(1, indexType);
+            encoding = builder.endTable();
+        }
+        builder.startTable();
+        builder.addOffset(0, nameOffset);
+        builder.addScalar(1, uint8_t{0});  // Not nullable.
+        builder.addScalar(2, typeType);
+        builder.addOffset(3, type);
+        if (encoding) {
+            builder.addOffset(4, *encoding);
+        }
+        builder.addOffset(5, children);
+        return builder.endTable();
+    }
+
+    static FlatBufferBuilder::Offset addUtf8(FlatBufferBuilder& builder) {
+        builder.startTable();
+        return builder.endTable();
+    }
+
+    static FlatBufferBuilder::Offset addSchema(FlatBufferBuilder& builder) {
+        std::vector<FlatBufferBuilder::Offset> fields;
+
+        const auto utc = builder.createString("UTC");
+        builder.startTable();
+        builder.addScalar(0, kNanosecond);
+        builder.addOffset(1, utc);
+        fields.push_back(addField(builder, "timestamp", kTimestampType, builder.endTable()));
+
+        fields.push_back(
+            addField(builder, "actor", kUtf8Type, addUtf8(builder), kActorDictionary));
+        fields.push_back(
+            addField(builder, "operation", kUtf8Type, addUtf8(builder), kOperationDictionary));
+        fields.push_back(addField(builder, "thread", kIntType, addInt(builder, 32, false)));
+
+        builder.startTable();
+        builder.addScalar(0, kNanosecond);
+        fields.push_back(addField(builder, "duration", kDurationType, builder.endTable()));
+
+        fields.push_back(addField(builder, "outcome", kIntType, addInt(builder, 8, false)));
+        for (const auto name : {"n", "ops", "errors", "size"}) {
+            fields.push_back(addField(builder, name, kIntType, addInt(builder, 64, true)));
+        }
+
+        const auto fieldVector = builder.createOffsetVector(fields);
+        builder.startTable();
+        builder.addOffset(1, fieldVector);
+        return builder.endTable();
+    }
+
+    static FlatBufferBuilder::Offset addRecordBatch(FlatBufferBuilder& builder,
+                                                    int64_t rows,
+                                                    const Body& body) {
+        std::string nodes;
+        for (const auto& [length, nulls] : body.nodes) {
+            appendLittleEndian(nodes, length);
+            appendLittleEndian(nodes, nulls);
+        }
+        std::string buffers;
+        for (const auto& [offset, length] : body.buffers) {
+            appendLittleEndian(buffers, offset);
+            appendLittleEndian(buffers, length);
+        }
+        const auto nodeVector = builder.createStructVector(nodes, body.nodes.size(), 8);
+        const auto bufferVector = builder.createStructVector(buffers, body.buffers.size(), 8);
+        builder.startTable();
+        builder.addScalar(0, rows);
+        builder.addOffset(1, nodeVector);
+        builder.addOffset(2, bufferVector);
+        return builder.endTable();
+    }
+
+    static FlatBufferBuilder::Offset addBlocks(FlatBufferBuilder& builder,
+                                               const std::vector<Block>& blocks) {
+        std::string bytes;
+        for (const auto& block : blocks) {
+            appendLittleEndian(bytes, block.offset);
+            appendLittleEndian(bytes, block.metadataLength);
+            appendLittleEndian(bytes, int32_t{0});  // Padding.
+            appendLittleEndian(bytes, block.bodyLength);
+        }
+        return builder.createStructVector(bytes, blocks.size(), 8);
+    }
+
+    static std::string finishMessage(FlatBufferBuilder& builder,
+                                     uint8_t headerType,
+                                     FlatBufferBuilder::Offset header,
+                                     size_t bodyLength) {
+        builder.startTable();
+        builder.addScalar(0, kMetadataVersion);
+        builder.addScalar(1, headerType);
+        builder.addOffset(2, header);
+        builder.addScalar(3, int64_t(bodyLength));
+        return builder.finish(builder.endTable());
+    }
+
+    Block writeDictionary(int64_t id, const std::string& value) {
+        Body body;
+        body.nodes.emplace_back(1, 0);
+        body.buffers.emplace_back(0, 0);
+        const int32_t offsets[] = {0, int32_t(value.size())};
+        body.buffer(offsets, sizeof(offsets));
+        body.buffer(value.data(), value.size());
+
+        FlatBufferBuilder builder;
+        const auto data = addRecordBatch(builder, 1, body);
+        builder.startTable();
+        builder.addScalar(0, id);
+        builder.addOffset(1, data);
+        const auto header = builder.endTable();
+        return writeMessage(
+            finishMessage(builder, kDictionaryBatchHeader, header, body.data.size()), body.data);
+    }
+
+    // Call with _mutex held once the file is open.
+    Block writeMessage(std::string metadata, const std::string& body) {
+        const auto offset = int64_t(_out.tellp());
+        // The body has to start 8-byte aligned.
+        metadata.append((8 - metadata.size() % 8) % 8, '\0');
+        writeUint32(kContinuation);
+        writeUint32(uint32_t(metadata.size()));
+        writeBytes(metadata);
+        writeBytes(body);
+        if (!_out) {
+            throw std::runtime_error("Couldn't write Arrow file " + _path.string());
+        }
+        return {offset, int32_t(metadata.size() + 8), int64_t(body.size())};
+    }
+
+    void writeUint32(uint32_t value) {
+        std::string bytes;
+        appendLittleEndian(bytes, value);
+        writeBytes(bytes);
+    }
+
+    void writeBytes(const std::string& bytes) {
+        _out.write(bytes.data(), std::streamsize(bytes.size()));
+    }
+
+    const boost::filesystem::path _path;
+    const std::string _actorName;
+    const std::string _opName;
+    std::mutex _mutex;
+    std::ofstream _out;
+    std::vector<Block> _dictionaries;
+    std::vector<Block> _recordBatches;
+};
+
+/**
+ * Every operation's ArrowFile.
+ */
+class ArrowFiles : private boost::noncopyable {
+public:
+    explicit ArrowFiles(ArrowOptions options) : _options{std::move(options)} {
+        if (_options.batchRows == 0) {
+            throw std::invalid_argument("Arrow record batches must hold some rows");
+        }
+    }
+
+    const ArrowOptions& options() const {
+        return _options;
+    }
+
+    /**
+     * @return the file for the given operation, opening it the first time.
+     */
+    ArrowFile* open(const boost::filesystem::path& directory,
+                    const std::string& actorName,
+                    const std::string& opName) {
+        const auto path = directory / (actorName + "." + opName + _options.extension);
+        std::lock_guard<std::mutex> lk{_mutex};
+        auto& file = _files[path.string()];
+        if (!file) {
+            file = std::make_unique<ArrowFile>(path, actorName, opName);
+        }
+        return file.get();
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lk{_mutex};
+        for (auto& [path, file] : _files) {
+            file->close();
+        }
+    }
+
+private:
+    const ArrowOptions _options;
+    std::mutex _mutex;
+    std::map<std::string, std::unique_ptr<ArrowFile>> _files;
+};
+
+/**
+ * The events of one operation on one thread that haven't been written to its ArrowFile yet.
+ */
+template <typename ClockSource>
+class ArrowRecorder : private boost::noncopyable {
+public:
+    using time_point = typename ClockSource::time_point;
+
+    ArrowRecorder(ArrowFile* file, ActorId thread, size_t batchRows)
+        : _file{file}, _thread{thread}, _batchRows{batchRows} {}
+
+    template <typename Event>
+    void record(time_point finished, const Event& event) {
+        using std::chrono::duration_cast;
+        using std::chrono::nanoseconds;
+        _batch.timestamps.push_back(
+            duration_cast<nanoseconds>(ClockSource::toReportTime(finished).time_since_epoch())
+                .count());
+        _batch.durations.push_back(
+            duration_cast<nanoseconds>(typename time_point::duration(event.duration)).count());
+        _batch.outcomes.push_back(static_cast<uint8_t>(event.outcome));
+        _batch.numbers.push_back(event.number);
+        _batch.ops.push_back(event.ops);
+        _batch.errors.push_back(event.errors);
+        _batch.sizes.push_back(event.size);
+        if (_batch.rows() >= _batchRows) {
+            flush();
+        }
+    }
+
+    /**
+     * Write out the events recorded since the last batch, if any.
+     */
+    void flush() {
+        _file->write(_thread, _batch);
+        _batch.clear();
+    }
+
+private:
+    ArrowFile* _file;
+    const ActorId _thread;
+    const size_t _batchRows;
+    ArrowBatch _batch;
+};
+
+}  // namespace genny::metrics::internals::v1
+
+#endif  // HEADER_59A2317E_19FA_43F5_B4D3_C7A85086A8CB_INCLUDED
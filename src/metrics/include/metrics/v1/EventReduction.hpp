@@ -0,0 +1,213 @@
+// Copyright 2022-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef HEADER_3E7EA838_A461_4D2B_B2ED_8B8243816263_INCLUDED
+#define HEADER_3E7EA838_A461_4D2B_B2ED_8B8243816263_INCLUDED
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+
+#include <boost/core/noncopyable.hpp>
+#include <boost/filesystem.hpp>
+
+#include <gennylib/Actor.hpp>
+
+#include <metrics/v1/HdrHistogram.hpp>
+#include <metrics/v1/HistogramLog.hpp>
+
+namespace genny::metrics::internals::v1 {
+
+/**
+ * How to cut down the events of an operation that runs too often to record every one.
+ * Set at most one of `sampleEvery` and `bucket`.
+ */
+struct ReductionOptions {
+    // Precision of the durations aggregated into each bucket.
+    static constexpr int kSignificantDigits = 2;
+
+    // Record one event in this many. Failed events are always recorded.
+    int64_t sampleEvery = 1;
+
+    // Record one event per bucket of this long summing the events finishing in it.
+    std::chrono::nanoseconds bucket = std::chrono::nanoseconds::zero();
+
+    // Where each bucket's durations are written. Defaults to `<Metrics Path>.buckets.csv`.
+    boost::filesystem::path bucketLogPath;
+};
+
+/**
+ * Records one event in `every` of an operation on one thread.
+ *
+ * The counts (n, ops, size and errors) and durations of the events that aren't recorded are added
+ * to the next one that is, so totals and mean durations (duration / n) stay exact.
+ */
+template <typename ClockSource, typename Event>
+class EventSampler : private boost::noncopyable {
+public:
+    using time_point = typename ClockSource::time_point;
+
+    explicit EventSampler(int64_t every) : _every{every} {}
+
+    /**
+     * @return whether to record `event`, which now includes the counts and durations of the
+     *   events skipped since the last one recorded.
+     */
+    bool sample(time_point finished, Event& event) {
+        if (++_seen < _every && !event.isFailure()) {
+            if (_skipped) {
+                addCounts(_skipped->second, event);
+            }
+            _skipped = std::make_pair(finished, event);
+            return false;
+        }
+        if (_skipped) {
+            addCounts(_skipped->second, event);
+        }
+        _skipped.reset();
+        _seen = 0;
+        return true;
+    }
+
+    /**
+     * @return the last event skipped, with the counts and durations of every event skipped since
+     *   the last one recorded, if any were.
+     */
+    std::optional<std::pair<time_point, Event>> flush() {
+        _seen = 0;
+        return std::exchange(_skipped, std::nullopt);
+    }
+
+private:
+    using duration = typename time_point::duration;
+
+    static void addCounts(const Event& from, Event& to) {
+        to.number += from.number;
+        to.ops += from.ops;
+        to.size += from.size;
+        to.errors += from.errors;
+        to.duration = duration(to.duration) + duration(from.duration);
+    }
+
+    const int64_t _every;
+    int64_t _seen = 0;
+    std::optional<std::pair<time_point, Event>> _skipped;
+};
+
+/**
+ * Sums the events of an operation on one thread that finish in the same bucket of time into one.
+ *
+ * The summed event has the bucket's total counts and duration, so totals and mean durations stay
+ * exact, and is recorded as having finished when the bucket's last event did. It's a failure if
+ * any of the bucket's events were. The bucket's HdrHistogram of durations, with its min and max,
+ * is written to a HistogramLog so percentiles aren't lost.
+ */
+template <typename ClockSource, typename Event>
+class BucketAggregator : private boost::noncopyable {
+public:
+    using time_point = typename ClockSource::time_point;
+    using Bucket = std::pair<time_point, Event>;
+
+    BucketAggregator(std::chrono::nanoseconds bucket, HistogramLog* log, ActorId thread)
+        : _bucket{std::chrono::duration_cast<duration>(bucket)},
+          _log{log},
+          _thread{thread},
+          _durations{ReductionOptions::kSignificantDigits} {}
+
+    /**
+     * Add an event.
+     *
+     * @return the previous bucket if the event finished after it.
+     */
+    std::optional<Bucket> add(const std::string& actorName,
+                              const std::string& opName,
+                              time_point finished,
+                              const Event& event) {
+        std::optional<Bucket> closed;
+        const auto since = finished.time_since_epoch();
+        if (_counters.count > 0 && (since < _start || since >= _start + _bucket)) {
+            closed = flush(actorName, opName);
+        }
+        if (_counters.count == 0) {
+            // Aligned like the histogram format's intervals so every thread's buckets line up.
+            _start = since - since % _bucket;
+        }
+        const auto eventDuration = duration(event.duration);
+        const auto nanos =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(eventDuration).count();
+        _durations.record(nanos);
+        _counters.count += 1;
+        _counters.ops += event.ops;
+        _counters.documents += event.number;
+        _counters.bytes += event.size;
+        _counters.errors += event.errors;
+        _counters.failures += event.isFailure() ? 1 : 0;
+        _counters.totalDuration += nanos;
+        _total += eventDuration;
+        _last = finished;
+        _outcome = event.outcome;
+        return closed;
+    }
+
+    /**
+     * Close the current bucket.
+     *
+     * @return the bucket as one event, if anything was added to it.
+     */
+    std::optional<Bucket> flush(const std::string& actorName, const std::string& opName) {
+        if (_counters.count == 0) {
+            return std::nullopt;
+        }
+        if (_log) {
+            const auto start = ClockSource::toReportTime(time_point{_start});
+            _log->write(
+                std::chrono::duration_cast<std::chrono::milliseconds>(start.time_since_epoch())
+                    .count(),
+                actorName,
+                opName,
+                _thread,
+                _counters,
+                _durations);
+        }
+        Event summed{_counters.documents,
+                     _counters.ops,
+                     _counters.bytes,
+                     _counters.errors,
+                     _total,
+                     _counters.failures > 0 ? decltype(_outcome)::kFailure : _outcome};
+        _counters = {};
+        _durations.reset();
+        _total = duration::zero();
+        return std::make_pair(_last, std::move(summed));
+    }
+
+private:
+    using duration = typename time_point::duration;
+
+    const duration _bucket;
+    HistogramLog* _log;
+    const ActorId _thread;
+    duration _start{};
+    IntervalCounters _counters;
+    HdrHistogram _durations;
+    duration _total = duration::zero();
+    time_point _last{};
+    decltype(Event{}.outcome) _outcome{};
+};
+
+}  // namespace genny::metrics::internals::v1
+
+#endif  // HEADER_3E7EA838_A461_4D2B_B2ED_8B8243816263_INCLUDED
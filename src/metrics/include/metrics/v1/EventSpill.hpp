@@ -0,0 +1,419 @@
+// Copyright 2022-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef HEADER_BCB17F23_E61F_49C8_A7AC_28EFE9B004AD_INCLUDED
+#define HEADER_BCB17F23_E61F_49C8_A7AC_28EFE9B004AD_INCLUDED
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <zlib.h>
+
+#include <boost/core/noncopyable.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/log/trivial.hpp>
+
+#include <gennylib/Actor.hpp>
+
+namespace genny::metrics::internals::v1 {
+
+/**
+ * How the cedar CSV formats keep events out of memory until the end of the run.
+ */
+struct SpillOptions {
+    // Where the segment files go. Removed along with the EventSpill.
+    boost::filesystem::path directory;
+
+    // Deflate each block before writing it.
+    bool compress = false;
+
+    // How much each Actor thread buffers before writing a block.
+    size_t bufferBytes = 256 * 1024;
+};
+
+/**
+ * One operation as it's written to a segment. Segments are only ever read back by the process
+ * that wrote them so the struct is written as-is.
+ */
+struct SpilledEvent {
+    // Nanoseconds since the metrics clock's epoch.
+    int64_t finished;
+    int64_t duration;
+    int64_t number;
+    int64_t ops;
+    int64_t errors;
+    int64_t size;
+    // Which of the EventSpill's operations this is.
+    uint32_t operation;
+    uint8_t outcome;
+};
+
+static_assert(std::is_trivially_copyable_v<SpilledEvent>);
+
+/**
+ * Buffers the events of one Actor thread and appends them to its segment files a block at a
+ * time.
+ *
+ * Each block is sorted by finish time before it's written. Events usually finish in the order
+ * they're reported, so a block that starts before the previous one ended is rare; when it
+ * happens the block starts a new segment so every segment stays sorted for the merge.
+ *
+ * A segment is a sequence of blocks, each a uint32 size of the events, a uint32 size of what was
+ * written (equal if it wasn't compressed) and then the (possibly deflated) events.
+ */
+class SpillWriter : private boost::noncopyable {
+public:
+    SpillWriter(const SpillOptions& options, ActorId thread)
+        : _options{options},
+          _prefix{(_options.directory / std::to_string(thread)).string()},
+          _capacity{std::max<size_t>(1, _options.bufferBytes / sizeof(SpilledEvent))} {}
+
+    /**
+     * Thread-safe, though only the Actor's own thread writes to it outside of setup.
+     */
+    void append(const SpilledEvent& event) {
+        std::lock_guard<std::mutex> lk{_mutex};
+        if (_buffer.capacity() == 0) {
+            // Allocated on first use so operations that are never run cost nothing.
+            _buffer.reserve(_capacity);
+        }
+        _buffer.push_back(event);
+        if (_buffer.size() >= _capacity) {
+            writeBlock();
+        }
+    }
+
+    /**
+     * Write out whatever is buffered so the segments can be read.
+     */
+    void flush() {
+        std::lock_guard<std::mutex> lk{_mutex};
+        writeBlock();
+        if (_out.is_open()) {
+            _out.flush();
+        }
+    }
+
+    const std::vector<std::string>& segments() const {
+        return _segments;
+    }
+
+private:
+    // Call with _mutex held.
+    void writeBlock() {
+        if (_buffer.empty()) {
+            return;
+        }
+        const auto byFinish = [](const SpilledEvent& lhs, const SpilledEvent& rhs) {
+            return lhs.finished < rhs.finished;
+        };
+        if (!std::is_sorted(_buffer.begin(), _buffer.end(), byFinish)) {
+            std::stable_sort(_buffer.begin(), _buffer.end(), byFinish);
+        }
+        if (!_out.is_open() || _buffer.front().finished < _lastFinished) {
+            nextSegment();
+        }
+        _lastFinished = _buffer.back().finished;
+
+        const auto* raw = reinterpret_cast<const char*>(_buffer.data());
+        const auto rawSize = uint32_t(_buffer.size() * sizeof(SpilledEvent));
+        const char* stored = raw;
+        auto storedSize = uLongf(rawSize);
+        if (_options.compress) {
+            storedSize = compressBound(rawSize);
+            _compressed.resize(storedSize);
+            if (compress2(reinterpret_cast<Bytef*>(_compressed.data()),
+                          &storedSize,
+                          reinterpret_cast<const Bytef*>(raw),
+                          rawSize,
+                          Z_BEST_SPEED) != Z_OK) {
+                throw std::runtime_error("Couldn't compress metrics spilled to " + _prefix);
+            }
+            stored = _compressed.data();
+        }
+        const uint32_t header[2] = {rawSize, uint32_t(storedSize)};
+        _out.write(reinterpret_cast<const char*>(header), sizeof(header));
+        _out.write(stored, std::streamsize(storedSize));
+        if (!_out) {
+            throw std::runtime_error("Couldn't spill metrics to " + _segments.back());
+        }
+        _buffer.clear();
+    }
+
+    void nextSegment() {
+        if (_out.is_open()) {
+            _out.close();
+        }
+        _segments.push_back(_prefix + "." + std::to_string(_segments.size()) + ".seg");
+        _out.open(_segments.back(), std::ofstream::binary | std::ofstream::trunc);
+        if (!_out) {
+            throw std::runtime_error("Couldn't spill metrics to " + _segments.back());
+        }
+    }
+
+    const SpillOptions& _options;
+    const std::string _prefix;
+    const size_t _capacity;
+    std::mutex _mutex;
+    std::vector<SpilledEvent> _buffer;
+    std::vector<char> _compressed;
+    std::ofstream _out;
+    std::vector<std::string> _segments;
+    int64_t _lastFinished = 0;
+};
+
+/**
+ * Reads a segment's events in order from a memory-mapped file.
+ */
+class SpillSegmentReader : private boost::noncopyable {
+public:
+    explicit SpillSegmentReader(const std::string& path) : _path{path} {
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        struct stat st {};
+        if (fd < 0 || ::fstat(fd, &st) != 0) {
+            const auto error = std::string{std::strerror(errno)};
+            if (fd >= 0) {
+                ::close(fd);
+            }
+            throw std::runtime_error("Couldn't read spilled metrics from " + path + ": " + error);
+        }
+        _size = size_t(st.st_size);
+        if (_size > 0) {
+            void* mapped = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped == MAP_FAILED) {
+                const auto error = std::string{std::strerror(errno)};
+                ::close(fd);
+                throw std::runtime_error("Couldn't map spilled metrics in " + path + ": " + error);
+            }
+            _data = static_cast<const char*>(mapped);
+            ::madvise(mapped, _size, MADV_SEQUENTIAL);
+        }
+        ::close(fd);
+        next();
+    }
+
+    ~SpillSegmentReader() {
+        if (_data) {
+            ::munmap(const_cast<char*>(_data), _size);
+        }
+    }
+
+    bool done() const {
+        return _done;
+    }
+
+    const SpilledEvent& current() const {
+        return _current;
+    }
+
+    void next() {
+        if (_blockAt >= _blockEnd && !nextBlock()) {
+            _done = true;
+            return;
+        }
+        // Blocks aren't necessarily aligned so copy the event out.
+        std::memcpy(&_current, _block + _blockAt, sizeof(SpilledEvent));
+        _blockAt += sizeof(SpilledEvent);
+    }
+
+private:
+    bool nextBlock() {
+        uint32_t header[2];
+        if (_offset + sizeof(header) > _size) {
+            return false;
+        }
+        std::memcpy(header, _data + _offset, sizeof(header));
+        const auto [rawSize, storedSize] = std::make_pair(header[0], header[1]);
+        _offset += sizeof(header);
+        if (_offset + storedSize > _size || rawSize % sizeof(SpilledEvent) != 0) {
+            throw std::runtime_error("Spilled metrics in " + _path + " are truncated");
+        }
+        if (storedSize == rawSize) {
+            _block = _data + _offset;
+        } else {
+            _inflated.resize(rawSize);
+            auto inflatedSize = uLongf(rawSize);
+            if (uncompress(reinterpret_cast<Bytef*>(_inflated.data()),
+                           &inflatedSize,
+                           reinterpret_cast<const Bytef*>(_data + _offset),
+                           storedSize) != Z_OK ||
+                inflatedSize != rawSize) {
+                throw std::runtime_error("Spilled metrics in " + _path + " are corrupt");
+            }
+            _block = _inflated.data();
+        }
+        _offset += storedSize;
+        _blockAt = 0;
+        _blockEnd = rawSize;
+        return rawSize > 0 || nextBlock();
+    }
+
+    const std::string _path;
+    const char* _data = nullptr;
+    size_t _size = 0;
+    size_t _offset = 0;
+
+    const char* _block = nullptr;
+    std::vector<char> _inflated;
+    size_t _blockAt = 0;
+    size_t _blockEnd = 0;
+
+    SpilledEvent _current{};
+    bool _done = false;
+};
+
+/**
+ * Keeps the events of the cedar CSV formats in segment files on disk rather than in memory, so
+ * memory use doesn't grow with the length of the run. At the end of the run the segments are
+ * merged by finish time into the CSV's `Operations` section.
+ */
+class EventSpill : private boost::noncopyable {
+public:
+    explicit EventSpill(SpillOptions options) : _options{std::move(options)} {
+        if (_options.directory.empty()) {
+            throw std::invalid_argument("Spilled metrics need a directory");
+        }
+        boost::filesystem::create_directories(_options.directory);
+    }
+
+    ~EventSpill() {
+        boost::system::error_code ec;
+        boost::filesystem::remove_all(_options.directory, ec);
+        if (ec) {
+            BOOST_LOG_TRIVIAL(warning) << "Couldn't remove spilled metrics in "
+                                       << _options.directory << ": " << ec.message();
+        }
+    }
+
+    const SpillOptions& options() const {
+        return _options;
+    }
+
+    /**
+     * Register an operation of one thread. Call during setup.
+     *
+     * @return the writer for the thread's events and the index to write them with.
+     */
+    std::pair<SpillWriter*, uint32_t> attach(const std::string& actorName,
+                                             const std::string& opName,
+                                             ActorId thread) {
+        std::lock_guard<std::mutex> lk{_mutex};
+        auto& writer = _writers[thread];
+        if (!writer) {
+            writer = std::make_unique<SpillWriter>(_options, thread);
+        }
+        _operations.push_back({actorName, opName, thread});
+        return {writer.get(), uint32_t(_operations.size() - 1)};
+    }
+
+    /**
+     * Write out every thread's buffered events. Call once the Actors have stopped.
+     */
+    void flush() {
+        std::lock_guard<std::mutex> lk{_mutex};
+        for (auto& [thread, writer] : _writers) {
+            writer->flush();
+        }
+    }
+
+    /**
+     * Write every flushed event as a line of the cedar CSV `Operations` section, in order of
+     * finish time, skipping operations for which `skip(actorName, opName)` is true.
+     */
+    void writeCedarCsv(
+        std::ostream& out,
+        const std::function<bool(const std::string&, const std::string&)>& skip) const {
+        std::lock_guard<std::mutex> lk{_mutex};
+        std::vector<bool> skipped;
+        for (const auto& operation : _operations) {
+            skipped.push_back(skip(operation.actorName, operation.opName));
+        }
+
+        std::vector<std::unique_ptr<SpillSegmentReader>> readers;
+        for (const auto& [thread, writer] : _writers) {
+            for (const auto& segment : writer->segments()) {
+                readers.push_back(std::make_unique<SpillSegmentReader>(segment));
+            }
+        }
+        // A min-heap of the readers by their next event.
+        const auto later = [&](size_t lhs, size_t rhs) {
+            const auto& left = readers[lhs]->current();
+            const auto& right = readers[rhs]->current();
+            return left.finished > right.finished ||
+                (left.finished == right.finished && lhs > rhs);
+        };
+        std::priority_queue<size_t, std::vector<size_t>, decltype(later)> heap{later};
+        for (size_t i = 0; i < readers.size(); ++i) {
+            if (!readers[i]->done()) {
+                heap.push(i);
+            }
+        }
+
+        while (!heap.empty()) {
+            const auto i = heap.top();
+            heap.pop();
+            const auto& event = readers[i]->current();
+            if (event.operation >= _operations.size()) {
+                throw std::runtime_error("Spilled metrics refer to an unknown operation");
+            }
+            if (!skipped[event.operation]) {
+                const auto& operation = _operations[event.operation];
+                out << event.finished << ',' << operation.actorName << ',' << operation.thread
+                    << ',' << operation.opName << ',' << event.duration << ','
+                    << unsigned(event.outcome) << ',' << event.number << ',' << event.ops << ','
+                    << event.errors << ',' << event.size << '\n';
+            }
+            readers[i]->next();
+            if (!readers[i]->done()) {
+                heap.push(i);
+            }
+        }
+        out.flush();
+    }
+
+private:
+    struct Operation {
+        std::string actorName;
+        std::string opName;
+        ActorId thread;
+    };
+
+    const SpillOptions _options;
+    mutable std::mutex _mutex;
+    std::unordered_map<ActorId, std::unique_ptr<SpillWriter>> _writers;
+    std::vector<Operation> _operations;
+};
+
+}  // namespace genny::metrics::internals::v1
+
+#endif  // HEADER_BCB17F23_E61F_49C8_A7AC_28EFE9B004AD_INCLUDED
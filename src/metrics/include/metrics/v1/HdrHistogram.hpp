@@ -0,0 +1,290 @@
+// Copyright 2022-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef HEADER_D1C4DE46_87B1_47D9_9F73_BF1E75B9E595_INCLUDED
+#define HEADER_D1C4DE46_87B1_47D9_9F73_BF1E75B9E595_INCLUDED
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace genny::metrics::internals::v1 {
+
+/**
+ * A High Dynamic Range histogram of non-negative integer values (nanoseconds in practice).
+ *
+ * Values are recorded with `significantDigits` decimal digits of precision: any value reported
+ * back (e.g. by valueAtPercentile()) is within 1 part in 10^significantDigits of a recorded one.
+ * Values from 0 to `highestTrackable` are tracked in a fixed number of buckets, so the memory
+ * used only depends on the precision and range, never on how many values are recorded.
+ * Larger values are counted as `highestTrackable` but still show up in max().
+ *
+ * This uses the same bucket layout as HdrHistogram so the counts are interchangeable with it.
+ * It isn't thread-safe; give each thread its own and add() them together.
+ *
+ * @see http://hdrhistogram.org
+ */
+class HdrHistogram {
+public:
+    static constexpr int64_t kDefaultHighestTrackable = 3600LL * 1000 * 1000 * 1000;  // 1 hour.
+
+    explicit HdrHistogram(int significantDigits = 3,
+                          int64_t highestTrackable = kDefaultHighestTrackable)
+        : _significantDigits{significantDigits}, _highestTrackable{highestTrackable} {
+        if (significantDigits < 1 || significantDigits > 5) {
+            throw std::invalid_argument("Histogram significant digits must be between 1 and 5");
+        }
+        if (highestTrackable < 2) {
+            throw std::invalid_argument("Histogram must be able to track values above 1");
+        }
+        int64_t singleUnitResolution = 2;
+        for (int i = 0; i < significantDigits; ++i) {
+            singleUnitResolution *= 10;
+        }
+        const auto subBucketCountMagnitude =
+            int(std::ceil(std::log2(double(singleUnitResolution))));
+        _subBucketHalfCountMagnitude = subBucketCountMagnitude - 1;
+        _subBucketCount = int64_t{1} << subBucketCountMagnitude;
+        _subBucketHalfCount = _subBucketCount / 2;
+        _subBucketMask = _subBucketCount - 1;
+
+        int64_t smallestUntrackable = _subBucketCount;
+        int bucketCount = 1;
+        while (smallestUntrackable <= highestTrackable) {
+            if (smallestUntrackable > std::numeric_limits<int64_t>::max() / 2) {
+                ++bucketCount;
+                break;
+            }
+            smallestUntrackable <<= 1;
+            ++bucketCount;
+        }
+        _countsLength = size_t(bucketCount + 1) * size_t(_subBucketHalfCount);
+    }
+
+    void record(int64_t value, uint64_t count = 1) {
+        value = std::max<int64_t>(value, 0);
+        if (_total == 0) {
+            _min = value;
+            _max = value;
+        } else {
+            _min = std::min(_min, value);
+            _max = std::max(_max, value);
+        }
+        recordAtIndex(indexOf(std::min(value, _highestTrackable)), count);
+    }
+
+    /**
+     * Add the counts of a histogram with the same precision and range.
+     */
+    void add(const HdrHistogram& other) {
+        if (other._countsLength != _countsLength) {
+            throw std::invalid_argument("Can't add histograms with different bucket layouts");
+        }
+        if (other._total == 0) {
+            return;
+        }
+        for (size_t i = other._minIndex; i <= other._maxIndex; ++i) {
+            if (other._counts[i] != 0) {
+                recordAtIndex(i, other._counts[i]);
+            }
+        }
+        _min = _total == other._total ? other._min : std::min(_min, other._min);
+        _max = std::max(_max, other._max);
+    }
+
+    /**
+     * Forget every recorded value. Keeps the memory for the counts.
+     */
+    void reset() {
+        if (_total != 0) {
+            std::fill(_counts.begin() + _minIndex, _counts.begin() + _maxIndex + 1, 0);
+        }
+        _total = 0;
+        _min = 0;
+        _max = 0;
+    }
+
+    uint64_t totalCount() const {
+        return _total;
+    }
+
+    int64_t min() const {
+        return _min;
+    }
+
+    int64_t max() const {
+        return _max;
+    }
+
+    int significantDigits() const {
+        return _significantDigits;
+    }
+
+    /**
+     * @return the largest value equivalent to the one at the given percentile, or 0 if nothing
+     *   has been recorded. p100 is max().
+     */
+    int64_t valueAtPercentile(double percentile) const {
+        if (_total == 0) {
+            return 0;
+        }
+        if (percentile >= 100) {
+            return _max;
+        }
+        // Rounded to the nearest rank like HdrHistogram so p99.9 of 1000 values isn't thrown
+        // off by floating-point error.
+        const auto rank = std::max<uint64_t>(1, uint64_t(percentile / 100 * double(_total) + 0.5));
+        uint64_t seen = 0;
+        for (size_t i = _minIndex; i <= _maxIndex; ++i) {
+            seen += _counts[i];
+            if (seen >= rank) {
+                return std::min(highestEquivalentValue(valueFromIndex(i)), _max);
+            }
+        }
+        return _max;
+    }
+
+    /**
+     * Write the non-zero counts as space-separated `<index>:<count>` pairs. Each index after the
+     * first is relative to the one before it, which keeps sparse histograms short.
+     */
+    void encode(std::ostream& out) const {
+        if (_total == 0) {
+            return;
+        }
+        size_t previous = 0;
+        bool first = true;
+        for (size_t i = _minIndex; i <= _maxIndex; ++i) {
+            if (_counts[i] == 0) {
+                continue;
+            }
+            if (!first) {
+                out << ' ';
+            }
+            out << (i - previous) << ':' << _counts[i];
+            previous = i;
+            first = false;
+        }
+    }
+
+    /**
+     * Add counts written by encode() from a histogram with the same precision and range.
+     * min() and max() are only as precise as the buckets, so set them separately if known.
+     */
+    void decode(const std::string& encoded) {
+        std::istringstream in{encoded};
+        size_t index = 0;
+        std::string pair;
+        while (in >> pair) {
+            const auto colon = pair.find(':');
+            if (colon == std::string::npos) {
+                throw std::invalid_argument("Malformed histogram counts: " + pair);
+            }
+            index += std::stoull(pair.substr(0, colon));
+            if (index >= _countsLength) {
+                throw std::invalid_argument("Histogram counts don't fit this histogram");
+            }
+            const auto count = std::stoull(pair.substr(colon + 1));
+            const auto value = valueFromIndex(index);
+            if (_total == 0) {
+                _min = value;
+                _max = value;
+            } else {
+                _min = std::min(_min, value);
+                _max = std::max(_max, highestEquivalentValue(value));
+            }
+            recordAtIndex(index, count);
+        }
+    }
+
+    /**
+     * Override the extremes after decode().
+     */
+    void setMinMax(int64_t min, int64_t max) {
+        _min = min;
+        _max = max;
+    }
+
+private:
+    void recordAtIndex(size_t index, uint64_t count) {
+        if (_counts.empty()) {
+            // Allocated on first use so operations that are never run cost nothing.
+            _counts.resize(_countsLength, 0);
+        }
+        if (_total == 0) {
+            _minIndex = index;
+            _maxIndex = index;
+        } else {
+            _minIndex = std::min(_minIndex, index);
+            _maxIndex = std::max(_maxIndex, index);
+        }
+        _counts[index] += count;
+        _total += count;
+    }
+
+    int bucketIndexOf(int64_t value) const {
+        const auto bits = uint64_t(value) | uint64_t(_subBucketMask);
+        return 64 - __builtin_clzll(bits) - (_subBucketHalfCountMagnitude + 1);
+    }
+
+    size_t indexOf(int64_t value) const {
+        const auto bucket = bucketIndexOf(value);
+        const auto subBucket = value >> bucket;
+        return size_t((int64_t(bucket + 1) << _subBucketHalfCountMagnitude) +
+                      (subBucket - _subBucketHalfCount));
+    }
+
+    int64_t valueFromIndex(size_t index) const {
+        auto bucket = int(index >> _subBucketHalfCountMagnitude) - 1;
+        auto subBucket = int64_t(index & size_t(_subBucketHalfCount - 1)) + _subBucketHalfCount;
+        if (bucket < 0) {
+            subBucket -= _subBucketHalfCount;
+            bucket = 0;
+        }
+        return subBucket << bucket;
+    }
+
+    int64_t highestEquivalentValue(int64_t value) const {
+        const auto bucket = bucketIndexOf(value);
+        const auto subBucket = value >> bucket;
+        const auto shift = bucket + (subBucket >= _subBucketCount ? 1 : 0);
+        const auto lowest = (value >> shift) << shift;
+        return lowest + (int64_t{1} << shift) - 1;
+    }
+
+    int _significantDigits;
+    int64_t _highestTrackable;
+    int _subBucketHalfCountMagnitude;
+    int64_t _subBucketCount;
+    int64_t _subBucketHalfCount;
+    int64_t _subBucketMask;
+    size_t _countsLength;
+
+    std::vector<uint64_t> _counts;
+    uint64_t _total = 0;
+    size_t _minIndex = 0;
+    size_t _maxIndex = 0;
+    int64_t _min = 0;
+    int64_t _max = 0;
+};
+
+}  // namespace genny::metrics::internals::v1
+
+#endif  // HEADER_D1C4DE46_87B1_47D9_9F73_BF1E75B9E595_INCLUDED
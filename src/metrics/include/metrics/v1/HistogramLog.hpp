@@ -0,0 +1,323 @@
+// Copyright 2022-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef HEADER_79578F1B_336C_4E2A_B13C_E196590C05EB_INCLUDED
+#define HEADER_79578F1B_336C_4E2A_B13C_E196590C05EB_INCLUDED
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <istream>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/core/noncopyable.hpp>
+#include <boost/filesystem.hpp>
+
+#include <gennylib/Actor.hpp>
+
+#include <metrics/v1/HdrHistogram.hpp>
+
+namespace genny::metrics::internals::v1 {
+
+/**
+ * How the `histogram` metrics format aggregates operations.
+ */
+struct HistogramOptions {
+    // Precision of the recorded durations.
+    int significantDigits = 3;
+
+    // Each thread writes one line per operation per interval it ran the operation in. Zero in a
+    // log whose operations each have their own interval, such as the buckets of ReductionOptions.
+    std::chrono::nanoseconds interval = std::chrono::seconds{1};
+
+    // Where to write the interval lines. Defaults to `<Metrics Path>.intervals.csv`.
+    boost::filesystem::path logPath;
+};
+
+/**
+ * Counters kept alongside each interval's histogram of durations.
+ */
+struct IntervalCounters {
+    int64_t count = 0;
+    int64_t ops = 0;
+    int64_t documents = 0;
+    int64_t bytes = 0;
+    int64_t errors = 0;
+    int64_t failures = 0;
+    int64_t totalDuration = 0;
+
+    void add(const IntervalCounters& other) {
+        count += other.count;
+        ops += other.ops;
+        documents += other.documents;
+        bytes += other.bytes;
+        errors += other.errors;
+        failures += other.failures;
+        totalDuration += other.totalDuration;
+    }
+};
+
+/**
+ * The file the `histogram` metrics format writes to while the workload runs.
+ *
+ * The first line records the options. Every line after the column header (shown wrapped here)
+ * is one interval of one operation on one thread:
+ *
+ *     #genny-histogram-log,significant-digits=3,interval-ns=1000000000
+ *     start,actor,operation,thread,count,ops,documents,bytes,errors,failures,duration,min,max,
+ *     counts
+ *
+ * `start` is the start of the interval in milliseconds since the Unix epoch. `duration`, `min`
+ * and `max` are in nanoseconds and `counts` is the HdrHistogram of durations as written by
+ * HdrHistogram::encode().
+ *
+ * Lines are written under a lock, at most once per interval per operation per thread, so
+ * recording an operation only takes the lock when its interval rolls over.
+ */
+class HistogramLog : private boost::noncopyable {
+public:
+    static constexpr auto kMagic = "#genny-histogram-log";
+    static constexpr auto kColumns =
+        "start,actor,operation,thread,count,ops,documents,bytes,errors,failures,duration,min,max,"
+        "counts";
+
+    explicit HistogramLog(HistogramOptions options) : _options{std::move(options)} {
+        if (_options.interval < std::chrono::nanoseconds::zero()) {
+            throw std::invalid_argument("Histogram interval must not be negative");
+        }
+        // Fail now rather than when the first interval ends.
+        HdrHistogram{_options.significantDigits};
+
+        if (_options.logPath.has_parent_path()) {
+            boost::filesystem::create_directories(_options.logPath.parent_path());
+        }
+        _out.open(_options.logPath.string(), std::ofstream::out | std::ofstream::trunc);
+        if (!_out) {
+            throw std::runtime_error("Couldn't open histogram log " + _options.logPath.string());
+        }
+        _out << kMagic << ",significant-digits=" << _options.significantDigits
+             << ",interval-ns=" << _options.interval.count() << "\n"
+             << kColumns << "\n";
+    }
+
+    const HistogramOptions& options() const {
+        return _options;
+    }
+
+    void write(int64_t startMillis,
+               const std::string& actorName,
+               const std::string& opName,
+               ActorId thread,
+               const IntervalCounters& counters,
+               const HdrHistogram& durations) {
+        std::lock_guard<std::mutex> lk{_mutex};
+        if (!_out.is_open()) {
+            return;
+        }
+        _out << startMillis << ',' << actorName << ',' << opName << ',' << thread << ','
+             << counters.count << ',' << counters.ops << ',' << counters.documents << ','
+             << counters.bytes << ',' << counters.errors << ',' << counters.failures << ','
+             << counters.totalDuration << ',' << durations.min() << ',' << durations.max() << ',';
+        durations.encode(_out);
+        _out << "\n";
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lk{_mutex};
+        _out.close();
+    }
+
+private:
+    const HistogramOptions _options;
+    std::mutex _mutex;
+    std::ofstream _out;
+};
+
+/**
+ * The current interval of one operation on one thread.
+ */
+template <typename ClockSource>
+class HistogramWindow : private boost::noncopyable {
+public:
+    using time_point = typename ClockSource::time_point;
+
+    HistogramWindow(HistogramLog* log, ActorId thread)
+        : _log{log}, _thread{thread}, _durations{log->options().significantDigits} {}
+
+    template <typename Event>
+    void record(const std::string& actorName,
+                const std::string& opName,
+                time_point finished,
+                const Event& event) {
+        const auto since = finished.time_since_epoch();
+        if (_counters.count > 0 && (since < _start || since >= _start + interval())) {
+            flush(actorName, opName);
+        }
+        if (_counters.count == 0) {
+            // Intervals are aligned so every thread's lines for an interval start together.
+            _start = since - since % interval();
+        }
+        const auto nanos =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(duration(event.duration))
+                .count();
+        _durations.record(nanos);
+        _counters.count += 1;
+        _counters.ops += event.ops;
+        _counters.documents += event.number;
+        _counters.bytes += event.size;
+        _counters.errors += event.errors;
+        _counters.failures += event.isFailure() ? 1 : 0;
+        _counters.totalDuration += nanos;
+    }
+
+    /**
+     * Write out the current interval, if anything was recorded in it.
+     */
+    void flush(const std::string& actorName, const std::string& opName) {
+        if (_counters.count == 0) {
+            return;
+        }
+        const auto start = ClockSource::toReportTime(time_point{_start});
+        _log->write(
+            std::chrono::duration_cast<std::chrono::milliseconds>(start.time_since_epoch())
+                .count(),
+            actorName,
+            opName,
+            _thread,
+            _counters,
+            _durations);
+        _counters = {};
+        _durations.reset();
+    }
+
+private:
+    using duration = typename time_point::duration;
+
+    duration interval() const {
+        return std::chrono::duration_cast<duration>(_log->options().interval);
+    }
+
+    HistogramLog* _log;
+    const ActorId _thread;
+    duration _start{};
+    IntervalCounters _counters;
+    HdrHistogram _durations;
+};
+
+/**
+ * Merge every interval in a HistogramLog into one line per operation:
+ *
+ *     actor,operation,threads,count,ops,documents,bytes,errors,failures,mean,min,p50,p90,p99,
+ *     p99.9,max
+ *
+ * Durations are in nanoseconds. Lines from several logs (e.g. one per worker process) can be
+ * concatenated as long as they were written with the same options.
+ */
+inline void summarizeHistogramLog(std::istream& in, std::ostream& out) {
+    struct Summary {
+        std::set<std::string> threads;
+        IntervalCounters counters;
+        HdrHistogram durations;
+        int64_t min = 0;
+        int64_t max = 0;
+    };
+    std::map<std::pair<std::string, std::string>, Summary> summaries;
+
+    int significantDigits = 0;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line == HistogramLog::kColumns) {
+            continue;
+        }
+        if (line.rfind(HistogramLog::kMagic, 0) == 0) {
+            const auto key = std::string{",significant-digits="};
+            const auto at = line.find(key);
+            if (at == std::string::npos) {
+                throw std::invalid_argument("Malformed histogram log header: " + line);
+            }
+            const int digits = std::stoi(line.substr(at + key.size()));
+            if (significantDigits != 0 && digits != significantDigits) {
+                throw std::invalid_argument("Can't merge histogram logs of different precision");
+            }
+            significantDigits = digits;
+            continue;
+        }
+        if (significantDigits == 0) {
+            throw std::invalid_argument("Histogram log is missing its header");
+        }
+
+        std::vector<std::string> fields;
+        std::istringstream row{line};
+        for (std::string field; fields.size() < 13 && std::getline(row, field, ',');) {
+            fields.push_back(std::move(field));
+        }
+        std::string counts;
+        std::getline(row, counts);
+        if (fields.size() != 13) {
+            throw std::invalid_argument("Malformed histogram log line: " + line);
+        }
+
+        auto& summary =
+            summaries
+                .try_emplace(std::make_pair(fields[1], fields[2]),
+                             Summary{{}, {}, HdrHistogram{significantDigits}})
+                .first->second;
+        const int64_t min = std::stoll(fields[11]);
+        const int64_t max = std::stoll(fields[12]);
+        if (summary.counters.count == 0) {
+            summary.min = min;
+            summary.max = max;
+        } else {
+            summary.min = std::min(summary.min, min);
+            summary.max = std::max(summary.max, max);
+        }
+        summary.threads.insert(fields[3]);
+        summary.counters.add(IntervalCounters{std::stoll(fields[4]),
+                                              std::stoll(fields[5]),
+                                              std::stoll(fields[6]),
+                                              std::stoll(fields[7]),
+                                              std::stoll(fields[8]),
+                                              std::stoll(fields[9]),
+                                              std::stoll(fields[10])});
+        summary.durations.decode(counts);
+    }
+
+    out << "actor,operation,threads,count,ops,documents,bytes,errors,failures,mean,min,p50,p90,"
+           "p99,p99.9,max"
+        << std::endl;
+    for (auto& [key, summary] : summaries) {
+        const auto& counters = summary.counters;
+        auto& durations = summary.durations;
+        durations.setMinMax(summary.min, summary.max);
+        out << key.first << ',' << key.second << ',' << summary.threads.size() << ','
+            << counters.count << ',' << counters.ops << ',' << counters.documents << ','
+            << counters.bytes << ',' << counters.errors << ',' << counters.failures << ','
+            << (counters.count > 0 ? counters.totalDuration / counters.count : 0) << ','
+            << summary.min << ',' << durations.valueAtPercentile(50) << ','
+            << durations.valueAtPercentile(90) << ',' << durations.valueAtPercentile(99) << ','
+            << durations.valueAtPercentile(99.9) << ',' << summary.max << std::endl;
+    }
+}
+
+}  // namespace genny::metrics::internals::v1
+
+#endif  // HEADER_79578F1B_336C_4E2A_B13C_E196590C05EB_INCLUDED
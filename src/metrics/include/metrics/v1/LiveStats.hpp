@@ -0,0 +1,107 @@
+// Copyright 2022-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef HEADER_71EDB942_06BF_481C_BCF2_D25E51B3EA80_INCLUDED
+#define HEADER_71EDB942_06BF_481C_BCF2_D25E51B3EA80_INCLUDED
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+
+#include <boost/core/noncopyable.hpp>
+
+#include <metrics/v1/HdrHistogram.hpp>
+#include <metrics/v1/HistogramLog.hpp>
+
+namespace genny::metrics::internals::v1 {
+
+/**
+ * How often the driver looks at the operations while the workload runs and where it serves
+ * what it saw.
+ */
+struct LiveOptions {
+    // Precision of the live latencies. Lower than the histogram format's default since every
+    // operation on every thread keeps one.
+    static constexpr int kSignificantDigits = 2;
+
+    std::chrono::nanoseconds interval = std::chrono::seconds{10};
+
+    // Throughput and percentiles are over this many of the most recent intervals.
+    size_t window = 6;
+
+    // Serve the latest numbers over HTTP on this port. 0 picks a free one. Unset doesn't serve.
+    std::optional<uint16_t> port;
+    std::string host = "127.0.0.1";
+};
+
+/**
+ * What one operation summed over every thread running it recorded in one interval.
+ */
+struct LiveOperation {
+    std::string actorName;
+    std::string opName;
+    size_t threads = 0;
+    IntervalCounters counters;
+    HdrHistogram durations{LiveOptions::kSignificantDigits};
+};
+
+/**
+ * What one operation on one thread has recorded since the live reporter last drained it.
+ *
+ * The thread running the operation records and the live reporter drains, so both take a lock.
+ * It's only contended once per interval while the reporter drains.
+ */
+class LiveStats : private boost::noncopyable {
+public:
+    template <typename Event>
+    void record(int64_t nanos, const Event& event) {
+        std::lock_guard<std::mutex> lk{_mutex};
+        _durations.record(nanos);
+        _counters.count += 1;
+        _counters.ops += event.ops;
+        _counters.documents += event.number;
+        _counters.bytes += event.size;
+        _counters.errors += event.errors;
+        _counters.failures += event.isFailure() ? 1 : 0;
+        _counters.totalDuration += nanos;
+    }
+
+    /**
+     * Add everything recorded since the last call to `into` and forget it.
+     *
+     * @return whether anything had been recorded.
+     */
+    bool drainInto(LiveOperation& into) {
+        std::lock_guard<std::mutex> lk{_mutex};
+        if (_counters.count == 0) {
+            return false;
+        }
+        into.counters.add(_counters);
+        into.durations.add(_durations);
+        _counters = {};
+        _durations.reset();
+        return true;
+    }
+
+private:
+    std::mutex _mutex;
+    IntervalCounters _counters;
+    HdrHistogram _durations{LiveOptions::kSignificantDigits};
+};
+
+}  // namespace genny::metrics::internals::v1
+
+#endif  // HEADER_71EDB942_06BF_481C_BCF2_D25E51B3EA80_INCLUDED
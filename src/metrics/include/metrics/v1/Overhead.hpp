@@ -0,0 +1,41 @@
+// Copyright 2022-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef HEADER_E4A19C73_6B2D_4F08_8D5E_31C7A0B9F642_INCLUDED
+#define HEADER_E4A19C73_6B2D_4F08_8D5E_31C7A0B9F642_INCLUDED
+
+#include <cstdint>
+
+namespace genny::metrics::internals::v1 {
+
+/**
+ * How long one Actor thread has spent in genny's own code since it last reported it.
+ *
+ * Only that thread touches it so nothing is atomic.
+ */
+struct Overhead {
+    // Recording the operations the thread reported, from when each one finished until it had
+    // been handed to every metrics format.
+    int64_t metricsNanos = 0;
+    int64_t metricsReports = 0;
+
+    // Between the thread's iterations in the PhaseLoop, not counting the sleeps, rate limiting
+    // and arrivals it was configured to wait for.
+    int64_t pacingNanos = 0;
+    int64_t pacingIterations = 0;
+};
+
+}  // namespace genny::metrics::internals::v1
+
+#endif  // HEADER_E4A19C73_6B2D_4F08_8D5E_31C7A0B9F642_INCLUDED
@@ -0,0 +1,234 @@
+// Copyright 2022-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef HEADER_8C2F4B61_0E7D_4F3A_9B85_6A1D2E7C3F90_INCLUDED
+#define HEADER_8C2F4B61_0E7D_4F3A_9B85_6A1D2E7C3F90_INCLUDED
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include <boost/core/noncopyable.hpp>
+
+#if defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+namespace genny::metrics::internals::v1 {
+
+/**
+ * A steady_clock read from the CPU's time-stamp counter.
+ *
+ * Reading the TSC takes a few nanoseconds. steady_clock::now() usually reads it too, but in VMs
+ * whose kernel doesn't trust the TSC it falls back to a much slower clocksource. The TSC is only
+ * used if the CPU says it ticks at a constant rate, even in deep sleep states, so it's the same
+ * on every core.
+ *
+ * Ticks are converted to steady_clock nanoseconds as they're read with one multiply against a
+ * calibration measured at startup and corrected by recalibrate(), so its time_points mix freely
+ * with steady_clock's.
+ */
+class TscClock : private boost::noncopyable {
+public:
+    using time_point = std::chrono::steady_clock::time_point;
+
+    /**
+     * @return the process's TscClock, calibrated on first use, or nullptr if the CPU's TSC
+     *   isn't invariant.
+     */
+    static const TscClock* invariant() {
+        static const TscClock* clock = hasInvariantTsc() ? new TscClock() : nullptr;
+        return clock;
+    }
+
+    /**
+     * @return whether /proc/cpuinfo lists both the constant_tsc and nonstop_tsc flags.
+     */
+    static bool hasInvariantTsc() {
+#if defined(__x86_64__)
+        std::ifstream cpuinfo{"/proc/cpuinfo"};
+        for (std::string line; std::getline(cpuinfo, line);) {
+            if (line.rfind("flags", 0) != 0) {
+                continue;
+            }
+            bool constant = false;
+            bool nonstop = false;
+            std::istringstream flags{line};
+            for (std::string flag; flags >> flag;) {
+                constant = constant || flag == "constant_tsc";
+                nonstop = nonstop || flag == "nonstop_tsc";
+            }
+            return constant && nonstop;
+        }
+#endif
+        return false;
+    }
+
+    time_point now() const noexcept {
+        return time_point{std::chrono::nanoseconds{toSteadyNanos(readTsc())}};
+    }
+
+    /**
+     * Correct the rate and offset of the conversion against steady_clock.
+     *
+     * The clock never jumps. Any offset that has built up since the last call is slewed away
+     * over the next `period`, at no more than 1% of its rate. Call this from one thread only.
+     */
+    void recalibrate(std::chrono::nanoseconds period) const {
+        const auto sample = takeSample();
+        const auto converted = toSteadyNanos(sample.tsc);
+        const auto [tscFirst, nanosFirst] = _first;
+        if (sample.tsc <= tscFirst || period <= std::chrono::nanoseconds::zero()) {
+            return;
+        }
+        // The longer the baseline the more precise the rate.
+        const auto rate = rateOf(sample.tsc - tscFirst, sample.nanos - nanosFirst);
+        const auto slew = std::clamp<int64_t>(
+            sample.nanos - converted, -period.count() / 100, period.count() / 100);
+        const auto mult = uint64_t((unsigned __int128)rate * uint64_t(period.count() + slew) /
+                                   uint64_t(period.count()));
+        publish(sample.tsc, converted, mult);
+    }
+
+private:
+    // Conversions are 32.32 fixed point nanoseconds per tick.
+    static constexpr int kShift = 32;
+
+    struct Sample {
+        int64_t tsc;
+        int64_t nanos;
+    };
+
+    TscClock() {
+        const auto start = takeSample();
+        // Long enough to measure the rate to well under a part per million at GHz rates. The
+        // periodic recalibrations refine it from there.
+        std::this_thread::sleep_for(std::chrono::milliseconds{20});
+        const auto end = takeSample();
+        _first = start;
+        publish(start.tsc, start.nanos, rateOf(end.tsc - start.tsc, end.nanos - start.nanos));
+    }
+
+    static int64_t readTsc() noexcept {
+#if defined(__x86_64__)
+        return int64_t(__rdtsc());
+#else
+        return 0;
+#endif
+    }
+
+    static int64_t steadyNanos() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    int64_t toSteadyNanos(int64_t tsc) const noexcept {
+        uint64_t seq;
+        int64_t tscBase;
+        int64_t nanosBase;
+        uint64_t mult;
+        do {
+            seq = _seq.load(std::memory_order_acquire);
+            tscBase = _tscBase.load(std::memory_order_relaxed);
+            nanosBase = _nanosBase.load(std::memory_order_relaxed);
+            mult = _mult.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } while ((seq & 1) != 0 || seq != _seq.load(std::memory_order_relaxed));
+        return nanosBase + toNanos(tsc - tscBase, mult);
+    }
+
+    static int64_t toNanos(int64_t ticks, uint64_t mult) noexcept {
+        return int64_t(((__int128)ticks * mult) >> kShift);
+    }
+
+    static uint64_t rateOf(int64_t ticks, int64_t nanos) {
+        return uint64_t(((unsigned __int128)nanos << kShift) / uint64_t(ticks));
+    }
+
+    // Pair a TSC reading with a steady_clock one. Of a few tries, keep the one whose
+    // steady_clock read was least likely to have been interrupted.
+    static Sample takeSample() {
+        Sample best{};
+        int64_t bestGap = -1;
+        for (int i = 0; i < 5; ++i) {
+            const auto before = readTsc();
+            const auto nanos = steadyNanos();
+            const auto after = readTsc();
+            if (bestGap < 0 || after - before < bestGap) {
+                bestGap = after - before;
+                best = Sample{before + (after - before) / 2, nanos};
+            }
+        }
+        return best;
+    }
+
+    // A seqlock so now() sees a consistent calibration without taking a lock.
+    void publish(int64_t tscBase, int64_t nanosBase, uint64_t mult) const {
+        const auto seq = _seq.load(std::memory_order_relaxed);
+        _seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        _tscBase.store(tscBase, std::memory_order_relaxed);
+        _nanosBase.store(nanosBase, std::memory_order_relaxed);
+        _mult.store(mult, std::memory_order_relaxed);
+        _seq.store(seq + 2, std::memory_order_release);
+    }
+
+    Sample _first{};
+    mutable std::atomic<uint64_t> _seq{0};
+    mutable std::atomic<int64_t> _tscBase{0};
+    mutable std::atomic<int64_t> _nanosBase{0};
+    mutable std::atomic<uint64_t> _mult{0};
+};
+
+/**
+ * Recalibrates the TscClock every `period` until destroyed.
+ */
+class TscCalibrator : private boost::noncopyable {
+public:
+    explicit TscCalibrator(const TscClock& clock,
+                           std::chrono::nanoseconds period = std::chrono::seconds{10})
+        : _thread{[this, &clock, period]() {
+              std::unique_lock<std::mutex> lk{_mutex};
+              while (!_cv.wait_for(lk, period, [&]() { return _stopping; })) {
+                  clock.recalibrate(period);
+              }
+          }} {}
+
+    ~TscCalibrator() {
+        {
+            std::lock_guard<std::mutex> lk{_mutex};
+            _stopping = true;
+        }
+        _cv.notify_all();
+        _thread.join();
+    }
+
+private:
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    bool _stopping = false;
+    std::thread _thread;
+};
+
+}  // namespace genny::metrics::internals::v1
+
+#endif  // HEADER_8C2F4B61_0E7D_4F3A_9B85_6A1D2E7C3F90_INCLUDED
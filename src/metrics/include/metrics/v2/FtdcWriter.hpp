@@ -0,0 +1,257 @@
+// Copyright 2022-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef HEADER_15593399_5C9A_4CAF_B4DD_F728A2EF5C3A_INCLUDED
+#define HEADER_15593399_5C9A_4CAF_B4DD_F728A2EF5C3A_INCLUDED
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <zlib.h>
+
+#include <boost/core/noncopyable.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/log/trivial.hpp>
+#include <boost/throw_exception.hpp>
+
+#include <bsoncxx/builder/basic/document.hpp>
+#include <bsoncxx/builder/basic/kvp.hpp>
+#include <bsoncxx/types.hpp>
+
+namespace genny::metrics::internals::v2 {
+
+/**
+ * One event, with the fields poplar's PERF recorder writes for it.
+ */
+struct FtdcSample {
+    // Milliseconds since the Unix epoch.
+    int64_t timestamp = 0;
+    int64_t id = 0;
+
+    int64_t number = 0;
+    int64_t ops = 0;
+    int64_t size = 0;
+    int64_t errors = 0;
+
+    // Nanoseconds.
+    int64_t duration = 0;
+    int64_t total = 0;
+
+    int64_t state = 0;
+    int64_t workers = 0;
+    bool failed = false;
+};
+
+/**
+ * Writes FTDC files in the format poplar writes them in, so curator and the rest of the analysis
+ * tooling can read them, without the round-trip through gRPC.
+ *
+ * A file is a sequence of BSON chunk documents `{_id: <date>, type: 1, data: <binary>}`. The
+ * binary is the little-endian uint32 size of the payload followed by the zlib-compressed payload:
+ *
+ * - the first sample of the chunk as a BSON document (the "reference" document),
+ * - the uint32 number of metrics, i.e. the numeric fields of the reference document in order,
+ * - the uint32 number of samples after the reference one,
+ * - the difference between each sample and the one before it, metric by metric, as unsigned
+ *   varints. A run of zeros is written as a 0 followed by the run's length minus one.
+ *
+ * Every FtdcSample has the same fields, so a chunk is written every `chunkSize` samples. write()
+ * is thread-safe since every thread running an operation writes to the operation's file.
+ */
+class FtdcWriter : private boost::noncopyable {
+public:
+    static constexpr size_t kMetrics = 11;
+
+    explicit FtdcWriter(const boost::filesystem::path& path, size_t chunkSize)
+        : _path{path}, _chunkSize{chunkSize} {
+        if (_chunkSize == 0) {
+            BOOST_THROW_EXCEPTION(std::invalid_argument("FTDC chunks must hold some samples"));
+        }
+        if (_path.has_parent_path()) {
+            boost::filesystem::create_directories(_path.parent_path());
+        }
+        _out.open(_path.string(),
+                  std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+        if (!_out) {
+            BOOST_THROW_EXCEPTION(std::runtime_error("Couldn't open FTDC file " + _path.string()));
+        }
+        _samples.reserve(_chunkSize);
+    }
+
+    ~FtdcWriter() {
+        try {
+            close();
+        } catch (const std::exception& x) {
+            BOOST_LOG_TRIVIAL(error) << x.what();
+        }
+    }
+
+    void write(const FtdcSample& sample) {
+        std::lock_guard<std::mutex> lk{_mutex};
+        if (_samples.empty()) {
+            _reference = sample;
+        }
+        _samples.push_back(metrics(sample));
+        if (_samples.size() >= _chunkSize) {
+            flush();
+        }
+    }
+
+    /**
+     * Write out the last chunk. Samples written after this are ignored.
+     */
+    void close() {
+        std::lock_guard<std::mutex> lk{_mutex};
+        if (!_out.is_open()) {
+            return;
+        }
+        flush();
+        _out.close();
+    }
+
+private:
+    // Encode the samples after the reference one as FTDC deltas.
+    static void appendDeltas(const std::vector<std::array<int64_t, kMetrics>>& samples,
+                             std::string& out) {
+        uint64_t zeros = 0;
+        for (size_t metric = 0; metric < kMetrics; ++metric) {
+            for (size_t i = 1; i < samples.size(); ++i) {
+                // Wrapping is fine; the reader wraps the same way.
+                const auto delta = uint64_t(samples[i][metric]) - uint64_t(samples[i - 1][metric]);
+                if (delta == 0) {
+                    ++zeros;
+                    continue;
+                }
+                if (zeros > 0) {
+                    appendVarint(0, out);
+                    appendVarint(zeros - 1, out);
+                    zeros = 0;
+                }
+                appendVarint(delta, out);
+            }
+        }
+        if (zeros > 0) {
+            appendVarint(0, out);
+            appendVarint(zeros - 1, out);
+        }
+    }
+
+    static std::array<int64_t, kMetrics> metrics(const FtdcSample& sample) {
+        // The order of the fields in the reference document.
+        return {sample.timestamp,
+                sample.id,
+                sample.number,
+                sample.ops,
+                sample.size,
+                sample.errors,
+                sample.duration,
+                sample.total,
+                sample.state,
+                sample.workers,
+                sample.failed ? 1 : 0};
+    }
+
+    static bsoncxx::document::value toBson(const FtdcSample& sample) {
+        using bsoncxx::builder::basic::kvp;
+        using bsoncxx::builder::basic::make_document;
+        return make_document(
+            kvp("ts", bsoncxx::types::b_date{std::chrono::milliseconds{sample.timestamp}}),
+            kvp("id", sample.id),
+            kvp("counters",
+                make_document(kvp("n", sample.number),
+                              kvp("ops", sample.ops),
+                              kvp("size", sample.size),
+                              kvp("errors", sample.errors))),
+            kvp("timers", make_document(kvp("dur", sample.duration), kvp("total", sample.total))),
+            kvp("gauges",
+                make_document(kvp("state", sample.state),
+                              kvp("workers", sample.workers),
+                              kvp("failed", sample.failed))));
+    }
+
+    static void appendVarint(uint64_t value, std::string& out) {
+        while (value >= 0x80) {
+            out.push_back(char(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(char(value));
+    }
+
+    static void appendUint32(uint32_t value, std::string& out) {
+        for (int i = 0; i < 4; ++i) {
+            out.push_back(char((value >> (8 * i)) & 0xff));
+        }
+    }
+
+    // Call with _mutex held.
+    void flush() {
+        if (_samples.empty()) {
+            return;
+        }
+        const auto reference = toBson(_reference);
+        std::string payload{reinterpret_cast<const char*>(reference.view().data()),
+                            reference.view().length()};
+        appendUint32(uint32_t(kMetrics), payload);
+        appendUint32(uint32_t(_samples.size() - 1), payload);
+        appendDeltas(_samples, payload);
+
+        std::string data;
+        appendUint32(uint32_t(payload.size()), data);
+        const auto header = data.size();
+        auto compressedSize = compressBound(uLong(payload.size()));
+        data.resize(header + compressedSize);
+        if (compress2(reinterpret_cast<Bytef*>(&data[header]),
+                      &compressedSize,
+                      reinterpret_cast<const Bytef*>(payload.data()),
+                      uLong(payload.size()),
+                      Z_DEFAULT_COMPRESSION) != Z_OK) {
+            BOOST_THROW_EXCEPTION(std::runtime_error("Couldn't compress FTDC chunk for " +
+                                                     _path.string()));
+        }
+        data.resize(header + compressedSize);
+
+        using bsoncxx::builder::basic::kvp;
+        using bsoncxx::builder::basic::make_document;
+        const auto chunk = make_document(
+            kvp("_id", bsoncxx::types::b_date{std::chrono::milliseconds{_reference.timestamp}}),
+            kvp("type", int32_t{1}),
+            kvp("data",
+                bsoncxx::types::b_binary{bsoncxx::binary_sub_type::k_binary,
+                                         uint32_t(data.size()),
+                                         reinterpret_cast<const uint8_t*>(data.data())}));
+        _out.write(reinterpret_cast<const char*>(chunk.view().data()),
+                   std::streamsize(chunk.view().length()));
+        if (!_out) {
+            BOOST_THROW_EXCEPTION(std::runtime_error("Couldn't write FTDC file " + _path.string()));
+        }
+        _samples.clear();
+    }
+
+    const boost::filesystem::path _path;
+    const size_t _chunkSize;
+    std::mutex _mutex;
+    std::ofstream _out;
+    FtdcSample _reference;
+    std::vector<std::array<int64_t, kMetrics>> _samples;
+};
+
+}  // namespace genny::metrics::internals::v2
+
+#endif  // HEADER_15593399_5C9A_4CAF_B4DD_F728A2EF5C3A_INCLUDED
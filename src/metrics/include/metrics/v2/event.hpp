@@ -16,17 +16,23 @@
 #ifndef HEADER_960919A5_5455_4DD2_BC68_EFBAEB228BB0_INCLUDED
 #define HEADER_960919A5_5455_4DD2_BC68_EFBAEB228BB0_INCLUDED
 
+#include <algorithm>
 #include <atomic>
 #include <condition_variable>
 #include <cstdint>
 #include <cstdlib>
 #include <deque>
+#include <functional>
+#include <memory>
 #include <mutex>
 #include <optional>
 #include <queue>
 #include <set>
+#include <sstream>
 #include <thread>
+#include <type_traits>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <boost/filesystem.hpp>
@@ -37,6 +43,7 @@
 #include <grpcpp/security/credentials.h>
 
 #include <metrics/operation.hpp>
+#include <metrics/v2/FtdcWriter.hpp>
 #include <poplarlib/collector.grpc.pb.h>
 
 /**
@@ -62,6 +69,7 @@ const double SWAP_BUFFER_PERCENT = .4;
 const double GRPC_THREAD_WAKEUP_PERCENT = .95;
 const int GRPC_BUFFER_SIZE = 5000;  // Max possible: 67108864
 const int SEND_CHUNK_SIZE = 1000;
+const int FTDC_CHUNK_SIZE = 1000;
 
 class PoplarRequestError : public std::runtime_error {
 public:
@@ -73,6 +81,34 @@ public:
     using std::runtime_error::runtime_error;
 };
 
+/**
+ * What reporting an operation does when its EventStream's buffer is full, i.e. when the
+ * GrpcThread can't send to poplar as fast as the Actor reports.
+ */
+enum class OverflowPolicy {
+    // Drop the event and fail the workload when the buffer is next drained.
+    kFail,
+    // Wait for the GrpcThread to make room. The Actor slows down.
+    kBlock,
+    // Drop the event and count it. The count is reported as the MetricsDropped operation.
+    kDrop,
+    // Allocate a buffer twice the size and carry on.
+    kGrow,
+};
+
+inline OverflowPolicy overflowPolicyFromString(const std::string& policy) {
+    if (policy == "Fail") {
+        return OverflowPolicy::kFail;
+    } else if (policy == "Block") {
+        return OverflowPolicy::kBlock;
+    } else if (policy == "Drop") {
+        return OverflowPolicy::kDrop;
+    } else if (policy == "Grow") {
+        return OverflowPolicy::kGrow;
+    }
+    throw std::invalid_argument("Unknown metrics buffer overflow policy " + policy);
+}
+
 
 /**
  * Wraps the channel-owning gRPC stub.
@@ -312,7 +348,7 @@ private:
         poplar::CreateOptions options;
         options.set_name(name);
         options.set_path(createPath(name, pathPrefix));
-        options.set_chunksize(1000);
+        options.set_chunksize(FTDC_CHUNK_SIZE);
         options.set_streaming(true);
         options.set_dynamic(false);
         options.set_recorder(poplar::CreateOptions_RecorderType_PERF);
@@ -329,17 +365,59 @@ private:
 template <typename Clocksource, typename StreamInterface>
 class EventStream;
 
-// Manages a thread of grpc client execution .
+/**
+ * Called once every stream has been flushed but before the collectors are closed. Set by the
+ * driver when other processes write to the same collectors so none of them closes a collector
+ * the others are still writing to.
+ */
+inline std::function<void()>& grpcStreamsFinishedHook() {
+    static std::function<void()> hook;
+    return hook;
+}
+
+/**
+ * How the ftdc formats get events from Actors to poplar or to FTDC files.
+ */
+struct GrpcOptions {
+    // What reporting does when an operation's buffer is full.
+    OverflowPolicy overflow = OverflowPolicy::kFail;
+
+    // How many GrpcThreads share the streams. 0 means one per core.
+    size_t senderThreads = NUM_CHANNELS;
+
+    // Write each operation's FTDC file with an FtdcWriter instead of streaming to poplar.
+    bool nativeFtdc = false;
+
+    // Appended to an operation's name to get the file its FtdcWriter writes.
+    std::string ftdcExtension = ".ftdc";
+
+    // Called at the start of every GrpcThread with the thread's index, e.g. to pin it to
+    // some CPUs. Empty means don't call anything.
+    std::function<void(size_t)> threadStartHook;
+};
+
+/**
+ * One of the GrpcClient's sender threads. Sends the events of the EventStreams assigned to it.
+ *
+ * Each pass over the streams sends at most SEND_CHUNK_SIZE events from each one so a busy
+ * stream can't starve the others. The thread sleeps once a pass finds nothing worth sending
+ * and is woken by a stream whose buffer is nearly full.
+ */
 template <typename ClockSource, typename StreamInterface>
 class GrpcThread {
 public:
     typedef EventStream<ClockSource, StreamInterface> Stream;
 
-    GrpcThread(bool assertMetricsBuffer, Stream& stream)
-        : _assertMetricsBuffer{assertMetricsBuffer},
-          _stream{stream},
-          _thread{&GrpcThread::run, this} {
+    GrpcThread(size_t index, std::function<void(size_t)> startHook)
+        : _index{index}, _startHook{std::move(startHook)}, _thread{&GrpcThread::run, this} {}
+
+    /**
+     * Start sending `stream`'s events. Thread-safe.
+     */
+    void add(Stream& stream) {
         stream.subscribe(this);
+        std::lock_guard<std::mutex> lk(_streamsMutex);
+        _streams.push_back(&stream);
     }
 
     void finish() {
@@ -357,74 +435,140 @@ public:
 
 private:
     void run() {
+        if (_startHook) {
+            _startHook(_index);
+        }
+        std::vector<Stream*> streams;
         while (!_finishing) {
+            if (sendPass(streams)) {
+                continue;
+            }
             std::unique_lock<std::mutex> lk(_cvLock);
             // We sleep for performance reasons, not correctness, so we don't need to
             // guard against spurious wakeups.
             _cv.wait_for(lk, std::chrono::milliseconds(GRPC_THREAD_SLEEP_MS));
-            reapActor();
         }
 
-        // Drain buffer and finish.
-        reapActor();
-        _stream.finish();
+        // Drain buffers and finish.
+        while (sendPass(streams)) {
+        }
+        for (auto* stream : streams) {
+            stream->finish();
+        }
     }
 
-    void reapActor() {
-        int counter = 0;
-        while (_stream.sendOne(_finishing, _assertMetricsBuffer)) {
-            counter++;
-            // If finishing and all threads are draining, this helps
-            // balance the server-side buffers.
-            if (counter >= SEND_CHUNK_SIZE) {
-                std::this_thread::yield();
-                counter = 0;
+    /**
+     * Send up to a chunk of events from each stream.
+     *
+     * @return true if some stream may have more to send.
+     */
+    bool sendPass(std::vector<Stream*>& streams) {
+        {
+            std::lock_guard<std::mutex> lk(_streamsMutex);
+            streams.assign(_streams.begin(), _streams.end());
+        }
+        // Read once per pass so every stream is drained the same way.
+        const bool force = _finishing;
+        bool more = false;
+        for (auto* stream : streams) {
+            int sent = 0;
+            while (sent < SEND_CHUNK_SIZE && stream->sendOne(force)) {
+                ++sent;
             }
+            more = more || sent == SEND_CHUNK_SIZE;
         }
+        return more;
     }
 
     std::atomic<bool> _finishing = false;
     std::mutex _streamsMutex;
+    std::vector<Stream*> _streams;
     std::mutex _cvLock;
     std::condition_variable _cv;
 
-    bool _assertMetricsBuffer;
-    Stream& _stream;
+    const size_t _index;
+    const std::function<void(size_t)> _startHook;
     std::thread _thread;
 };
 
-// Manages all the grpc threads. Divides the workload evenly between them.
-// Owns / manages streams, through which OperationsImpl can add events.
+// Manages a fixed pool of grpc threads and assigns streams to them round-robin.
+// Owns / manages streams, through which OperationsImpl can add events. With nativeFtdc the
+// streams write to an FtdcWriter per operation and nothing is sent over gRPC.
 template <typename ClockSource, typename StreamInterface>
 class GrpcClient {
 public:
     // Map from "Actor.Operation.Phase" to a Collector.
     using CollectorsMap = std::unordered_map<std::string, v2::Collector>;
+    // Map from "Actor.Operation.Phase" to the FtdcWriter that replaces its Collector.
+    using WritersMap = std::unordered_map<std::string, std::unique_ptr<FtdcWriter>>;
     using OptionalPhaseNumber = std::optional<genny::PhaseNumber>;
     typedef EventStream<ClockSource, StreamInterface> Stream;
 
-    GrpcClient(bool assertMetricsBuffer) : _assertMetricsBuffer{assertMetricsBuffer} {}
+    explicit GrpcClient(GrpcOptions options)
+        : _overflow{options.overflow},
+          _senderThreads{options.senderThreads > 0
+                             ? options.senderThreads
+                             : std::max<size_t>(1, std::thread::hardware_concurrency())},
+          _nativeFtdc{options.nativeFtdc},
+          _ftdcExtension{std::move(options.ftdcExtension)},
+          _threadStartHook{std::move(options.threadStartHook)} {}
 
     Stream* createStream(const ActorId& actorId,
                          const std::string& name,
                          const OptionalPhaseNumber& phase,
                          const boost::filesystem::path pathPrefix) {
-        _collectors.try_emplace(name, name, pathPrefix);
-        _collectors.at(name).incStreams();
-        _streams.emplace_back(actorId, name, phase);
-        _threads.emplace_back(_assertMetricsBuffer, _streams.back());
+        FtdcWriter* writer = nullptr;
+        if (_nativeFtdc) {
+            auto& slot = _writers[name];
+            if (!slot) {
+                slot = std::make_unique<FtdcWriter>(pathPrefix / (name + _ftdcExtension),
+                                                    FTDC_CHUNK_SIZE);
+            }
+            writer = slot.get();
+        } else {
+            _collectors.try_emplace(name, name, pathPrefix);
+            _collectors.at(name).incStreams();
+        }
+        _streams.emplace_back(actorId, name, phase, _overflow, writer);
+        // Threads are started as they're needed so small workloads don't start the whole pool.
+        if (_threads.size() < _senderThreads) {
+            _threads.emplace_back(_threads.size(), _threadStartHook);
+        }
+        _threads[(_streams.size() - 1) % _threads.size()].add(_streams.back());
         return &_streams.back();
     }
 
+    /**
+     * @return how many events every stream has dropped so far. Thread-safe once setup is done.
+     */
+    uint64_t dropped() const {
+        uint64_t total = 0;
+        for (const auto& stream : _streams) {
+            total += stream.dropped();
+        }
+        return total;
+    }
+
     ~GrpcClient() {
         for (int i = 0; i < _threads.size(); i++) {
             _threads[i].finish();
         }
+        // Joining the threads flushes their streams.
+        _threads.clear();
+        _writers.clear();
+        if (const auto& hook = grpcStreamsFinishedHook()) {
+            hook();
+        }
     }
 
 private:
-    const bool _assertMetricsBuffer;
+    const OverflowPolicy _overflow;
+    const size_t _senderThreads;
+    const bool _nativeFtdc;
+    const std::string _ftdcExtension;
+    const std::function<void(size_t)> _threadStartHook;
     CollectorsMap _collectors;
+    WritersMap _writers;
     // deque avoid copy-constructor calls
     std::deque<Stream> _streams;
     std::deque<GrpcThread<ClockSource, StreamInterface>> _threads;
@@ -443,74 +587,219 @@ struct MetricsArgs {
     size_t workerCount;
 };
 
-// Efficient buffer that should rarely be blocked on insertions.
+/**
+ * Lock-free single-producer/single-consumer queue of MetricsArgs.
+ *
+ * The producer is whichever Actor thread reports the EventStream's operation (Actors that share
+ * an operation across threads, like the internal ones, serialize their reports) and the
+ * consumer is the stream's GrpcThread. Reporting never takes a lock. It only allocates under
+ * OverflowPolicy::kGrow when the ring is full.
+ */
 template <typename ClockSource>
 class MetricsBuffer {
 public:
     using time_point = typename ClockSource::time_point;
 
-    explicit MetricsBuffer(size_t size, const std::string& name)
-        : size{size},
-          name{name},
-          _loading{std::make_unique<std::vector<MetricsArgs<ClockSource>>>()},
-          _draining{std::make_unique<std::vector<MetricsArgs<ClockSource>>>()} {
-        _loading->reserve(size);
-        _draining->reserve(size);
+    explicit MetricsBuffer(size_t size,
+                           const std::string& name,
+                           OverflowPolicy overflow = OverflowPolicy::kFail)
+        : name{name},
+          size{size},
+          _overflow{overflow},
+          _writeSegment{new Segment(size)},
+          _readSegment{_writeSegment} {}
+
+    ~MetricsBuffer() {
+        while (_readSegment) {
+            delete std::exchange(_readSegment, _readSegment->next.load());
+        }
     }
 
-    // Thread-safe.
-    size_t addAt(const time_point& finish, OperationEventT<ClockSource> event, size_t workerCount) {
-        const std::lock_guard<std::mutex> lock(_loadingMutex);
-        _loading->emplace_back(finish, std::move(event), workerCount);
-        return _loading->size();
+    MetricsBuffer(const MetricsBuffer&) = delete;
+    MetricsBuffer& operator=(const MetricsBuffer&) = delete;
+
+    /**
+     * Only call from the producer.
+     *
+     * @param wake called while waiting for room under OverflowPolicy::kBlock.
+     * @return how full the ring being written to is, as far as the producer knows.
+     */
+    template <typename Wake>
+    size_t addAt(const time_point& finish,
+                 const OperationEventT<ClockSource>& event,
+                 size_t workerCount,
+                 Wake&& wake) {
+        auto* segment = _writeSegment;
+        const auto head = segment->head.load(std::memory_order_relaxed);
+        if (head - segment->cachedTail >= segment->capacity) {
+            segment->cachedTail = segment->tail.load(std::memory_order_acquire);
+            while (head - segment->cachedTail >= segment->capacity) {
+                switch (_overflow) {
+                    case OverflowPolicy::kBlock:
+                        wake();
+                        std::this_thread::yield();
+                        segment->cachedTail = segment->tail.load(std::memory_order_acquire);
+                        continue;
+                    case OverflowPolicy::kGrow:
+                        return grow(finish, event, workerCount);
+                    case OverflowPolicy::kFail:
+                    case OverflowPolicy::kDrop:
+                        _dropped.fetch_add(1, std::memory_order_relaxed);
+                        return segment->capacity;
+                }
+            }
+        }
+        segment->write(head, finish, event, workerCount);
+        auto fill = head + 1 - segment->cachedTail;
+        if (fill >= segment->capacity * GRPC_THREAD_WAKEUP_PERCENT) {
+            // Don't have the caller wake the consumer over and over based on an old look.
+            segment->cachedTail = segment->tail.load(std::memory_order_acquire);
+            fill = head + 1 - segment->cachedTail;
+        }
+        return fill;
     }
 
-    // Not thread-safe.
-    std::optional<MetricsArgs<ClockSource>> pop(bool force, bool assertMetricsBuffer = true) {
-        refresh(force, assertMetricsBuffer);
-        if (_location >= _draining->size()) {
+    size_t addAt(const time_point& finish,
+                 const OperationEventT<ClockSource>& event,
+                 size_t workerCount) {
+        return addAt(finish, event, workerCount, []() {});
+    }
+
+    /**
+     * Only call from the consumer. Unless `force` is set, events are only handed out once
+     * enough have built up to be worth sending in a batch.
+     *
+     * @throws MetricsError under OverflowPolicy::kFail if any events have been dropped.
+     */
+    std::optional<MetricsArgs<ClockSource>> pop(bool force) {
+        if (_batch == 0) {
+            refresh(force);
+        }
+        if (_batch == 0) {
             return std::nullopt;
-        } else {
-            // Tracking location explicitly lets us create FIFO semantics with a vector.
-            // No STL queue allows us to reserve space.
-            auto ret = std::move(_draining->at(_location++));
-            return ret;
         }
+        auto* segment = _readSegment;
+        const auto tail = segment->tail.load(std::memory_order_relaxed);
+        auto ret = segment->slots[segment->indexOf(tail)];
+        segment->tail.store(tail + 1, std::memory_order_release);
+        --_batch;
+        return ret;
+    }
+
+    /**
+     * @return how many events have been dropped because the ring was full. Thread-safe.
+     */
+    uint64_t dropped() const {
+        return _dropped.load(std::memory_order_relaxed);
     }
 
     const std::string name;
     const size_t size;
 
 private:
-    void refresh(bool force, bool assertMetricsBuffer) {
-        if (_location < _draining->size()) {
-            return;
+    // One cache line per index so the producer and consumer don't false-share.
+    static constexpr size_t kCacheLine = 64;
+
+    struct Segment {
+        explicit Segment(size_t capacity)
+            : capacity{std::max<size_t>(capacity, 1)},
+              // Round the storage up to a power of two so positions map to slots with a mask.
+              mask{roundUpToPowerOfTwo(this->capacity) - 1},
+              // Allocate without constructing. The pages aren't touched until the Actor writes
+              // to them, so they come from its NUMA node rather than the setup thread's.
+              slots{std::allocator<MetricsArgs<ClockSource>>{}.allocate(mask + 1)} {}
+
+        ~Segment() {
+            std::allocator<MetricsArgs<ClockSource>>{}.deallocate(slots, mask + 1);
         }
 
-        _draining->clear();
-        _location = 0;
-        const std::lock_guard<std::mutex> lock(_loadingMutex);
-        if (force || _loading->size() >= size * SWAP_BUFFER_PERCENT) {
-            _draining.swap(_loading);
+        size_t indexOf(uint64_t position) const {
+            return size_t(position & mask);
         }
 
-        // Maybe a bit nuclear, but this draws a box around the entire grpc system
-        // and errors if it ever backs up enough to slow down an actor thread.
-        if (_draining->size() > size && assertMetricsBuffer) {
+        void write(uint64_t head,
+                   const time_point& finish,
+                   const OperationEventT<ClockSource>& event,
+                   size_t workerCount) {
+            new (&slots[indexOf(head)]) MetricsArgs<ClockSource>(finish, event, workerCount);
+            this->head.store(head + 1, std::memory_order_release);
+        }
+
+        const size_t capacity;
+        const size_t mask;
+        MetricsArgs<ClockSource>* const slots;
+
+        // Written by the producer.
+        alignas(kCacheLine) std::atomic<uint64_t> head = 0;
+        // The producer's last look at `tail` so it only reads the consumer's line when full.
+        uint64_t cachedTail = 0;
+        // Set by the producer once it has moved on to a bigger segment.
+        std::atomic<Segment*> next = nullptr;
+
+        // Written by the consumer.
+        alignas(kCacheLine) std::atomic<uint64_t> tail = 0;
+    };
+
+    static size_t roundUpToPowerOfTwo(size_t n) {
+        size_t power = 1;
+        while (power < n) {
+            power <<= 1;
+        }
+        return power;
+    }
+
+    static_assert(std::is_trivially_destructible_v<MetricsArgs<ClockSource>>,
+                  "Ring slots are overwritten without being destroyed");
+
+    size_t grow(const time_point& finish,
+                const OperationEventT<ClockSource>& event,
+                size_t workerCount) {
+        auto* bigger = new Segment(_writeSegment->capacity * 2);
+        bigger->write(0, finish, event, workerCount);
+        BOOST_LOG_TRIVIAL(debug) << "Metrics buffer for operation name " << name
+                                 << " grew to " << bigger->capacity << " events";
+        // The consumer finishes the old segment before following `next` to this one.
+        std::exchange(_writeSegment, bigger)->next.store(bigger, std::memory_order_release);
+        return 1;
+    }
+
+    void refresh(bool force) {
+        if (_overflow == OverflowPolicy::kFail && dropped() > 0) {
+            // Maybe a bit nuclear, but this draws a box around the entire grpc system
+            // and errors if it ever backs up enough to slow down an actor thread.
             std::ostringstream os;
             os << "Metrics buffer for operation name " << name << " exceeded pre-allocated space"
-               << ". Expected size: " << size << ". Actual size: " << _draining->size()
+               << ". Expected size: " << size << ". Dropped events: " << dropped()
                << ". This may affect recorded performance.";
-
             BOOST_THROW_EXCEPTION(MetricsError(os.str()));
         }
+
+        auto* segment = _readSegment;
+        auto* next = segment->next.load(std::memory_order_acquire);
+        auto available = segment->head.load(std::memory_order_acquire) -
+            segment->tail.load(std::memory_order_relaxed);
+        if (available == 0 && next) {
+            // Everything the producer wrote here was published before `next`.
+            delete std::exchange(_readSegment, next);
+            return refresh(force);
+        }
+        if (force || next || available >= size * SWAP_BUFFER_PERCENT) {
+            _batch = available;
+        }
     }
 
-    std::unique_ptr<std::vector<MetricsArgs<ClockSource>>> _loading;
-    std::unique_ptr<std::vector<MetricsArgs<ClockSource>>> _draining;
-    std::mutex _loadingMutex;
-    size_t _location = 0;
+    const OverflowPolicy _overflow;
+
+    // Only touched by the producer.
+    Segment* _writeSegment;
+
+    // Only touched by the consumer.
+    Segment* _readSegment;
+    size_t _batch = 0;
+
+    std::atomic<uint64_t> _dropped = 0;
 };
+
 /**
  * Primary point of interaction between v2 poplar internals and the metrics system.
  */
@@ -523,28 +812,34 @@ class EventStream {
 public:
     explicit EventStream(const ActorId& actorId,
                          const std::string& name,
-                         const OptionalPhaseNumber& phase)
+                         const OptionalPhaseNumber& phase,
+                         OverflowPolicy overflow = OverflowPolicy::kFail,
+                         FtdcWriter* writer = nullptr)
         : _name{name},
-          _stream{name, actorId},
+          _actorId{actorId},
+          _writer{writer},
           _phase{phase},
           _lastFinish{ClockSource::now()},
-          _buffer(std::make_unique<MetricsBuffer<ClockSource>>(BUFFER_SIZE, _name)) {
+          _buffer(std::make_unique<MetricsBuffer<ClockSource>>(BUFFER_SIZE, _name, overflow)) {
+        if (!_writer) {
+            _stream.emplace(name, actorId);
+        }
         _metrics.set_name(_name);
         _metrics.set_id(actorId);
     }
 
-    // Record a metrics event to the loading buffer.
+    // Record a metrics event to the buffer. Called by the Actor.
     void addAt(const time_point& finish, OperationEventT<ClockSource> event, size_t workerCount) {
-        auto size = _buffer->addAt(finish, std::move(event), workerCount);
+        auto size = _buffer->addAt(finish, event, workerCount, [this]() { wake(); });
         if (size >= BUFFER_SIZE * GRPC_THREAD_WAKEUP_PERCENT) {
-            subscriber->wake();
+            wake();
         }
     }
 
-    // Send one event from the draining buffer to the grpc api.
+    // Send one event from the buffer to the grpc api.
     // Returns true if there are more events to send.
-    bool sendOne(bool force = false, bool assertMetricsBuffer = true) {
-        auto metricsArgsOptional = _buffer->pop(force, assertMetricsBuffer);
+    bool sendOne(bool force = false) {
+        auto metricsArgsOptional = _buffer->pop(force);
         if (!metricsArgsOptional)
             return false;
         auto metricsArgs = *metricsArgsOptional;
@@ -553,6 +848,15 @@ public:
         // the stead_clock finish time is used to calculate the total field
         // further below.
         auto reportFinish = ClockSource::toReportTime(metricsArgs.finish);
+        if (_writer) {
+            writeFtdc(std::chrono::duration_cast<std::chrono::milliseconds>(
+                          reportFinish.time_since_epoch())
+                          .count(),
+                      metricsArgs);
+            _lastFinish = metricsArgs.finish;
+            return true;
+        }
+
         _metrics.mutable_time()->set_seconds(
             Period<ClockSource>(reportFinish.time_since_epoch()).getSecondsCount());
         _metrics.mutable_time()->set_nanos(
@@ -586,14 +890,30 @@ public:
         if (_phase) {
             _metrics.mutable_gauges()->set_state(*_phase);
         }
-        _stream.write(_metrics);
+        _stream->write(_metrics);
         _lastFinish = metricsArgs.finish;
 
         return true;
     }
 
     void finish() {
-        _stream.finish();
+        if (const auto dropped = _buffer->dropped(); dropped > 0) {
+            BOOST_LOG_TRIVIAL(warning) << "Dropped " << dropped << " metrics events for operation "
+                                       << _name << " because its buffer was full";
+        }
+        if (_stream) {
+            _stream->finish();
+        }
+    }
+
+    uint64_t dropped() const {
+        return _buffer->dropped();
+    }
+
+    void wake() {
+        if (subscriber) {
+            subscriber->wake();
+        }
     }
 
     void subscribe(GrpcThread<ClockSource, StreamInterface>* thread) {
@@ -605,12 +925,37 @@ public:
         const EventStream<ClockSource, StreamInterface>&) = delete;
 
 private:
+    // Converts an event the same way poplar does before its PERF recorder writes it.
+    void writeFtdc(int64_t reportFinishMillis, const MetricsArgs<ClockSource>& args) {
+        using std::chrono::nanoseconds;
+        FtdcSample sample;
+        sample.timestamp = reportFinishMillis;
+        sample.id = _actorId;
+        sample.number = args.event.number;
+        sample.ops = args.event.ops;
+        sample.size = args.event.size;
+        sample.errors = args.event.errors;
+        sample.duration =
+            std::chrono::duration_cast<nanoseconds>(duration(args.event.duration)).count();
+        // If the EventStream was constructed after the end time was recorded.
+        sample.total = args.finish < _lastFinish
+            ? sample.duration
+            : std::chrono::duration_cast<nanoseconds>(args.finish - _lastFinish).count();
+        sample.state = _phase ? *_phase : 0;
+        sample.workers = args.workerCount;
+        sample.failed = args.event.isFailure();
+        _writer->write(sample);
+    }
+
     std::string _name;
-    StreamInterface _stream;
+    ActorId _actorId;
+    // Owned by the GrpcClient. Only one of _writer and _stream is set.
+    FtdcWriter* _writer;
+    std::optional<StreamInterface> _stream;
     poplar::EventMetrics _metrics;
     std::optional<genny::PhaseNumber> _phase;
     time_point _lastFinish;
-    GrpcThread<ClockSource, StreamInterface>* subscriber;
+    GrpcThread<ClockSource, StreamInterface>* subscriber = nullptr;
     std::unique_ptr<MetricsBuffer<ClockSource>> _buffer;
 };
 
@@ -12,13 +12,28 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
 #include <iomanip>
+#include <iterator>
+#include <map>
 #include <optional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
 
+#include <zlib.h>
+
+#include <bsoncxx/document/view.hpp>
+#include <bsoncxx/types.hpp>
 #include <google/protobuf/util/message_differencer.h>
 
 #include <metrics/MetricsReporter.hpp>
 #include <metrics/metrics.hpp>
+#include <metrics/v2/FtdcWriter.hpp>
 #include <metrics/v2/event.hpp>
 
 #include <testlib/ActorHelper.hpp>
@@ -282,6 +297,62 @@ TEST_CASE("metrics output format") {
     }
 }
 
+TEST_CASE("Spilled cedar-csv reporting") {
+    for (const bool compress : {false, true}) {
+        RegistryClockSourceStub::reset();
+        internals::v1::SpillOptions spillOptions;
+        spillOptions.directory =
+            boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+        spillOptions.compress = compress;
+        // One event per block so every event goes through a segment file.
+        spillOptions.bufferBytes = sizeof(internals::v1::SpilledEvent);
+        auto metrics =
+            internals::RegistryT<RegistryClockSourceStub>{MetricsFormat("cedar-csv"),
+                                                          "unused",
+                                                          internals::v2::GrpcOptions{},
+                                                          internals::v1::HistogramOptions{},
+                                                          spillOptions};
+        auto reporter = genny::metrics::internals::v1::ReporterT{metrics};
+
+        auto insert1 = metrics.operation("InsertRemove", "Insert", 1u);
+        auto insert2 = metrics.operation("InsertRemove", "Insert", 2u);
+        auto late1 = metrics.operation("InsertRemove", "Late", 1u);
+
+        RegistryClockSourceStub::advance(5ns);
+        insert2.report(RegistryClockSourceStub::now(), 1us, OutcomeType::kSuccess, 1, 0, 1, 10);
+        RegistryClockSourceStub::advance(5ns);
+        insert1.report(RegistryClockSourceStub::now(), 2us, OutcomeType::kFailure, 1, 1, 1, 20);
+        const auto earlier = RegistryClockSourceStub::now();
+        RegistryClockSourceStub::advance(5ns);
+        insert2.report(RegistryClockSourceStub::now(), 3us, OutcomeType::kSuccess, 1, 0, 1, 30);
+        // Reported out of order so it starts another of thread 1's segments.
+        late1.report(earlier - 2ns, 4us, OutcomeType::kSuccess, 1, 0, 1, 40);
+
+        REQUIRE(boost::filesystem::exists(spillOptions.directory));
+        metrics.flushEventSpill();
+
+        std::ostringstream out;
+        reporter.report<ReporterClockSourceStub>(out, MetricsFormat("cedar-csv"));
+        REQUIRE(out.str() ==
+                "Clocks\n"
+                "clock,nanoseconds\n"
+                "SystemTime,42000000\n"
+                "MetricsTime,15\n"
+                "\n"
+                "OperationThreadCounts\n"
+                "actor,operation,workers\n"
+                "InsertRemove,Insert,2\n"
+                "InsertRemove,Late,1\n"
+                "\n"
+                "Operations\n"
+                "timestamp,actor,thread,operation,duration,outcome,n,ops,errors,size\n"
+                "5,InsertRemove,2,Insert,1000,0,1,1,0,10\n"
+                "8,InsertRemove,1,Late,4000,0,1,1,0,40\n"
+                "10,InsertRemove,1,Insert,2000,1,1,1,1,20\n"
+                "15,InsertRemove,2,Insert,3000,0,1,1,0,30\n");
+    }
+}
+
 TEST_CASE("Genny.Setup metric") {
     RegistryClockSourceStub::reset();
     auto metrics = internals::RegistryT<RegistryClockSourceStub>{};
@@ -522,6 +593,151 @@ TEST_CASE("Phases can set metrics") {
     }
 }
 
+TEST_CASE("Actor threads can report their metrics and pacing overhead") {
+    NodeSource yaml(R"(
+    SchemaVersion: 2018-07-01
+    Database: test
+    Actors:
+    - Name: OverheadTest
+      Type: HelloWorld
+      Threads: 2
+      Phases:
+      - Repeat: 3
+
+    Metrics:
+      Format: cedar-csv
+      Path: build/genny-metrics
+      Overhead: true
+    )",
+                    "");
+
+    ActorHelper ah{yaml.root(), 2};
+    ah.run();
+
+    // Collects the values of the csv rows `<time>,<name>,<value>` by name.
+    std::istringstream metrics{ah.getMetricsOutput()};
+    std::map<std::string, std::vector<int64_t>> values;
+    for (std::string line; std::getline(metrics, line);) {
+        const auto first = line.find(',');
+        const auto last = line.rfind(',');
+        if (first != std::string::npos && first != last) {
+            values[line.substr(first + 1, last - first - 1)].push_back(
+                std::stoll(line.substr(last + 1)));
+        }
+    }
+
+    // HelloWorld records two operations in each of its three iterations.
+    const std::pair<const char*, int64_t> expected[] = {{"MetricsOverhead", 6},
+                                                        {"PacingOverhead", 3}};
+    for (const auto& [op, ops] : expected) {
+        for (const auto* thread : {".id-1.", ".id-2."}) {
+            const auto name = std::string{"OverheadTest"} + thread + op;
+            INFO(name);
+            REQUIRE(values[name + "_iters"] == std::vector<int64_t>{ops});
+            REQUIRE(values[name + "_timer"].size() == 1);
+            REQUIRE(values[name + "_timer"][0] >= 0);
+        }
+    }
+}
+
+TEST_CASE("Pacing overhead leaves out the sleeps a phase asks for") {
+    NodeSource yaml(R"(
+    SchemaVersion: 2018-07-01
+    Database: test
+    Actors:
+    - Name: SleepyOverheadTest
+      Type: HelloWorld
+      Threads: 1
+      Phases:
+      - Repeat: 4
+        SleepBefore: 50 milliseconds
+        SleepAfter: 50 milliseconds
+
+    Metrics:
+      Format: cedar-csv
+      Path: build/genny-metrics
+      Overhead: true
+    )",
+                    "");
+
+    ActorHelper ah{yaml.root(), 1};
+    ah.run();
+
+    std::istringstream metrics{ah.getMetricsOutput()};
+    std::optional<int64_t> pacingNanos;
+    for (std::string line; std::getline(metrics, line);) {
+        if (line.find(",SleepyOverheadTest.id-1.PacingOverhead_timer,") != std::string::npos) {
+            pacingNanos = std::stoll(line.substr(line.rfind(',') + 1));
+        }
+    }
+
+    // The thread slept for 400ms. Deciding to do so takes a tiny fraction of one sleep.
+    REQUIRE(pacingNanos);
+    REQUIRE(*pacingNanos >= 0);
+    REQUIRE(*pacingNanos < 25 * 1000 * 1000);
+}
+
+TEST_CASE("Open-loop operations measure from their intended start") {
+    RegistryClockSourceStub::reset();
+    internals::v1::IntendedStart::clear();
+
+    auto dummy_metrics = internals::RegistryT<RegistryClockSourceStub>{};
+    auto op =
+        internals::OperationImpl<RegistryClockSourceStub>{"Actor", dummy_metrics, "Op", nullptr};
+    auto serviceOp = internals::OperationImpl<RegistryClockSourceStub>{
+        "Actor", dummy_metrics, "Op.ServiceTime", nullptr};
+    op.setServiceTime(&serviceOp);
+
+    // Scheduled to start at 5ns but queued behind a slow operation until 45ns.
+    RegistryClockSourceStub::advance(5ns);
+    internals::v1::IntendedStart::set(RegistryClockSourceStub::now());
+    RegistryClockSourceStub::advance(40ns);
+
+    auto ctx = std::make_optional<internals::OperationContextT<RegistryClockSourceStub>>(&op);
+    RegistryClockSourceStub::advance(10ns);
+
+    SECTION("Response time is from the intended start and service time from the actual start") {
+        ctx->success();
+        ctx.reset();
+
+        REQUIRE(op.getEvents().size() == 1);
+        REQUIRE(serviceOp.getEvents().size() == 1);
+        assertDurationsEqual(op.getEvents()[0].first.time_since_epoch(), 55ns);
+        assertDurationsEqual(op.getEvents()[0].second.duration, 50ns);
+        assertDurationsEqual(serviceOp.getEvents()[0].first.time_since_epoch(), 55ns);
+        assertDurationsEqual(serviceOp.getEvents()[0].second.duration, 10ns);
+    }
+
+    SECTION("Only the first operation in an iteration uses the intended start") {
+        ctx->success();
+        ctx.reset();
+
+        auto second =
+            std::make_optional<internals::OperationContextT<RegistryClockSourceStub>>(&op);
+        RegistryClockSourceStub::advance(7ns);
+        second->success();
+        second.reset();
+
+        REQUIRE(op.getEvents().size() == 2);
+        REQUIRE(serviceOp.getEvents().size() == 1);
+        assertDurationsEqual(op.getEvents()[1].second.duration, 7ns);
+    }
+}
+
+TEST_CASE("Registry creates service-time operations for open-loop actors") {
+    RegistryClockSourceStub::reset();
+    auto metrics = internals::RegistryT<RegistryClockSourceStub>{};
+    metrics.enableServiceTime("actor1");
+
+    metrics.operation("actor1", "op1", 1u);
+    metrics.operation("actor1", "op1", 2u);
+    metrics.operation("actor2", "op1", 3u);
+
+    REQUIRE(metrics.getWorkerCount("actor1", "op1") == 2);
+    REQUIRE(metrics.getWorkerCount("actor1", "op1.ServiceTime") == 2);
+    REQUIRE_THROWS(metrics.getWorkerCount("actor2", "op1.ServiceTime"));
+}
+
 TEST_CASE("Registry counts the number of workers") {
     RegistryClockSourceStub::reset();
     auto metrics = internals::RegistryT<RegistryClockSourceStub>{};
@@ -782,6 +998,39 @@ TEST_CASE("Events stream to gRPC") {
     }
 
 
+    SECTION("One sender thread drains several streams") {
+        using Stream =
+            internals::v2::EventStream<RegistryClockSourceStub, internals::v2::MockStreamInterface>;
+        RegistryClockSourceStub::reset();
+        internals::v2::MockStreamInterface::events.clear();
+
+        Stream first{1, "First", 1};
+        Stream second{2, "Second", 1};
+        std::optional<size_t> started;
+        {
+            internals::v2::GrpcThread<RegistryClockSourceStub, internals::v2::MockStreamInterface>
+                sender{3, [&](size_t index) { started = index; }};
+            sender.add(first);
+            sender.add(second);
+            for (int i = 0; i < 3; i++) {
+                OperationEventT<RegistryClockSourceStub> event;
+                first.addAt(RegistryClockSourceStub::now(), event, 1);
+                second.addAt(RegistryClockSourceStub::now(), event, 1);
+            }
+            // Too few events to be sent until the sender finishes and drains them.
+            sender.finish();
+        }
+        // The thread is told its index before it sends anything.
+        REQUIRE(started == size_t(3));
+
+        auto& events = internals::v2::MockStreamInterface::events;
+        REQUIRE(events.size() == 6);
+        REQUIRE(std::count_if(events.begin(), events.end(), [](const auto& event) {
+                    return event.name() == "First";
+                }) == 3);
+        events.clear();
+    }
+
     SECTION("Create folder for ftdc output") {
         auto metricsPath = getMetricsPath();
 
@@ -867,6 +1116,551 @@ TEST_CASE("Events stream to gRPC") {
         metricsBuffer.addAt(endTime, event, 1);
         REQUIRE_THROWS(metricsBuffer.pop(false));
     }
+
+    SECTION("Metrics buffer drops and counts events when full.") {
+        auto metricsBuffer = internals::v2::MetricsBuffer<RegistryClockSourceStub>(
+            3, "test_buffer", internals::v2::OverflowPolicy::kDrop);
+        auto endTime = RegistryClockSourceStub::now();
+        OperationEventT<RegistryClockSourceStub> event;
+
+        for (int i = 0; i < 5; i++) {
+            metricsBuffer.addAt(endTime, event, 1);
+        }
+        REQUIRE(metricsBuffer.dropped() == 2);
+
+        int popped = 0;
+        while (metricsBuffer.pop(true)) {
+            popped++;
+        }
+        REQUIRE(popped == 3);
+
+        // There's room again.
+        metricsBuffer.addAt(endTime, event, 1);
+        REQUIRE(metricsBuffer.pop(true));
+        REQUIRE(metricsBuffer.dropped() == 2);
+    }
+
+    SECTION("Growing metrics buffer keeps every event in order.") {
+        auto metricsBuffer = internals::v2::MetricsBuffer<RegistryClockSourceStub>(
+            3, "test_buffer", internals::v2::OverflowPolicy::kGrow);
+        auto endTime = RegistryClockSourceStub::now();
+
+        for (int i = 0; i < 20; i++) {
+            metricsBuffer.addAt(endTime, OperationEventT<RegistryClockSourceStub>(i), 1);
+        }
+        REQUIRE(metricsBuffer.dropped() == 0);
+
+        for (int i = 0; i < 20; i++) {
+            auto popped = metricsBuffer.pop(true);
+            REQUIRE(popped);
+            REQUIRE(popped->event.number == i);
+        }
+        REQUIRE_FALSE(metricsBuffer.pop(true));
+    }
+}
+
+// Append the numeric fields of an FTDC reference document in order, like FTDC readers do.
+void appendFtdcMetrics(bsoncxx::document::view doc, std::vector<int64_t>& metrics) {
+    for (const auto& element : doc) {
+        switch (element.type()) {
+            case bsoncxx::type::k_document:
+                appendFtdcMetrics(element.get_document().value, metrics);
+                break;
+            case bsoncxx::type::k_date:
+                metrics.push_back(element.get_date().to_int64());
+                break;
+            case bsoncxx::type::k_int64:
+                metrics.push_back(element.get_int64().value);
+                break;
+            case bsoncxx::type::k_bool:
+                metrics.push_back(element.get_bool().value ? 1 : 0);
+                break;
+            default:
+                FAIL("Unexpected field in FTDC reference document " << element.key());
+        }
+    }
+}
+
+uint64_t readVarint(const std::string& in, size_t& offset) {
+    uint64_t value = 0;
+    for (int shift = 0;; shift += 7) {
+        const auto byte = uint8_t(in.at(offset++));
+        value |= uint64_t(byte & 0x7f) << shift;
+        if (byte < 0x80) {
+            return value;
+        }
+    }
+}
+
+uint32_t readUint32(const uint8_t* in) {
+    return uint32_t(in[0]) | uint32_t(in[1]) << 8 | uint32_t(in[2]) << 16 | uint32_t(in[3]) << 24;
+}
+
+// Decode every sample in an FTDC file into its metrics.
+std::vector<std::vector<int64_t>> readFtdc(const std::string& path) {
+    std::ifstream in{path, std::ifstream::binary};
+    const std::string file{std::istreambuf_iterator<char>{in}, {}};
+    std::vector<std::vector<int64_t>> samples;
+    for (size_t offset = 0; offset < file.size();) {
+        const auto* bytes = reinterpret_cast<const uint8_t*>(file.data() + offset);
+        const bsoncxx::document::view chunk{bytes, readUint32(bytes)};
+        offset += chunk.length();
+        REQUIRE(chunk["type"].get_int32().value == 1);
+
+        const auto data = chunk["data"].get_binary();
+        uLongf size = readUint32(data.bytes);
+        std::string payload(size, '\0');
+        REQUIRE(uncompress(reinterpret_cast<Bytef*>(&payload[0]),
+                           &size,
+                           data.bytes + 4,
+                           data.size - 4) == Z_OK);
+        REQUIRE(size == payload.size());
+
+        const auto* payloadBytes = reinterpret_cast<const uint8_t*>(payload.data());
+        const bsoncxx::document::view reference{payloadBytes, readUint32(payloadBytes)};
+        std::vector<int64_t> metrics;
+        appendFtdcMetrics(reference, metrics);
+        REQUIRE(chunk["_id"].get_date().to_int64() == metrics.front());
+        REQUIRE(readUint32(payloadBytes + reference.length()) == metrics.size());
+        const auto deltas = readUint32(payloadBytes + reference.length() + 4);
+
+        samples.push_back(metrics);
+        for (size_t i = 0; i < deltas; ++i) {
+            samples.push_back(metrics);
+        }
+        size_t at = reference.length() + 8;
+        uint64_t zeros = 0;
+        const auto first = samples.size() - deltas;
+        for (size_t metric = 0; metric < metrics.size(); ++metric) {
+            for (size_t i = first; i < samples.size(); ++i) {
+                uint64_t delta = 0;
+                if (zeros > 0) {
+                    --zeros;
+                } else if ((delta = readVarint(payload, at)) == 0) {
+                    zeros = readVarint(payload, at);
+                }
+                samples[i][metric] = int64_t(uint64_t(samples[i - 1][metric]) + delta);
+            }
+        }
+        REQUIRE(at == payload.size());
+    }
+    return samples;
+}
+
+TEST_CASE("The none metrics format keeps nothing") {
+    const auto format = MetricsFormat{MetricsFormat::Format::kNone};
+    REQUIRE(!format.useCsv());
+    REQUIRE(!format.useFtdc());
+    REQUIRE(!format.useHistogram());
+    REQUIRE(!format.useArrow());
+    REQUIRE_THROWS_AS(MetricsFormat{format.toString()}, std::invalid_argument);
+
+    auto metrics = internals::RegistryT<RegistryClockSourceStub>{format, "unused"};
+    auto op = metrics.operation("Actor", "Op", 1u);
+    op.report(RegistryClockSourceStub::now(), 1us, OutcomeType::kSuccess);
+    REQUIRE(!boost::filesystem::exists("unused"));
+}
+
+TEST_CASE("Native ftdc metrics format") {
+    RegistryClockSourceStub::reset();
+    const auto metricsPath =
+        (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()).string();
+    {
+        auto metrics = internals::RegistryT<RegistryClockSourceStub>{MetricsFormat("ftdc-native"),
+                                                                     metricsPath};
+        auto op1 = metrics.operation("Actor", "Op", 1u, 3);
+        auto op2 = metrics.operation("Actor", "Op", 2u, 3);
+        for (int i = 1; i <= 3; ++i) {
+            RegistryClockSourceStub::advance(200ms);
+            op1.report(RegistryClockSourceStub::now(),
+                       std::chrono::microseconds{i},
+                       i == 3 ? OutcomeType::kFailure : OutcomeType::kSuccess);
+        }
+        op2.report(RegistryClockSourceStub::now(), 1000us, OutcomeType::kSuccess);
+        // Destroying the registry flushes the streams and closes the files.
+    }
+
+    // ts, id, n, ops, size, errors, dur, total, state, workers, failed
+    auto samples = readFtdc(metricsPath + "/Actor.Op.3.ftdc");
+    REQUIRE(samples.size() == 4);
+    // Each sender thread writes its streams' events in order but the threads may interleave.
+    std::stable_sort(samples.begin(), samples.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs[1] < rhs[1];
+    });
+    for (int i = 0; i < 3; ++i) {
+        const auto& sample = samples[i];
+        REQUIRE(sample[1] == 1);
+        REQUIRE(sample[3] == 1);
+        REQUIRE(sample[6] == (i + 1) * 1000);
+        REQUIRE(sample[8] == 3);
+        REQUIRE(sample[9] == 2);
+        REQUIRE(sample[10] == (i == 2 ? 1 : 0));
+    }
+    REQUIRE(samples[1][0] - samples[0][0] == 200);
+    REQUIRE(samples[1][7] == 200 * 1000 * 1000);
+    REQUIRE(samples[3][1] == 2);
+    REQUIRE(samples[3][6] == 1000 * 1000);
+
+    boost::filesystem::remove_all(metricsPath);
+}
+
+TEST_CASE("Native ftdc files match what poplar writes") {
+    // Written by hand from the FTDC format, not by FtdcWriter. The reference document is the
+    // first sample {ts: Date(1000), id: 1, counters: {n: 1, ops: 1, size: 0, errors: 0},
+    // timers: {dur: 1000, total: 1000}, gauges: {state: 3, workers: 2, failed: false}}, then
+    // 11 metrics, 2 more samples, and their deltas metric by metric with runs of zeros as
+    // 0 <run length - 1>.
+    const std::vector<uint8_t> expectedPayload{
+        0xc1, 0x00, 0x00, 0x00, 0x09, 0x74, 0x73, 0x00, 0xe8, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x12, 0x69, 0x64, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0x63,
+        0x6f, 0x75, 0x6e, 0x74, 0x65, 0x72, 0x73, 0x00, 0x3b, 0x00, 0x00, 0x00, 0x12, 0x6e, 0x00,
+        0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x12, 0x6f, 0x70, 0x73, 0x00, 0x01, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x12, 0x73, 0x69, 0x7a, 0x65, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x12, 0x65, 0x72, 0x72, 0x6f, 0x72, 0x73, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0x74, 0x69, 0x6d, 0x65, 0x72, 0x73, 0x00,
+        0x21, 0x00, 0x00, 0x00, 0x12, 0x64, 0x75, 0x72, 0x00, 0xe8, 0x03, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x12, 0x74, 0x6f, 0x74, 0x61, 0x6c, 0x00, 0xe8, 0x03, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x03, 0x67, 0x61, 0x75, 0x67, 0x65, 0x73, 0x00, 0x2e, 0x00, 0x00, 0x00,
+        0x12, 0x73, 0x74, 0x61, 0x74, 0x65, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x12, 0x77, 0x6f, 0x72, 0x6b, 0x65, 0x72, 0x73, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x08, 0x66, 0x61, 0x69, 0x6c, 0x65, 0x64, 0x00, 0x00, 0x00,
+        // 11 metrics, 2 samples after the reference one.
+        0x0b, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00,
+        // ts: 200 200, id: 0 0, n: 1 1, ops: 1 1, size and errors: 0 0 0 1
+        0xc8, 0x01, 0xc8, 0x01, 0x00, 0x01, 0x01, 0x01, 0x01, 0x01, 0x00, 0x02, 0x01,
+        // dur: 1000 1000, total: 2000 3000, state, workers and failed: 0 0 0 0 0 1
+        0xe8, 0x07, 0xe8, 0x07, 0xd0, 0x0f, 0xb8, 0x17, 0x00, 0x04, 0x01};
+
+    // {_id: Date(1000), type: 1, data: BinData(0, ...)} up to the binary's length.
+    const std::vector<uint8_t> expectedChunkStart{
+        0x09, 0x5f, 0x69, 0x64, 0x00, 0xe8, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x10, 0x74, 0x79, 0x70, 0x65, 0x00, 0x01, 0x00, 0x00, 0x00,
+        0x05, 0x64, 0x61, 0x74, 0x61, 0x00};
+
+    const auto path =
+        (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()).string();
+    {
+        internals::v2::FtdcWriter writer{path, 3};
+        writer.write({1000, 1, 1, 1, 0, 0, 1000, 1000, 3, 2, false});
+        writer.write({1200, 1, 2, 2, 0, 0, 2000, 3000, 3, 2, false});
+        writer.write({1400, 1, 3, 3, 0, 1, 3000, 6000, 3, 2, true});
+    }
+
+    std::ifstream in{path, std::ifstream::binary};
+    const std::string file{std::istreambuf_iterator<char>{in}, {}};
+    const auto* bytes = reinterpret_cast<const uint8_t*>(file.data());
+    // The document's length, its fields, the binary's length, subtype and data.
+    REQUIRE(file.size() > 4 + expectedChunkStart.size() + 5 + 4);
+    REQUIRE(readUint32(bytes) == file.size());
+    REQUIRE(std::vector<uint8_t>(bytes + 4, bytes + 4 + expectedChunkStart.size()) ==
+            expectedChunkStart);
+
+    const auto* data = bytes + 4 + expectedChunkStart.size();
+    const auto dataSize = readUint32(data);
+    REQUIRE(data[4] == 0x00);
+    REQUIRE(data + 5 + dataSize + 1 == bytes + file.size());
+    REQUIRE(readUint32(data + 5) == expectedPayload.size());
+
+    // The compressed bytes depend on the zlib version, so compare what they decompress to.
+    uLongf size = expectedPayload.size();
+    std::vector<uint8_t> payload(size);
+    REQUIRE(uncompress(payload.data(), &size, data + 9, dataSize - 4) == Z_OK);
+    REQUIRE(size == expectedPayload.size());
+    REQUIRE(payload == expectedPayload);
+
+    boost::filesystem::remove(path);
+}
+
+template <typename T>
+T readLittleEndian(const std::string& in, size_t offset) {
+    T value;
+    std::memcpy(&value, in.data() + offset, sizeof(T));
+    return value;
+}
+
+// Where field `id` of the FlatBuffers table at `table` is, or 0 if it isn't set.
+size_t flatField(const std::string& in, size_t table, int id) {
+    const auto vtable = table - readLittleEndian<int32_t>(in, table);
+    if (size_t(4 + 2 * id) >= readLittleEndian<uint16_t>(in, vtable)) {
+        return 0;
+    }
+    const auto offset = readLittleEndian<uint16_t>(in, vtable + 4 + 2 * id);
+    return offset == 0 ? 0 : table + offset;
+}
+
+size_t flatOffset(const std::string& in, size_t at) {
+    return at + readLittleEndian<uint32_t>(in, at);
+}
+
+struct ArrowBatchColumns {
+    std::vector<uint32_t> threads;
+    std::vector<int64_t> durations;
+};
+
+// The thread and duration columns of each record batch in an Arrow IPC file.
+std::vector<ArrowBatchColumns> readArrowBatches(const std::string& path) {
+    std::ifstream file{path, std::ios::binary};
+    const std::string in{std::istreambuf_iterator<char>{file}, {}};
+    REQUIRE(in.compare(0, 8, std::string("ARROW1\0\0", 8)) == 0);
+    REQUIRE(in.compare(in.size() - 6, 6, "ARROW1") == 0);
+
+    std::vector<ArrowBatchColumns> batches;
+    for (size_t at = 8; readLittleEndian<int32_t>(in, at + 4) != 0;) {
+        REQUIRE(readLittleEndian<uint32_t>(in, at) == 0xFFFFFFFF);
+        const auto metadata = at + 8;
+        const auto body = metadata + readLittleEndian<int32_t>(in, at + 4);
+        const auto message = flatOffset(in, metadata);
+        const auto bodyLength = readLittleEndian<int64_t>(in, flatField(in, message, 3));
+        // MessageHeader::RecordBatch
+        if (in[flatField(in, message, 1)] == 3) {
+            const auto batch = flatOffset(in, flatField(in, message, 2));
+            const auto rows = readLittleEndian<int64_t>(in, flatField(in, batch, 0));
+            const auto buffers = flatOffset(in, flatField(in, batch, 2)) + 4;
+            // Each column has a validity buffer then its values. Each Buffer is 16 bytes.
+            const auto values = [&](size_t column) {
+                return body + readLittleEndian<int64_t>(in, buffers + (2 * column + 1) * 16);
+            };
+            ArrowBatchColumns columns;
+            for (int64_t row = 0; row < rows; ++row) {
+                columns.threads.push_back(readLittleEndian<uint32_t>(in, values(3) + 4 * row));
+                columns.durations.push_back(readLittleEndian<int64_t>(in, values(4) + 8 * row));
+            }
+            batches.push_back(std::move(columns));
+        }
+        at = body + bodyLength;
+    }
+    return batches;
+}
+
+TEST_CASE("Arrow metrics format") {
+    RegistryClockSourceStub::reset();
+    const auto metricsPath =
+        (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()).string();
+    auto metrics = internals::RegistryT<RegistryClockSourceStub>{
+        MetricsFormat("arrow"), metricsPath, {}, {}, std::nullopt, internals::v1::ArrowOptions{2}};
+    auto op1 = metrics.operation("Actor", "Op", 1u);
+    auto op2 = metrics.operation("Actor", "Op", 2u);
+    for (int i = 1; i <= 3; ++i) {
+        RegistryClockSourceStub::advance(200ms);
+        op1.report(RegistryClockSourceStub::now(), std::chrono::microseconds{i});
+    }
+    op2.report(RegistryClockSourceStub::now(), 1000us);
+    metrics.closeArrowFiles();
+
+    // Each thread writes a batch once it has two events and the rest when the files are closed.
+    auto batches = readArrowBatches(metricsPath + "/Actor.Op.arrow");
+    REQUIRE(batches.size() == 3);
+    std::sort(batches.begin(), batches.end(), [](const auto& lhs, const auto& rhs) {
+        return std::make_pair(lhs.threads.front(), lhs.durations.size()) >
+            std::make_pair(rhs.threads.front(), rhs.durations.size());
+    });
+    REQUIRE(batches[0].threads == std::vector<uint32_t>{2});
+    REQUIRE(batches[0].durations == std::vector<int64_t>{1000 * 1000});
+    REQUIRE(batches[1].threads == std::vector<uint32_t>{1, 1});
+    REQUIRE(batches[1].durations == std::vector<int64_t>{1000, 2000});
+    REQUIRE(batches[2].threads == std::vector<uint32_t>{1});
+    REQUIRE(batches[2].durations == std::vector<int64_t>{3000});
+
+    boost::filesystem::remove_all(metricsPath);
+}
+
+TEST_CASE("Histogram metrics format") {
+    using internals::v1::HdrHistogram;
+
+    SECTION("Percentiles are accurate to the significant digits") {
+        for (int digits = 1; digits <= 5; ++digits) {
+            HdrHistogram histogram{digits};
+            for (int64_t value = 1; value <= 100 * 1000; ++value) {
+                histogram.record(value * 997);
+            }
+            const double tolerance = std::pow(10.0, -digits);
+            for (double percentile : {50.0, 90.0, 99.0, 99.9}) {
+                const auto exact = double(int64_t(percentile * 1000) * 997);
+                const auto actual = double(histogram.valueAtPercentile(percentile));
+                INFO(digits << " digits at p" << percentile);
+                REQUIRE(std::abs(actual - exact) / exact <= tolerance);
+            }
+            REQUIRE(histogram.valueAtPercentile(100) == 100 * 1000 * 997);
+            REQUIRE(histogram.min() == 997);
+        }
+    }
+
+    SECTION("Encoded counts decode to the same histogram") {
+        HdrHistogram histogram{3};
+        histogram.record(5, 3);
+        histogram.record(12345);
+        histogram.record(987654321);
+
+        std::ostringstream encoded;
+        histogram.encode(encoded);
+        HdrHistogram decoded{3};
+        decoded.decode(encoded.str());
+        decoded.setMinMax(histogram.min(), histogram.max());
+
+        REQUIRE(decoded.totalCount() == 5);
+        for (double percentile : {10.0, 70.0, 90.0, 100.0}) {
+            REQUIRE(decoded.valueAtPercentile(percentile) ==
+                    histogram.valueAtPercentile(percentile));
+        }
+    }
+
+    SECTION("Operations are written per interval and summarized") {
+        RegistryClockSourceStub::reset();
+        const auto metricsPath =
+            (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()).string();
+        internals::v1::HistogramOptions options;
+        options.interval = 1s;
+        auto metrics =
+            internals::RegistryT<RegistryClockSourceStub>{MetricsFormat("histogram"),
+                                                          metricsPath,
+                                                          internals::v2::GrpcOptions{},
+                                                          options};
+        REQUIRE(metrics.getHistogramLog()->options().logPath ==
+                metricsPath + ".intervals.csv");
+
+        auto op1 = metrics.operation("Actor", "Op", 1u);
+        auto op2 = metrics.operation("Actor", "Op", 2u);
+        for (int i = 1; i <= 10; ++i) {
+            RegistryClockSourceStub::advance(200ms);
+            op1.report(RegistryClockSourceStub::now(),
+                       std::chrono::microseconds{i},
+                       OutcomeType::kSuccess);
+        }
+        op2.report(RegistryClockSourceStub::now(), 1000us, OutcomeType::kFailure);
+        metrics.closeHistogramLog();
+
+        std::ifstream log{metricsPath + ".intervals.csv"};
+        std::vector<std::string> lines;
+        for (std::string line; std::getline(log, line);) {
+            lines.push_back(line);
+        }
+        // The header, the column names, two full intervals of op1, its last (partial) interval,
+        // and op2's interval.
+        REQUIRE(lines.size() == 6);
+        REQUIRE(lines[0] == "#genny-histogram-log,significant-digits=3,interval-ns=1000000000");
+        REQUIRE(lines[2].rfind("0,Actor,Op,1,4,", 0) == 0);
+        REQUIRE(lines[3].rfind("1000,Actor,Op,1,5,", 0) == 0);
+
+        std::ifstream in{metricsPath + ".intervals.csv"};
+        std::ostringstream summary;
+        internals::v1::summarizeHistogramLog(in, summary);
+        REQUIRE(summary.str() ==
+                "actor,operation,threads,count,ops,documents,bytes,errors,failures,mean,min,p50,"
+                "p90,p99,p99.9,max\n"
+                "Actor,Op,2,11,11,11,0,0,1,95909,1000,6003,10007,1000000,1000000,1000000\n");
+
+        boost::filesystem::remove(metricsPath + ".intervals.csv");
+    }
+}
+
+TEST_CASE("Sampled and aggregated operations") {
+    RegistryClockSourceStub::reset();
+    auto metrics = internals::RegistryT<RegistryClockSourceStub>{MetricsFormat("cedar-csv"),
+                                                                 "unused"};
+    auto reporter = genny::metrics::internals::v1::ReporterT{metrics};
+    const auto operations = [&]() {
+        std::ostringstream out;
+        reporter.report<ReporterClockSourceStub>(out, MetricsFormat("cedar-csv"));
+        return out.str().substr(out.str().find("Operations\n"));
+    };
+
+    SECTION("Samples carry the counts and durations of the events they skip") {
+        internals::v1::ReductionOptions options;
+        options.sampleEvery = 3;
+        metrics.reduceEvents("Actor", "", options);
+        auto op = metrics.operation("Actor", "Op", 1u);
+        for (int i = 1; i <= 7; ++i) {
+            RegistryClockSourceStub::advance(1ns);
+            op.report(RegistryClockSourceStub::now(),
+                      std::chrono::microseconds{i},
+                      i == 2 ? OutcomeType::kFailure : OutcomeType::kSuccess,
+                      1,
+                      0,
+                      1,
+                      10);
+        }
+        metrics.flushReductions();
+
+        // The failure is recorded early and the last sample is only recorded by the flush.
+        REQUIRE(operations() ==
+                "Operations\n"
+                "timestamp,actor,thread,operation,duration,outcome,n,ops,errors,size\n"
+                "2,Actor,1,Op,3000,1,2,2,0,20\n"
+                "5,Actor,1,Op,12000,0,3,3,0,30\n"
+                "7,Actor,1,Op,13000,0,2,2,0,20\n");
+    }
+
+    SECTION("Buckets sum their events") {
+        const auto logPath =
+            boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+        internals::v1::ReductionOptions options;
+        options.bucket = 10ns;
+        options.bucketLogPath = logPath;
+        metrics.reduceEvents("Actor", "Op", options);
+        auto op = metrics.operation("Actor", "Op", 1u);
+        for (int i = 1; i <= 5; ++i) {
+            RegistryClockSourceStub::advance(3ns);
+            op.report(RegistryClockSourceStub::now(),
+                      std::chrono::microseconds{i},
+                      i == 2 ? OutcomeType::kFailure : OutcomeType::kSuccess,
+                      1,
+                      0,
+                      1,
+                      10);
+        }
+        metrics.flushReductions();
+
+        REQUIRE(operations() ==
+                "Operations\n"
+                "timestamp,actor,thread,operation,duration,outcome,n,ops,errors,size\n"
+                "9,Actor,1,Op,6000,1,3,3,0,30\n"
+                "15,Actor,1,Op,9000,0,2,2,0,20\n");
+
+        std::ifstream log{logPath.string()};
+        std::vector<std::string> lines;
+        for (std::string line; std::getline(log, line);) {
+            lines.push_back(line);
+        }
+        REQUIRE(lines.size() == 4);
+        REQUIRE(lines[0] == "#genny-histogram-log,significant-digits=2,interval-ns=0");
+        REQUIRE(lines[2].rfind("0,Actor,Op,1,3,3,3,30,0,1,6000,1000,3000,", 0) == 0);
+        REQUIRE(lines[3].rfind("0,Actor,Op,1,2,2,2,20,0,0,9000,4000,5000,", 0) == 0);
+        boost::filesystem::remove(logPath);
+    }
+}
+
+TEST_CASE("TSC metrics clock") {
+    using internals::v1::TscClock;
+    // Nothing is calibrated until the TSC is asked for.
+    REQUIRE(!metrics::clock::usingTsc());
+    const auto* tsc = TscClock::invariant();
+    if (!tsc) {
+        REQUIRE(!metrics::clock::useTsc(true));
+        return;
+    }
+
+    auto closeToSteady = [&]() {
+        const auto before = std::chrono::steady_clock::now();
+        const auto read = tsc->now();
+        const auto after = std::chrono::steady_clock::now();
+        // Generous since the calibration is only good to a few microseconds.
+        return read > before - 1ms && read < after + 1ms;
+    };
+    REQUIRE(closeToSteady());
+
+    auto last = tsc->now();
+    for (int i = 0; i < 3; ++i) {
+        std::this_thread::sleep_for(10ms);
+        tsc->recalibrate(10ms);
+        // Recalibrating never moves the clock back.
+        const auto now = tsc->now();
+        REQUIRE(now >= last);
+        last = now;
+        REQUIRE(closeToSteady());
+    }
+
+    REQUIRE(metrics::clock::useTsc(true));
+    REQUIRE(!metrics::clock::useTsc(false));
 }
 
 }  // namespace
@@ -80,6 +80,8 @@ public:
     }
 
 private:
+    void reportMetrics();
+
     // These are only used when constructing the workload context, but the context doesn't own
     // them.
     std::unique_ptr<Orchestrator> _orchestrator;
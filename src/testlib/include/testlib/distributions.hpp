@@ -0,0 +1,82 @@
+// Copyright 2023-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef HEADER_D9BEA6F1_9B9D_47FE_8E45_CBA2E84FAC33_INCLUDED
+#define HEADER_D9BEA6F1_9B9D_47FE_8E45_CBA2E84FAC33_INCLUDED
+
+#include <catch2/catch_all.hpp>
+
+#include <cmath>
+#include <map>
+#include <vector>
+
+#include <boost/math/distributions/chi_squared.hpp>
+
+namespace genny::testing {
+
+/**
+ * Pearson's chi-squared test of the `observed` counts against the probabilities in `pmf`, at a
+ * significance level of 0.001. Values expected fewer than 20 times are pooled into one bin.
+ */
+template <typename T>
+void requireDistribution(const std::map<T, double>& observed, const std::map<T, double>& pmf) {
+    double total = 0;
+    for (const auto& [value, count] : observed) {
+        INFO("Observed " << value << " " << count << " times");
+        REQUIRE(pmf.count(value) == 1);
+        total += count;
+    }
+
+    double chiSquared = 0;
+    int bins = 0;
+    double pooledExpected = 0;
+    double pooledObserved = 0;
+    for (const auto& [value, p] : pmf) {
+        const double expected = total * p;
+        const auto found = observed.find(value);
+        const double count = found == observed.end() ? 0 : found->second;
+        if (expected < 20) {
+            pooledExpected += expected;
+            pooledObserved += count;
+            continue;
+        }
+        chiSquared += std::pow(count - expected, 2) / expected;
+        ++bins;
+    }
+    if (pooledExpected > 0) {
+        chiSquared += std::pow(pooledObserved - pooledExpected, 2) / pooledExpected;
+        ++bins;
+    }
+
+    const boost::math::chi_squared distribution(bins - 1);
+    const double critical = boost::math::quantile(boost::math::complement(distribution, 0.001));
+    INFO("bins=" << bins);
+    REQUIRE(chiSquared < critical);
+}
+
+/**
+ * Chi-squared test of how often each value appears in `samples`.
+ */
+template <typename T>
+void requireDistribution(const std::vector<T>& samples, const std::map<T, double>& pmf) {
+    std::map<T, double> observed;
+    for (const auto& value : samples) {
+        ++observed[value];
+    }
+    requireDistribution(observed, pmf);
+}
+
+}  // namespace genny::testing
+
+#endif  // HEADER_D9BEA6F1_9B9D_47FE_8E45_CBA2E84FAC33_INCLUDED
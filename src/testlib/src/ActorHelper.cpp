@@ -21,6 +21,7 @@
 
 #include <gennylib/Orchestrator.hpp>
 #include <gennylib/context.hpp>
+#include <gennylib/parallel.hpp>
 
 #include <metrics/MetricsReporter.hpp>
 #include <metrics/metrics.hpp>
@@ -81,12 +82,21 @@ void ActorHelper::runAndVerify(ActorHelper::FuncWithContext&& runnerFunc,
 }
 
 void ActorHelper::doRunThreaded(const WorkloadContext& wl) {
+    if (wl.executionOptions().mode == v1::ExecutionOptions::Mode::kFibers) {
+        parallelRun(wl.actors(),
+                    [](const auto& actor) { actor->run(); },
+                    wl.executionOptions());
+        reportMetrics();
+        return;
+    }
+
     std::vector<std::thread> threads;
     std::transform(cbegin(wl.actors()),
                    cend(wl.actors()),
                    std::back_inserter(threads),
                    [&](const auto& actor) {
                        return std::thread{[&]() {
+                           v1::setSleepOptions(wl.executionOptions().sleep);
                            try {
                                actor->run();
                            } catch (const boost::exception& b) {
@@ -99,6 +109,10 @@ void ActorHelper::doRunThreaded(const WorkloadContext& wl) {
     for (auto& thread : threads)
         thread.join();
 
+    reportMetrics();
+}
+
+void ActorHelper::reportMetrics() {
     auto reporter = genny::metrics::Reporter{_wlc->getMetrics()};
 
     reporter.report(_metricsOutput, metrics::MetricsFormat("csv"));
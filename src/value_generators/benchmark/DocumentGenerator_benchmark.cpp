@@ -0,0 +1,103 @@
+// Copyright 2022-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <chrono>
+#include <string>
+
+#include <boost/log/trivial.hpp>
+
+#include <gennylib/Node.hpp>
+
+#include <value_generators/DefaultRandom.hpp>
+#include <value_generators/DocumentGenerator.hpp>
+
+#include <testlib/helpers.hpp>
+
+namespace genny {
+namespace {
+
+// Shaped like the documents CrudActor workloads typically insert: mostly constant fields with
+// a few random ones.
+constexpr auto kTemplate = R"(
+a: {^RandomInt: {min: 0, max: 1000000}}
+b: {^RandomInt: {distribution: geometric, p: 0.1}}
+c: {^RandomDouble: {min: 0, max: 100}}
+s: {^FastRandomString: {length: 100}}
+t: {^RandomString: {length: {^RandomInt: {min: 8, max: 16}}}}
+type: widget
+tags: [red, green, blue]
+meta: {version: 3, owner: genny, limits: {min: 0, max: 100}}
+pos: {x: {^RandomInt: {min: 0, max: 100}}, y: 1}
+choice: {^Choose: {from: [1, 2, 3]}}
+)";
+
+// Shaped like the documents Loader workloads insert: the same keys and types every time, so the
+// program is a skeleton patched in place.
+constexpr auto kFixedShapeTemplate = R"(
+_id: {^ObjectId: {^FastRandomString: {length: 24, alphabet: "0123456789abcdef"}}}
+id: {^Inc: {}}
+a: {^RandomInt: {min: 0, max: 1000000}}
+c: {^RandomDouble: {min: 0, max: 100}}
+s: {^FastRandomString: {length: 100}}
+when: {^RandomDate: {min: "2020-01-01", max: "2021-01-01"}}
+type: widget
+meta: {version: 3, owner: genny, limits: {min: 0, max: 100}}
+pos: {x: {^RandomInt: {min: 0, max: 100}}, y: 1}
+)";
+
+constexpr int kDocuments = 100000;
+
+std::chrono::nanoseconds timeOf(DocumentGenerator& docGen,
+                                bsoncxx::document::value (DocumentGenerator::*evaluate)()) {
+    size_t bytes = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kDocuments; ++i) {
+        bytes += (docGen.*evaluate)().view().length();
+    }
+    const auto duration = std::chrono::steady_clock::now() - start;
+    REQUIRE(bytes > 0);
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(duration);
+}
+
+void compare(const char* yaml, const std::string& name) {
+    NodeSource ns{yaml, "DocumentGenerator_benchmark"};
+
+    DefaultRandom programRng;
+    DefaultRandom treeRng;
+    DocumentGenerator program{ns.root(), GeneratorArgs{programRng, 1}};
+    DocumentGenerator tree{ns.root(), GeneratorArgs{treeRng, 1}};
+    for (int i = 0; i < 1000; ++i) {
+        REQUIRE(program().view() == tree.evaluateTree().view());
+    }
+
+    const auto treeTime = timeOf(tree, &DocumentGenerator::evaluateTree);
+    const auto programTime = timeOf(program, &DocumentGenerator::evaluate);
+
+    BOOST_LOG_TRIVIAL(info) << "Generating " << kDocuments << " " << name << " documents took "
+                            << treeTime.count() / kDocuments << "ns each walking the tree and "
+                            << programTime.count() / kDocuments << "ns each running the program";
+    REQUIRE(programTime < treeTime);
+}
+
+TEST_CASE("Compiled DocumentGenerator programs", "[benchmark]") {
+    SECTION("Typical documents") {
+        compare(kTemplate, "typical");
+    }
+    SECTION("Fixed-shape documents") {
+        compare(kFixedShapeTemplate, "fixed-shape");
+    }
+}
+
+}  // namespace
+}  // namespace genny
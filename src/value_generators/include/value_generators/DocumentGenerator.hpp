@@ -123,6 +123,13 @@ public:
      * @return
      */
     bsoncxx::document::value evaluate();
+    /**
+     * Same as `evaluate()` but walks the tree of generators the node was parsed into rather
+     * than running the flat program that tree is compiled into. Both draw the same random
+     * numbers and produce the same bytes; this is only here to test and benchmark the two
+     * against each other.
+     */
+    bsoncxx::document::value evaluateTree();
     DocumentGenerator(DocumentGenerator&&) noexcept;
     ~DocumentGenerator();
     class Impl;
@@ -15,6 +15,7 @@
 #ifndef HEADER_0BC4D6BC_FC92_4F1C_BAEA_26A633807830_INCLUDE
 #define HEADER_0BC4D6BC_FC92_4F1C_BAEA_26A633807830_INCLUDE
 
+#include <atomic>
 #include <cstdint>
 #include <exception>
 #include <memory>
@@ -22,12 +23,41 @@
 #include <string>
 #include <vector>
 
+#include <boost/random/uniform_int_distribution.hpp>
+
+#include <value_generators/DefaultRandom.hpp>
+
 namespace genny::v1 {
 
+/**
+ * Find the item holding the given instance in a 1-based Fenwick tree over item counts.
+ *
+ * Instances are numbered from zero in item order, so with counts {2, 3} instances 0 and 1 belong
+ * to item 0 and instances 2 through 4 belong to item 1.
+ *
+ * @return the 0-based index of the item, or `size` if the tree holds fewer instances.
+ */
+template <typename Tree>
+size_t fenwickFind(const Tree& tree, size_t size, uint64_t instance) {
+    size_t step = 1;
+    while (step * 2 <= size) {
+        step *= 2;
+    }
+    size_t position = 0;
+    for (; step > 0; step /= 2) {
+        if (position + step <= size && tree[position + step] <= instance) {
+            position += step;
+            instance -= tree[position];
+        }
+    }
+    return position;
+}
+
 /**
  * Genny frequency map. A list of pairs <string, count>
  *
- * The list is unsorted.
+ * The list is unsorted. Items keep their index when their count runs out, and a Fenwick tree over
+ * the counts lets callers find, take, and total the remaining instances in O(log n).
  */
 class FrequencyMap {
 public:
@@ -35,57 +65,170 @@ public:
      * Add an item and a count to the back of the list of items in the map.
      */
     void push_back(std::string name, size_t count) {
-        _list.push_back({name, count});
+        _list.push_back({std::move(name), count});
+        if (_tree.empty()) {
+            _tree.push_back(0);
+        }
+        // The new node covers the items (i - lowbit(i), i], the ones before it are already
+        // summed by the nodes i - 1, i - 1 - lowbit(i - 1), ...
+        const size_t i = _list.size();
+        uint64_t sum = count;
+        for (size_t j = i - 1; j > i - (i & -i); j -= j & -j) {
+            sum += _tree[j];
+        }
+        _tree.push_back(sum);
+
+        _total += count;
+        if (count > 0) {
+            ++_size;
+        }
     }
 
     /**
      * Take a instance of one of the items, decrements the count.
      *
-     * It the count for the item goes to zero, it removes the item.
-     *
-     * Throws an error if there are no items in the map.
+     * Throws an error if the index is out of bounds or the item has no instances left.
      */
     std::string take(size_t index) {
-        if (index >= _list.size()) {
+        if (index >= _list.size() || _list[index].second == 0) {
             throw std::range_error("Out of bounds of frequency map");
         }
 
         auto& pair = _list[index];
-        auto ret = pair.first;
         pair.second--;
 
         // We have taken all the entries for this element
         if (pair.second == 0) {
-            _list.erase(_list.begin() + index);
+            --_size;
         }
+        for (size_t i = index + 1; i <= _list.size(); i += i & -i) {
+            --_tree[i];
+        }
+        --_total;
+
+        return pair.first;
+    }
 
-        return ret;
+    /**
+     * Returns the index of the item holding the given instance, counting the remaining instances
+     * from zero in list order. Picking `instance` uniformly from [0, total_count()) picks items in
+     * proportion to their remaining counts.
+     *
+     * Throws an error if `instance` is not less than total_count().
+     */
+    size_t find(uint64_t instance) const {
+        if (instance >= _total) {
+            throw std::range_error("Out of bounds of frequency map");
+        }
+        return fenwickFind(_tree, _list.size(), instance);
     }
 
     /**
      * Returns the number of elements with counts
      */
     size_t size() const {
-        return _list.size();
+        return _size;
     }
 
     /**
      * Returns a total size of the frequency map
      */
     size_t total_count() const {
-        size_t total_count = 0;
+        return _total;
+    }
 
-        for (const auto& p : _list) {
-            total_count += p.second;
+private:
+    friend class ConcurrentFrequencyMap;
+
+    std::vector<std::pair<std::string, uint64_t>> _list;
+    // 1-based Fenwick tree: _tree[i] is the sum of the counts of items (i - lowbit(i), i].
+    std::vector<uint64_t> _tree;
+    size_t _size = 0;
+    uint64_t _total = 0;
+};
+
+/**
+ * A FrequencyMap that many threads can take from at once without a lock.
+ *
+ * Its items are fixed when it's constructed. Each item is handed out exactly as many times as its
+ * count, and items are picked in proportion to their remaining counts, which is exact when one
+ * thread is taking and approximate while other threads are part way through a take.
+ */
+class ConcurrentFrequencyMap {
+public:
+    explicit ConcurrentFrequencyMap(const FrequencyMap& map)
+        : _names(map._list.size()),
+          _counts{std::make_unique<std::atomic<uint64_t>[]>(map._list.size())},
+          _tree{std::make_unique<std::atomic<uint64_t>[]>(map._tree.size())},
+          _remaining{map._total} {
+        for (size_t i = 0; i < map._list.size(); ++i) {
+            _names[i] = map._list[i].first;
+            _counts[i] = map._list[i].second;
         }
+        for (size_t i = 0; i < map._tree.size(); ++i) {
+            _tree[i] = map._tree[i];
+        }
+    }
 
-        return total_count;
+    /**
+     * Take an instance of a random item, weighted by the remaining counts.
+     *
+     * Throws an error if all the instances have been taken.
+     */
+    std::string take(DefaultRandom& rng) {
+        // Reserve an instance first so that no more than the total are ever handed out and a
+        // reserved take always has an instance left to find. Every counter here is only ever
+        // updated with a single atomic read-modify-write, so relaxed ordering is enough.
+        auto remaining = _remaining.load(std::memory_order_relaxed);
+        do {
+            if (remaining == 0) {
+                throw std::range_error("Frequency map is empty");
+            }
+        } while (!_remaining.compare_exchange_weak(
+            remaining, remaining - 1, std::memory_order_relaxed));
+
+        // The item counts are the source of truth and the tree can briefly overcount items that
+        // another thread has claimed but not yet removed from the tree, so a draw can land on an
+        // item that has run out. Draw again until one lands on an item this thread can claim.
+        for (uint64_t range = remaining;;) {
+            auto distribution = boost::random::uniform_int_distribution<uint64_t>(0, range - 1);
+            const auto index = fenwickFind(_tree, _names.size(), distribution(rng));
+            if (index < _names.size() && claim(index)) {
+                for (size_t i = index + 1; i <= _names.size(); i += i & -i) {
+                    _tree[i].fetch_sub(1, std::memory_order_relaxed);
+                }
+                return _names[index];
+            }
+            range = _remaining.load(std::memory_order_relaxed) + 1;
+        }
+    }
+
+    /**
+     * Returns the number of instances that haven't been taken or reserved by a take.
+     */
+    uint64_t total_count() const {
+        return _remaining.load(std::memory_order_relaxed);
     }
 
 private:
-    std::vector<std::pair<std::string, uint64_t>> _list;
+    bool claim(size_t index) {
+        auto count = _counts[index].load(std::memory_order_relaxed);
+        do {
+            if (count == 0) {
+                return false;
+            }
+        } while (!_counts[index].compare_exchange_weak(
+            count, count - 1, std::memory_order_relaxed));
+        return true;
+    }
+
+    std::vector<std::string> _names;
+    std::unique_ptr<std::atomic<uint64_t>[]> _counts;
+    // Same layout as FrequencyMap::_tree.
+    std::unique_ptr<std::atomic<uint64_t>[]> _tree;
+    std::atomic<uint64_t> _remaining;
 };
 
 }  // namespace genny::v1
 
-#endif
\ No newline at end of file
+#endif
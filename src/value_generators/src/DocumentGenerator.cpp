@@ -16,7 +16,9 @@
 #include <value_generators/DocumentGenerator.hpp>
 #include <value_generators/FrequencyMap.hpp>
 
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <fstream>
 #include <functional>
 #include <iostream>
@@ -40,70 +42,156 @@
 #include <bsoncxx/decimal128.hpp>
 #include <bsoncxx/json.hpp>
 #include <bsoncxx/oid.hpp>
+#include <bsoncxx/types.hpp>
 #include <bsoncxx/types/bson_value/view.hpp>
 
 namespace {
 
+/**
+ * Zipfian distribution over [1, n], drawing k with probability proportional to 1/k^alpha.
+ *
+ * Samples by rejection-inversion (W. Hörmann and G. Derflinger, "Rejection-inversion to generate
+ * variates from monotone discrete distributions", 1996), as in Apache Commons RNG's
+ * RejectionInversionZipfSampler. Setup takes constant time and each sample a small, bounded
+ * expected number of uniform draws, however large n is.
+ */
 template <class IntType = int64_t>
 class zipfian_distribution {
 public:
     explicit zipfian_distribution(double alpha, IntType n)
-        : _alpha{alpha}, _n{n}, _c{calculateNormalizationConstant(n, alpha)} {}
+        : _alpha{alpha},
+          _n{n},
+          _hIntegralX1{hIntegral(1.5) - 1},
+          _hIntegralN{hIntegral(double(n) + 0.5)},
+          _s{2 - hIntegralInverse(hIntegral(2.5) - h(2))} {}
 
     template <class URNG>
     IntType operator()(URNG& urng) {
-        return generate(urng);
+        boost::random::uniform_01<> uniform01{};
+        while (true) {
+            // Invert a uniform draw from the area under the continuous hat function h, then
+            // accept it if it's also under the histogram of the discrete distribution.
+            const double u = _hIntegralN + uniform01(urng) * (_hIntegralX1 - _hIntegralN);
+            const double x = hIntegralInverse(u);
+            const auto k = std::clamp<IntType>(IntType(x + 0.5), 1, _n);
+            if (double(k) - x <= _s || u >= hIntegral(double(k) + 0.5) - h(double(k))) {
+                return k;
+            }
+        }
     }
 
 private:
+    // h(x) = 1/x^alpha, the continuous hat function.
+    double h(double x) const {
+        return std::exp(-_alpha * std::log(x));
+    }
+
+    // The integral of h from 1 to x, with the constant chosen so it's continuous in alpha.
+    double hIntegral(double x) const {
+        const double logX = std::log(x);
+        return expm1Over((1 - _alpha) * logX) * logX;
+    }
+
+    double hIntegralInverse(double x) const {
+        const double t = std::max(x * (1 - _alpha), -1.0);
+        return std::exp(log1pOver(t) * x);
+    }
+
+    // log(1 + x) / x and (exp(x) - 1) / x, accurate near 0 where alpha is near 1.
+    static double log1pOver(double x) {
+        if (std::abs(x) > 1e-8) {
+            return std::log1p(x) / x;
+        }
+        return 1 - x * (0.5 - x * (1.0 / 3 - 0.25 * x));
+    }
+
+    static double expm1Over(double x) {
+        if (std::abs(x) > 1e-8) {
+            return std::expm1(x) / x;
+        }
+        return 1 + x * 0.5 * (1 + x * (1.0 / 3) * (1 + 0.25 * x));
+    }
+
     // Shape parameter for the distribution.
     double _alpha;
-    // Normalization constant for the distribution.
-    double _c;
     // Number of distinct elements in the distribution.
     IntType _n;
+    double _hIntegralX1;
+    double _hIntegralN;
+    // Draws within this of k are accepted without evaluating hIntegral.
+    double _s;
+};
 
-    // This implementation is based on https://cse.usf.edu/~kchriste/tools/genzipf.c,
-    // it uses the inverse transform sampling method for generating random numbers.
-    // This method is not the most accurate and efficient for heavy tailed distributions,
-    // but is sufficient for our current purposes as we're not doing any numerical analysis.
-    template <class URNG>
-    IntType generate(URNG& urng) {
-        boost::random::uniform_01<> _uniform01{};
-        double randomNumber = 1.0 - _uniform01(urng);
-        double sum = 0;
-
-        for (IntType i = 1; i <= _n; ++i) {
-            // std::pow might be a point for optimization, although fast calculation
-            // of powers might reduce accuracy, so this is TBD.
-            // Another point for optimization is to hold these cumulative sum values
-            // in a precomputed array since they are the same for generate() calls.
-            sum += 1.0 / std::pow(i, _alpha);
-            if (sum >= randomNumber * _c) {
-                return i;
-            }
+/**
+ * A fixed pseudo-random permutation of [0, n).
+ *
+ * A 4-round Feistel network permutes the smallest power of 4 that's at least n. Values that land
+ * outside [0, n) are permuted again until they land inside it, which takes under 4 rounds of the
+ * network on average.
+ */
+template <class IntType = int64_t>
+class scrambled_permutation {
+public:
+    explicit scrambled_permutation(IntType n) : _n{n} {
+        while (_halfBits < 32 && (uint64_t{1} << (2 * _halfBits)) < uint64_t(n)) {
+            ++_halfBits;
         }
+        _mask = (uint64_t{1} << _halfBits) - 1;
     }
 
-    double calculateNormalizationConstant(IntType n, double alpha) {
-        double constant = 0;
-        for (int64_t i = 1; i <= n; ++i) {
-            constant += 1.0 / std::pow(i, alpha);
+    IntType operator()(IntType x) const {
+        auto y = uint64_t(x);
+        do {
+            y = permute(y);
+        } while (y >= uint64_t(_n));
+        return IntType(y);
+    }
+
+private:
+    uint64_t permute(uint64_t x) const {
+        // Fixed keys, so every actor agrees on where each rank goes.
+        constexpr uint64_t kKeys[] = {
+            0x9e3779b97f4a7c15, 0xbf58476d1ce4e5b9, 0x94d049bb133111eb, 0xd6e8feb86659fd93};
+        auto left = x >> _halfBits;
+        auto right = x & _mask;
+        for (auto key : kKeys) {
+            const auto next = left ^ (mix(right ^ key) & _mask);
+            left = right;
+            right = next;
         }
-        return constant;
+        return (left << _halfBits) | right;
     }
+
+    // The splitmix64 finalizer.
+    static uint64_t mix(uint64_t z) {
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+        return z ^ (z >> 31);
+    }
+
+    IntType _n;
+    int _halfBits = 0;
+    uint64_t _mask = 0;
 };
 }  // namespace
 
 namespace {
 using bsoncxx::oid;
 
+class Program;
+
 class Appendable {
 public:
     virtual ~Appendable() = default;
     virtual void append(const std::string& key, bsoncxx::builder::basic::document& builder) = 0;
     virtual void append(bsoncxx::builder::basic::array& builder) = 0;
 
+    /**
+     * Add this value to `program` as the field `key`. By default the program calls append() for
+     * it; generators whose output it can write directly override this.
+     */
+    virtual void lower(const std::string& key, Program& program);
+
 protected:
     // Custom hasher to enable hashing for BSON types.
     struct SetHasher {
@@ -145,6 +233,250 @@ protected:
 };
 
 using UniqueAppendable = std::unique_ptr<Appendable>;
+
+/**
+ * A document template lowered into a flat list of ops that write BSON straight into a buffer
+ * reused across evaluations.
+ *
+ * Fields whose values never change are encoded once, when the program is built, and adjacent
+ * ones are merged into a single copy. Values of the common scalar types are written in place.
+ * Anything else is evaluated with Appendable::append into a scratch builder and copied over.
+ * Ops run in the same order the generator tree evaluates its fields, so a program makes the
+ * same random draws and produces the same bytes as the tree it was lowered from.
+ *
+ * Most templates have a fixed shape: the same keys and types every time, with values of fixed
+ * width. Their programs are reduced to a skeleton of the whole document, encoded once, and a
+ * list of offsets into it. Each run copies the skeleton and writes the values at those offsets.
+ *
+ * Assumes a little-endian host, as BSON is little-endian.
+ */
+class Program {
+public:
+    /** Types whose values ops write directly. */
+    template <typename T>
+    static constexpr bool kWritesDirectly = std::is_same_v<T, int32_t> ||
+        std::is_same_v<T, int64_t> || std::is_same_v<T, double> ||
+        std::is_same_v<T, std::string> || std::is_same_v<T, bsoncxx::types::b_date> ||
+        std::is_same_v<T, bsoncxx::types::b_oid> || std::is_same_v<T, bsoncxx::types::b_binary>;
+
+    /** Add a field whose value never changes. */
+    void constant(const std::string& key, Appendable& value) {
+        bsoncxx::builder::basic::document builder;
+        value.append(key, builder);
+        write(elementOf(builder.view()));
+    }
+
+    /** Add a field whose value is written directly from a generator of one of the above types. */
+    template <typename T>
+    void direct(const std::string& key, genny::Generator<T>& value);
+
+    /** Add a field whose value is evaluated by Appendable::append. */
+    void fallback(const std::string& key, Appendable& value) {
+        _keys.push_back(key);
+        add(Op{OpCode::kAppend, _keys.size() - 1, 0, &value});
+    }
+
+    /** Add an embedded document or array field holding the fields of `body`. */
+    void embed(const std::string& key, bsoncxx::type type, const Program& body) {
+        std::string prefix{char(type)};
+        prefix.append(key.c_str(), key.size() + 1);
+        enclose(prefix, body);
+    }
+
+    /** Make this the program for a top-level document holding the fields of `body`. */
+    void enclose(const Program& body) {
+        enclose({}, body);
+        _opened.reserve(_depth);
+        buildSkeleton();
+    }
+
+    bsoncxx::document::value run();
+
+private:
+    enum class OpCode : uint8_t {
+        // Copy `length` pre-encoded bytes starting at `offset` in _bytes.
+        kBytes,
+        // Write the value of `source`, whose type and key are already written.
+        kInt32,
+        kInt64,
+        kDouble,
+        kDate,
+        kOid,
+        kString,
+        kBinary,
+        // Append `source` under the key at index `offset` in _keys.
+        kAppend,
+        // Start and finish an embedded document, whose type and key are already written.
+        kOpen,
+        kClose,
+    };
+
+    struct Op {
+        OpCode code;
+        size_t offset = 0;
+        size_t length = 0;
+        Appendable* source = nullptr;
+        // For kString and kBinary, whether every value is `length` bytes long.
+        bool fixed = false;
+    };
+
+    static std::string_view elementOf(bsoncxx::document::view document) {
+        // Skip the document's length prefix and trailing null.
+        return {reinterpret_cast<const char*>(document.data()) + 4, document.length() - 5};
+    }
+
+    void add(Op op) {
+        _ops.push_back(op);
+    }
+
+    void write(std::string_view bytes) {
+        if (!_ops.empty() && _ops.back().code == OpCode::kBytes) {
+            _ops.back().length += bytes.size();
+        } else {
+            add(Op{OpCode::kBytes, _bytes.size(), bytes.size()});
+        }
+        _bytes.append(bytes);
+    }
+
+    // Append `body`'s ops, merging its leading bytes with any we end with.
+    void splice(const Program& body) {
+        for (auto op : body._ops) {
+            if (op.code == OpCode::kBytes) {
+                write(std::string_view{body._bytes}.substr(op.offset, op.length));
+                continue;
+            }
+            if (op.code == OpCode::kAppend) {
+                _keys.push_back(body._keys[op.offset]);
+                op.offset = _keys.size() - 1;
+            }
+            add(op);
+        }
+        _depth = std::max(_depth, body._depth);
+    }
+
+    void enclose(std::string_view prefix, const Program& body) {
+        write(prefix);
+        if (body._ops.empty() || (body._ops.size() == 1 && body._ops[0].code == OpCode::kBytes)) {
+            // Encode a document of only constant fields whole.
+            const int32_t length = 4 + body._bytes.size() + 1;
+            write({reinterpret_cast<const char*>(&length), sizeof(length)});
+            write(body._bytes);
+            write(std::string_view{"", 1});
+            return;
+        }
+        add(Op{OpCode::kOpen});
+        splice(body);
+        add(Op{OpCode::kClose});
+        _depth = std::max(_depth, body._depth + 1);
+    }
+
+    template <typename T>
+    void put(const T& value) {
+        const auto size = _buffer.size();
+        _buffer.resize(size + sizeof(T));
+        std::memcpy(_buffer.data() + size, &value, sizeof(T));
+    }
+
+    void put(std::string_view bytes) {
+        _buffer.insert(_buffer.end(), bytes.begin(), bytes.end());
+    }
+
+    // If every op writes a fixed number of bytes, lay them all out in _skeleton and keep the
+    // ops that write values in _patches, with their `offset` into it.
+    void buildSkeleton() {
+        std::string skeleton;
+        std::vector<Op> patches;
+        std::vector<size_t> opened;
+        for (auto op : _ops) {
+            const auto at = skeleton.size();
+            switch (op.code) {
+                case OpCode::kBytes:
+                    skeleton.append(_bytes, op.offset, op.length);
+                    continue;
+                case OpCode::kOpen:
+                    opened.push_back(at);
+                    skeleton.append(4, '\0');
+                    continue;
+                case OpCode::kClose: {
+                    skeleton.push_back('\0');
+                    const int32_t length = skeleton.size() - opened.back();
+                    std::memcpy(skeleton.data() + opened.back(), &length, sizeof(length));
+                    opened.pop_back();
+                    continue;
+                }
+                case OpCode::kInt32:
+                    skeleton.append(sizeof(int32_t), '\0');
+                    break;
+                case OpCode::kInt64:
+                case OpCode::kDouble:
+                case OpCode::kDate:
+                    skeleton.append(8, '\0');
+                    break;
+                case OpCode::kOid:
+                    skeleton.append(oid::k_oid_length, '\0');
+                    break;
+                case OpCode::kString: {
+                    if (!op.fixed) {
+                        return;
+                    }
+                    // Only the characters are patched.
+                    const int32_t length = op.length + 1;
+                    skeleton.append(reinterpret_cast<const char*>(&length), sizeof(length));
+                    op.offset = skeleton.size();
+                    skeleton.append(op.length + 1, '\0');
+                    patches.push_back(op);
+                    continue;
+                }
+                case OpCode::kBinary: {
+                    if (!op.fixed) {
+                        return;
+                    }
+                    // The subtype and the bytes are patched.
+                    const int32_t length = op.length;
+                    skeleton.append(reinterpret_cast<const char*>(&length), sizeof(length));
+                    op.offset = skeleton.size();
+                    skeleton.append(op.length + 1, '\0');
+                    patches.push_back(op);
+                    continue;
+                }
+                case OpCode::kAppend:
+                    return;
+            }
+            op.offset = at;
+            patches.push_back(op);
+        }
+        _skeleton = std::move(skeleton);
+        _patches = std::move(patches);
+    }
+
+    // Write the value of a patch from _patches into the copy of the skeleton at `document`.
+    void patch(const Op& op, char* document);
+
+    static void checkFixedLength(size_t length, const Op& op) {
+        if (length != op.length) {
+            std::stringstream msg;
+            msg << "Generator of values of length " << op.length << " produced one of length "
+                << length;
+            BOOST_THROW_EXCEPTION(std::logic_error(msg.str()));
+        }
+    }
+
+    // What run() executes.
+    std::vector<Op> _ops;
+    std::string _bytes;
+    std::vector<std::string> _keys;
+    size_t _depth = 0;
+
+    // Set if the document has a fixed shape, in which case run() only uses these.
+    std::optional<std::string> _skeleton;
+    std::vector<Op> _patches;
+
+    // Reused by each run().
+    std::vector<char> _buffer;
+    std::vector<size_t> _opened;
+    std::string _string;
+    bsoncxx::builder::basic::document _scratch;
+};
 }  // namespace
 
 namespace genny {
@@ -154,15 +486,200 @@ class Generator : public Appendable {
 public:
     ~Generator() override = default;
     virtual T evaluate() = 0;
+    /**
+     * Evaluate into `out`. Generators that can reuse its storage override this.
+     */
+    virtual void evaluateInto(T& out) {
+        out = this->evaluate();
+    }
+    /**
+     * @return the length of every value, for generators of strings or binary data whose values
+     *   never change length.
+     */
+    virtual std::optional<size_t> fixedLength() {
+        return std::nullopt;
+    }
     void append(const std::string& key, bsoncxx::builder::basic::document& builder) override {
         builder.append(bsoncxx::builder::basic::kvp(key, this->evaluate()));
     }
     void append(bsoncxx::builder::basic::array& builder) override {
         builder.append(this->evaluate());
     }
+    void lower(const std::string& key, Program& program) override {
+        if constexpr (Program::kWritesDirectly<T>) {
+            program.direct(key, *this);
+        } else {
+            program.fallback(key, *this);
+        }
+    }
 };
 }  // namespace genny
 
+namespace {
+
+void Appendable::lower(const std::string& key, Program& program) {
+    program.fallback(key, *this);
+}
+
+template <typename T>
+void Program::direct(const std::string& key, genny::Generator<T>& value) {
+    const auto [type, code] = [&]() {
+        if constexpr (std::is_same_v<T, int32_t>) {
+            return std::make_pair(bsoncxx::type::k_int32, OpCode::kInt32);
+        } else if constexpr (std::is_same_v<T, int64_t>) {
+            return std::make_pair(bsoncxx::type::k_int64, OpCode::kInt64);
+        } else if constexpr (std::is_same_v<T, double>) {
+            return std::make_pair(bsoncxx::type::k_double, OpCode::kDouble);
+        } else if constexpr (std::is_same_v<T, bsoncxx::types::b_date>) {
+            return std::make_pair(bsoncxx::type::k_date, OpCode::kDate);
+        } else if constexpr (std::is_same_v<T, bsoncxx::types::b_oid>) {
+            return std::make_pair(bsoncxx::type::k_oid, OpCode::kOid);
+        } else if constexpr (std::is_same_v<T, bsoncxx::types::b_binary>) {
+            return std::make_pair(bsoncxx::type::k_binary, OpCode::kBinary);
+        } else {
+            static_assert(std::is_same_v<T, std::string>);
+            return std::make_pair(bsoncxx::type::k_utf8, OpCode::kString);
+        }
+    }();
+    std::string prefix{char(type)};
+    prefix.append(key.c_str(), key.size() + 1);
+    write(prefix);
+    Op op{code, 0, 0, &value};
+    if (auto length = value.fixedLength()) {
+        op.fixed = true;
+        op.length = *length;
+    }
+    add(op);
+}
+
+void Program::patch(const Op& op, char* document) {
+    auto at = document + op.offset;
+    switch (op.code) {
+        case OpCode::kInt32: {
+            const auto value = static_cast<genny::Generator<int32_t>*>(op.source)->evaluate();
+            std::memcpy(at, &value, sizeof(value));
+            break;
+        }
+        case OpCode::kInt64: {
+            const auto value = static_cast<genny::Generator<int64_t>*>(op.source)->evaluate();
+            std::memcpy(at, &value, sizeof(value));
+            break;
+        }
+        case OpCode::kDouble: {
+            const auto value = static_cast<genny::Generator<double>*>(op.source)->evaluate();
+            std::memcpy(at, &value, sizeof(value));
+            break;
+        }
+        case OpCode::kDate: {
+            const auto value = static_cast<genny::Generator<bsoncxx::types::b_date>*>(op.source)
+                                   ->evaluate()
+                                   .to_int64();
+            std::memcpy(at, &value, sizeof(value));
+            break;
+        }
+        case OpCode::kOid: {
+            const auto value =
+                static_cast<genny::Generator<bsoncxx::types::b_oid>*>(op.source)->evaluate();
+            std::memcpy(at, value.value.bytes(), oid::k_oid_length);
+            break;
+        }
+        case OpCode::kString:
+            static_cast<genny::Generator<std::string>*>(op.source)->evaluateInto(_string);
+            checkFixedLength(_string.size(), op);
+            std::memcpy(at, _string.data(), op.length);
+            break;
+        case OpCode::kBinary: {
+            const auto value =
+                static_cast<genny::Generator<bsoncxx::types::b_binary>*>(op.source)->evaluate();
+            checkFixedLength(value.size, op);
+            *at = char(value.sub_type);
+            std::memcpy(at + 1, value.bytes, op.length);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+bsoncxx::document::value Program::run() {
+    if (_skeleton) {
+        const auto size = _skeleton->size();
+        auto document = new uint8_t[size];
+        bsoncxx::document::value out{document, size, [](uint8_t* data) { delete[] data; }};
+        std::memcpy(document, _skeleton->data(), size);
+        for (const auto& op : _patches) {
+            patch(op, reinterpret_cast<char*>(document));
+        }
+        return out;
+    }
+
+    _buffer.clear();
+    // In case the last run threw.
+    _opened.clear();
+    for (const auto& op : _ops) {
+        switch (op.code) {
+            case OpCode::kBytes:
+                put(std::string_view{_bytes}.substr(op.offset, op.length));
+                break;
+            case OpCode::kInt32:
+                put(static_cast<genny::Generator<int32_t>*>(op.source)->evaluate());
+                break;
+            case OpCode::kInt64:
+                put(static_cast<genny::Generator<int64_t>*>(op.source)->evaluate());
+                break;
+            case OpCode::kDouble:
+                put(static_cast<genny::Generator<double>*>(op.source)->evaluate());
+                break;
+            case OpCode::kDate:
+                put(static_cast<genny::Generator<bsoncxx::types::b_date>*>(op.source)
+                        ->evaluate()
+                        .to_int64());
+                break;
+            case OpCode::kOid:
+                put(std::string_view{
+                    static_cast<genny::Generator<bsoncxx::types::b_oid>*>(op.source)
+                        ->evaluate()
+                        .value.bytes(),
+                    oid::k_oid_length});
+                break;
+            case OpCode::kString:
+                static_cast<genny::Generator<std::string>*>(op.source)->evaluateInto(_string);
+                put(int32_t(_string.size() + 1));
+                put(std::string_view{_string.c_str(), _string.size() + 1});
+                break;
+            case OpCode::kBinary: {
+                const auto value =
+                    static_cast<genny::Generator<bsoncxx::types::b_binary>*>(op.source)
+                        ->evaluate();
+                put(int32_t(value.size));
+                put(char(value.sub_type));
+                put(std::string_view{reinterpret_cast<const char*>(value.bytes), value.size});
+                break;
+            }
+            case OpCode::kAppend:
+                _scratch.clear();
+                op.source->append(_keys[op.offset], _scratch);
+                put(elementOf(_scratch.view()));
+                break;
+            case OpCode::kOpen:
+                _opened.push_back(_buffer.size());
+                put(int32_t{0});
+                break;
+            case OpCode::kClose: {
+                put(char{0});
+                const auto start = _opened.back();
+                _opened.pop_back();
+                const int32_t length = _buffer.size() - start;
+                std::memcpy(_buffer.data() + start, &length, sizeof(length));
+                break;
+            }
+        }
+    }
+    return bsoncxx::document::value{
+        bsoncxx::document::view{reinterpret_cast<const uint8_t*>(_buffer.data()), _buffer.size()}};
+}
+}  // namespace
+
 namespace {
 using namespace genny;
 const static boost::posix_time::ptime epoch{boost::gregorian::date(1970, 1, 1)};
@@ -175,6 +692,9 @@ public:
     T evaluate() override {
         return _value;
     }
+    void lower(const std::string& key, Program& program) override {
+        program.constant(key, *this);
+    }
 
 protected:
     T _value;
@@ -188,6 +708,17 @@ public:
 
     explicit Impl(Entries entries) : _entries{std::move(entries)} {}
 
+    /**
+     * Build the program run(). Embedded documents are lowered into their parent's program instead.
+     */
+    void compile() {
+        _program.enclose(body());
+    }
+
+    bsoncxx::document::value run() {
+        return _program.run();
+    }
+
     bsoncxx::document::value evaluate() override {
         bsoncxx::builder::basic::document builder;
         for (auto&& [k, app] : _entries) {
@@ -196,8 +727,21 @@ public:
         return builder.extract();
     }
 
+    void lower(const std::string& key, Program& program) override {
+        program.embed(key, bsoncxx::type::k_document, body());
+    }
+
 private:
+    Program body() {
+        Program body;
+        for (auto&& [k, app] : _entries) {
+            app->lower(k, body);
+        }
+        return body;
+    }
+
     Entries _entries;
+    Program _program;
 };
 }  // namespace genny
 
@@ -543,23 +1087,62 @@ private:
 /** `{^RandomInt:{distribution:zipfian...}}` */
 class ZipfianInt64Generator : public Generator<int64_t> {
 public:
-    /** @param node `{alpha:double, n:<int>}` */
+    /** @param node `{alpha:double, n:<int>, scrambled:opt bool}` */
     ZipfianInt64Generator(const Node& node, GeneratorArgs generatorArgs)
-        : _rng{generatorArgs.rng},
-          _id{generatorArgs.actorId},
-          _distribution{extract(node, "alpha", "zipfian").to<double>(),
-                        intGenerator(extract(node, "n", "zipfian"), generatorArgs)->evaluate()} {}
+        : ZipfianInt64Generator(
+              node,
+              generatorArgs,
+              extract(node, "alpha", "zipfian").to<double>(),
+              intGenerator(extract(node, "n", "zipfian"), generatorArgs)->evaluate()) {}
 
     int64_t evaluate() override {
-        return _distribution(_rng);
+        const auto rank = _distribution(_rng);
+        if (_scrambled) {
+            return 1 + (*_scrambled)(rank - 1);
+        }
+        return rank;
     }
 
 private:
-    ActorId _id;
+    ZipfianInt64Generator(const Node& node, GeneratorArgs generatorArgs, double alpha, int64_t n)
+        : _rng{generatorArgs.rng}, _id{generatorArgs.actorId}, _distribution{alpha, n} {
+        if (alpha < 0 || n < 1) {
+            std::stringstream msg;
+            msg << "Zipfian distribution needs alpha >= 0 and n >= 1 in " << node;
+            BOOST_THROW_EXCEPTION(InvalidValueGeneratorSyntax(msg.str()));
+        }
+        // Spread the most frequent values across [1, n] rather than clustering them at 1.
+        if (node["scrambled"].maybe<bool>().value_or(false)) {
+            _scrambled.emplace(n);
+        }
+    }
+
     DefaultRandom& _rng;
+    ActorId _id;
     zipfian_distribution<int64_t> _distribution;
+    std::optional<scrambled_permutation<int64_t>> _scrambled;
 };
 
+/**
+ * @param node `{from:[...], weights:opt [<int>...]}`
+ * @return a distribution of indexes into `from`, weighted by `weights` or else uniform.
+ *
+ * boost's discrete_distribution is a Walker alias table. Building one allocates and takes time
+ * linear in the number of choices, but drawing from it takes constant time, so build it once.
+ */
+boost::random::discrete_distribution<> weightedChoice(const Node& node, size_t choices) {
+    std::vector<int64_t> weights;
+    if (node["weights"]) {
+        for (const auto&& [k, v] : node["weights"]) {
+            weights.push_back(v.to<int64_t>());
+        }
+    } else {
+        // If not passed in, give each choice equal weight
+        weights.assign(choices, 1);
+    }
+    return boost::random::discrete_distribution<>(weights);
+}
+
 // This generator allows choosing any valid generator, incuding documents. As such it cannot be used
 // by JoinGenerator today. See ChooseStringGenerator.
 class ChooseGenerator : public Appendable {
@@ -571,10 +1154,7 @@ public:
             ++_elemNumber;
             return *_choices[_elemNumber % _choices.size()];
         }
-        // Pick a random number between 0 and sum(weights)
-        // Pick value based on that.
-        auto distribution = boost::random::discrete_distribution(_weights);
-        return (*_choices[distribution(_rng)]);
+        return (*_choices[_distribution(_rng)]);
     }
 
     void append(const std::string& key, bsoncxx::builder::basic::document& builder) override {
@@ -588,7 +1168,8 @@ protected:
     DefaultRandom& _rng;
     ActorId _id;
     std::vector<UniqueAppendable> _choices;
-    std::vector<int64_t> _weights;
+    // Picks an index into _choices with probability proportional to its weight.
+    boost::random::discrete_distribution<> _distribution;
     int32_t _elemNumber;
     bool _deterministic;
 };
@@ -612,14 +1193,7 @@ public:
         for (const auto&& [k, v] : node["from"]) {
             _choices.push_back(stringGenerator(v, generatorArgs));
         }
-        if (node["weights"]) {
-            for (const auto&& [k, v] : node["weights"]) {
-                _weights.push_back(v.to<int64_t>());
-            }
-        } else {
-            // If not passed in, give each choice equal weight
-            _weights.assign(_choices.size(), 1);
-        }
+        _distribution = weightedChoice(node, _choices.size());
         if (node["deterministic"]) {
             _deterministic = node["deterministic"].maybe<bool>().value_or(false);
         } else {
@@ -633,54 +1207,56 @@ public:
             ++_elemNumber;
             return (_choices[_elemNumber % _choices.size()]->evaluate());
         }
-        // Pick a random number between 0 and sum(weights)
-        // Pick value based on that.
-        auto distribution = boost::random::discrete_distribution(_weights);
-        return (_choices[distribution(_rng)]->evaluate());
+        return (_choices[_distribution(_rng)]->evaluate());
     };
 
 protected:
     DefaultRandom& _rng;
     ActorId _id;
     std::vector<UniqueGenerator<std::string>> _choices;
-    std::vector<int64_t> _weights;
+    // Picks an index into _choices with probability proportional to its weight.
+    boost::random::discrete_distribution<> _distribution;
     int32_t _elemNumber;
     bool _deterministic;
 };
 
+/**
+ * @return the {string, count} pairs under the `from` key of a FrequencyMap generator.
+ */
+v1::FrequencyMap parseFrequencyMap(const Node& node) {
+    if (!node["from"].isMap()) {
+        std::stringstream msg;
+        msg << "Malformed node for 'TakeRandomStringFromFrequencyMap' from a map " << node;
+        BOOST_THROW_EXCEPTION(InvalidValueGeneratorSyntax(msg.str()));
+    }
+
+    v1::FrequencyMap map;
+    for (const auto&& [k, v] : node["from"]) {
+        map.push_back(v.key(), v.to<std::size_t>());
+    }
+    return map;
+}
+
 /**
  * FrequencyMaps
  * A list of {string, count} pairs.
- * An item will be pulled from a random bucket and its count will be decremented. If all buckets are
- * empty, the generator throws an error.
+ * An item will be pulled from a random bucket, weighted by the counts remaining in each bucket, and
+ * its count will be decremented. If all buckets are empty, the generator throws an error.
  */
 class FrequencyMapGenerator : public Generator<std::string> {
 public:
-    FrequencyMapGenerator(const Node& node, GeneratorArgs generatorArgs) : _rng{generatorArgs.rng} {
-        if (!node["from"].isMap()) {
-            std::stringstream msg;
-            msg << "Malformed node for 'TakeRandomStringFromFrequencyMap' from a map " << node;
-            BOOST_THROW_EXCEPTION(InvalidValueGeneratorSyntax(msg.str()));
-        }
+    FrequencyMapGenerator(const Node& node, GeneratorArgs generatorArgs)
+        : _rng{generatorArgs.rng}, _map{parseFrequencyMap(node)} {}
 
-        for (const auto&& [k, v] : node["from"]) {
-            _map.push_back(v.key(), v.to<std::size_t>());
-        }
-    }
-
-    std::string evaluateWithRng(DefaultRandom& rng) {
-        if (_map.size() == 1) {
-            return _map.take(0);
+    std::string evaluate() override {
+        if (_map.total_count() == 0) {
+            throw std::range_error("Frequency map is empty");
         }
 
-        // Pick a random number between 0 and _map.size() inclusive
-        auto distribution = boost::random::uniform_int_distribution<size_t>(0, _map.size() - 1);
-        auto value = distribution(rng);
-        return _map.take(value);
-    }
-
-    std::string evaluate() override {
-        return evaluateWithRng(_rng);
+        // Pick one of the remaining instances, so each bucket is picked in proportion to its count.
+        auto distribution =
+            boost::random::uniform_int_distribution<uint64_t>(0, _map.total_count() - 1);
+        return _map.take(_map.find(distribution(_rng)));
     };
 
 private:
@@ -694,38 +1270,40 @@ private:
  * This can be used to ensure the distribution across threads matches exactly. This is important if
  * you want a single value for given thread, but use multiple threads to load the data. Maps are
  * identified by their "id" are shared.
+ *
+ * The registry is only locked while generators are constructed. Taking from a shared map is
+ * lock-free so that many loader threads can draw from the same map at once.
  */
 class FrequencyMapSingletonGenerator : public Generator<std::string> {
 public:
     FrequencyMapSingletonGenerator(const Node& node, GeneratorArgs generatorArgs)
         : _rng{generatorArgs.rng} {
-        _id = node["id"].maybe<std::string>().value();
+        auto id = node["id"].maybe<std::string>().value();
 
-        // Keep a singleton of these generators by id
-        {
-            std::lock_guard<std::mutex> lck(_mutex);
-
-            if (_generators.count(_id) == 0) {
-                FrequencyMapGenerator gen(node, generatorArgs);
-                _generators.insert({_id, gen});
-            }
+        // Keep a singleton of these maps by id
+        std::lock_guard<std::mutex> lck(_mutex);
+        auto& map = _maps[id];
+        if (!map) {
+            map = std::make_unique<v1::ConcurrentFrequencyMap>(parseFrequencyMap(node));
         }
+        _map = map.get();
     }
 
     std::string evaluate() override {
-        std::lock_guard<std::mutex> lck(_mutex);
-        return _generators.at(_id).evaluateWithRng(_rng);
+        return _map->take(_rng);
     };
 
 private:
-    std::string _id;
     DefaultRandom& _rng;
+    // Owned by _maps, which is never erased from.
+    v1::ConcurrentFrequencyMap* _map;
 
-    static std::unordered_map<std::string, FrequencyMapGenerator> _generators;
+    static std::unordered_map<std::string, std::unique_ptr<v1::ConcurrentFrequencyMap>> _maps;
     static std::mutex _mutex;
 };
 
-std::unordered_map<std::string, FrequencyMapGenerator> FrequencyMapSingletonGenerator::_generators;
+std::unordered_map<std::string, std::unique_ptr<v1::ConcurrentFrequencyMap>>
+    FrequencyMapSingletonGenerator::_maps;
 std::mutex FrequencyMapSingletonGenerator::_mutex;
 
 class IPGenerator : public Generator<std::string> {
@@ -1068,6 +1646,10 @@ public:
         return bsoncxx::types::b_binary{sub_type, 16, hex2BinUuid(hex, uuid)};
     }
 
+    std::optional<size_t> fixedLength() override {
+        return 16;
+    }
+
 private:
     DefaultRandom& _rng;
     const Node& _node;
@@ -1091,6 +1673,13 @@ public:
         }
     }
 
+    std::optional<size_t> fixedLength() override {
+        if (auto length = dynamic_cast<ConstantAppender<int64_t>*>(_lengthGen.get())) {
+            return std::max<int64_t>(length->evaluate(), 0);
+        }
+        return std::nullopt;
+    }
+
 protected:
     DefaultRandom& _rng;
     ActorId _id;
@@ -1258,16 +1847,20 @@ public:
         : StringGenerator(node, generatorArgs) {}
 
     std::string evaluate() override {
+        std::string str;
+        evaluateInto(str);
+        return str;
+    }
+
+    void evaluateInto(std::string& str) override {
         auto distribution = boost::random::uniform_int_distribution<size_t>{0, _alphabetLength - 1};
 
         auto length = _lengthGen->evaluate();
-        std::string str(length, '\0');
+        str.resize(length);
 
         for (int i = 0; i < length; ++i) {
             str[i] = _alphabet[distribution(_rng)];
         }
-
-        return str;
     }
 };
 
@@ -1279,8 +1872,14 @@ public:
         : StringGenerator(node, generatorArgs) {}
 
     std::string evaluate() override {
+        std::string str;
+        evaluateInto(str);
+        return str;
+    }
+
+    void evaluateInto(std::string& str) override {
         auto length = _lengthGen->evaluate();
-        std::string str(length, '\0');
+        str.resize(length);
 
         auto randomValue = _rng();
         int bits = 64;
@@ -1295,7 +1894,6 @@ public:
             randomValue >>= 6;
             bits -= 6;
         }
-        return str;
     }
 };
 
@@ -1586,6 +2184,10 @@ public:
         return _binData;
     }
 
+    std::optional<size_t> fixedLength() override {
+        return _binData.size;
+    }
+
     bsoncxx::types::b_binary genRandBinData(const Node& node, const bintype binDataType) {
         int64_t numBytes = node["numBytes"].maybe<int64_t>().value_or(32);
         uint8_t bytesArr[numBytes];
@@ -2047,6 +2649,14 @@ public:
         return builder.extract();
     }
 
+    void lower(const std::string& key, Program& program) override {
+        Program body;
+        for (size_t i = 0; i < _values.size(); ++i) {
+            _values[i]->lower(std::to_string(i), body);
+        }
+        program.embed(key, bsoncxx::type::k_array, body);
+    }
+
 private:
     const ValueType _values;
 };
@@ -2625,14 +3235,7 @@ ChooseGenerator::ChooseGenerator(const Node& node, GeneratorArgs generatorArgs)
     for (const auto&& [k, v] : node["from"]) {
         _choices.push_back(valueGenerator<false, UniqueAppendable>(v, generatorArgs, allParsers));
     }
-    if (node["weights"]) {
-        for (const auto&& [k, v] : node["weights"]) {
-            _weights.push_back(v.to<int64_t>());
-        }
-    } else {
-        // If not passed in, give each choice equal weight
-        _weights.assign(_choices.size(), 1);
-    }
+    _distribution = weightedChoice(node, _choices.size());
     if (node["deterministic"]) {
         _deterministic = node["deterministic"].maybe<bool>().value_or(false);
     } else {
@@ -2751,7 +3354,9 @@ UniqueGenerator<int64_t> dateGenerator(const Node& node,
 
 // Kick the recursion into motion
 DocumentGenerator::DocumentGenerator(const Node& node, GeneratorArgs generatorArgs)
-    : _impl{documentGenerator<false>(node, generatorArgs)} {}
+    : _impl{documentGenerator<false>(node, generatorArgs)} {
+    _impl->compile();
+}
 DocumentGenerator::DocumentGenerator(const Node& node, PhaseContext& phaseContext, ActorId actorId)
     : DocumentGenerator{node, GeneratorArgs{phaseContext.rng(actorId), actorId}} {}
 DocumentGenerator::DocumentGenerator(const Node& node, ActorContext& actorContext, ActorId actorId)
@@ -2764,13 +3369,17 @@ DocumentGenerator::~DocumentGenerator() = default;
 
 // Can't define this before DocumentGenerator::Impl ↑
 bsoncxx::document::value DocumentGenerator::operator()() {
-    return _impl->evaluate();
+    return _impl->run();
 }
 
 bsoncxx::document::value DocumentGenerator::evaluate() {
     return operator()();
 }
 
+bsoncxx::document::value DocumentGenerator::evaluateTree() {
+    return _impl->evaluate();
+}
+
 namespace genny {
 // template <class T>
 // TypeGenerator<T>::TypeGenerator(const Node& node, GeneratorArgs generatorArgs) {}
@@ -0,0 +1,87 @@
+// Copyright 2023-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <gennylib/Node.hpp>
+
+#include <testlib/distributions.hpp>
+#include <testlib/helpers.hpp>
+
+#include <value_generators/DefaultRandom.hpp>
+#include <value_generators/DocumentGenerator.hpp>
+
+namespace genny {
+namespace {
+
+/**
+ * @return `count` values of the field `a` from the template `{a: <value>}`.
+ */
+template <typename T>
+std::vector<T> sample(const std::string& value, int count, DefaultRandom::result_type seed) {
+    NodeSource ns{"a: " + value, ""};
+    DefaultRandom rng{seed};
+    DocumentGenerator docGen{ns.root(), GeneratorArgs{rng, 1}};
+
+    std::vector<T> out;
+    out.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        auto doc = docGen();
+        if constexpr (std::is_same_v<T, std::string>) {
+            out.push_back(doc.view()["a"].get_string().value.to_string());
+        } else {
+            out.push_back(doc.view()["a"].get_int32().value);
+        }
+    }
+    return out;
+}
+
+TEST_CASE("Weighted choice") {
+    SECTION("^Choose draws values in proportion to their weights") {
+        // 1000 choices weighted 1, 2, ..., 1000.
+        std::stringstream from;
+        std::stringstream weights;
+        std::map<int32_t, double> pmf;
+        for (int32_t i = 1; i <= 1000; ++i) {
+            from << (i == 1 ? "" : ", ") << i;
+            weights << (i == 1 ? "" : ", ") << i;
+            pmf.emplace(i, i / 500500.0);
+        }
+        const auto value =
+            "{^Choose: {from: [" + from.str() + "], weights: [" + weights.str() + "]}}";
+        testing::requireDistribution(sample<int32_t>(value, 200000, 1234), pmf);
+    }
+
+    SECTION("^Choose without weights is uniform") {
+        std::map<int32_t, double> pmf;
+        for (int32_t i = 1; i <= 5; ++i) {
+            pmf.emplace(i, 0.2);
+        }
+        testing::requireDistribution(
+            sample<int32_t>("{^Choose: {from: [1, 2, 3, 4, 5]}}", 10000, 1234), pmf);
+    }
+
+    SECTION("^Choose of strings draws values in proportion to their weights") {
+        const auto value = "{^Join: {array: [{^Choose: {from: [a, b, c], weights: [1, 2, 7]}}]}}";
+        testing::requireDistribution(
+            sample<std::string>(value, 10000, 1234),
+            std::map<std::string, double>{{"a", 0.1}, {"b", 0.2}, {"c", 0.7}});
+    }
+}
+
+}  // namespace
+}  // namespace genny
@@ -1,5 +1,6 @@
 #include <iostream>
 #include <memory>
+#include <optional>
 #include <string>
 
 #include <bsoncxx/json.hpp>
@@ -22,7 +23,8 @@ public:
           _givenTemplate{node["GivenTemplate"]},
           _thenReturns{node["ThenReturns"]},
           _thenExecuteAndIgnore{node["ThenExecuteAndIgnore"]},
-          _expectedExceptionMessage{node["ThenThrows"]} {
+          _expectedExceptionMessage{node["ThenThrows"]},
+          _sharedState{node["SharedState"].as<bool>(false)} {
         if (!_givenTemplate) {
             std::stringstream msg;
             msg << "Need GivenTemplate in '" << toString(node) << "'";
@@ -95,9 +97,19 @@ public:
             auto docGen = genny::DocumentGenerator(ns.root(), GeneratorArgs{rng, 2});
             if (_runMode == RunMode::kIgnoreReturn)
                 return;
+            // The compiled program must match the generator tree byte for byte. Generators that
+            // share state across DocumentGenerators can't be replayed by a second one.
+            genny::DefaultRandom treeRng;
+            std::optional<genny::DocumentGenerator> treeGen;
+            if (!_sharedState) {
+                treeGen.emplace(ns.root(), GeneratorArgs{treeRng, 2});
+            }
             for (const auto&& nextValue : this->_thenReturns) {
                 auto expected = testing::toDocumentBson(nextValue);
                 auto actual = docGen();
+                if (treeGen) {
+                    REQUIRE(actual.view() == treeGen->evaluateTree().view());
+                }
                 // After implementing TIG-2839 uncomment the line below and remove the two lines
                 // underneath it as it is a workaround suggested in HELP-21664
                 // REQUIRE(toString(expected.view()) == toString(actual.view()));
@@ -130,6 +142,7 @@ private:
     YAML::Node _thenReturns;
     YAML::Node _thenExecuteAndIgnore;
     YAML::Node _expectedExceptionMessage;
+    bool _sharedState = false;
 };
 
 }  // namespace genny
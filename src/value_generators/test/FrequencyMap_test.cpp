@@ -15,9 +15,13 @@
 
 #include <algorithm>
 #include <iostream>
+#include <map>
+#include <thread>
+#include <vector>
 
 #include <catch2/catch_all.hpp>
 
+#include <value_generators/DefaultRandom.hpp>
 #include <value_generators/FrequencyMap.hpp>
 
 namespace genny {
@@ -61,6 +65,69 @@ TEST_CASE("genny frequencyMap") {
 
         REQUIRE(map.size() == 2);
         REQUIRE(map.total_count() == 6);
+
+        // Exhausted items keep their index
+        REQUIRE_THROWS_AS(map.take(1), std::range_error);
+        REQUIRE(map.take(2) == "c");
+    }
+
+    SECTION("Find") {
+        v1::FrequencyMap map;
+        map.push_back("a", 2);
+        map.push_back("b", 0);
+        map.push_back("c", 3);
+
+        REQUIRE(map.size() == 2);
+        REQUIRE(map.find(0) == 0);
+        REQUIRE(map.find(1) == 0);
+        REQUIRE(map.find(2) == 2);
+        REQUIRE(map.find(4) == 2);
+        REQUIRE_THROWS_AS(map.find(5), std::range_error);
+
+        map.take(0);
+        REQUIRE(map.find(0) == 0);
+        REQUIRE(map.find(1) == 2);
+        REQUIRE_THROWS_AS(map.find(4), std::range_error);
+    }
+
+    SECTION("Concurrent takes hand out exactly the counts") {
+        v1::FrequencyMap map;
+        for (size_t i = 0; i < 1000; ++i) {
+            map.push_back(std::to_string(i), i % 7 + 1);
+        }
+        v1::ConcurrentFrequencyMap shared(map);
+
+        std::vector<std::map<std::string, size_t>> taken(8);
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < taken.size(); ++t) {
+            threads.emplace_back([&, t]() {
+                DefaultRandom rng{t};
+                for (;;) {
+                    try {
+                        ++taken[t][shared.take(rng)];
+                    } catch (const std::range_error&) {
+                        return;
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        std::map<std::string, size_t> total;
+        for (const auto& counts : taken) {
+            for (const auto& [name, count] : counts) {
+                total[name] += count;
+            }
+        }
+        REQUIRE(total.size() == 1000);
+        bool exact = true;
+        for (size_t i = 0; i < 1000; ++i) {
+            exact = exact && total[std::to_string(i)] == i % 7 + 1;
+        }
+        REQUIRE(exact);
+        REQUIRE(shared.total_count() == 0);
     }
 }
 
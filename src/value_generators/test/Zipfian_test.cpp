@@ -0,0 +1,119 @@
+// Copyright 2023-present MongoDB Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <sstream>
+#include <vector>
+
+#include <gennylib/Node.hpp>
+
+#include <testlib/distributions.hpp>
+#include <testlib/helpers.hpp>
+
+#include <value_generators/DefaultRandom.hpp>
+#include <value_generators/DocumentGenerator.hpp>
+
+namespace genny {
+namespace {
+
+std::vector<int64_t> sample(const std::string& args, int count, DefaultRandom::result_type seed) {
+    std::stringstream yaml;
+    yaml << "a: {^RandomInt: {distribution: zipfian, " << args << "}}";
+    NodeSource ns{yaml.str(), ""};
+    DefaultRandom rng{seed};
+    DocumentGenerator docGen{ns.root(), GeneratorArgs{rng, 1}};
+
+    std::vector<int64_t> out;
+    out.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        out.push_back(docGen().view()["a"].get_int64().value);
+    }
+    return out;
+}
+
+/**
+ * Chi-squared test of `samples` against the zipfian pmf.
+ */
+void requireZipfian(const std::vector<int64_t>& samples, double alpha, int64_t n) {
+    const auto [min, max] = std::minmax_element(samples.begin(), samples.end());
+    REQUIRE(*min >= 1);
+    REQUIRE(*max <= n);
+
+    double normalization = 0;
+    for (int64_t k = 1; k <= n; ++k) {
+        normalization += std::pow(k, -alpha);
+    }
+    std::map<int64_t, double> pmf;
+    for (int64_t k = 1; k <= n; ++k) {
+        pmf.emplace(k, std::pow(k, -alpha) / normalization);
+    }
+
+    INFO("alpha=" << alpha << " n=" << n);
+    testing::requireDistribution(samples, pmf);
+}
+
+TEST_CASE("Zipfian distribution") {
+    SECTION("Matches its pmf") {
+        for (double alpha : {0.0, 0.5, 0.99, 1.0, 2.0}) {
+            requireZipfian(sample("alpha: " + std::to_string(alpha) + ", n: 1000", 200000, 1234),
+                           alpha,
+                           1000);
+        }
+    }
+
+    SECTION("Doesn't depend on n being small") {
+        // With n = 10^10 and alpha = 1, P(1) = 1/H(n) ~= 0.0424.
+        const auto samples = sample("alpha: 1.0, n: 10000000000", 100000, 1234);
+        const double p = 1 / (std::log(1e10) + 0.5772156649);
+        const double ones = std::count(samples.begin(), samples.end(), 1);
+        const double sigma = std::sqrt(samples.size() * p * (1 - p));
+        REQUIRE(std::abs(ones - samples.size() * p) < 5 * sigma);
+        const auto [min, max] = std::minmax_element(samples.begin(), samples.end());
+        REQUIRE(*min >= 1);
+        REQUIRE(*max <= 10000000000);
+    }
+
+    SECTION("Scrambling permutes the values") {
+        const int64_t n = 1000;
+        const auto plain = sample("alpha: 1.0, n: 1000", 100000, 1234);
+        const auto scrambled = sample("alpha: 1.0, n: 1000, scrambled: true", 100000, 1234);
+
+        const auto [min, max] = std::minmax_element(scrambled.begin(), scrambled.end());
+        REQUIRE(*min >= 1);
+        REQUIRE(*max <= n);
+
+        // Each value always maps to the same scrambled value, and no two values share one.
+        std::map<int64_t, int64_t> forward;
+        std::map<int64_t, int64_t> backward;
+        bool consistent = true;
+        for (size_t i = 0; i < plain.size(); ++i) {
+            consistent = consistent &&
+                forward.emplace(plain[i], scrambled[i]).first->second == scrambled[i] &&
+                backward.emplace(scrambled[i], plain[i]).first->second == plain[i];
+        }
+        REQUIRE(consistent);
+
+        // The most frequent values aren't all at the low end.
+        int64_t highest = 0;
+        for (int64_t k = 1; k <= 10; ++k) {
+            highest = std::max(highest, forward.at(k));
+        }
+        REQUIRE(highest > n / 10);
+    }
+}
+
+}  // namespace
+}  // namespace genny